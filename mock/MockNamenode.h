@@ -83,6 +83,7 @@ public:
     MOCK_METHOD2(recoverLease, bool(const std::string & src,
                            const std::string & clientName));
     MOCK_METHOD0(getFsStats, std::vector<int64_t>());
+    MOCK_METHOD0(msync, void());
     MOCK_METHOD1(metaSave, void(
           const std::string & filename));
     MOCK_METHOD2(getFileInfo, FileStatus(const std::string & src, bool *exist));
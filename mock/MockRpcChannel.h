@@ -36,11 +36,12 @@ namespace Mock {
 
 class MockRpcChannel: public Hdfs::Internal::RpcChannel {
 public:
-	MOCK_METHOD0(close, void());
+	MOCK_METHOD1(close, void(bool));
 	MOCK_METHOD1(invoke, void(const Hdfs::Internal::RpcCall &));
 	MOCK_METHOD0(checkIdle, bool());
 	MOCK_METHOD0(waitForExit, void());
 	MOCK_METHOD0(addRef, void());
+	MOCK_METHOD0(getRefCount, int());
 };
 
 }
@@ -41,7 +41,7 @@ public:
 			RpcRemoteCall(c, id, clientId) {
 	}
 
-	MOCK_METHOD2(serialize, void(const RpcProtocolInfo&, WriteBuffer &));
+	MOCK_METHOD3(serialize, void(const RpcProtocolInfo&, WriteBuffer &, RpcRequestHeaders &));
 	MOCK_METHOD1(cancel, void(exception_ptr ));
 
 };
@@ -1,6 +1,12 @@
 #include <Python.h>
 #include <memoryobject.h>
+#include <structmember.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
 #include <unistd.h>
 
 #include "../src/client/hdfs.h"
@@ -12,17 +18,46 @@ static const char fileinfo_capsule_name[] = "hdfs3py.hdfsFileInfo";
 static const char fs_capsule_name[] = "hdfs3py.hdfsFS";
 
 static PyObject *
-hdfs_err() {
+hdfs_raise(const char *msg) {
   PyObject *type = PyErr_NewException("hdfs3py.error", NULL, NULL);
-  const char *msg = hdfsGetLastError();
   PyErr_SetString(type, msg);
   return NULL;
-}  
+}
+
+static PyObject *
+hdfs_err() {
+  return hdfs_raise(hdfsGetLastError());
+}
+
+/*
+ * Calls into libhdfs3 may wait on the network for seconds, so they run
+ * with the GIL released and other Python threads keep going.  The
+ * message of hdfsGetLastError() is thread local; when the call failed it
+ * is copied into errmsg before the GIL is taken back, and later raised
+ * with hdfs_raise().
+ */
+typedef char hdfs_errmsg[1024];
+
+static void
+save_err( hdfs_errmsg errmsg ) {
+  strncpy(errmsg, hdfsGetLastError(), sizeof(hdfs_errmsg) - 1);
+  errmsg[sizeof(hdfs_errmsg) - 1] = '\0';
+}
+
+#define HDFS_NOGIL(call, failed, errmsg)	\
+  do {						\
+    Py_BEGIN_ALLOW_THREADS			\
+    call;					\
+    if( failed ) {				\
+      save_err(errmsg);				\
+    }						\
+    Py_END_ALLOW_THREADS			\
+  } while(0)
 
 static const char getLastError_doc[] =
   "Return error information of last failed operation";
 static PyObject *
-getLastError() {
+getLastError(PyObject *self, PyObject *unused) {
   return PyUnicode_FromString(hdfsGetLastError());
 }
 
@@ -33,7 +68,7 @@ extract_fs( PyObject * fs_capsule, void *pout ) {
     hdfs_err();
     return 0;
   }
-  *pfs = *(hdfsFS*)pout;
+  *pfs = (hdfsFS)pout;
   return 1;
 }
 
@@ -44,14 +79,14 @@ extract_file( PyObject * file_capsule, void *pout ) {
     hdfs_err();
     return 0;
   }
-  *pfile = *(hdfsFile*)pout;
+  *pfile = (hdfsFile)pout;
   return 1;
 }
 
 static const char fileIsOpenForRead_doc[] = 
   "Determine if a file is open for read";
 static PyObject *
-fileIsOpenForRead(PyObject * args) {
+fileIsOpenForRead(PyObject *self, PyObject * args) {
   hdfsFile file;
   if( !PyArg_ParseTuple(args, "O&", extract_file, &file) ) {
     return NULL;
@@ -64,7 +99,7 @@ fileIsOpenForRead(PyObject * args) {
 static const char fileIsOpenForWrite_doc[] = 
   "Determine if a file is open for write";
 static PyObject *
-fileIsOpenForWrite(PyObject * args) {
+fileIsOpenForWrite(PyObject *self, PyObject * args) {
   hdfsFile file;
   if( !PyArg_ParseTuple(args, "O&", extract_file, &file) ) {
     return NULL;
@@ -78,37 +113,34 @@ static const char connect_doc[] =
   "Connect to an hdfs file system, as current or other user, "
   "with or without a new instance";
 static PyObject *
-connect(PyObject * args, PyObject *keywords) {
-  static char *okwords[] = { "user", "new_instance" };
+connect(PyObject *self, PyObject * args, PyObject *keywords) {
+  static char *okwords[] = { "nn", "port", "user", "new_instance", NULL };
   const char *nn, *user = NULL;
   tPort port;
-  bool is_new_instance = false;
+  int is_new_instance = false;
   hdfsFS fs;
   PyObject* fs_capsule;
+  hdfs_errmsg errmsg;
 
-  if( !PyArg_ParseTupleAndKeywords(args, keywords, "sh$zp", okwords, 
+  if( !PyArg_ParseTupleAndKeywords(args, keywords, "sH|$zp", okwords, 
 				   &nn, &port, &user, &is_new_instance) ) {
     return NULL;
   }
 
+  Py_BEGIN_ALLOW_THREADS
   if( is_new_instance ) {
-    if( user ) {
-      if( (fs = hdfsConnectAsUserNewInstance(nn, port, user)) == NULL ) {
-	return hdfs_err();
-      }
-    }
-    if( (fs = hdfsConnectNewInstance(nn, port)) == NULL ) {
-      return hdfs_err();
-    }
+    fs = user? hdfsConnectAsUserNewInstance(nn, port, user) 
+             : hdfsConnectNewInstance(nn, port);
   } else {
-    if( user ) {
-      if( (fs = hdfsConnectAsUser(nn, port, user)) == NULL ) {
-	return hdfs_err();
-      }
-    }
-    if( (fs = hdfsConnect(nn, port)) == NULL ) {
-      return hdfs_err();
-    }
+    fs = user? hdfsConnectAsUser(nn, port, user) : hdfsConnect(nn, port);
+  }
+  if( fs == NULL ) {
+    save_err(errmsg);
+  }
+  Py_END_ALLOW_THREADS
+
+  if( fs == NULL ) {
+    return hdfs_raise(errmsg);
   }
 
   if( (fs_capsule = PyCapsule_New(fs, fs_capsule_name, NULL)) == NULL ) {
@@ -120,13 +152,16 @@ connect(PyObject * args, PyObject *keywords) {
 static const char disconnect_doc[] = 
   "Disconnect from the hdfs file system";
 static PyObject *
-disconnect(PyObject * args) {
+disconnect(PyObject *self, PyObject * args) {
   hdfsFS fs;
+  int erc;
+  hdfs_errmsg errmsg;
   if( !PyArg_ParseTuple(args, "O&", extract_fs, &fs) ) {
     return NULL;
   }
-  if( 0 != hdfsDisconnect(fs) ) {
-    return hdfs_err();
+  HDFS_NOGIL(erc = hdfsDisconnect(fs), erc != 0, errmsg);
+  if( erc != 0 ) {
+    return hdfs_raise(errmsg);
   }
   Py_RETURN_TRUE;
 }
@@ -138,23 +173,25 @@ extract_bld( PyObject * bld_capsule, void *pout ) {
     hdfs_err();
     return 0;
   }
-  *pbld = *(struct hdfsBuilder **)pout;
+  *pbld = (struct hdfsBuilder *)pout;
   return 1;
 }
 
 static const char builderConnect_doc[] = 
   "Connect to HDFS using the parameters defined by the builder";
 static PyObject *
-builderConnect(PyObject * args) {
+builderConnect(PyObject *self, PyObject * args) {
   hdfsFS fs;
   PyObject * fs_capsule;
   struct hdfsBuilder * bld;
+  hdfs_errmsg errmsg;
   if( !PyArg_ParseTuple(args, "O&", extract_bld, &bld) ) {
     return NULL;
   }
 
-  if( (fs = hdfsBuilderConnect(bld)) == NULL ) {
-    return hdfs_err();
+  HDFS_NOGIL(fs = hdfsBuilderConnect(bld), fs == NULL, errmsg);
+  if( fs == NULL ) {
+    return hdfs_raise(errmsg);
   }
   if( (fs_capsule = PyCapsule_New(fs, fs_capsule_name, NULL)) == NULL ) {
     return NULL;
@@ -164,7 +201,7 @@ builderConnect(PyObject * args) {
 
 static const char newBuilder_doc[] = "Create an HDFS builder";
 PyObject *
-newBuilder(void) {
+newBuilder(PyObject *self, PyObject *unused) {
   PyObject* bld_capsule;
   struct hdfsBuilder * bld;
   if( (bld = hdfsNewBuilder()) == NULL ) {
@@ -185,7 +222,7 @@ newBuilder(void) {
 static const char builderSetNameNode_doc[] = 
   "Set the HDFS NameNode to connect to";
 PyObject *
-builderSetNameNode(PyObject * args) {
+builderSetNameNode(PyObject *self, PyObject * args) {
   struct hdfsBuilder * bld;
   const char * nn;
   if( !PyArg_ParseTuple(args, "O&s", extract_bld, &bld, &nn) ) {
@@ -198,7 +235,7 @@ builderSetNameNode(PyObject * args) {
 static const char builderSetNameNodePort_doc[] = 
   "Set the port of the HDFS NameNode to connect to.";
 PyObject *
-builderSetNameNodePort(PyObject * args ) {
+builderSetNameNodePort(PyObject *self, PyObject * args) {
   struct hdfsBuilder * bld;
   tPort port;
   if( !PyArg_ParseTuple(args, "O&h", extract_bld, &bld, &port) ) {
@@ -211,7 +248,7 @@ builderSetNameNodePort(PyObject * args ) {
 static const char builderSetUserName_doc[] = 
   "Set the username to use when connecting to the HDFS cluster.";
 static PyObject *
-builderSetUserName(PyObject * args) {
+builderSetUserName(PyObject *self, PyObject * args) {
   struct hdfsBuilder * bld;
   const char * name;
   if( !PyArg_ParseTuple(args, "O&s", extract_bld, &bld, &name) ) {
@@ -224,7 +261,7 @@ builderSetUserName(PyObject * args) {
 static const char builderSetKerbTicketCachePath_doc[] = 
   "Set the path to the Kerberos ticket cache to use when connecting to";
 static PyObject *
-builderSetKerbTicketCachePath(PyObject * args) {
+builderSetKerbTicketCachePath(PyObject *self, PyObject * args) {
   struct hdfsBuilder * bld;
   const char * name;
   if( !PyArg_ParseTuple(args, "O&s", extract_bld, &bld, &name) ) {
@@ -237,7 +274,7 @@ builderSetKerbTicketCachePath(PyObject * args) {
 static const char builderSetToken_doc[] = 
  "Set the token used to authenticate";
 static PyObject *
-builderSetToken(PyObject * args) {
+builderSetToken(PyObject *self, PyObject * args) {
   struct hdfsBuilder * bld;
   const char * token;
   if( !PyArg_ParseTuple(args, "O&s", extract_bld, &bld, &token) ) {
@@ -249,7 +286,7 @@ builderSetToken(PyObject * args) {
 
 static const char freeBuilder_doc[] = "Free an HDFS builder.";
 static PyObject *
-freeBuilder(PyObject * args) {
+freeBuilder(PyObject *self, PyObject * args) {
   struct hdfsBuilder * bld;
   if( !PyArg_ParseTuple(args, "O&", extract_bld, &bld) ) {
     return NULL;
@@ -261,7 +298,7 @@ freeBuilder(PyObject * args) {
 static const char builderConfSetStr_doc[] = 
   "Set a configuration string for an HdfsBuilder.";
 static PyObject *
-builderConfSetStr(PyObject * args) {
+builderConfSetStr(PyObject *self, PyObject * args) {
   struct hdfsBuilder * bld;
   const char * key;
   const char * val;
@@ -277,7 +314,7 @@ builderConfSetStr(PyObject * args) {
 
 static const char confGetStr_doc[] = "Get a configuration string.";
 static PyObject *
-confGetStr(PyObject * args) {
+confGetStr(PyObject *self, PyObject * args) {
   const char * key;
   char * val;
   int erc;
@@ -292,7 +329,7 @@ confGetStr(PyObject * args) {
 
 static const char confGetInt_doc[] = "Get a configuration integer";
 static PyObject *
-confGetInt(PyObject * args) {
+confGetInt(PyObject *self, PyObject * args) {
   const char * key;
   int32_t val;
   int erc;
@@ -308,7 +345,7 @@ confGetInt(PyObject * args) {
 static const char confStrFree_doc[] = 
   "Free a configuration string found with hdfsConfGetStr";
 static PyObject *
-confStrFree(PyObject * args) {
+confStrFree(PyObject *self, PyObject * args) {
   char * key;
   if( !PyArg_ParseTuple(args, "s", &key) ) {
     return NULL;
@@ -319,7 +356,7 @@ confStrFree(PyObject * args) {
 
 static const char openFile_doc[] = "Open a hdfs file in given mode";
 static PyObject *
-openFile(PyObject * args) {
+openFile(PyObject *self, PyObject * args) {
   hdfsFS fs;
   hdfsFile file;
   const char * path;
@@ -327,33 +364,38 @@ openFile(PyObject * args) {
   int bufferSize;
   short replication;
   tOffset blocksize;
-  PyObject * fs_capsule;
+  PyObject * file_capsule;
+  hdfs_errmsg errmsg;
 
   if( !PyArg_ParseTuple(args, "O&siihl", extract_fs, &fs, &path, 
 			&flags, &bufferSize, &replication, &blocksize) ) {
     return NULL;
   }
-  if( (file = hdfsOpenFile(fs, path, flags, bufferSize, 
-			   replication, blocksize)) == NULL ) {
-    return hdfs_err();
+  HDFS_NOGIL(file = hdfsOpenFile(fs, path, flags, bufferSize, 
+				 replication, blocksize), 
+	     file == NULL, errmsg);
+  if( file == NULL ) {
+    return hdfs_raise(errmsg);
   }
-  if( (fs_capsule = PyCapsule_New(fs, fs_capsule_name, NULL)) == NULL ) {
+  if( (file_capsule = PyCapsule_New(file, file_capsule_name, NULL)) == NULL ) {
     return NULL;
   }
-  return fs_capsule;  
+  return file_capsule;  
 }
 
 static const char closeFile_doc[] = "Close an open file";
 static PyObject *
-closeFile(PyObject * args) {
+closeFile(PyObject *self, PyObject * args) {
   hdfsFS fs;
   hdfsFile file;
   int erc;
+  hdfs_errmsg errmsg;
   if( !PyArg_ParseTuple(args, "O&O&", extract_fs, &fs, extract_file, &file) ) {
     return NULL;
   }
-  if( (erc = hdfsCloseFile(fs, file)) != 0 ) {
-    return hdfs_err();
+  HDFS_NOGIL(erc = hdfsCloseFile(fs, file), erc != 0, errmsg);
+  if( erc != 0 ) {
+    return hdfs_raise(errmsg);
   }
   Py_RETURN_TRUE;
 }
@@ -361,40 +403,44 @@ closeFile(PyObject * args) {
 static const char exists_doc[] = 
   "Checks if a given path exsits on the filesystem";
 static PyObject *
-exists(PyObject * args) {
+exists(PyObject *self, PyObject * args) {
   hdfsFS fs;
   const char *name;
   int erc;
+  hdfs_errmsg errmsg;
   if( !PyArg_ParseTuple(args, "O&s", extract_fs, &fs, &name) ) {
     return NULL;
   }
-  if( (erc = hdfsExists(fs, name)) != 0 ) {
-    return hdfs_err();
+  HDFS_NOGIL(erc = hdfsExists(fs, name), erc != 0, errmsg);
+  if( erc != 0 ) {
+    return hdfs_raise(errmsg);
   }
   Py_RETURN_TRUE;
 }
 
 static const char seek_doc[] = "Seek to given offset in file";
 static PyObject *
-hdfs_seek(PyObject * args) {
+hdfs_seek(PyObject *self, PyObject * args) {
   hdfsFS fs;
   hdfsFile file;
   tOffset pos;
   int erc;
+  hdfs_errmsg errmsg;
   if( !PyArg_ParseTuple(args, "O&O&l", 
 			extract_fs, &fs, extract_file, &file, &pos) ) {
     return NULL;
   }
 
- if( (erc = hdfsSeek(fs, file, pos)) != 0 ) {
-    return hdfs_err();
+  HDFS_NOGIL(erc = hdfsSeek(fs, file, pos), erc != 0, errmsg);
+  if( erc != 0 ) {
+    return hdfs_raise(errmsg);
   }
   Py_RETURN_TRUE;
 }
 
 static const char tell_doc[] = "Get the current offset in the file, in bytes";
 static PyObject *
-hdfs_tell(PyObject * args) {
+hdfs_tell(PyObject *self, PyObject * args) {
   hdfsFS fs;
   hdfsFile file;
   tOffset pos;
@@ -410,12 +456,13 @@ hdfs_tell(PyObject * args) {
 
 static const char read_doc[] = "Read data from an open file";
 static PyObject *
-hdfs_read(PyObject * args) {
+hdfs_read(PyObject *self, PyObject * args) {
   hdfsFS fs;
   hdfsFile file;
   PyObject *buffer;
   tSize len;
-  if( !PyArg_ParseTuple(args, "O&O&l", extract_fs, &fs, 
+  hdfs_errmsg errmsg;
+  if( !PyArg_ParseTuple(args, "O&O&i", extract_fs, &fs, 
 			               extract_file, &file, &len) ) {
     return NULL;
   }
@@ -424,42 +471,96 @@ hdfs_read(PyObject * args) {
     return NULL;
   }
 
-  if( (len = hdfsRead(fs, file, PyBytes_AS_STRING(buffer), len)) == -1 ) {
+  /* the new bytes object is not visible to other threads yet */
+  HDFS_NOGIL(len = hdfsRead(fs, file, PyBytes_AS_STRING(buffer), len), 
+	     len == -1, errmsg);
+  if( len == -1 ) {
     Py_DECREF(buffer);
-    return hdfs_err();
+    return hdfs_raise(errmsg);
+  }
+  if( len < PyBytes_GET_SIZE(buffer) && _PyBytes_Resize(&buffer, len) != 0 ) {
+    return NULL;
   }
   return buffer;
 }
 
-static const char write_doc[] = "Write data into an open file";
+static const char readinto_doc[] = 
+  "Read data from an open file into a writable buffer";
 static PyObject *
-hdfs_write(PyObject * args) {
+hdfs_readinto(PyObject *self, PyObject * args) {
   hdfsFS fs;
   hdfsFile file;
-  PyObject *buffer;
+  Py_buffer view;
   tSize len;
-  if( !PyArg_ParseTuple(args, "O&O&Ol", extract_fs, &fs, extract_fs, &file, 
-			&buffer, &len) ) {
+  hdfs_errmsg errmsg;
+  if( !PyArg_ParseTuple(args, "O&O&w*", extract_fs, &fs, 
+			extract_file, &file, &view) ) {
     return NULL;
   }
 
- if( (len = hdfsWrite(fs, file, PyBytes_AsString(buffer), len)) == -1 ) {
-    return hdfs_err();
+  /* like read(2) a large buffer may be filled only partially */
+  len = view.len < INT32_MAX? (tSize)view.len : INT32_MAX;
+  if( len > 0 ) {
+    /* the export keeps the buffer from being resized or freed */
+    HDFS_NOGIL(len = hdfsRead(fs, file, view.buf, len), len == -1, errmsg);
+  }
+  PyBuffer_Release(&view);
+  if( len == -1 ) {
+    return hdfs_raise(errmsg);
   }
   return PyLong_FromLong(len);
 }
 
+static const char write_doc[] = 
+  "Write data from any contiguous buffer into an open file";
+static PyObject *
+hdfs_write(PyObject *self, PyObject * args) {
+  hdfsFS fs;
+  hdfsFile file;
+  Py_buffer view;
+  Py_ssize_t len = -1, done = 0;
+  hdfs_errmsg errmsg;
+  if( !PyArg_ParseTuple(args, "O&O&y*|n", extract_fs, &fs, 
+			extract_file, &file, &view, &len) ) {
+    return NULL;
+  }
+
+  if( len < 0 || len > view.len ) {
+    len = view.len;
+  }
+
+  Py_BEGIN_ALLOW_THREADS
+  while( done < len ) {
+    tSize todo = len - done < INT32_MAX? (tSize)(len - done) : INT32_MAX;
+    tSize n = hdfsWrite(fs, file, (const char *)view.buf + done, todo);
+    if( n <= 0 ) {
+      save_err(errmsg);
+      break;
+    }
+    done += n;
+  }
+  Py_END_ALLOW_THREADS
+
+  PyBuffer_Release(&view);
+  if( done < len ) {
+    return hdfs_raise(errmsg);
+  }
+  return PyLong_FromSsize_t(done);
+}
+
 static const char flush_doc[] = "Flush the data";
 static PyObject *
-flush(PyObject * args) {
+flush(PyObject *self, PyObject * args) {
   hdfsFS fs;
   hdfsFile file;
   int erc;
+  hdfs_errmsg errmsg;
   if( !PyArg_ParseTuple(args, "O&O&", extract_fs, &fs, extract_file, &file) ) {
     return NULL;
   }
- if( (erc = hdfsFlush(fs, file)) == -1 ) {
-    return hdfs_err();
+  HDFS_NOGIL(erc = hdfsFlush(fs, file), erc == -1, errmsg);
+  if( erc == -1 ) {
+    return hdfs_raise(errmsg);
   }
   Py_RETURN_TRUE;
 }
@@ -467,15 +568,17 @@ flush(PyObject * args) {
 static const char hFlush_doc[] = 
   "Flush out the data in client's user buffer";
 static PyObject *
-hFlush(PyObject * args) {
+hFlush(PyObject *self, PyObject * args) {
   hdfsFS fs;
   hdfsFile file;
   int erc;
+  hdfs_errmsg errmsg;
   if( !PyArg_ParseTuple(args, "O&O&", extract_fs, &fs, extract_file, &file) ) {
     return NULL;
   }
- if( (erc = hdfsHFlush(fs, file)) == -1 ) {
-    return hdfs_err();
+  HDFS_NOGIL(erc = hdfsHFlush(fs, file), erc == -1, errmsg);
+  if( erc == -1 ) {
+    return hdfs_raise(errmsg);
   }
   Py_RETURN_TRUE;
 }
@@ -483,15 +586,17 @@ hFlush(PyObject * args) {
 static const char sync_doc[] = 
   "Flush out and sync the data in client's user buffer";
 static PyObject *
-hdfs_sync(PyObject * args) {
+hdfs_sync(PyObject *self, PyObject * args) {
   hdfsFS fs;
   hdfsFile file;
   int erc;
+  hdfs_errmsg errmsg;
   if( !PyArg_ParseTuple(args, "O&O&", extract_fs, &fs, extract_file, &file) ) {
     return NULL;
   }
- if( (erc = hdfsSync(fs, file)) != 0 ) {
-    return hdfs_err();
+  HDFS_NOGIL(erc = hdfsSync(fs, file), erc != 0, errmsg);
+  if( erc != 0 ) {
+    return hdfs_raise(errmsg);
   }
   Py_RETURN_TRUE;
 }
@@ -499,7 +604,7 @@ hdfs_sync(PyObject * args) {
 static const char available_doc[] = 
   "Number of bytes that can be read from this input stream without blocking";
 static PyObject *
-available(PyObject * args) {
+available(PyObject *self, PyObject * args) {
   hdfsFS fs;
   hdfsFile file;
   int len;
@@ -514,65 +619,73 @@ available(PyObject * args) {
 
 static const char copy_doc[] = "Copy file from one filesystem to another";
 static PyObject *
-copy(PyObject * args) {
+copy(PyObject *self, PyObject * args) {
   hdfsFS srcFS, dstFS;
   const char *src, *dst;
   int erc;
+  hdfs_errmsg errmsg;
   if( !PyArg_ParseTuple(args, "O&sO&s", 
 			extract_fs, &srcFS, &src, 
 			extract_fs, &dstFS, &dst) ) {
     return NULL;
   }
- if( (erc = hdfsCopy(srcFS, src, dstFS, dst)) == -1 ) {
-    return hdfs_err();
+  HDFS_NOGIL(erc = hdfsCopy(srcFS, src, dstFS, dst), erc == -1, errmsg);
+  if( erc == -1 ) {
+    return hdfs_raise(errmsg);
   }
   Py_RETURN_TRUE;
 }
 
 static const char move_doc[] = "Move file from one filesystem to another";
 static PyObject *
-move(PyObject * args) {
+move(PyObject *self, PyObject * args) {
   hdfsFS srcFS, dstFS;
   const char *src, *dst;
   int erc;
+  hdfs_errmsg errmsg;
   if( !PyArg_ParseTuple(args, "O&sO&s", 
 			extract_fs, &srcFS, &src, 
 			extract_fs, &dstFS, &dst) ) {
     return NULL;
   }
- if( (erc = hdfsMove(srcFS, src, dstFS, dst)) == -1 ) {
-    return hdfs_err();
+  HDFS_NOGIL(erc = hdfsMove(srcFS, src, dstFS, dst), erc == -1, errmsg);
+  if( erc == -1 ) {
+    return hdfs_raise(errmsg);
   }
   Py_RETURN_TRUE;
 }
 
 static const char delete_doc[] = "Delete file";
 static PyObject *
-delete(PyObject * args) {
+delete(PyObject *self, PyObject * args) {
   hdfsFS fs;
   const char *name;
   bool recursive;
   int erc;
+  hdfs_errmsg errmsg;
   if( !PyArg_ParseTuple(args, "O&sp", extract_fs, &fs, &name, &recursive) ) {
     return NULL;
   }
- if( (erc = hdfsDelete(fs, name, recursive)) == -1 ) {
-    return hdfs_err();
+  HDFS_NOGIL(erc = hdfsDelete(fs, name, recursive), erc == -1, errmsg);
+  if( erc == -1 ) {
+    return hdfs_raise(errmsg);
   }
   Py_RETURN_TRUE;
 }
 
 static const char rename_doc[] = "Rename file";
 static PyObject *
-hdfs_rename(PyObject * args) {
+hdfs_rename(PyObject *self, PyObject * args) {
   hdfsFS fs;
   const char *src, *tgt;
   int erc;
-  if( !PyArg_ParseTuple(args, "O&sp", extract_fs, &fs, &src, &tgt) ) {
+  hdfs_errmsg errmsg;
+  if( !PyArg_ParseTuple(args, "O&ss", extract_fs, &fs, &src, &tgt) ) {
     return NULL;
   }
- if( (erc = hdfsRename(fs, src, tgt)) == -1 ) {
-    return hdfs_err();
+  HDFS_NOGIL(erc = hdfsRename(fs, src, tgt), erc == -1, errmsg);
+  if( erc == -1 ) {
+    return hdfs_raise(errmsg);
   }
   Py_RETURN_TRUE;
 }
@@ -580,7 +693,7 @@ hdfs_rename(PyObject * args) {
 static const char getWorkingDirectory_doc[] = 
   "Get the current working directory for the given filesystem";
 static PyObject *
-getWorkingDirectory(PyObject * args) {
+getWorkingDirectory(PyObject *self, PyObject * args) {
   hdfsFS fs;
   PyObject *buffer;
   char *name;
@@ -602,7 +715,7 @@ getWorkingDirectory(PyObject * args) {
 
 static const char setWorkingDirectory_doc[] = "Set the working directory";
 static PyObject *
-setWorkingDirectory(PyObject * args) {
+setWorkingDirectory(PyObject *self, PyObject * args) {
   hdfsFS fs;
   char *name;
   int erc;
@@ -618,15 +731,17 @@ setWorkingDirectory(PyObject * args) {
 static const char createDirectory_doc[] = 
   "Make the given file and all non-existent parents into directories";
 static PyObject *
-createDirectory(PyObject * args) {
+createDirectory(PyObject *self, PyObject * args) {
   hdfsFS fs;
   char *name;
   int erc;
+  hdfs_errmsg errmsg;
   if( !PyArg_ParseTuple(args, "O&s", extract_fs, &fs, &name) ) {
     return NULL;
   }
-  if( (erc = hdfsCreateDirectory(fs, name)) == -1 ) {
-    return hdfs_err();
+  HDFS_NOGIL(erc = hdfsCreateDirectory(fs, name), erc == -1, errmsg);
+  if( erc == -1 ) {
+    return hdfs_raise(errmsg);
   }
   Py_RETURN_TRUE;
 }
@@ -634,16 +749,19 @@ createDirectory(PyObject * args) {
 static const char setReplication_doc[] = 
   "Set the replication of the specified file to the supplied value";
 static PyObject *
-setReplication(PyObject * args) {
+setReplication(PyObject *self, PyObject * args) {
   hdfsFS fs;
   char *name;
   int16_t replication;
   int erc;
+  hdfs_errmsg errmsg;
   if( !PyArg_ParseTuple(args, "O&sh", extract_fs, &fs, &name, &replication) ) {
     return NULL;
   }
- if( (erc = hdfsSetReplication(fs, name, replication)) == -1 ) {
-    return hdfs_err();
+  HDFS_NOGIL(erc = hdfsSetReplication(fs, name, replication), 
+             erc == -1, errmsg);
+  if( erc == -1 ) {
+    return hdfs_raise(errmsg);
   }
   Py_RETURN_TRUE;
 }
@@ -713,19 +831,22 @@ hdfsFileInfo_New(const hdfsFileInfo *info) {
 static const char listDirectory_doc[] = 
   "Get list of files/directories for a given";
 static PyObject *
-listDirectory(PyObject * args) {
+listDirectory(PyObject *self, PyObject * args) {
   hdfsFS fs;
   char *name;
   hdfsFileInfo *pinfo;
   int nelem;
   int i, erc;
   PyObject *output;
+  hdfs_errmsg errmsg;
   if( !PyArg_ParseTuple(args, "O&s", extract_fs, &fs, &name) ) {
     return NULL;
   }
 
-  if( (pinfo = hdfsListDirectory(fs, name, &nelem)) == NULL ) {
-    return hdfs_err();
+  HDFS_NOGIL(pinfo = hdfsListDirectory(fs, name, &nelem), 
+             pinfo == NULL, errmsg);
+  if( pinfo == NULL ) {
+    return hdfs_raise(errmsg);
   }
   
   if( (output = PyTuple_New(nelem)) == NULL ) {
@@ -746,32 +867,307 @@ listDirectory(PyObject * args) {
   return output;
 }
 
+/*
+ * DirectoryIterator - yields the entries of a directory one by one
+ * through hdfsOpenDirectory/hdfsReadDirectory, so only the current page
+ * of the listing is held in memory.  The next page is fetched with the
+ * GIL released.
+ */
+typedef struct {
+  PyObject_HEAD
+  PyObject *fs_capsule;
+  hdfsDir dir;
+  bool busy;
+} DirectoryIteratorObject;
+
+static void
+DirectoryIterator_close_dir(DirectoryIteratorObject *self) {
+  if( self->dir != NULL ) {
+    hdfsCloseDirectory(self->dir);
+    self->dir = NULL;
+  }
+}
+
+static void
+DirectoryIterator_dealloc(DirectoryIteratorObject *self) {
+  DirectoryIterator_close_dir(self);
+  Py_XDECREF(self->fs_capsule);
+  Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static PyObject *
+DirectoryIterator_next(DirectoryIteratorObject *self) {
+  hdfsFileInfo *info;
+  int err = 0;
+  hdfs_errmsg errmsg;
+
+  if( self->dir == NULL ) {
+    return NULL;
+  }
+  if( self->busy ) {
+    PyErr_SetString(PyExc_ValueError, "directory iterator already executing");
+    return NULL;
+  }
+
+  self->busy = true;
+  Py_BEGIN_ALLOW_THREADS
+  errno = 0;
+  if( (info = hdfsReadDirectory(self->dir)) == NULL && (err = errno) != 0 ) {
+    save_err(errmsg);
+  }
+  Py_END_ALLOW_THREADS
+  self->busy = false;
+
+  if( info == NULL ) {
+    DirectoryIterator_close_dir(self);
+    return err != 0? hdfs_raise(errmsg) : NULL;
+  }
+  return hdfsFileInfo_New(info);
+}
+
+static PyObject *
+DirectoryIterator_close(DirectoryIteratorObject *self, PyObject *unused) {
+  if( self->busy ) {
+    PyErr_SetString(PyExc_ValueError, "directory iterator already executing");
+    return NULL;
+  }
+  DirectoryIterator_close_dir(self);
+  Py_RETURN_NONE;
+}
+
+static PyObject *
+DirectoryIterator_enter(DirectoryIteratorObject *self, PyObject *unused) {
+  Py_INCREF(self);
+  return (PyObject *)self;
+}
+
+static PyObject *
+DirectoryIterator_exit(DirectoryIteratorObject *self, PyObject *args) {
+  return DirectoryIterator_close(self, NULL);
+}
+
+static PyMethodDef DirectoryIterator_methods[] = {
+  { "close", (PyCFunction)DirectoryIterator_close, METH_NOARGS, 
+    PyDoc_STR("Stop the listing and release the directory handle") }, 
+  { "__enter__", (PyCFunction)DirectoryIterator_enter, METH_NOARGS, NULL }, 
+  { "__exit__", (PyCFunction)DirectoryIterator_exit, METH_VARARGS, NULL }, 
+  { NULL, NULL, 0, NULL },
+};
+
+static PyTypeObject DirectoryIterator_Type = {
+  PyVarObject_HEAD_INIT(NULL, 0)
+  .tp_name = "hdfs3py.DirectoryIterator",
+  .tp_basicsize = sizeof(DirectoryIteratorObject),
+  .tp_dealloc = (destructor)DirectoryIterator_dealloc,
+  .tp_flags = Py_TPFLAGS_DEFAULT,
+  .tp_doc = "Iterator over the hdfsFileInfo entries of a directory",
+  .tp_iter = PyObject_SelfIter,
+  .tp_iternext = (iternextfunc)DirectoryIterator_next,
+  .tp_methods = DirectoryIterator_methods,
+};
+
+static const char iterDirectory_doc[] = 
+  "Return an iterator over the hdfsFileInfo entries of a directory, "
+  "fetched page by page";
+static PyObject *
+iterDirectory(PyObject *self, PyObject * args) {
+  PyObject *fs_capsule;
+  DirectoryIteratorObject *output;
+  const char *name;
+  hdfsFS fs;
+  hdfsDir dir;
+  hdfs_errmsg errmsg;
+  if( !PyArg_ParseTuple(args, "Os", &fs_capsule, &name) 
+      || !extract_fs(fs_capsule, &fs) ) {
+    return NULL;
+  }
+
+  HDFS_NOGIL(dir = hdfsOpenDirectory(fs, name), dir == NULL, errmsg);
+  if( dir == NULL ) {
+    return hdfs_raise(errmsg);
+  }
+
+  output = PyObject_New(DirectoryIteratorObject, &DirectoryIterator_Type);
+  if( output == NULL ) {
+    hdfsCloseDirectory(dir);
+    return NULL;
+  }
+  Py_INCREF(fs_capsule);
+  output->fs_capsule = fs_capsule;
+  output->dir = dir;
+  output->busy = false;
+  return (PyObject *)output;
+}
+
+/*
+ * A growable C array, filled while the GIL is released.
+ */
+typedef struct {
+  char *data;
+  size_t size;
+  size_t capacity;
+} column;
+
+static bool
+column_append(column *col, const void *data, size_t size) {
+  if( col->size + size > col->capacity ) {
+    size_t capacity = col->capacity? col->capacity : 4096;
+    char *grown;
+    while( capacity < col->size + size ) {
+      capacity *= 2;
+    }
+    if( (grown = realloc(col->data, capacity)) == NULL ) {
+      return false;
+    }
+    col->data = grown;
+    col->capacity = capacity;
+  }
+  memcpy(col->data + col->size, data, size);
+  col->size += size;
+  return true;
+}
+
+/* the column as a bytes object, or a memoryview of int64 */
+static PyObject *
+column_to_python(const column *col, bool int64) {
+  PyObject *bytes, *view, *output;
+  if( (bytes = PyBytes_FromStringAndSize(col->data? col->data : "", 
+					 col->size)) == NULL ) {
+    return NULL;
+  }
+  if( !int64 ) {
+    return bytes;
+  }
+  view = PyMemoryView_FromObject(bytes);
+  Py_DECREF(bytes);
+  if( view == NULL ) {
+    return NULL;
+  }
+  output = PyObject_CallMethod(view, "cast", "s", "q");
+  Py_DECREF(view);
+  return output;
+}
+
+static PyTypeObject * DirectoryColumns_Type = NULL;
+
+static void 
+DirectoryColumns_NewType() {
+  static PyStructSequence_Field fields[] = 
+    { { "names", "the UTF-8 names of all entries packed in one bytes" }, 
+      { "offsets", "int64 start of each name in names, plus the end" }, 
+      { "kinds", "one byte per entry, F for a file, D for a directory" }, 
+      { "sizes", "int64 size of each entry in bytes" }, 
+      { "mtimes", "int64 last modification time of each entry in seconds" }, 
+      { NULL, NULL }
+    };
+  static PyStructSequence_Desc desc = 
+    { .name = "hdfs3py.DirectoryColumns", 
+      .doc = "A directory listing as parallel arrays", 
+      .fields = fields, 
+      .n_in_sequence = sizeof(fields)/sizeof(fields[0]) - 1
+    };
+  DirectoryColumns_Type = PyStructSequence_NewType(&desc);
+}
+
+static const char listDirectoryColumns_doc[] = 
+  "Get the entries of a directory as parallel arrays "
+  "(names, offsets, kinds, sizes, mtimes)";
+static PyObject *
+listDirectoryColumns(PyObject *self, PyObject * args) {
+  enum { names, offsets, kinds, sizes, mtimes, ncolumns };
+  column cols[ncolumns];
+  const char *name;
+  hdfsFS fs;
+  hdfsDir dir;
+  hdfsFileInfo *info;
+  int64_t value = 0;
+  bool nomem = false;
+  int i, err = 0;
+  PyObject *output = NULL;
+  hdfs_errmsg errmsg;
+
+  if( !PyArg_ParseTuple(args, "O&s", extract_fs, &fs, &name) ) {
+    return NULL;
+  }
+  memset(cols, 0, sizeof(cols));
+
+  Py_BEGIN_ALLOW_THREADS
+  if( (dir = hdfsOpenDirectory(fs, name)) == NULL ) {
+    save_err(errmsg);
+  } else {
+    nomem = !column_append(cols + offsets, &value, sizeof(value));
+    errno = 0;
+    while( !nomem && (info = hdfsReadDirectory(dir)) != NULL ) {
+      int64_t size = info->mSize, mtime = info->mLastMod;
+      char kind = info->mKind;
+      nomem = !column_append(cols + names, info->mName, strlen(info->mName));
+      value = cols[names].size;
+      nomem = nomem 
+	|| !column_append(cols + offsets, &value, sizeof(value))
+	|| !column_append(cols + kinds, &kind, 1)
+	|| !column_append(cols + sizes, &size, sizeof(size))
+	|| !column_append(cols + mtimes, &mtime, sizeof(mtime));
+    }
+    if( !nomem && (err = errno) != 0 ) {
+      save_err(errmsg);
+    }
+    hdfsCloseDirectory(dir);
+  }
+  Py_END_ALLOW_THREADS
+
+  if( nomem ) {
+    PyErr_NoMemory();
+  } else if( dir == NULL || err != 0 ) {
+    hdfs_raise(errmsg);
+  } else {
+    if( DirectoryColumns_Type == NULL ) {
+      DirectoryColumns_NewType();
+    }
+    if( (output = PyStructSequence_New(DirectoryColumns_Type)) != NULL ) {
+      for( i=0; i < ncolumns; i++ ) {
+	PyObject *elem = column_to_python(cols + i, i != names && i != kinds);
+	if( elem == NULL ) {
+	  Py_CLEAR(output);
+	  break;
+	}
+	PyStructSequence_SET_ITEM(output, i, elem);
+      }
+    }
+  }
+
+  for( i=0; i < ncolumns; i++ ) {
+    free(cols[i].data);
+  }
+  return output;
+}
+
 static const char getPathInfo_doc[] = 
   "Get information about a path as an hdfsFileInfo struct";
 static PyObject *
-getPathInfo(PyObject * args) {
+getPathInfo(PyObject *self, PyObject * args) {
   hdfsFS fs;
   char *name;
   hdfsFileInfo * info;
   int erc;
   PyObject *output;
+  hdfs_errmsg errmsg;
 
   if( !PyArg_ParseTuple(args, "O&s", extract_fs, &fs, &name) ) {
     return NULL;
   }
 
-  if( (info = hdfsGetPathInfo(fs, name)) == NULL ) {
-    return hdfs_err();
+  HDFS_NOGIL(info = hdfsGetPathInfo(fs, name), info == NULL, errmsg);
+  if( info == NULL ) {
+    return hdfs_raise(errmsg);
   }
 
-  if( (output = hdfsFileInfo_New(info)) == NULL ){
+  output = hdfsFileInfo_New(info);
+  hdfsFreeFileInfo(info, 1);
+  if( output == NULL ){
     PyObject *type = PyErr_NewException("hdfs3py.error", NULL, NULL);
     PyErr_SetString(type, "logic error");
     return NULL;
   }
-  if( 0 != PyTuple_SetItem(output, 0, output) ) {
-    return NULL;
-  }
   return output;
 }
 
@@ -783,14 +1179,14 @@ extract_fileinfo( PyObject * fileinfo_capsule, void *pout ) {
     hdfs_err();
     return 0;
   }
-  *pfileinfo = *(struct hdfsFileInfo **)pout;
+  *pfileinfo = (struct hdfsFileInfo *)pout;
   return 1;
 }
 
 static const char freeFileInfo_doc[] = 
   "Free up the hdfsFileInfo array (including fields)";
 static PyObject *
-freeFileInfo(PyObject * args) {
+freeFileInfo(PyObject *self, PyObject * args) {
   hdfsFileInfo *pfi;
   int nelem;
   if( !PyArg_ParseTuple(args, "O&si", extract_fileinfo, &pfi, &nelem) ) {
@@ -803,9 +1199,10 @@ freeFileInfo(PyObject * args) {
 static const char getHosts_doc[] = 
   "Get hostnames where a particular block of a file is stored";
 static PyObject *
-getHosts(PyObject * args) {
+getHosts(PyObject *self, PyObject * args) {
   hdfsFS fs;
   char *name;
+  hdfs_errmsg errmsg;
   tOffset i, nelem, start, len;  
   char ***hosts;
   PyObject *output;
@@ -813,11 +1210,12 @@ getHosts(PyObject * args) {
     return NULL;
   }
 
-  if( (hosts = hdfsGetHosts(fs, name, start, len)) == NULL ) {
-    return hdfs_err();
+  HDFS_NOGIL(hosts = hdfsGetHosts(fs, name, start, len), hosts == NULL, errmsg);
+  if( hosts == NULL ) {
+    return hdfs_raise(errmsg);
   }
 
-  for( nelem=0; hosts + nelem != NULL; nelem++ )
+  for( nelem=0; hosts[nelem] != NULL; nelem++ )
     ;
 
   if( (output = PyTuple_New(nelem)) == NULL ) {
@@ -827,7 +1225,7 @@ getHosts(PyObject * args) {
   for( i=0; i < nelem; i++ ) {
     int j, nhosts = 0;
     PyObject *row;
-    while( hosts[i] + nhosts ) {
+    while( hosts[i][nhosts] != NULL ) {
       nhosts++;
     }
     if( (row = PyTuple_New(nhosts)) == NULL ) {
@@ -849,13 +1247,14 @@ getHosts(PyObject * args) {
       return NULL;
     }
   }
+  hdfsFreeHosts(hosts);
   return output;
 }
 
 static const char freeHosts_doc[] = 
   "Free up the structure returned by hdfsGetHosts";
 static PyObject *
-freeHosts(PyObject * args) {
+freeHosts(PyObject *self, PyObject * args) {
   PyObject *pyhosts;
   int i, j, nhosts;
   char ***hosts = NULL;
@@ -898,7 +1297,7 @@ freeHosts(PyObject * args) {
 static const char getDefaultBlockSize_doc[] = 
   "Get the default blocksize";
 static PyObject *
-getDefaultBlockSize(PyObject * args) {
+getDefaultBlockSize(PyObject *self, PyObject * args) {
   hdfsFS fs;
   tOffset len;
   if( !PyArg_ParseTuple(args, "O&", extract_fs, &fs) ) {
@@ -914,14 +1313,16 @@ getDefaultBlockSize(PyObject * args) {
 static const char getCapacity_doc[] = 
   "Return the raw capacity of the filesystem";
 static PyObject *
-getCapacity(PyObject * args) {
+getCapacity(PyObject *self, PyObject * args) {
   hdfsFS fs;
   tOffset len;
+  hdfs_errmsg errmsg;
   if( !PyArg_ParseTuple(args, "O&", extract_fs, &fs) ) {
     return NULL;
   }
-  if( (len = hdfsGetCapacity(fs)) == -1 ) {
-    return  hdfs_err();
+  HDFS_NOGIL(len = hdfsGetCapacity(fs), len == -1, errmsg);
+  if( len == -1 ) {
+    return hdfs_raise(errmsg);
   }
   return PyLong_FromLong(len);
 }
@@ -929,14 +1330,16 @@ getCapacity(PyObject * args) {
 static const char getUsed_doc[] = 
   "Return the total raw size of all files in the filesystem";
 static PyObject *
-getUsed(PyObject * args) {
+getUsed(PyObject *self, PyObject * args) {
   hdfsFS fs;
   tOffset len;
+  hdfs_errmsg errmsg;
   if( !PyArg_ParseTuple(args, "O&", extract_fs, &fs) ) {
     return NULL;
   }
-  if( (len = hdfsGetUsed(fs)) == -1 ) {
-    return  hdfs_err();
+  HDFS_NOGIL(len = hdfsGetUsed(fs), len == -1, errmsg);
+  if( len == -1 ) {
+    return hdfs_raise(errmsg);
   }
   return PyLong_FromLong(len);
 }
@@ -944,48 +1347,55 @@ getUsed(PyObject * args) {
 static const char chown_doc[] = 
   "Change the user and/or group of a file or directory";
 static PyObject *
-hdfs_chown(PyObject * args) {
+hdfs_chown(PyObject *self, PyObject * args) {
   hdfsFS fs;
   const char *path,  *owner,  *group;
   int erc;
+  hdfs_errmsg errmsg;
   if( !PyArg_ParseTuple(args, "O&sss", 
 			extract_fs, &fs, &path,  &owner,  &group) ) {
     return NULL;
   }
-  if( (erc = hdfsChown(fs, path, owner, group)) == -1 ) {
-    return  hdfs_err();
+  HDFS_NOGIL(erc = hdfsChown(fs, path, owner, group), erc == -1, errmsg);
+  if( erc == -1 ) {
+    return hdfs_raise(errmsg);
   }
   Py_RETURN_TRUE;
 }
 
 static const char chmod_doc[] = "Chmod";
 static PyObject *
-hdfs_chmod(PyObject * args) {
+hdfs_chmod(PyObject *self, PyObject * args) {
   hdfsFS fs;
   const char *path;
   short mode;
   int erc;
+  hdfs_errmsg errmsg;
   if( !PyArg_ParseTuple(args, "O&sh", extract_fs, &fs, &path, &mode) ) {
     return NULL;
   }
-  if( (erc = hdfsChmod(fs, path, mode)) == -1 ) {
-    return  hdfs_err();
+  HDFS_NOGIL(erc = hdfsChmod(fs, path, mode), erc == -1, errmsg);
+  if( erc == -1 ) {
+    return hdfs_raise(errmsg);
   }
   Py_RETURN_TRUE;
 }
 
 static const char utime_doc[] = "Utime";
 static PyObject *
-utime(PyObject * args) {
+utime(PyObject *self, PyObject * args) {
   hdfsFS fs;
   const char *path;
   tTime mtime, atime;
   int erc;
-  if( !PyArg_ParseTuple(args, "O&sll", extract_fs, &fs, &mtime, &atime) ) {
+  hdfs_errmsg errmsg;
+  if( !PyArg_ParseTuple(args, "O&sll", extract_fs, &fs, &path, 
+			&mtime, &atime) ) {
     return NULL;
   }
-  if( (erc = hdfsUtime(fs, path, mtime, atime)) == -1 ) {
-    return  hdfs_err();
+  HDFS_NOGIL(erc = hdfsUtime(fs, path, mtime, atime), erc == -1, errmsg);
+  if( erc == -1 ) {
+    return hdfs_raise(errmsg);
   }
   Py_RETURN_TRUE;
 }
@@ -993,17 +1403,19 @@ utime(PyObject * args) {
 static const char truncate_doc[] = 
   "Truncate the file in the indicated path to the indicated size";
 static PyObject *
-hdfs_truncate(PyObject * args) {
+hdfs_truncate(PyObject *self, PyObject * args) {
   hdfsFS fs;
   const char *path;
   tOffset pos;
   int shouldWait;
   int erc;
-  if( !PyArg_ParseTuple(args, "O&sl", extract_fs, &fs, &pos) ) {
+  hdfs_errmsg errmsg;
+  if( !PyArg_ParseTuple(args, "O&sl", extract_fs, &fs, &path, &pos) ) {
     return NULL;
   }
-  if( (erc = hdfsTruncate(fs, path, pos, &shouldWait)) == -1 ) {
-    return  hdfs_err();
+  HDFS_NOGIL(erc = hdfsTruncate(fs, path, pos, &shouldWait), erc == -1, errmsg);
+  if( erc == -1 ) {
+    return hdfs_raise(errmsg);
   }
   if( shouldWait ) 
     Py_RETURN_TRUE;
@@ -1013,23 +1425,28 @@ hdfs_truncate(PyObject * args) {
 static const char getDelegationToken_doc[] = 
   "Get a delegation token from namenode";
 static PyObject *
-getDelegationToken(PyObject * args) {
+getDelegationToken(PyObject *self, PyObject * args) {
   hdfsFS fs;
   const char *name;
   char * token;
+  PyObject *output;
+  hdfs_errmsg errmsg;
   if( !PyArg_ParseTuple(args, "O&s", extract_fs, &fs, &name) ) {
     return NULL;
   }
-  if( (token = hdfsGetDelegationToken(fs, name)) == NULL ) {
-    return  hdfs_err();
+  HDFS_NOGIL(token = hdfsGetDelegationToken(fs, name), token == NULL, errmsg);
+  if( token == NULL ) {
+    return hdfs_raise(errmsg);
   }
-  return PyUnicode_FromString(name);
+  output = PyUnicode_FromString(token);
+  hdfsFreeDelegationToken(token);
+  return output;
 }
 
 static const char freeDelegationToken_doc[] = 
   "Free a delegation token";
 static PyObject *
-freeDelegationToken(PyObject * args) {
+freeDelegationToken(PyObject *self, PyObject * args) {
   hdfsFS fs;
   char * token;
   if( !PyArg_ParseTuple(args, "s", &token) ) {
@@ -1041,15 +1458,17 @@ freeDelegationToken(PyObject * args) {
 
 static const char renewDelegationToken_doc[] = "Renew a delegation token";
 static PyObject *
-renewDelegationToken(PyObject * args) {
+renewDelegationToken(PyObject *self, PyObject * args) {
   hdfsFS fs;
   char * token;
   long erc;
+  hdfs_errmsg errmsg;
   if( !PyArg_ParseTuple(args, "O&s", extract_fs, &fs, &token) ) {
     return NULL;
   }
-  if( (erc = hdfsRenewDelegationToken(fs, token)) == -1 ) {
-    return  hdfs_err();
+  HDFS_NOGIL(erc = hdfsRenewDelegationToken(fs, token), erc == -1, errmsg);
+  if( erc == -1 ) {
+    return hdfs_raise(errmsg);
   }
   Py_RETURN_TRUE;
 }
@@ -1057,15 +1476,17 @@ renewDelegationToken(PyObject * args) {
 static const char cancelDelegationToken_doc[] = 
   "Cancel a delegation token";
 static PyObject *
-cancelDelegationToken(PyObject * args) {
+cancelDelegationToken(PyObject *self, PyObject * args) {
   hdfsFS fs;
   char * token;
   long erc;
+  hdfs_errmsg errmsg;
   if( !PyArg_ParseTuple(args, "O&s", extract_fs, &fs, &token) ) {
     return NULL;
   }
-  if( (erc = hdfsCancelDelegationToken(fs, token)) == -1 ) {
-    return  hdfs_err();
+  HDFS_NOGIL(erc = hdfsCancelDelegationToken(fs, token), erc == -1, errmsg);
+  if( erc == -1 ) {
+    return hdfs_raise(errmsg);
   }
   Py_RETURN_TRUE;
 }
@@ -1116,20 +1537,25 @@ static const char getHANamenodes_doc[] =
   "return all namenode information as an array, else NULL"
   " (config is optional 3rd parameter)";
 static PyObject *
-getHANamenodes(PyObject * args) {
+getHANamenodes(PyObject *self, PyObject * args) {
   const char * nameservice, *config = NULL;
   int i, len;
   Namenode *nodes;
+  hdfs_errmsg errmsg;
   if( !PyArg_ParseTuple(args, "s|s", &nameservice, &config) ) {
     return NULL;
   }
   if( config != NULL ) {
-    if( (nodes = hdfsGetHANamenodesWithConfig(config, nameservice, &len)) == NULL ) {
-      return  hdfs_err();
+    HDFS_NOGIL(nodes = hdfsGetHANamenodesWithConfig(config, nameservice, &len), 
+               nodes == NULL, errmsg);
+    if( nodes == NULL ) {
+      return hdfs_raise(errmsg);
     }
   } else {
-    if( (nodes = hdfsGetHANamenodes(nameservice, &len)) == NULL ) {
-      return  hdfs_err();
+    HDFS_NOGIL(nodes = hdfsGetHANamenodes(nameservice, &len), 
+               nodes == NULL, errmsg);
+    if( nodes == NULL ) {
+      return hdfs_raise(errmsg);
     }
   }
 
@@ -1160,7 +1586,7 @@ getHANamenodes(PyObject * args) {
 static const char freeNamenodeInformation_doc[] = 
   "Free the array returned by hdfsGetConfiguredNamenodes";
 static PyObject *
-freeNamenodeInformation(PyObject * args) {
+freeNamenodeInformation(PyObject *self, PyObject * args) {
   PyObject *pynodes;
   Namenode * nodes = NULL;
   int i, len = 0;
@@ -1212,11 +1638,9 @@ BlockLocation_NewType()  {
 }
 
 static PyObject *
-BlockLocation_SetRow( char **input ) {
+BlockLocation_SetRow( char **input, int nelem ) {
   PyObject *output;
-  int i, nelem;
-  for( nelem=0; input + nelem != NULL; nelem++ )
-    ;
+  int i;
   if( (output = PyTuple_New(nelem)) == NULL ) {
     return NULL;
   }
@@ -1244,9 +1668,10 @@ BlockLocation_New(const BlockLocation *info) {
   e[length]        = PyLong_FromLong(info->length);
   e[offset]        = PyLong_FromLong(info->offset);
 
-  e[hosts] = BlockLocation_SetRow(info->hosts);
-  e[names] = BlockLocation_SetRow(info->names);
-  e[topologyPaths] = BlockLocation_SetRow(info->topologyPaths);
+  e[hosts] = BlockLocation_SetRow(info->hosts, info->numOfNodes);
+  e[names] = BlockLocation_SetRow(info->names, info->numOfNodes);
+  e[topologyPaths] = BlockLocation_SetRow(info->topologyPaths, 
+					  info->numOfNodes);
 
   for( i=0; i < sizeof(e)/sizeof(e[0]); i++ ) {
     if( e[i] == NULL ) {
@@ -1297,19 +1722,21 @@ static const char getFileBlockLocations_doc[] =
   "Get an array containing hostnames, offset and size "
   "of portions of the given file";
 static PyObject *
-getFileBlockLocations(PyObject * args) {
+getFileBlockLocations(PyObject *self, PyObject * args) {
   hdfsFS fs;
   const char *name;
   tOffset start;
   tOffset i, len;
   BlockLocation *pblocks;
   int nblocks;
-  if( !PyArg_ParseTuple(args, "O&s", extract_fs, &fs, &name, &start, &len) ) {
+  hdfs_errmsg errmsg;
+  if( !PyArg_ParseTuple(args, "O&sll", extract_fs, &fs, &name, &start, &len) ) {
     return NULL;
   }
-  if( (pblocks = hdfsGetFileBlockLocations(fs, name, 
-					   start, len, &nblocks)) == NULL ) {
-    return  hdfs_err();
+  HDFS_NOGIL(pblocks = hdfsGetFileBlockLocations(fs, name, start, len, &nblocks), 
+             pblocks == NULL, errmsg);
+  if( pblocks == NULL ) {
+    return hdfs_raise(errmsg);
   }
   
   PyObject *output;
@@ -1335,7 +1762,7 @@ getFileBlockLocations(PyObject * args) {
 static const char freeFileBlockLocations_doc[] = 
   "Free the BlockLocation array returned by hdfsGetFileBlockLocations";
 static PyObject *
-freeFileBlockLocations(PyObject * args) {
+freeFileBlockLocations(PyObject *self, PyObject * args) {
   BlockLocation *blocks;
   int i, nblocks;
   PyObject *pynodes;
@@ -1362,6 +1789,921 @@ freeFileBlockLocations(PyObject * args) {
   Py_RETURN_TRUE;
 }
 
+/*
+ * HdfsFile - a raw file object over an hdfsFile, registered as an
+ * io.RawIOBase so it can be wrapped by io.BufferedReader/Writer and
+ * io.TextIOWrapper.  Every call into libhdfs3 runs with the GIL
+ * released while holding the lock of the object, so one file may be
+ * shared between threads.
+ */
+typedef struct {
+  PyObject_HEAD
+  PyObject *fs_capsule;
+  hdfsFS fs;
+  hdfsFile file;
+  PyObject *name;
+  PyObject *mode;
+  bool writable;
+  PyThread_type_lock lock;
+} HdfsFileObject;
+
+static PyTypeObject HdfsFile_Type;
+
+/* default buffer of the objects returned by open() */
+enum { HDFSFILE_BUFFER_SIZE = 1024 * 1024 };
+
+static PyObject *io_module = NULL;
+
+static bool
+hdfsfile_check_open(HdfsFileObject *self) {
+  if( self->file == NULL ) {
+    PyErr_SetString(PyExc_ValueError, "I/O operation on closed file");
+    return false;
+  }
+  return true;
+}
+
+static bool
+hdfsfile_check_mode(HdfsFileObject *self, bool writing) {
+  if( self->writable != writing ) {
+    PyObject *exc = PyObject_GetAttrString(io_module, "UnsupportedOperation");
+    PyErr_SetString(exc? exc : PyExc_OSError, 
+		    writing? "File not open for writing" 
+		           : "File not open for reading");
+    Py_XDECREF(exc);
+    return false;
+  }
+  return true;
+}
+
+#define HDFSFILE_NOGIL(self, call, failed, errmsg)	\
+  HDFS_NOGIL(PyThread_acquire_lock((self)->lock, WAIT_LOCK);	\
+	     call;						\
+	     PyThread_release_lock((self)->lock), 		\
+	     failed, errmsg)
+
+/* read up to len bytes, fewer only at the end of the file */
+static tSize
+hdfsfile_read_fully(HdfsFileObject *self, char *buf, tSize len) {
+  tSize done = 0, n;
+  while( done < len ) {
+    if( (n = hdfsRead(self->fs, self->file, buf + done, len - done)) <= 0 ) {
+      return n == 0? done : -1;
+    }
+    done += n;
+  }
+  return done;
+}
+
+static int
+HdfsFile_init(HdfsFileObject *self, PyObject *args, PyObject *keywords) {
+  static char *okwords[] = { "fs", "path", "mode", 
+			     "buffer_size", "replication", "block_size", NULL };
+  const char *path, *mode = "r";
+  PyObject *fs_capsule;
+  int flags, bufferSize = 0;
+  short replication = 0;
+  tOffset blocksize = 0;
+  hdfsFS fs;
+  hdfsFile file;
+  hdfs_errmsg errmsg;
+
+  if( !PyArg_ParseTupleAndKeywords(args, keywords, "Os|sihl", okwords, 
+				   &fs_capsule, &path, &mode, 
+				   &bufferSize, &replication, &blocksize) ) {
+    return -1;
+  }
+
+  /* hdfs files are either read or written, and always binary */
+  switch( mode[0] ) {
+  case 'r': flags = O_RDONLY; break;
+  case 'w': flags = O_WRONLY; break;
+  case 'a': flags = O_WRONLY | O_APPEND; break;
+  default: flags = -1; break;
+  }
+  if( flags == -1 || !(mode[1] == '\0' || strcmp(mode + 1, "b") == 0) ) {
+    PyErr_Format(PyExc_ValueError, "invalid mode: '%s'", mode);
+    return -1;
+  }
+
+  if( !extract_fs(fs_capsule, &fs) ) {
+    return -1;
+  }
+
+  if( self->file != NULL ) {
+    PyErr_SetString(PyExc_ValueError, "file is already open");
+    return -1;
+  }
+
+  HDFS_NOGIL(file = hdfsOpenFile(fs, path, flags, bufferSize, 
+				 replication, blocksize), 
+	     file == NULL, errmsg);
+  if( file == NULL ) {
+    hdfs_raise(errmsg);
+    return -1;
+  }
+
+  self->fs = fs;
+  self->file = file;
+  self->writable = flags != O_RDONLY;
+  Py_INCREF(fs_capsule);
+  Py_XDECREF(self->fs_capsule);
+  self->fs_capsule = fs_capsule;
+  Py_XDECREF(self->name);
+  Py_XDECREF(self->mode);
+  self->name = PyUnicode_FromString(path);
+  self->mode = PyUnicode_FromString(self->writable? 
+				    (flags & O_APPEND? "ab" : "wb") : "rb");
+  return self->name && self->mode? 0 : -1;
+}
+
+static PyObject *
+HdfsFile_new(PyTypeObject *type, PyObject *args, PyObject *keywords) {
+  HdfsFileObject *self = (HdfsFileObject *)type->tp_alloc(type, 0);
+  if( self == NULL ) {
+    return NULL;
+  }
+  if( (self->lock = PyThread_allocate_lock()) == NULL ) {
+    Py_DECREF(self);
+    return PyErr_NoMemory();
+  }
+  return (PyObject *)self;
+}
+
+static int
+hdfsfile_close(HdfsFileObject *self, hdfs_errmsg errmsg) {
+  hdfsFile file = self->file;
+  int erc;
+  self->file = NULL;
+  HDFSFILE_NOGIL(self, erc = hdfsCloseFile(self->fs, file), erc != 0, errmsg);
+  return erc;
+}
+
+static void
+HdfsFile_dealloc(HdfsFileObject *self) {
+  hdfs_errmsg errmsg;
+  if( self->file != NULL ) {
+    hdfsfile_close(self, errmsg);
+  }
+  if( self->lock != NULL ) {
+    PyThread_free_lock(self->lock);
+  }
+  Py_XDECREF(self->fs_capsule);
+  Py_XDECREF(self->name);
+  Py_XDECREF(self->mode);
+  Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static PyObject *
+HdfsFile_readinto(HdfsFileObject *self, PyObject *args) {
+  Py_buffer view;
+  tSize len;
+  hdfs_errmsg errmsg;
+  if( !PyArg_ParseTuple(args, "w*", &view) ) {
+    return NULL;
+  }
+  if( !hdfsfile_check_open(self) || !hdfsfile_check_mode(self, false) ) {
+    PyBuffer_Release(&view);
+    return NULL;
+  }
+  len = view.len < INT32_MAX? (tSize)view.len : INT32_MAX;
+  if( len > 0 ) {
+    HDFSFILE_NOGIL(self, len = hdfsRead(self->fs, self->file, view.buf, len), 
+		   len == -1, errmsg);
+  }
+  PyBuffer_Release(&view);
+  if( len == -1 ) {
+    return hdfs_raise(errmsg);
+  }
+  return PyLong_FromLong(len);
+}
+
+static PyObject *
+HdfsFile_readall(HdfsFileObject *self, PyObject *unused) {
+  PyObject *buffer;
+  Py_ssize_t size = 0;
+  tSize n;
+  hdfs_errmsg errmsg;
+  if( !hdfsfile_check_open(self) || !hdfsfile_check_mode(self, false) ) {
+    return NULL;
+  }
+  if( (buffer = PyBytes_FromStringAndSize(NULL, HDFSFILE_BUFFER_SIZE)) == NULL ) {
+    return NULL;
+  }
+  for( ;; ) {
+    if( size == PyBytes_GET_SIZE(buffer) && 
+	_PyBytes_Resize(&buffer, size * 2) != 0 ) {
+      return NULL;
+    }
+    HDFSFILE_NOGIL(self, 
+		   n = hdfsRead(self->fs, self->file, 
+				PyBytes_AS_STRING(buffer) + size, 
+				PyBytes_GET_SIZE(buffer) - size < INT32_MAX? 
+				(tSize)(PyBytes_GET_SIZE(buffer) - size) 
+				: INT32_MAX), 
+		   n == -1, errmsg);
+    if( n == -1 ) {
+      Py_DECREF(buffer);
+      return hdfs_raise(errmsg);
+    }
+    if( n == 0 ) {
+      break;
+    }
+    size += n;
+  }
+  if( _PyBytes_Resize(&buffer, size) != 0 ) {
+    return NULL;
+  }
+  return buffer;
+}
+
+static PyObject *
+HdfsFile_read(HdfsFileObject *self, PyObject *args) {
+  Py_ssize_t size = -1;
+  PyObject *buffer;
+  tSize len;
+  hdfs_errmsg errmsg;
+  if( !PyArg_ParseTuple(args, "|n", &size) ) {
+    return NULL;
+  }
+  if( size < 0 ) {
+    return HdfsFile_readall(self, NULL);
+  }
+  if( !hdfsfile_check_open(self) || !hdfsfile_check_mode(self, false) ) {
+    return NULL;
+  }
+  len = size < INT32_MAX? (tSize)size : INT32_MAX;
+  if( (buffer = PyBytes_FromStringAndSize(NULL, len)) == NULL ) {
+    return NULL;
+  }
+  if( len > 0 ) {
+    HDFSFILE_NOGIL(self, 
+		   len = hdfsRead(self->fs, self->file, 
+				  PyBytes_AS_STRING(buffer), len), 
+		   len == -1, errmsg);
+  }
+  if( len == -1 ) {
+    Py_DECREF(buffer);
+    return hdfs_raise(errmsg);
+  }
+  if( len < PyBytes_GET_SIZE(buffer) && _PyBytes_Resize(&buffer, len) != 0 ) {
+    return NULL;
+  }
+  return buffer;
+}
+
+static PyObject *
+HdfsFile_pread(HdfsFileObject *self, PyObject *args) {
+  tOffset offset, pos = -1;
+  Py_ssize_t size;
+  PyObject *buffer;
+  tSize len;
+  hdfs_errmsg errmsg;
+  if( !PyArg_ParseTuple(args, "ln", &offset, &size) ) {
+    return NULL;
+  }
+  if( !hdfsfile_check_open(self) || !hdfsfile_check_mode(self, false) ) {
+    return NULL;
+  }
+  if( offset < 0 || size < 0 ) {
+    PyErr_SetString(PyExc_ValueError, "negative offset or size");
+    return NULL;
+  }
+  len = size < INT32_MAX? (tSize)size : INT32_MAX;
+  if( (buffer = PyBytes_FromStringAndSize(NULL, len)) == NULL ) {
+    return NULL;
+  }
+
+  /*
+   * Read at offset and restore the file position, all under the lock 
+   * so another thread never observes the temporary position.
+   */
+  Py_BEGIN_ALLOW_THREADS
+  PyThread_acquire_lock(self->lock, WAIT_LOCK);
+  if( (pos = hdfsTell(self->fs, self->file)) == -1 
+      || hdfsSeek(self->fs, self->file, offset) != 0 
+      || (len = hdfsfile_read_fully(self, PyBytes_AS_STRING(buffer), len)) == -1 
+      || hdfsSeek(self->fs, self->file, pos) != 0 ) {
+    save_err(errmsg);
+    len = -1;
+  }
+  PyThread_release_lock(self->lock);
+  Py_END_ALLOW_THREADS
+
+  if( len == -1 ) {
+    Py_DECREF(buffer);
+    return hdfs_raise(errmsg);
+  }
+  if( len < PyBytes_GET_SIZE(buffer) && _PyBytes_Resize(&buffer, len) != 0 ) {
+    return NULL;
+  }
+  return buffer;
+}
+
+static PyObject *
+HdfsFile_write(HdfsFileObject *self, PyObject *args) {
+  Py_buffer view;
+  Py_ssize_t done = 0;
+  tSize n;
+  hdfs_errmsg errmsg;
+  if( !PyArg_ParseTuple(args, "y*", &view) ) {
+    return NULL;
+  }
+  if( !hdfsfile_check_open(self) || !hdfsfile_check_mode(self, true) ) {
+    PyBuffer_Release(&view);
+    return NULL;
+  }
+
+  Py_BEGIN_ALLOW_THREADS
+  PyThread_acquire_lock(self->lock, WAIT_LOCK);
+  while( done < view.len ) {
+    tSize todo = view.len - done < INT32_MAX? 
+      (tSize)(view.len - done) : INT32_MAX;
+    if( (n = hdfsWrite(self->fs, self->file, 
+		       (const char *)view.buf + done, todo)) <= 0 ) {
+      save_err(errmsg);
+      break;
+    }
+    done += n;
+  }
+  PyThread_release_lock(self->lock);
+  Py_END_ALLOW_THREADS
+
+  if( done < view.len ) {
+    PyBuffer_Release(&view);
+    return hdfs_raise(errmsg);
+  }
+  PyBuffer_Release(&view);
+  return PyLong_FromSsize_t(done);
+}
+
+static PyObject *
+HdfsFile_tell(HdfsFileObject *self, PyObject *unused) {
+  tOffset pos;
+  hdfs_errmsg errmsg;
+  if( !hdfsfile_check_open(self) ) {
+    return NULL;
+  }
+  HDFSFILE_NOGIL(self, pos = hdfsTell(self->fs, self->file), 
+		 pos == -1, errmsg);
+  if( pos == -1 ) {
+    return hdfs_raise(errmsg);
+  }
+  return PyLong_FromLong(pos);
+}
+
+static PyObject *
+HdfsFile_seek(HdfsFileObject *self, PyObject *args) {
+  tOffset pos, base = 0;
+  int whence = SEEK_SET, erc;
+  hdfsFileInfo *info;
+  hdfs_errmsg errmsg;
+  if( !PyArg_ParseTuple(args, "l|i", &pos, &whence) ) {
+    return NULL;
+  }
+  if( !hdfsfile_check_open(self) || !hdfsfile_check_mode(self, false) ) {
+    return NULL;
+  }
+
+  switch( whence ) {
+  case SEEK_SET: 
+    break;
+  case SEEK_CUR: 
+    HDFSFILE_NOGIL(self, base = hdfsTell(self->fs, self->file), 
+		   base == -1, errmsg);
+    if( base == -1 ) {
+      return hdfs_raise(errmsg);
+    }
+    break;
+  case SEEK_END: 
+    HDFS_NOGIL(info = hdfsGetPathInfo(self->fs, PyUnicode_AsUTF8(self->name)), 
+	       info == NULL, errmsg);
+    if( info == NULL ) {
+      return hdfs_raise(errmsg);
+    }
+    base = info->mSize;
+    hdfsFreeFileInfo(info, 1);
+    break;
+  default:
+    PyErr_Format(PyExc_ValueError, "invalid whence (%d)", whence);
+    return NULL;
+  }
+
+  if( (pos += base) < 0 ) {
+    PyErr_SetString(PyExc_ValueError, "negative seek position");
+    return NULL;
+  }
+  HDFSFILE_NOGIL(self, erc = hdfsSeek(self->fs, self->file, pos), 
+		 erc != 0, errmsg);
+  if( erc != 0 ) {
+    return hdfs_raise(errmsg);
+  }
+  return PyLong_FromLong(pos);
+}
+
+static PyObject *
+HdfsFile_flush(HdfsFileObject *self, PyObject *unused) {
+  int erc;
+  hdfs_errmsg errmsg;
+  if( !hdfsfile_check_open(self) ) {
+    return NULL;
+  }
+  if( self->writable ) {
+    HDFSFILE_NOGIL(self, erc = hdfsFlush(self->fs, self->file), 
+		   erc != 0, errmsg);
+    if( erc != 0 ) {
+      return hdfs_raise(errmsg);
+    }
+  }
+  Py_RETURN_NONE;
+}
+
+static PyObject *
+HdfsFile_close(HdfsFileObject *self, PyObject *unused) {
+  hdfs_errmsg errmsg;
+  if( self->file != NULL && hdfsfile_close(self, errmsg) != 0 ) {
+    return hdfs_raise(errmsg);
+  }
+  Py_RETURN_NONE;
+}
+
+static PyObject *
+HdfsFile_readable(HdfsFileObject *self, PyObject *unused) {
+  if( !hdfsfile_check_open(self) ) {
+    return NULL;
+  }
+  return PyBool_FromLong(!self->writable);
+}
+
+static PyObject *
+HdfsFile_writable(HdfsFileObject *self, PyObject *unused) {
+  if( !hdfsfile_check_open(self) ) {
+    return NULL;
+  }
+  return PyBool_FromLong(self->writable);
+}
+
+static PyObject *
+HdfsFile_isatty(HdfsFileObject *self, PyObject *unused) {
+  if( !hdfsfile_check_open(self) ) {
+    return NULL;
+  }
+  Py_RETURN_FALSE;
+}
+
+static PyObject *
+HdfsFile_enter(HdfsFileObject *self, PyObject *unused) {
+  if( !hdfsfile_check_open(self) ) {
+    return NULL;
+  }
+  Py_INCREF(self);
+  return (PyObject *)self;
+}
+
+static PyObject *
+HdfsFile_exit(HdfsFileObject *self, PyObject *args) {
+  return HdfsFile_close(self, NULL);
+}
+
+static PyObject *
+HdfsFile_get_closed(HdfsFileObject *self, void *closure) {
+  return PyBool_FromLong(self->file == NULL);
+}
+
+static PyMethodDef HdfsFile_methods[] = {
+  { "readinto", (PyCFunction)HdfsFile_readinto, METH_VARARGS, 
+    PyDoc_STR("Read into a writable buffer, return the number of bytes read") }, 
+  { "read", (PyCFunction)HdfsFile_read, METH_VARARGS, 
+    PyDoc_STR("Read at most size bytes, everything if size is negative") }, 
+  { "readall", (PyCFunction)HdfsFile_readall, METH_NOARGS, 
+    PyDoc_STR("Read until the end of the file") }, 
+  { "pread", (PyCFunction)HdfsFile_pread, METH_VARARGS, 
+    PyDoc_STR("Read size bytes at offset without moving the file position") }, 
+  { "write", (PyCFunction)HdfsFile_write, METH_VARARGS, 
+    PyDoc_STR("Write a bytes-like object, return the number of bytes written") }, 
+  { "seek", (PyCFunction)HdfsFile_seek, METH_VARARGS, 
+    PyDoc_STR("Move to a new file position, return it") }, 
+  { "tell", (PyCFunction)HdfsFile_tell, METH_NOARGS, 
+    PyDoc_STR("Return the current file position") }, 
+  { "flush", (PyCFunction)HdfsFile_flush, METH_NOARGS, 
+    PyDoc_STR("Flush the data written so far to the datanodes") }, 
+  { "close", (PyCFunction)HdfsFile_close, METH_NOARGS, 
+    PyDoc_STR("Close the file") }, 
+  { "readable", (PyCFunction)HdfsFile_readable, METH_NOARGS, 
+    PyDoc_STR("True if the file was opened for reading") }, 
+  { "writable", (PyCFunction)HdfsFile_writable, METH_NOARGS, 
+    PyDoc_STR("True if the file was opened for writing") }, 
+  { "seekable", (PyCFunction)HdfsFile_readable, METH_NOARGS, 
+    PyDoc_STR("True if the file supports seek, only files open for reading do") }, 
+  { "isatty", (PyCFunction)HdfsFile_isatty, METH_NOARGS, 
+    PyDoc_STR("Always False") }, 
+  { "__enter__", (PyCFunction)HdfsFile_enter, METH_NOARGS, NULL }, 
+  { "__exit__", (PyCFunction)HdfsFile_exit, METH_VARARGS, NULL }, 
+  { NULL, NULL, 0, NULL },
+};
+
+static PyMemberDef HdfsFile_members[] = {
+  { "name", T_OBJECT, offsetof(HdfsFileObject, name), READONLY, 
+    PyDoc_STR("path of the file") }, 
+  { "mode", T_OBJECT, offsetof(HdfsFileObject, mode), READONLY, 
+    PyDoc_STR("mode the file was opened with") }, 
+  { NULL, 0, 0, 0, NULL },
+};
+
+static PyGetSetDef HdfsFile_getset[] = {
+  { "closed", (getter)HdfsFile_get_closed, NULL, 
+    PyDoc_STR("True if the file is closed"), NULL }, 
+  { NULL, NULL, NULL, NULL, NULL },
+};
+
+static PyTypeObject HdfsFile_Type = {
+  PyVarObject_HEAD_INIT(NULL, 0)
+  .tp_name = "hdfs3py.HdfsFile",
+  .tp_basicsize = sizeof(HdfsFileObject),
+  .tp_dealloc = (destructor)HdfsFile_dealloc,
+  .tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE,
+  .tp_doc = "HdfsFile(fs, path, mode='r', buffer_size=0, replication=0, "
+            "block_size=0)\n\nRaw unbuffered file on HDFS, "
+            "mode is one of 'r', 'w' or 'a', optionally followed by 'b'",
+  .tp_methods = HdfsFile_methods,
+  .tp_members = HdfsFile_members,
+  .tp_getset = HdfsFile_getset,
+  .tp_init = (initproc)HdfsFile_init,
+  .tp_new = HdfsFile_new,
+};
+
+static const char open_doc[] = 
+  "Open a file as a buffered io object, "
+  "open(fs, path, mode='rb', buffering=-1, readahead=-1)";
+static PyObject *
+hdfs_open(PyObject *self, PyObject * args, PyObject *keywords) {
+  static char *okwords[] = { "fs", "path", "mode", 
+			     "buffering", "readahead", NULL };
+  PyObject *fs_capsule, *path, *raw, *output;
+  const char *mode = "rb";
+  Py_ssize_t buffering = -1;
+  tOffset readahead = -1;
+  int erc;
+  hdfs_errmsg errmsg;
+
+  if( !PyArg_ParseTupleAndKeywords(args, keywords, "OU|snl", okwords, 
+				   &fs_capsule, &path, &mode, 
+				   &buffering, &readahead) ) {
+    return NULL;
+  }
+
+  if( (raw = PyObject_CallFunction((PyObject *)&HdfsFile_Type, "OOs", 
+				   fs_capsule, path, mode)) == NULL ) {
+    return NULL;
+  }
+
+  if( readahead >= 0 && !((HdfsFileObject *)raw)->writable ) {
+    HdfsFileObject *file = (HdfsFileObject *)raw;
+    HDFS_NOGIL(erc = hdfsFileSetReadahead(file->fs, file->file, readahead), 
+	       erc != 0, errmsg);
+    if( erc != 0 ) {
+      Py_DECREF(raw);
+      return hdfs_raise(errmsg);
+    }
+  }
+
+  if( buffering == 0 ) {
+    return raw;
+  }
+  if( buffering < 0 ) {
+    buffering = HDFSFILE_BUFFER_SIZE;
+  }
+  output = PyObject_CallMethod(io_module, 
+			       ((HdfsFileObject *)raw)->writable? 
+			       "BufferedWriter" : "BufferedReader", 
+			       "On", raw, buffering);
+  Py_DECREF(raw);
+  return output;
+}
+
+/*
+ * download_many/upload_many - copy many files between HDFS and the
+ * local disk with a pool of native threads.  The GIL is released for
+ * the whole transfer, each worker owns a large buffer and takes the
+ * next pair from a shared index.
+ */
+typedef struct {
+  char *src;
+  char *dst;
+  tOffset bytes;
+  bool failed;
+  hdfs_errmsg errmsg;
+} transfer_job;
+
+typedef struct {
+  hdfsFS fs;
+  bool upload;
+  size_t buffer_size;
+  transfer_job *jobs;
+  Py_ssize_t njobs;
+  Py_ssize_t next;
+  pthread_mutex_t mutex;
+} transfer_pool;
+
+typedef struct {
+  transfer_pool *pool;
+  char *buf;
+} transfer_worker_arg;
+
+static PyTypeObject * TransferResult_Type = NULL;
+
+static void 
+TransferResult_NewType() {
+  static PyStructSequence_Field fields[] = 
+    { { "src", "path copied from" }, 
+      { "dst", "path copied to" }, 
+      { "bytes", "number of bytes copied" }, 
+      { "error", "error message, None if the copy succeeded" }, 
+      { NULL, NULL }
+    };
+  static PyStructSequence_Desc desc = 
+    { .name = "hdfs3py.TransferResult", 
+      .doc = "Outcome of one copy of download_many or upload_many", 
+      .fields = fields, 
+      .n_in_sequence = sizeof(fields)/sizeof(fields[0]) - 1
+    };
+  TransferResult_Type = PyStructSequence_NewType(&desc);
+}
+
+static bool
+transfer_fail(transfer_job *job, const char *path, const char *msg) {
+  snprintf(job->errmsg, sizeof(job->errmsg), "%s: %s", path, msg);
+  job->failed = true;
+  return false;
+}
+
+/* write the whole buffer, a short write is not an error */
+static bool
+write_fully(int fd, const char *buf, size_t len) {
+  ssize_t n;
+
+  while( len > 0 ) {
+    if( (n = write(fd, buf, len)) == -1 ) {
+      if( errno == EINTR ) {
+	continue;
+      }
+      return false;
+    }
+    if( n == 0 ) {
+      errno = EIO;
+      return false;
+    }
+    buf += n;
+    len -= n;
+  }
+  return true;
+}
+
+/* copy one file from HDFS, filling the buffer before each local write */
+static bool
+transfer_download(hdfsFS fs, transfer_job *job, char *buf, size_t size) {
+  hdfsFile in;
+  int out;
+  tSize n = 0;
+  size_t filled;
+
+  if( (in = hdfsOpenFile(fs, job->src, O_RDONLY, 0, 0, 0)) == NULL ) {
+    return transfer_fail(job, job->src, hdfsGetLastError());
+  }
+  if( (out = open(job->dst, O_WRONLY | O_CREAT | O_TRUNC, 0666)) == -1 ) {
+    transfer_fail(job, job->dst, strerror(errno));
+    hdfsCloseFile(fs, in);
+    return false;
+  }
+
+  do {
+    for( filled = 0; filled < size; filled += n ) {
+      if( (n = hdfsRead(fs, in, buf + filled, size - filled)) <= 0 ) {
+	break;
+      }
+    }
+    if( n == -1 ) {
+      transfer_fail(job, job->src, hdfsGetLastError());
+      break;
+    }
+    if( !write_fully(out, buf, filled) ) {
+      transfer_fail(job, job->dst, strerror(errno));
+      break;
+    }
+    job->bytes += filled;
+  } while( filled == size );
+
+  if( close(out) != 0 && !job->failed ) {
+    transfer_fail(job, job->dst, strerror(errno));
+  }
+  hdfsCloseFile(fs, in);
+  return !job->failed;
+}
+
+static bool
+transfer_upload(hdfsFS fs, transfer_job *job, char *buf, size_t size) {
+  hdfsFile out;
+  int in;
+  ssize_t n;
+
+  if( (in = open(job->src, O_RDONLY)) == -1 ) {
+    return transfer_fail(job, job->src, strerror(errno));
+  }
+  if( (out = hdfsOpenFile(fs, job->dst, O_WRONLY, 0, 0, 0)) == NULL ) {
+    transfer_fail(job, job->dst, hdfsGetLastError());
+    close(in);
+    return false;
+  }
+
+  while( (n = read(in, buf, size)) != 0 ) {
+    if( n == -1 ) {
+      if( errno == EINTR ) {
+	continue;
+      }
+      transfer_fail(job, job->src, strerror(errno));
+      break;
+    }
+    if( hdfsWrite(fs, out, buf, n) != n ) {
+      transfer_fail(job, job->dst, hdfsGetLastError());
+      break;
+    }
+    job->bytes += n;
+  }
+
+  /* closing completes the file on the namenode and may fail */
+  if( hdfsCloseFile(fs, out) != 0 && !job->failed ) {
+    transfer_fail(job, job->dst, hdfsGetLastError());
+  }
+  close(in);
+  return !job->failed;
+}
+
+static void *
+transfer_worker(void *arg) {
+  transfer_pool *pool = ((transfer_worker_arg *)arg)->pool;
+  char *buf = ((transfer_worker_arg *)arg)->buf;
+  Py_ssize_t i;
+
+  for( ;; ) {
+    pthread_mutex_lock(&pool->mutex);
+    i = pool->next < pool->njobs? pool->next++ : -1;
+    pthread_mutex_unlock(&pool->mutex);
+    if( i == -1 ) {
+      break;
+    }
+    if( pool->upload ) {
+      transfer_upload(pool->fs, pool->jobs + i, buf, pool->buffer_size);
+    } else {
+      transfer_download(pool->fs, pool->jobs + i, buf, pool->buffer_size);
+    }
+  }
+  return NULL;
+}
+
+static PyObject *
+transfer_many(PyObject * args, PyObject *keywords, bool upload) {
+  static char *okwords[] = { "fs", "pairs", "threads", "buffer_size", NULL };
+  transfer_pool pool = { .upload = upload, .buffer_size = 4 * 1024 * 1024 };
+  PyObject *pairs, *seq, *output = NULL;
+  pthread_t *threads = NULL;
+  transfer_worker_arg *workers = NULL;
+  int nthreads = 8, started = 0;
+  Py_ssize_t i, buffer_size = pool.buffer_size;
+
+  if( !PyArg_ParseTupleAndKeywords(args, keywords, "O&O|in", okwords, 
+				   extract_fs, &pool.fs, &pairs, 
+				   &nthreads, &buffer_size) ) {
+    return NULL;
+  }
+  if( nthreads <= 0 || buffer_size <= 0 ) {
+    PyErr_SetString(PyExc_ValueError, 
+		    "threads and buffer_size must be positive");
+    return NULL;
+  }
+  /* each buffer goes to hdfsRead/hdfsWrite at once */
+  pool.buffer_size = buffer_size < INT32_MAX? buffer_size : INT32_MAX;
+  if( (seq = PySequence_Fast(pairs, "pairs must be a sequence")) == NULL ) {
+    return NULL;
+  }
+
+  pool.njobs = PySequence_Fast_GET_SIZE(seq);
+  if( (pool.jobs = calloc(pool.njobs + 1, sizeof(transfer_job))) == NULL ) {
+    Py_DECREF(seq);
+    return PyErr_NoMemory();
+  }
+  for( i=0; i < pool.njobs; i++ ) {
+    const char *src, *dst;
+    if( !PyArg_ParseTuple(PySequence_Fast_GET_ITEM(seq, i), "ss", &src, &dst) ) {
+      goto done;
+    }
+    pool.jobs[i].src = strdup(src);
+    pool.jobs[i].dst = strdup(dst);
+    if( pool.jobs[i].src == NULL || pool.jobs[i].dst == NULL ) {
+      PyErr_NoMemory();
+      goto done;
+    }
+  }
+
+  if( nthreads > pool.njobs ) {
+    nthreads = pool.njobs;
+  }
+  if( (threads = calloc(nthreads + 1, sizeof(pthread_t))) == NULL ||
+      (workers = calloc(nthreads + 1, sizeof(transfer_worker_arg))) == NULL ) {
+    PyErr_NoMemory();
+    goto done;
+  }
+  /*
+   * allocate every buffer up front, so no job is left unprocessed by a
+   * worker which could not get one; the last one is the calling thread's
+   */
+  for( i=0; i <= nthreads; i++ ) {
+    workers[i].pool = &pool;
+    if( (workers[i].buf = malloc(pool.buffer_size)) == NULL ) {
+      PyErr_NoMemory();
+      goto done;
+    }
+  }
+
+  Py_BEGIN_ALLOW_THREADS
+  pthread_mutex_init(&pool.mutex, NULL);
+  for( started = 0; started < nthreads; started++ ) {
+    if( pthread_create(threads + started, NULL, 
+		       transfer_worker, workers + started) != 0 ) {
+      break;
+    }
+  }
+  /* the calling thread works too, so a failed pthread_create is harmless */
+  transfer_worker(workers + nthreads);
+  for( i=0; i < started; i++ ) {
+    pthread_join(threads[i], NULL);
+  }
+  pthread_mutex_destroy(&pool.mutex);
+  Py_END_ALLOW_THREADS
+
+  if( TransferResult_Type == NULL ) {
+    TransferResult_NewType();
+  }
+  if( (output = PyList_New(pool.njobs)) == NULL ) {
+    goto done;
+  }
+  for( i=0; i < pool.njobs; i++ ) {
+    transfer_job *job = pool.jobs + i;
+    PyObject *elem = PyStructSequence_New(TransferResult_Type);
+    if( elem == NULL ) {
+      Py_CLEAR(output);
+      goto done;
+    }
+    PyList_SET_ITEM(output, i, elem);
+    PyStructSequence_SET_ITEM(elem, 0, PyUnicode_FromString(job->src));
+    PyStructSequence_SET_ITEM(elem, 1, PyUnicode_FromString(job->dst));
+    PyStructSequence_SET_ITEM(elem, 2, PyLong_FromLong(job->bytes));
+    if( job->failed ) {
+      PyStructSequence_SET_ITEM(elem, 3, PyUnicode_FromString(job->errmsg));
+    } else {
+      Py_INCREF(Py_None);
+      PyStructSequence_SET_ITEM(elem, 3, Py_None);
+    }
+    if( PyErr_Occurred() ) {
+      Py_CLEAR(output);
+      goto done;
+    }
+  }
+
+ done:
+  for( i=0; i < pool.njobs; i++ ) {
+    free(pool.jobs[i].src);
+    free(pool.jobs[i].dst);
+  }
+  free(pool.jobs);
+  if( workers != NULL ) {
+    for( i=0; i <= nthreads; i++ ) {
+      free(workers[i].buf);
+    }
+  }
+  free(workers);
+  free(threads);
+  Py_DECREF(seq);
+  return output;
+}
+
+static const char download_many_doc[] = 
+  "Copy files from HDFS to the local disk in parallel, "
+  "download_many(fs, [(hdfs_path, local_path), ...], threads=8, "
+  "buffer_size=4MiB), returns a list of TransferResult";
+static PyObject *
+download_many(PyObject *self, PyObject * args, PyObject *keywords) {
+  return transfer_many(args, keywords, false);
+}
+
+static const char upload_many_doc[] = 
+  "Copy files from the local disk to HDFS in parallel, "
+  "upload_many(fs, [(local_path, hdfs_path), ...], threads=8, "
+  "buffer_size=4MiB), returns a list of TransferResult";
+static PyObject *
+upload_many(PyObject *self, PyObject * args, PyObject *keywords) {
+  return transfer_many(args, keywords, true);
+}
+
 enum { METH_KWARGS = METH_VARARGS | METH_KEYWORDS };
 
 static PyMethodDef methods[] = {
@@ -1382,12 +2724,14 @@ static PyMethodDef methods[] = {
   { "confGetInt", (PyCFunction)confGetInt, METH_VARARGS, PyDoc_STR(confGetInt_doc) }, 
   { "confStrFree", (PyCFunction)confStrFree, METH_VARARGS, PyDoc_STR(confStrFree_doc) }, 
   { "disconnect", (PyCFunction)disconnect, METH_VARARGS, PyDoc_STR(disconnect_doc) }, 
+  { "open", (PyCFunction)hdfs_open, METH_KWARGS, PyDoc_STR(open_doc) }, 
   { "openFile", (PyCFunction)openFile, METH_VARARGS, PyDoc_STR(openFile_doc) }, 
   { "closeFile", (PyCFunction)closeFile, METH_VARARGS, PyDoc_STR(closeFile_doc) }, 
   { "exists", (PyCFunction)exists, METH_VARARGS, PyDoc_STR(exists_doc) }, 
   { "seek", (PyCFunction)hdfs_seek, METH_VARARGS, PyDoc_STR(seek_doc) }, 
   { "tell", (PyCFunction)hdfs_tell, METH_VARARGS, PyDoc_STR(tell_doc) }, 
   { "read", (PyCFunction)hdfs_read, METH_VARARGS, PyDoc_STR(read_doc) }, 
+  { "readinto", (PyCFunction)hdfs_readinto, METH_VARARGS, PyDoc_STR(readinto_doc) }, 
   { "write", (PyCFunction)hdfs_write, METH_VARARGS, PyDoc_STR(write_doc) }, 
   { "flush", (PyCFunction)flush, METH_VARARGS, PyDoc_STR(flush_doc) }, 
   { "hFlush", (PyCFunction)hFlush, METH_VARARGS, PyDoc_STR(hFlush_doc) }, 
@@ -1402,6 +2746,8 @@ static PyMethodDef methods[] = {
   { "createDirectory", (PyCFunction)createDirectory, METH_VARARGS, PyDoc_STR(createDirectory_doc) }, 
   { "setReplication", (PyCFunction)setReplication, METH_VARARGS, PyDoc_STR(setReplication_doc) }, 
   { "listDirectory", (PyCFunction)listDirectory, METH_VARARGS, PyDoc_STR(listDirectory_doc) }, 
+  { "iterDirectory", (PyCFunction)iterDirectory, METH_VARARGS, PyDoc_STR(iterDirectory_doc) }, 
+  { "listDirectoryColumns", (PyCFunction)listDirectoryColumns, METH_VARARGS, PyDoc_STR(listDirectoryColumns_doc) }, 
   { "getPathInfo", (PyCFunction)getPathInfo, METH_VARARGS, PyDoc_STR(getPathInfo_doc) }, 
   { "freeFileInfo", (PyCFunction)freeFileInfo, METH_VARARGS, PyDoc_STR(freeFileInfo_doc) }, 
   { "getHosts", (PyCFunction)getHosts, METH_VARARGS, PyDoc_STR(getHosts_doc) }, 
@@ -1420,6 +2766,8 @@ static PyMethodDef methods[] = {
   { "getHANamenodes", (PyCFunction)getHANamenodes, METH_VARARGS, PyDoc_STR(getHANamenodes_doc) }, 
   { "freeNamenodeInformation", (PyCFunction)freeNamenodeInformation, METH_VARARGS, PyDoc_STR(freeNamenodeInformation_doc) }, 
   { "getFileBlockLocations", (PyCFunction)getFileBlockLocations, METH_VARARGS, PyDoc_STR(getFileBlockLocations_doc) }, 
+  { "download_many", (PyCFunction)download_many, METH_KWARGS, PyDoc_STR(download_many_doc) }, 
+  { "upload_many", (PyCFunction)upload_many, METH_KWARGS, PyDoc_STR(upload_many_doc) }, 
   { "freeFileBlockLocations", (PyCFunction)freeFileBlockLocations, METH_VARARGS, PyDoc_STR(freeFileBlockLocations_doc) }, 
   { NULL, NULL, 0, NULL },
 };
@@ -1436,6 +2784,35 @@ static struct PyModuleDef module = {
 PyMODINIT_FUNC
 PyInit_hdfs3py(void)
 {
+  PyObject *m, *base, *erc;
   printf("%ld methods in %s\n", sizeof(methods)/sizeof(*methods), module_name);
-  return PyModule_Create(&module);
+
+  if( PyType_Ready(&HdfsFile_Type) < 0 
+      || PyType_Ready(&DirectoryIterator_Type) < 0 ) {
+    return NULL;
+  }
+  if( io_module == NULL && (io_module = PyImport_ImportModule("io")) == NULL ) {
+    return NULL;
+  }
+  /* HdfsFile is an io.RawIOBase to isinstance() and the io classes */
+  if( (base = PyObject_GetAttrString(io_module, "RawIOBase")) == NULL ) {
+    return NULL;
+  }
+  erc = PyObject_CallMethod(base, "register", "O", (PyObject *)&HdfsFile_Type);
+  Py_DECREF(base);
+  if( erc == NULL ) {
+    return NULL;
+  }
+  Py_DECREF(erc);
+
+  if( (m = PyModule_Create(&module)) == NULL ) {
+    return NULL;
+  }
+  Py_INCREF(&HdfsFile_Type);
+  if( PyModule_AddObject(m, "HdfsFile", (PyObject *)&HdfsFile_Type) != 0 ) {
+    Py_DECREF(&HdfsFile_Type);
+    Py_DECREF(m);
+    return NULL;
+  }
+  return m;
 }
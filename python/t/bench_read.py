@@ -0,0 +1,87 @@
+"""Multi-threaded read benchmark for hdfs3py.
+
+Every thread opens its own handle and reads a disjoint slice of one
+file.  With the GIL released around libhdfs3 calls the throughput
+should grow with the number of threads until the network or the
+datanodes saturate.
+
+Environment:
+  HDFS3PY_NAMENODE  namenode host (default localhost)
+  HDFS3PY_PORT      namenode port (default 9000)
+  HDFS3PY_FILE      file to read, created if missing (default
+                    /tmp/hdfs3py_bench_read)
+  HDFS3PY_SIZE      size of the created file in MB (default 256)
+  HDFS3PY_THREADS   thread counts to try (default 1,2,4,8)
+"""
+
+import os
+import sys
+import threading
+import time
+
+import hdfs3py
+
+CHUNK = 1 << 20
+
+
+def create(fs, path, size):
+    f = hdfs3py.openFile(fs, path, os.O_WRONLY, 0, 0, 0)
+    data = os.urandom(CHUNK)
+    written = 0
+    while written < size:
+        written += hdfs3py.write(fs, f, data, min(CHUNK, size - written))
+    hdfs3py.closeFile(fs, f)
+
+
+def read_slice(fs, path, start, end):
+    f = hdfs3py.openFile(fs, path, os.O_RDONLY, 0, 0, 0)
+    hdfs3py.seek(fs, f, start)
+    buf = memoryview(bytearray(CHUNK))
+    pos = start
+    while pos < end:
+        n = hdfs3py.readinto(fs, f, buf[:min(CHUNK, end - pos)])
+        if n == 0:
+            break
+        pos += n
+    hdfs3py.closeFile(fs, f)
+
+
+def run(fs, path, size, nthreads):
+    step = size // nthreads
+    threads = [threading.Thread(target=read_slice,
+                                args=(fs, path, i * step, (i + 1) * step))
+               for i in range(nthreads)]
+    begin = time.time()
+    for t in threads:
+        t.start()
+    for t in threads:
+        t.join()
+    return time.time() - begin
+
+
+def main():
+    nn = os.environ.get('HDFS3PY_NAMENODE', 'localhost')
+    port = int(os.environ.get('HDFS3PY_PORT', '9000'))
+    path = os.environ.get('HDFS3PY_FILE', '/tmp/hdfs3py_bench_read')
+    size = int(os.environ.get('HDFS3PY_SIZE', '256')) << 20
+    counts = [int(n) for n in
+              os.environ.get('HDFS3PY_THREADS', '1,2,4,8').split(',')]
+
+    fs = hdfs3py.connect(nn, port)
+    try:
+        hdfs3py.exists(fs, path)
+    except Exception:
+        create(fs, path, size)
+
+    base = None
+    for n in counts:
+        elapsed = run(fs, path, size, n)
+        mbps = size / elapsed / (1 << 20)
+        base = base or mbps
+        print('%2d threads: %8.1f MB/s  speedup %.2fx' % (n, mbps, mbps / base))
+    hdfs3py.disconnect(fs)
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
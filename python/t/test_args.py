@@ -0,0 +1,52 @@
+"""Argument and mode parsing of hdfs3py.
+
+None of the calls reach a namenode: they either fail while parsing the
+arguments or on the invalid filesystem handle passed in place of a
+connection, so the tests run without a cluster.
+
+  PYTHONPATH=. python t/test_args.py
+"""
+
+import unittest
+
+import hdfs3py
+
+
+class ModeTest(unittest.TestCase):
+
+    def test_invalid_modes(self):
+        for mode in ("", "r+", "rw", "w+", "rt", "x", "bw", "rbb"):
+            with self.assertRaisesRegex(ValueError, "invalid mode"):
+                hdfs3py.HdfsFile(None, "/tmp/f", mode)
+            with self.assertRaisesRegex(ValueError, "invalid mode"):
+                hdfs3py.open(None, "/tmp/f", mode)
+
+    def test_valid_modes(self):
+        # a valid mode gets as far as the filesystem handle
+        for mode in ("r", "rb", "w", "wb", "a", "ab"):
+            with self.assertRaises(Exception) as cm:
+                hdfs3py.HdfsFile(None, "/tmp/f", mode)
+            self.assertNotIn("invalid mode", str(cm.exception))
+
+
+class ArgumentTest(unittest.TestCase):
+
+    def test_path_arguments(self):
+        with self.assertRaises(TypeError):
+            hdfs3py.utime(None, 1, 2)
+        with self.assertRaises(TypeError):
+            hdfs3py.truncate(None, 1)
+        with self.assertRaises(TypeError):
+            hdfs3py.getFileBlockLocations(None, "/tmp/f")
+
+    def test_invalid_filesystem(self):
+        with self.assertRaises(Exception) as cm:
+            hdfs3py.utime(None, "/tmp/f", 1, 2)
+        self.assertNotIsInstance(cm.exception, TypeError)
+        with self.assertRaises(Exception) as cm:
+            hdfs3py.rename(None, "/tmp/f", "/tmp/g")
+        self.assertNotIsInstance(cm.exception, TypeError)
+
+
+if __name__ == "__main__":
+    unittest.main()
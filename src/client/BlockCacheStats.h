@@ -0,0 +1,152 @@
+/********************************************************************
+ * Copyright (c) 2013 - 2014, Pivotal Inc.
+ * All rights reserved.
+ *
+ * Author: Zhanwei Wang
+ ********************************************************************/
+/********************************************************************
+ * 2014 -
+ * open source under Apache License Version 2.0
+ ********************************************************************/
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef _HDFS_LIBHDFS3_CLIENT_BLOCKCACHESTATS_H_
+#define _HDFS_LIBHDFS3_CLIENT_BLOCKCACHESTATS_H_
+
+#include <stdint.h>
+
+namespace Hdfs {
+
+/**
+ * Statistics of the client side block range cache of a file system.
+ */
+class BlockCacheStats {
+public:
+    /**
+     * To construct an empty BlockCacheStats.
+     */
+    BlockCacheStats() :
+        capacity(0), cachedBytes(0), hits(0), misses(0), hitBytes(0),
+        missBytes(0), evictedBytes(0) {
+    }
+
+    /**
+     * Return the byte budget of the cache, 0 if the cache is disabled.
+     * @return the capacity in bytes.
+     */
+    int64_t getCapacity() const {
+        return capacity;
+    }
+
+    void setCapacity(int64_t capacity) {
+        this->capacity = capacity;
+    }
+
+    /**
+     * Return the number of bytes held by the cache.
+     * @return the cached bytes.
+     */
+    int64_t getCachedBytes() const {
+        return cachedBytes;
+    }
+
+    void setCachedBytes(int64_t cachedBytes) {
+        this->cachedBytes = cachedBytes;
+    }
+
+    /**
+     * Return the number of reads served from the cache.
+     * @return the number of hits.
+     */
+    int64_t getHits() const {
+        return hits;
+    }
+
+    void setHits(int64_t hits) {
+        this->hits = hits;
+    }
+
+    /**
+     * Return the number of reads which had to fetch a range from a datanode.
+     * @return the number of misses.
+     */
+    int64_t getMisses() const {
+        return misses;
+    }
+
+    void setMisses(int64_t misses) {
+        this->misses = misses;
+    }
+
+    /**
+     * Return the number of bytes served from the cache.
+     * @return the hit bytes.
+     */
+    int64_t getHitBytes() const {
+        return hitBytes;
+    }
+
+    void setHitBytes(int64_t hitBytes) {
+        this->hitBytes = hitBytes;
+    }
+
+    /**
+     * Return the number of bytes fetched from datanodes into the cache.
+     * @return the miss bytes.
+     */
+    int64_t getMissBytes() const {
+        return missBytes;
+    }
+
+    void setMissBytes(int64_t missBytes) {
+        this->missBytes = missBytes;
+    }
+
+    /**
+     * Return the number of bytes evicted from the cache.
+     * @return the evicted bytes.
+     */
+    int64_t getEvictedBytes() const {
+        return evictedBytes;
+    }
+
+    void setEvictedBytes(int64_t evictedBytes) {
+        this->evictedBytes = evictedBytes;
+    }
+
+    /**
+     * Return the fraction of reads served from the cache.
+     * @return the hit ratio between 0 and 1.
+     */
+    double getHitRatio() const {
+        int64_t total = hits + misses;
+        return total > 0 ? static_cast<double>(hits) / total : 0;
+    }
+
+private:
+    int64_t capacity;
+    int64_t cachedBytes;
+    int64_t hits;
+    int64_t misses;
+    int64_t hitBytes;
+    int64_t missBytes;
+    int64_t evictedBytes;
+};
+
+}
+#endif /* _HDFS_LIBHDFS3_CLIENT_BLOCKCACHESTATS_H_ */
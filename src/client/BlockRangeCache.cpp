@@ -0,0 +1,180 @@
+/********************************************************************
+ * Copyright (c) 2013 - 2014, Pivotal Inc.
+ * All rights reserved.
+ *
+ * Author: Zhanwei Wang
+ ********************************************************************/
+/********************************************************************
+ * 2014 -
+ * open source under Apache License Version 2.0
+ ********************************************************************/
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "client/BlockRangeCache.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace Hdfs {
+namespace Internal {
+
+BlockRangeCache::BlockRangeCache(int64_t capacity, int32_t rangeSize) :
+    rangeSize(rangeSize), capacity(capacity),
+    //80% of the budget for ranges read more than once.
+    protectedCapacity(capacity / 5 * 4), probationBytes(0), protectedBytes(0),
+    hits(0), misses(0), hitBytes(0), missBytes(0), evictedBytes(0) {
+    assert(rangeSize > 0);
+}
+
+BlockRangeCache::BlockRangeCache(const SessionConfig & conf) :
+    rangeSize(conf.getBlockCacheRangeSize()), capacity(conf.getBlockCacheSize()),
+    protectedCapacity(capacity / 5 * 4), probationBytes(0), protectedBytes(0),
+    hits(0), misses(0), hitBytes(0), missBytes(0), evictedBytes(0) {
+}
+
+int32_t BlockRangeCache::read(const BlockRangeKey & key, int64_t skip,
+                              char * buf, int32_t size) {
+    Range data;
+    int32_t len;
+    {
+        lock_guard<mutex> lock(mut);
+        unordered_map<BlockRangeKey, Entry>::iterator it = entries.find(key);
+
+        if (it == entries.end()
+                || skip >= static_cast<int64_t>(it->second.data->size())) {
+            ++misses;
+            return -1;
+        }
+
+        Entry & entry = it->second;
+        int64_t bytes = entry.data->size();
+
+        if (entry.isProtected) {
+            protectedRanges.splice(protectedRanges.begin(), protectedRanges,
+                                   entry.pos);
+        } else {
+            /*
+             * second hit, promote and demote the coldest protected ranges.
+             */
+            probation.erase(entry.pos);
+            probationBytes -= bytes;
+            protectedRanges.push_front(key);
+            entry.pos = protectedRanges.begin();
+            entry.isProtected = true;
+            protectedBytes += bytes;
+
+            while (protectedBytes > protectedCapacity
+                    && protectedRanges.size() > 1) {
+                Entry & cold = entries.find(protectedRanges.back())->second;
+                int64_t coldBytes = cold.data->size();
+                probation.push_front(protectedRanges.back());
+                protectedRanges.pop_back();
+                cold.pos = probation.begin();
+                cold.isProtected = false;
+                protectedBytes -= coldBytes;
+                probationBytes += coldBytes;
+            }
+        }
+
+        data = entry.data;
+        len = static_cast<int32_t>(std::min<int64_t>(size, bytes - skip));
+        ++hits;
+        hitBytes += len;
+    }
+    /*
+     * the range is immutable, copy without holding the lock.
+     */
+    memcpy(buf, &(*data)[skip], len);
+    return len;
+}
+
+void BlockRangeCache::insert(const BlockRangeKey & key, const Range & range) {
+    int64_t bytes = range->size();
+
+    if (bytes == 0 || bytes > capacity) {
+        return;
+    }
+
+    lock_guard<mutex> lock(mut);
+    missBytes += bytes;
+    unordered_map<BlockRangeKey, Entry>::iterator it = entries.find(key);
+
+    if (it != entries.end()) {
+        int64_t cached = it->second.data->size();
+
+        if (cached >= bytes) {
+            return;
+        }
+
+        /*
+         * the last block has grown since the range was cached.
+         */
+        if (it->second.isProtected) {
+            protectedRanges.erase(it->second.pos);
+            protectedBytes -= cached;
+        } else {
+            probation.erase(it->second.pos);
+            probationBytes -= cached;
+        }
+
+        entries.erase(it);
+    }
+
+    probation.push_front(key);
+    Entry & entry = entries[key];
+    entry.isProtected = false;
+    entry.pos = probation.begin();
+    entry.data = range;
+    probationBytes += bytes;
+    evict();
+}
+
+void BlockRangeCache::evict() {
+    while (probationBytes + protectedBytes > capacity) {
+        LruList & victims = probation.empty() ? protectedRanges : probation;
+        unordered_map<BlockRangeKey, Entry>::iterator it =
+            entries.find(victims.back());
+        int64_t bytes = it->second.data->size();
+
+        if (it->second.isProtected) {
+            protectedBytes -= bytes;
+        } else {
+            probationBytes -= bytes;
+        }
+
+        evictedBytes += bytes;
+        victims.pop_back();
+        entries.erase(it);
+    }
+}
+
+BlockCacheStats BlockRangeCache::getStats() {
+    lock_guard<mutex> lock(mut);
+    BlockCacheStats retval;
+    retval.setCapacity(capacity);
+    retval.setCachedBytes(probationBytes + protectedBytes);
+    retval.setHits(hits);
+    retval.setMisses(misses);
+    retval.setHitBytes(hitBytes);
+    retval.setMissBytes(missBytes);
+    retval.setEvictedBytes(evictedBytes);
+    return retval;
+}
+
+}
+}
@@ -0,0 +1,155 @@
+/********************************************************************
+ * Copyright (c) 2013 - 2014, Pivotal Inc.
+ * All rights reserved.
+ *
+ * Author: Zhanwei Wang
+ ********************************************************************/
+/********************************************************************
+ * 2014 -
+ * open source under Apache License Version 2.0
+ ********************************************************************/
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef _HDFS_LIBHDFS3_CLIENT_BLOCKRANGECACHE_H_
+#define _HDFS_LIBHDFS3_CLIENT_BLOCKRANGECACHE_H_
+
+#include <list>
+#include <vector>
+
+#include "client/BlockCacheStats.h"
+#include "common/Hash.h"
+#include "common/Memory.h"
+#include "common/SessionConfig.h"
+#include "common/Thread.h"
+#include "common/Unordered.h"
+
+namespace Hdfs {
+namespace Internal {
+
+/*
+ * An aligned range of a replica. The generation stamp is part of the key,
+ * so data of an appended or recovered block is never served.
+ */
+class BlockRangeKey {
+public:
+    BlockRangeKey(int64_t blockId, int64_t generationStamp, int64_t offset) :
+        blockId(blockId), generationStamp(generationStamp), offset(offset) {
+    }
+
+    size_t hash_value() const {
+        size_t values[] = { Int64Hasher(blockId), Int64Hasher(generationStamp),
+                            Int64Hasher(offset)
+                          };
+        return CombineHasher(values, sizeof(values) / sizeof(values[0]));
+    }
+
+    bool operator ==(const BlockRangeKey & other) const {
+        return blockId == other.blockId
+               && generationStamp == other.generationStamp
+               && offset == other.offset;
+    }
+
+private:
+    int64_t blockId;
+    int64_t generationStamp;
+    int64_t offset;
+};
+
+}
+}
+
+HDFS_HASH_DEFINE(::Hdfs::Internal::BlockRangeKey);
+
+namespace Hdfs {
+namespace Internal {
+
+/*
+ * Ranges of blocks kept in memory and shared by all input streams of a
+ * file system, bounded by a byte budget.
+ *
+ * Eviction is segmented LRU: a new range enters the probation segment and
+ * moves to the protected segment on its second hit. Only ranges evicted from
+ * probation leave the cache, so a scan reading every range once cannot push
+ * out the hot ranges.
+ */
+class BlockRangeCache {
+public:
+    typedef shared_ptr<const std::vector<char> > Range;
+
+    BlockRangeCache(int64_t capacity, int32_t rangeSize);
+
+    explicit BlockRangeCache(const SessionConfig & conf);
+
+    int32_t getRangeSize() const {
+        return rangeSize;
+    }
+
+    int64_t alignOffset(int64_t offset) const {
+        return offset - offset % rangeSize;
+    }
+
+    /*
+     * Copy from a cached range.
+     * @param key the range.
+     * @param skip the number of bytes to skip from the start of the range.
+     * @param buf the buffer to fill.
+     * @param size the size of buf.
+     * @return the number of bytes copied, -1 if the range is not cached.
+     */
+    int32_t read(const BlockRangeKey & key, int64_t skip, char * buf,
+                 int32_t size);
+
+    /*
+     * Add a range just read and verified from a datanode.
+     */
+    void insert(const BlockRangeKey & key, const Range & range);
+
+    BlockCacheStats getStats();
+
+private:
+    typedef std::list<BlockRangeKey> LruList;
+
+    struct Entry {
+        bool isProtected;
+        LruList::iterator pos;
+        Range data;
+    };
+
+    void evict();
+
+private:
+    int32_t rangeSize;
+    int64_t capacity;
+    int64_t protectedCapacity;
+    int64_t probationBytes;
+    int64_t protectedBytes;
+    int64_t hits;
+    int64_t misses;
+    int64_t hitBytes;
+    int64_t missBytes;
+    int64_t evictedBytes;
+    mutex mut;
+    LruList probation; //most recently used first.
+    LruList protectedRanges;
+    unordered_map<BlockRangeKey, Entry> entries;
+};
+
+}
+}
+
+#endif /* _HDFS_LIBHDFS3_CLIENT_BLOCKRANGECACHE_H_ */
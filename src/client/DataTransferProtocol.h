@@ -28,6 +28,7 @@
 #ifndef _HDFS_LIBHDFS_3_CLIENT_DATATRANSFERPROTOCOL_H_
 #define _HDFS_LIBHDFS_3_CLIENT_DATATRANSFERPROTOCOL_H_
 
+#include "client/ShortCircuitShm.h"
 #include "client/Token.h"
 #include "server/DatanodeInfo.h"
 #include "server/ExtendedBlock.h"
@@ -37,6 +38,53 @@
 namespace Hdfs {
 namespace Internal {
 
+/**
+ * Page cache hints sent to the datanode with a block read or write.
+ * An unset hint leaves the choice to the datanode's own configuration.
+ */
+class CachingStrategy {
+public:
+    CachingStrategy() :
+        dropBehind(-1), readahead(-1) {
+    }
+
+    /**
+     * @param dropBehind 1 to drop behind, 0 not to, negative if unset.
+     * @param readahead the readahead in bytes, negative if unset.
+     */
+    CachingStrategy(int32_t dropBehind, int64_t readahead) :
+        dropBehind(dropBehind), readahead(readahead) {
+    }
+
+    bool hasDropBehind() const {
+        return dropBehind >= 0;
+    }
+
+    /**
+     * @return true if the datanode should drop the block from its page
+     *  cache once it is transferred.
+     */
+    bool isDropBehind() const {
+        return dropBehind > 0;
+    }
+
+    /**
+     * @return the number of bytes the datanode should read ahead,
+     *  negative if unset.
+     */
+    int64_t getReadahead() const {
+        return readahead;
+    }
+
+    bool empty() const {
+        return dropBehind < 0 && readahead < 0;
+    }
+
+private:
+    int32_t dropBehind;
+    int64_t readahead;
+};
+
 /**
  * Transfer data to/from datanode using a streaming protocol.
  */
@@ -52,10 +100,14 @@ public:
      * @param clientName client's name.
      * @param blockOffset offset of the block.
      * @param length maximum number of bytes for this read.
+     * @param sendChecksums false to ask the datanode not to send checksums.
+     * @param caching page cache hints for the datanode.
      */
     virtual void readBlock(const ExtendedBlock & blk,
                            const Token & blockToken, const char * clientName,
-                           int64_t blockOffset, int64_t length) = 0;
+                           int64_t blockOffset, int64_t length,
+                           bool sendChecksums = true,
+                           const CachingStrategy & caching = CachingStrategy()) = 0;
 
     /**
      * Write a block to a datanode pipeline.
@@ -70,13 +122,15 @@ public:
      * @param minBytesRcvd minimum number of bytes received.
      * @param maxBytesRcvd maximum number of bytes received.
      * @param latestGenerationStamp the latest generation stamp of the block.
+     * @param caching page cache hints for the datanodes.
      */
     virtual void writeBlock(const ExtendedBlock & blk,
                             const Token & blockToken, const char * clientName,
                             const std::vector<DatanodeInfo> & targets, int stage,
                             int pipelineSize, int64_t minBytesRcvd, int64_t maxBytesRcvd,
                             int64_t latestGenerationStamp, int checksumType,
-                            int bytesPerChecksum) = 0;
+                            int bytesPerChecksum,
+                            const CachingStrategy & caching = CachingStrategy()) = 0;
 
     /**
      * Transfer a block to another datanode.
@@ -111,10 +165,27 @@ public:
      * @param clientName      client's name.
      * @param maxVersion      Maximum version of the block data the client
      *                          can understand.
+     * @param slotId          The shared memory slot to register the replica
+     *                          in, or NULL if the client does not use one.
      */
     virtual void requestShortCircuitFds(const ExtendedBlock blk,
                                         const Token& blockToken,
-                                        uint32_t maxVersion) = 0;
+                                        uint32_t maxVersion,
+                                        const ShortCircuitSlotId * slotId = NULL) = 0;
+
+    /**
+     * Release a shared memory slot of a replica the client no longer uses.
+     *
+     * @param slotId          The slot to release.
+     */
+    virtual void releaseShortCircuitFds(const ShortCircuitSlotId & slotId) = 0;
+
+    /**
+     * Request a shared memory segment from a DataNode.
+     *
+     * @param clientName      client's name.
+     */
+    virtual void requestShortCircuitShm(const char * clientName) = 0;
 };
 
 }
@@ -77,6 +77,13 @@ static inline void BuildClientHeader(const ExtendedBlock & block,
     BuildBaseHeader(block, accessToken, header->mutable_baseheader());
 }
 
+static inline void BuildSlotId(const ShortCircuitSlotId & slotId,
+                               ShortCircuitShmSlotProto * proto) {
+    proto->mutable_shmid()->set_hi(slotId.shmId.hi);
+    proto->mutable_shmid()->set_lo(slotId.shmId.lo);
+    proto->set_slotidx(slotId.slotIdx);
+}
+
 static inline void BuildNodeInfo(const DatanodeInfo & node,
                                  DatanodeInfoProto * info) {
     DatanodeIDProto * id = info->mutable_id();
@@ -96,6 +103,17 @@ static inline void BuildNodesInfo(const std::vector<DatanodeInfo> & nodes,
     }
 }
 
+static inline void BuildCachingStrategy(const CachingStrategy & caching,
+                                        CachingStrategyProto * proto) {
+    if (caching.hasDropBehind()) {
+        proto->set_dropbehind(caching.isDropBehind());
+    }
+
+    if (caching.getReadahead() >= 0) {
+        proto->set_readahead(caching.getReadahead());
+    }
+}
+
 DataTransferProtocolSender::DataTransferProtocolSender(Socket & sock,
         int writeTimeout, const std::string & datanodeAddr) :
     sock(sock), writeTimeout(writeTimeout), datanode(datanodeAddr) {
@@ -106,11 +124,21 @@ DataTransferProtocolSender::~DataTransferProtocolSender() {
 
 void DataTransferProtocolSender::readBlock(const ExtendedBlock & blk,
         const Token & blockToken, const char * clientName,
-        int64_t blockOffset, int64_t length) {
+        int64_t blockOffset, int64_t length, bool sendChecksums,
+        const CachingStrategy & caching) {
     try {
         OpReadBlockProto op;
         op.set_len(length);
         op.set_offset(blockOffset);
+
+        if (!sendChecksums) {
+            op.set_sendchecksums(false);
+        }
+
+        if (!caching.empty()) {
+            BuildCachingStrategy(caching, op.mutable_cachingstrategy());
+        }
+
         BuildClientHeader(blk, blockToken, clientName, op.mutable_header());
         Send(sock, READ_BLOCK, &op, writeTimeout);
     } catch (const HdfsCanceled & e) {
@@ -126,7 +154,8 @@ void DataTransferProtocolSender::writeBlock(const ExtendedBlock & blk,
         const Token & blockToken, const char * clientName,
         const std::vector<DatanodeInfo> & targets, int stage, int pipelineSize,
         int64_t minBytesRcvd, int64_t maxBytesRcvd,
-        int64_t latestGenerationStamp, int checksumType, int bytesPerChecksum) {
+        int64_t latestGenerationStamp, int checksumType, int bytesPerChecksum,
+        const CachingStrategy & caching) {
     try {
         OpWriteBlockProto op;
         op.set_latestgenerationstamp(latestGenerationStamp);
@@ -139,6 +168,11 @@ void DataTransferProtocolSender::writeBlock(const ExtendedBlock & blk,
         ck->set_bytesperchecksum(bytesPerChecksum);
         ck->set_type((ChecksumTypeProto) checksumType);
         BuildNodesInfo(targets, op.mutable_targets());
+
+        if (!caching.empty()) {
+            BuildCachingStrategy(caching, op.mutable_cachingstrategy());
+        }
+
         Send(sock, WRITE_BLOCK, &op, writeTimeout);
     } catch (const HdfsCanceled & e) {
         throw;
@@ -181,12 +215,17 @@ void DataTransferProtocolSender::blockChecksum(const ExtendedBlock & blk,
 
 void DataTransferProtocolSender::requestShortCircuitFds(const ExtendedBlock blk,
                                                         const Token& blockToken,
-                                                        uint32_t maxVersion) {
+                                                        uint32_t maxVersion,
+                                                        const ShortCircuitSlotId * slotId) {
     try {
         OpRequestShortCircuitAccessProto op;
         BuildBaseHeader(blk, blockToken, op.mutable_header());
         op.set_maxversion(maxVersion);
 
+        if (slotId) {
+            BuildSlotId(*slotId, op.mutable_slotid());
+        }
+
         Send(sock, REQUEST_SHORT_CIRCUIT_FDS, &op, writeTimeout);
     } catch (const HdfsCanceled& e) {
         throw;
@@ -198,6 +237,36 @@ void DataTransferProtocolSender::requestShortCircuitFds(const ExtendedBlock blk,
                      datanode.c_str());
     }
 }
+
+void DataTransferProtocolSender::releaseShortCircuitFds(const ShortCircuitSlotId & slotId) {
+    try {
+        ReleaseShortCircuitAccessRequestProto op;
+        BuildSlotId(slotId, op.mutable_slotid());
+        Send(sock, RELEASE_SHORT_CIRCUIT_FDS, &op, writeTimeout);
+    } catch (const HdfsCanceled & e) {
+        throw;
+    } catch (const HdfsException & e) {
+        NESTED_THROW(HdfsIOException,
+                     "DataTransferProtocolSender cannot send release "
+                     "short-circuit fds request to datanode %s.",
+                     datanode.c_str());
+    }
+}
+
+void DataTransferProtocolSender::requestShortCircuitShm(const char * clientName) {
+    try {
+        ShortCircuitShmRequestProto op;
+        op.set_clientname(clientName);
+        Send(sock, REQUEST_SHORT_CIRCUIT_SHM, &op, writeTimeout);
+    } catch (const HdfsCanceled & e) {
+        throw;
+    } catch (const HdfsException & e) {
+        NESTED_THROW(HdfsIOException,
+                     "DataTransferProtocolSender cannot send request "
+                     "short-circuit shared memory request to datanode %s.",
+                     datanode.c_str());
+    }
+}
 }
 }
 
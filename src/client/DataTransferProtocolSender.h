@@ -49,7 +49,8 @@ enum DataTransferOp {
     BLOCK_CHECKSUM = 85,
     TRANSFER_BLOCK = 86,
     REQUEST_SHORT_CIRCUIT_FDS = 87,
-    RELEASE_SHORT_CIRCUIT_FDS = 88
+    RELEASE_SHORT_CIRCUIT_FDS = 88,
+    REQUEST_SHORT_CIRCUIT_SHM = 89
 };
 
 /**
@@ -70,9 +71,12 @@ public:
      * @param clientName client's name.
      * @param blockOffset offset of the block.
      * @param length maximum number of bytes for this read.
+     * @param sendChecksums false to ask the datanode not to send checksums.
      */
     virtual void readBlock(const ExtendedBlock & blk, const Token & blockToken,
-                           const char * clientName, int64_t blockOffset, int64_t length);
+                           const char * clientName, int64_t blockOffset, int64_t length,
+                           bool sendChecksums = true,
+                           const CachingStrategy & caching = CachingStrategy());
 
     /**
      * Write a block to a datanode pipeline.
@@ -92,7 +96,8 @@ public:
                             const char * clientName, const std::vector<DatanodeInfo> & targets,
                             int stage, int pipelineSize, int64_t minBytesRcvd,
                             int64_t maxBytesRcvd, int64_t latestGenerationStamp,
-                            int checksumType, int bytesPerChecksum);
+                            int checksumType, int bytesPerChecksum,
+                            const CachingStrategy & caching = CachingStrategy());
 
     /**
      * Transfer a block to another datanode.
@@ -126,10 +131,27 @@ public:
      * @param blockToken      Security token for accessing the block.
      * @param maxVersion      Maximum version of the block data the client
      *                          can understand.
+     * @param slotId          The shared memory slot to register the replica
+     *                          in, or NULL if the client does not use one.
      */
     virtual void requestShortCircuitFds(const ExtendedBlock blk,
                                         const Token& blockToken,
-                                        uint32_t maxVersion);
+                                        uint32_t maxVersion,
+                                        const ShortCircuitSlotId * slotId = NULL);
+
+    /**
+     * Release a shared memory slot of a replica the client no longer uses.
+     *
+     * @param slotId          The slot to release.
+     */
+    virtual void releaseShortCircuitFds(const ShortCircuitSlotId & slotId);
+
+    /**
+     * Request a shared memory segment from a DataNode.
+     *
+     * @param clientName      client's name.
+     */
+    virtual void requestShortCircuitShm(const char * clientName);
 
 private:
     Socket & sock;
@@ -0,0 +1,274 @@
+/********************************************************************
+ * Copyright (c) 2013 - 2014, Pivotal Inc.
+ * All rights reserved.
+ *
+ * Author: Zhanwei Wang
+ ********************************************************************/
+/********************************************************************
+ * 2014 -
+ * open source under Apache License Version 2.0
+ ********************************************************************/
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "DatanodeHealth.h"
+#include "Exception.h"
+#include "ExceptionInternal.h"
+#include "Logger.h"
+#include "network/TcpSocket.h"
+
+#include <algorithm>
+#include <cmath>
+
+/*
+ * weight of the newest sample in the latency moving average.
+ */
+#define LATENCY_EWMA_ALPHA 0.25
+
+namespace Hdfs {
+namespace Internal {
+
+once_flag DatanodeHealth::once;
+shared_ptr<DatanodeHealth> DatanodeHealth::health;
+
+DatanodeHealth & DatanodeHealth::GetDatanodeHealth() {
+    call_once(once, &DatanodeHealth::CreateSinglten);
+    assert(health);
+    return *health;
+}
+
+void DatanodeHealth::CreateSinglten() {
+    health = shared_ptr<DatanodeHealth>(new DatanodeHealth());
+}
+
+DatanodeHealth::DatanodeHealth() :
+    stop(true), failureHalfLife(60 * 1000), probeInterval(10 * 1000),
+    probeTimeout(3 * 1000), suppressMax(300 * 1000), suppressMin(5 * 1000) {
+}
+
+DatanodeHealth::~DatanodeHealth() {
+    {
+        lock_guard<mutex> lock(mut);
+        stop = true;
+        cond.notify_all();
+    }
+
+    if (worker.joinable()) {
+        worker.join();
+    }
+}
+
+void DatanodeHealth::configure(const SessionConfig & conf) {
+    lock_guard<mutex> lock(mut);
+    failureHalfLife = conf.getDatanodeFailureHalfLife();
+    probeInterval = conf.getDatanodeProbeInterval();
+    probeTimeout = conf.getInputConnTimeout();
+    suppressMax = conf.getDatanodeSuppressMax();
+    suppressMin = conf.getDatanodeSuppressMin();
+}
+
+DatanodeHealth::NodeHealth & DatanodeHealth::getNode(const DatanodeInfo & node) {
+    NodeHealth & retval = nodes[node.getXferAddr()];
+
+    if (retval.node.getIpAddr().empty()) {
+        retval.node = node;
+    }
+
+    return retval;
+}
+
+static void UpdateLatency(double & average, int64_t micros) {
+    if (average < 0) {
+        average = micros;
+    } else {
+        average += LATENCY_EWMA_ALPHA * (micros - average);
+    }
+}
+
+void DatanodeHealth::recordConnect(const DatanodeInfo & node, int64_t micros) {
+    lock_guard<mutex> lock(mut);
+    UpdateLatency(getNode(node).connectLatency, micros);
+}
+
+void DatanodeHealth::recordFirstByte(const DatanodeInfo & node, int64_t micros) {
+    lock_guard<mutex> lock(mut);
+    UpdateLatency(getNode(node).firstByteLatency, micros);
+}
+
+void DatanodeHealth::recordConnectFailure(const DatanodeInfo & node) {
+    lock_guard<mutex> lock(mut);
+    suppress(node, true);
+
+    if (stop && probeInterval > 0) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+
+        stop = false;
+        CREATE_THREAD(worker, bind(&DatanodeHealth::prober, this));
+    }
+}
+
+void DatanodeHealth::recordFailure(const DatanodeInfo & node) {
+    lock_guard<mutex> lock(mut);
+    suppress(node, false);
+}
+
+/*
+ * Must hold mut.
+ */
+void DatanodeHealth::suppress(const DatanodeInfo & node, bool unreachable) {
+    NodeHealth & h = getNode(node);
+    steady_clock::time_point now = steady_clock::now();
+
+    if (h.failures > 0) {
+        double elapsed = ToMilliSeconds(h.lastFailure, now);
+        h.failures *= std::pow(0.5, elapsed / std::max(failureHalfLife, 1));
+    }
+
+    /*
+     * Double the suppression for every recent failure.
+     */
+    h.failures += 1;
+    h.lastFailure = now;
+    h.down = true;
+    h.unreachable = unreachable;
+    double duration = std::min<double>(suppressMax,
+                                       suppressMin * std::pow(2.0, h.failures - 1));
+    h.suppressedUntil = std::max(h.suppressedUntil,
+                                 now + milliseconds(static_cast<int64_t>(duration)));
+    LOG(INFO, "DatanodeHealth: suppress datanode %s for %d milliseconds.",
+        node.formatAddress().c_str(), static_cast<int>(duration));
+}
+
+bool DatanodeHealth::isSuppressed(const DatanodeInfo & node) {
+    lock_guard<mutex> lock(mut);
+    std::map<std::string, NodeHealth>::iterator it = nodes.find(node.getXferAddr());
+    return it != nodes.end() && it->second.down
+           && steady_clock::now() < it->second.suppressedUntil;
+}
+
+int64_t DatanodeHealth::getExpectedLatency(const DatanodeInfo & node) {
+    lock_guard<mutex> lock(mut);
+    std::map<std::string, NodeHealth>::iterator it = nodes.find(node.getXferAddr());
+
+    if (it == nodes.end() || it->second.connectLatency < 0
+            || it->second.firstByteLatency < 0) {
+        return -1;
+    }
+
+    return static_cast<int64_t>(it->second.connectLatency + it->second.firstByteLatency);
+}
+
+std::vector<DatanodeInfo> DatanodeHealth::getSuppressedNodes() {
+    lock_guard<mutex> lock(mut);
+    std::vector<DatanodeInfo> retval;
+    steady_clock::time_point now = steady_clock::now();
+    std::map<std::string, NodeHealth>::iterator it;
+
+    for (it = nodes.begin(); it != nodes.end(); ++it) {
+        if (it->second.down && now < it->second.suppressedUntil) {
+            retval.push_back(it->second.node);
+        }
+    }
+
+    return retval;
+}
+
+bool DatanodeHealth::probe(const DatanodeInfo & node, int64_t & micros) {
+    steady_clock::time_point start = steady_clock::now();
+
+    try {
+        TcpSocketImpl sock;
+        sock.connect(node.getIpAddr().c_str(), node.getXferPort(), probeTimeout);
+        sock.close();
+    } catch (const HdfsException & e) {
+        return false;
+    }
+
+    micros = duration_cast<microseconds>(steady_clock::now() - start).count();
+    return true;
+}
+
+/*
+ * A probe only tells the datanode accepts connections, so it lifts the
+ * suppression caused by a failure to connect, not by a timeout.
+ */
+void DatanodeHealth::recordProbe(const DatanodeInfo & node, int64_t micros) {
+    lock_guard<mutex> lock(mut);
+    NodeHealth & h = getNode(node);
+    UpdateLatency(h.connectLatency, micros);
+
+    if (h.down && h.unreachable) {
+        LOG(INFO, "DatanodeHealth: datanode %s is reachable again.",
+            node.formatAddress().c_str());
+        h.down = false;
+        h.unreachable = false;
+        h.suppressedUntil = steady_clock::now();
+    }
+}
+
+void DatanodeHealth::prober() {
+    while (true) {
+        std::vector<DatanodeInfo> down;
+
+        try {
+            unique_lock<mutex> lock(mut);
+            cond.wait_for(lock, milliseconds(probeInterval));
+
+            if (stop) {
+                return;
+            }
+
+            std::map<std::string, NodeHealth>::iterator it;
+
+            for (it = nodes.begin(); it != nodes.end(); ++it) {
+                if (it->second.down && it->second.unreachable) {
+                    down.push_back(it->second.node);
+                }
+            }
+
+            if (down.empty()) {
+                stop = true;
+                return;
+            }
+        } catch (const std::exception & e) {
+            lock_guard<mutex> lock(mut);
+            stop = true;
+            return;
+        }
+
+        for (size_t i = 0; i < down.size(); ++i) {
+            int64_t micros = 0;
+
+            if (probe(down[i], micros)) {
+                recordProbe(down[i], micros);
+            } else {
+                /*
+                 * still down, keep readers away until the next probe.
+                 */
+                lock_guard<mutex> lock(mut);
+                NodeHealth & h = getNode(down[i]);
+                h.suppressedUntil = std::max(h.suppressedUntil,
+                                             steady_clock::now() + milliseconds(probeInterval));
+            }
+        }
+    }
+}
+
+}
+}
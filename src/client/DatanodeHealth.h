@@ -0,0 +1,163 @@
+/********************************************************************
+ * Copyright (c) 2013 - 2014, Pivotal Inc.
+ * All rights reserved.
+ *
+ * Author: Zhanwei Wang
+ ********************************************************************/
+/********************************************************************
+ * 2014 -
+ * open source under Apache License Version 2.0
+ ********************************************************************/
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef _HDFS_LIBHDFS3_CLIENT_DATANODEHEALTH_H_
+#define _HDFS_LIBHDFS3_CLIENT_DATANODEHEALTH_H_
+
+#include "DateTime.h"
+#include "Memory.h"
+#include "server/DatanodeInfo.h"
+#include "SessionConfig.h"
+#include "Thread.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace Hdfs {
+namespace Internal {
+
+/**
+ * A process wide table of datanode health shared by all streams.
+ *
+ * It keeps an moving average of the connect and first byte latency of each
+ * datanode, and the recent failures. A failure suppresses the datanode for
+ * a while, the more recent failures the longer, up to a limit. Failures
+ * decay with a half life so a datanode failed long ago is not punished
+ * again. While a datanode refuses connections, a background thread probes
+ * it and lifts the suppression as soon as it accepts connections again.
+ * A datanode which accepts connections but times out stays suppressed
+ * until its backoff expires.
+ */
+class DatanodeHealth {
+public:
+    DatanodeHealth();
+
+    ~DatanodeHealth();
+
+    /**
+     * @return the table shared by the process.
+     */
+    static DatanodeHealth & GetDatanodeHealth();
+
+    /**
+     * Update the tunables, the last session to configure the table wins.
+     * @param conf the session configure.
+     */
+    void configure(const SessionConfig & conf);
+
+    /**
+     * Record a successful connect.
+     * @param node the datanode.
+     * @param micros the time used to connect in microseconds.
+     */
+    void recordConnect(const DatanodeInfo & node, int64_t micros);
+
+    /**
+     * Record the time from sending a request to the first byte of response.
+     * @param node the datanode.
+     * @param micros the latency in microseconds.
+     */
+    void recordFirstByte(const DatanodeInfo & node, int64_t micros);
+
+    /**
+     * Record a failure to connect to the datanode.
+     * @param node the datanode.
+     */
+    void recordConnectFailure(const DatanodeInfo & node);
+
+    /**
+     * Record a timeout or other failure of a datanode which accepts
+     * connections.
+     * @param node the datanode.
+     */
+    void recordFailure(const DatanodeInfo & node);
+
+    /**
+     * @param node the datanode.
+     * @return true if the datanode failed recently and should be avoided.
+     */
+    bool isSuppressed(const DatanodeInfo & node);
+
+    /**
+     * @param node the datanode.
+     * @return the expected connect plus first byte latency in microseconds,
+     *  -1 if unknown.
+     */
+    int64_t getExpectedLatency(const DatanodeInfo & node);
+
+    /**
+     * @return the datanodes which should be avoided now.
+     */
+    std::vector<DatanodeInfo> getSuppressedNodes();
+
+private:
+    struct NodeHealth {
+        NodeHealth() :
+            down(false), unreachable(false), connectLatency(-1),
+            firstByteLatency(-1), failures(0) {
+        }
+
+        bool down;
+        bool unreachable; //the last failure was a failure to connect.
+        DatanodeInfo node;
+        double connectLatency;
+        double firstByteLatency;
+        double failures;
+        steady_clock::time_point lastFailure;
+        steady_clock::time_point suppressedUntil;
+    };
+
+private:
+    NodeHealth & getNode(const DatanodeInfo & node);
+    void suppress(const DatanodeInfo & node, bool unreachable);
+    bool probe(const DatanodeInfo & node, int64_t & micros);
+    void recordProbe(const DatanodeInfo & node, int64_t micros);
+    void prober();
+
+private:
+    bool stop;
+    condition_variable cond;
+    int failureHalfLife;
+    int probeInterval;
+    int probeTimeout;
+    int suppressMax;
+    int suppressMin;
+    mutex mut;
+    std::map<std::string, NodeHealth> nodes;
+    thread worker;
+
+private:
+    static once_flag once;
+    static shared_ptr<DatanodeHealth> health;
+    static void CreateSinglten();
+};
+
+}
+}
+
+#endif /* _HDFS_LIBHDFS3_CLIENT_DATANODEHEALTH_H_ */
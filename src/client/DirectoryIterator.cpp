@@ -30,21 +30,139 @@
 #include "Exception.h"
 #include "ExceptionInternal.h"
 #include "FileSystemImpl.h"
+#include "Function.h"
+#include "Thread.h"
 
 namespace Hdfs {
+namespace Internal {
+
+/**
+ * Fetch the next page of a directory listing in a background thread,
+ * so that the RPC latency overlaps with consuming the current page.
+ */
+class ListingPrefetcher {
+public:
+    ListingPrefetcher(FileSystemImpl * fs, const std::string & path,
+                      const std::string & startAfter, bool needLocations) :
+        abandoned(false), done(false), needLocations(needLocations),
+        more(false), filesystem(fs), path(path), startAfter(startAfter) {
+        filesystem->beginBackgroundCall();
+
+        try {
+            CREATE_THREAD(worker, bind(&ListingPrefetcher::run, this));
+        } catch (...) {
+            filesystem->endBackgroundCall();
+            throw;
+        }
+    }
+
+    ~ListingPrefetcher() {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+
+    /**
+     * Wait for the page and hand it over to the caller.
+     * @param lists output the fetched page.
+     * @return return true if there are more entries after this page.
+     */
+    bool get(std::vector<FileStatus> & lists) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+
+        if (error) {
+            rethrow_exception(error);
+        }
+
+        lists.swap(result);
+        return more;
+    }
+
+    /**
+     * Give up the page without waiting for the request, so that closing
+     * or copying the iterator never blocks on the namenode. A pending
+     * request deletes the prefetcher when it finishes.
+     * @param prefetcher the prefetcher to give up.
+     */
+    static void Cancel(ListingPrefetcher * prefetcher) {
+        {
+            lock_guard<mutex> lock(prefetcher->mut);
+
+            if (!prefetcher->done) {
+                prefetcher->abandoned = true;
+                prefetcher->worker.detach();
+                return;
+            }
+        }
+
+        delete prefetcher;
+    }
+
+private:
+    void run() {
+        try {
+            more = filesystem->getListing(path, startAfter, needLocations, result);
+        } catch (...) {
+            error = current_exception();
+        }
+
+        /*
+         * The file system may be gone once the call is over.
+         */
+        filesystem->endBackgroundCall();
+        bool orphan;
+        {
+            lock_guard<mutex> lock(mut);
+            done = true;
+            orphan = abandoned;
+        }
+
+        if (orphan) {
+            delete this;
+        }
+    }
+
+private:
+    bool abandoned;
+    bool done;
+    bool needLocations;
+    bool more;
+    exception_ptr error;
+    FileSystemImpl * filesystem;
+    std::string path;
+    std::string startAfter;
+    std::vector<FileStatus> result;
+    mutex mut;
+    thread worker;
+};
+
+}
 
 DirectoryIterator::DirectoryIterator() :
-    needLocations(false), filesystem(NULL), next(0) {
+    needLocations(false), prefetch(false), filesystem(NULL), prefetcher(NULL),
+    next(0) {
 }
 
 DirectoryIterator::DirectoryIterator(Hdfs::Internal::FileSystemImpl * const fs,
-                                     std::string path, bool needLocations) :
-    needLocations(needLocations), filesystem(fs), next(0), path(path) {
+                                     std::string path, bool needLocations,
+                                     bool prefetch) :
+    needLocations(needLocations), prefetch(prefetch), filesystem(fs),
+    prefetcher(NULL), next(0), path(path) {
 }
 
+/*
+ * A pending prefetch is never shared, the copy fetches the next page by itself.
+ */
 DirectoryIterator::DirectoryIterator(const DirectoryIterator & it) :
-    needLocations(it.needLocations), filesystem(it.filesystem), next(it.next), path(it.path), startAfter(
-        it.startAfter), lists(it.lists) {
+    needLocations(it.needLocations), prefetch(it.prefetch), filesystem(it.filesystem),
+    prefetcher(NULL), next(it.next), path(it.path), startAfter(it.startAfter),
+    lists(it.lists) {
+}
+
+DirectoryIterator::~DirectoryIterator() {
+    cancelPrefetch();
 }
 
 DirectoryIterator & DirectoryIterator::operator =(const DirectoryIterator & it) {
@@ -52,7 +170,9 @@ DirectoryIterator & DirectoryIterator::operator =(const DirectoryIterator & it)
         return *this;
     }
 
+    cancelPrefetch();
     needLocations = it.needLocations;
+    prefetch = it.prefetch;
     filesystem = it.filesystem;
     next = it.next;
     path = it.path;
@@ -61,6 +181,28 @@ DirectoryIterator & DirectoryIterator::operator =(const DirectoryIterator & it)
     return *this;
 }
 
+void DirectoryIterator::startPrefetch() {
+    assert(NULL == prefetcher);
+
+    try {
+        prefetcher = new Hdfs::Internal::ListingPrefetcher(filesystem, path,
+                startAfter, needLocations);
+    } catch (const std::exception & e) {
+        /*
+         * failed to create thread, fall back to fetch the next page on demand.
+         */
+        prefetcher = NULL;
+    }
+}
+
+void DirectoryIterator::cancelPrefetch() {
+    if (prefetcher) {
+        Hdfs::Internal::ListingPrefetcher::Cancel(prefetcher);
+    }
+
+    prefetcher = NULL;
+}
+
 bool DirectoryIterator::getListing() {
     bool more;
 
@@ -70,12 +212,28 @@ bool DirectoryIterator::getListing() {
 
     next = 0;
     lists.clear();
-    more = filesystem->getListing(path, startAfter, needLocations, lists);
+
+    if (prefetcher) {
+        try {
+            more = prefetcher->get(lists);
+        } catch (...) {
+            cancelPrefetch();
+            throw;
+        }
+
+        cancelPrefetch();
+    } else {
+        more = filesystem->getListing(path, startAfter, needLocations, lists);
+    }
 
     if (!lists.empty()) {
         startAfter = lists.back().getPath();
     }
 
+    if (prefetch && more && !lists.empty()) {
+        startPrefetch();
+    }
+
     return more || !lists.empty();
 }
 
@@ -34,24 +34,31 @@
 namespace Hdfs {
 namespace Internal {
 class FileSystemImpl;
+class ListingPrefetcher;
 }
 
 class DirectoryIterator {
 public:
     DirectoryIterator();
     DirectoryIterator(Hdfs::Internal::FileSystemImpl * const fs,
-                      std::string path, bool needLocations);
+                      std::string path, bool needLocations,
+                      bool prefetch = false);
     DirectoryIterator(const DirectoryIterator & it);
+    ~DirectoryIterator();
     DirectoryIterator & operator = (const DirectoryIterator & it);
     bool hasNext();
     FileStatus getNext();
 
 private:
     bool getListing();
+    void startPrefetch();
+    void cancelPrefetch();
 
 private:
     bool needLocations;
+    bool prefetch;
     Hdfs::Internal::FileSystemImpl * filesystem;
+    Hdfs::Internal::ListingPrefetcher * prefetcher;
     size_t next;
     std::string path;
     std::string startAfter;
@@ -521,6 +521,15 @@ FileSystemStats FileSystem::getStats() const {
     return impl->filesystem->getFsStats();
 }
 
+BlockCacheStats FileSystem::getBlockCacheStats() const {
+    if (!impl) {
+        THROW(HdfsIOException, "FileSystem: not connected.");
+    }
+
+    Internal::BlockRangeCache * cache = impl->filesystem->getBlockRangeCache();
+    return cache ? cache->getStats() : BlockCacheStats();
+}
+
 /**
  * Truncate the file in the indicated path to the indicated size.
  * @param src The path to the file to be truncated
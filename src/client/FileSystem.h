@@ -31,6 +31,7 @@
 #include "BlockLocation.h"
 #include "DirectoryIterator.h"
 #include "FileStatus.h"
+#include "BlockCacheStats.h"
 #include "FileSystemStats.h"
 #include "Permission.h"
 #include "XmlConfig.h"
@@ -238,6 +239,13 @@ public:
      */
     FileSystemStats getStats() const;
 
+    /**
+     * To get the statistics of the client side block range cache,
+     * enabled by "input.block-cache.size".
+     * @return the block cache statistics, all zero if it is disabled.
+     */
+    BlockCacheStats getBlockCacheStats() const;
+
     /**
      * Truncate the file in the indicated path to the indicated size.
      * @param src The path to the file to be truncated
@@ -27,6 +27,7 @@
  */
 #include "Atomic.h"
 #include "BlockLocation.h"
+#include "DatanodeHealth.h"
 #include "DirectoryIterator.h"
 #include "Exception.h"
 #include "ExceptionInternal.h"
@@ -38,10 +39,14 @@
 #include "Logger.h"
 #include "OutputStream.h"
 #include "OutputStreamImpl.h"
+#include "ReadShortCircuitInfo.h"
 #include "server/LocatedBlocks.h"
 #include "server/NamenodeInfo.h"
 #include "server/NamenodeProxy.h"
+#include "ShortCircuitShm.h"
 #include "StringUtil.h"
+#include "Trace.h"
+#include "VerifiedChunkCache.h"
 
 #include <cstring>
 #include <inttypes.h>
@@ -103,6 +108,7 @@ static const std::string CanonicalizePath(const std::string & path) {
 FileSystemImpl::FileSystemImpl(const FileSystemKey& key, const Config& c)
     : conf(c),
       key(key),
+      backgroundCalls(0),
       openedOutputStream(0),
       nn(NULL),
       sconf(c),
@@ -116,11 +122,27 @@ FileSystemImpl::FileSystemImpl(const FileSystemKey& key, const Config& c)
     clientName = ss.str();
     workingDir = std::string("/user/") + user.getEffectiveUser();
     peerCache = shared_ptr<PeerCache>(new PeerCache(sconf));
+
+    if (sconf.getBlockCacheSize() > 0) {
+        blockCache = shared_ptr<BlockRangeCache>(new BlockRangeCache(sconf));
+    }
 #ifdef MOCK
     stub = NULL;
 #endif
     //set log level
     RootLogger.setLogSeverity(sconf.getLogSeverity());
+
+    /*
+     * the log writer and the trace sample rate are shared by the process,
+     * a filesystem which does not configure them leaves them alone.
+     */
+    if (c.getString("dfs.client.log.async", NULL)) {
+        RootLogger.setAsync(sconf.isLogAsync());
+    }
+
+    if (c.getString("dfs.client.trace.sample-rate", NULL)) {
+        Tracer::SetSampleRate(sconf.getTraceSampleRate());
+    }
 }
 
 /**
@@ -148,7 +170,7 @@ const char * FileSystemImpl::getClientName() {
 
 void FileSystemImpl::connect() {
     std::string host, port, uri;
-    std::vector<NamenodeInfo> namenodeInfos;
+    std::vector<NamenodeInfo> namenodeInfos, observerInfos;
 
     if (nn) {
         THROW(HdfsIOException, "FileSystemImpl: already connected.");
@@ -161,10 +183,27 @@ void FileSystemImpl::connect() {
     if (port.empty()) {
         try {
             namenodeInfos = NamenodeInfo::GetHANamenodeInfo(key.getHost(), conf);
+            observerInfos = NamenodeInfo::GetObserverNamenodeInfo(key.getHost(), conf);
         } catch (const HdfsConfigNotFound & e) {
             NESTED_THROW(InvalidParameter, "Cannot parse URI: %s, missing port or invalid HA configuration", uri.c_str());
         }
 
+        /*
+         * observers never become active, do not fail over to them.
+         */
+        for (size_t i = 0; i < observerInfos.size(); ++i) {
+            for (size_t j = 0; j < namenodeInfos.size(); ++j) {
+                if (namenodeInfos[j].getRpcAddr() == observerInfos[i].getRpcAddr()) {
+                    namenodeInfos.erase(namenodeInfos.begin() + j);
+                    break;
+                }
+            }
+        }
+
+        if (namenodeInfos.empty()) {
+            THROW(InvalidParameter, "Cannot parse URI: %s, no namenode other than observers is configured", uri.c_str());
+        }
+
         tokenService = "ha-hdfs:";
         tokenService += host;
     } else {
@@ -179,12 +218,19 @@ void FileSystemImpl::connect() {
 #ifdef MOCK
     nn = stub->getNamenode();
 #else
-    nn = new NamenodeProxy(namenodeInfos, tokenService, sconf, RpcAuth(user, RpcAuth::ParseMethod(sconf.getRpcAuthMethod())));
+    nn = new NamenodeProxy(namenodeInfos, observerInfos, tokenService, sconf, RpcAuth(user, RpcAuth::ParseMethod(sconf.getRpcAuthMethod())));
 #endif
     /*
      * To test if the connection is ok
      */
     getFsStats();
+
+    if (sconf.isDatanodeHealthEnabled()) {
+        DatanodeHealth::GetDatanodeHealth().configure(sconf);
+    }
+
+    ReadShortCircuitInfoBuilder::GetVerifiedChunkCache().configure(
+        sconf.getVerifiedChunkCacheSize());
 }
 
 /**
@@ -193,10 +239,37 @@ void FileSystemImpl::connect() {
 void FileSystemImpl::disconnect() {
     if (nn) {
         nn->close();
+        /*
+         * A listing prefetched for a closed directory iterator may still
+         * be using the namenode.
+         */
+        unique_lock<mutex> lock(mutBackground);
+
+        while (backgroundCalls > 0) {
+            condBackground.wait(lock);
+        }
+
         delete nn;
     }
 
     nn = NULL;
+
+    if (sconf.isShortCircuitShmEnabled()) {
+        ShortCircuitShmManager::FlushAll(sconf);
+    }
+}
+
+void FileSystemImpl::beginBackgroundCall() {
+    lock_guard<mutex> lock(mutBackground);
+    ++backgroundCalls;
+}
+
+void FileSystemImpl::endBackgroundCall() {
+    lock_guard<mutex> lock(mutBackground);
+
+    if (--backgroundCalls == 0) {
+        condBackground.notify_all();
+    }
 }
 
 /**
@@ -363,7 +436,8 @@ DirectoryIterator FileSystemImpl::listDirectory(const char * path,
         THROW(InvalidParameter, "Invalid input: path should not be empty");
     }
 
-    return DirectoryIterator(this, getStandardPath(path), needLocation);
+    return DirectoryIterator(this, getStandardPath(path), needLocation,
+                             sconf.doesPrefetchListing());
 }
 
 /**
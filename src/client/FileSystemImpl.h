@@ -467,6 +467,14 @@ public:
     bool getListing(const std::string & src, const std::string & startAfter,
                     bool needLocation, std::vector<FileStatus> & dl);
 
+    /**
+     * Track a namenode call running in the background and not waited for,
+     * disconnect waits for it to finish.
+     */
+    void beginBackgroundCall();
+
+    void endBackgroundCall();
+
     /**
      * To renew the lease.
      *
@@ -483,13 +491,26 @@ public:
         return *peerCache;
     }
 
+    /**
+     * Get the block range cache shared by the input streams.
+     *
+     * @return return the cache, NULL if it is disabled.
+     */
+    BlockRangeCache * getBlockRangeCache() {
+        return blockCache.get();
+    }
+
 private:
+    condition_variable condBackground;
     Config conf;
     FileSystemKey key;
+    int backgroundCalls;
     int openedOutputStream;
+    mutex mutBackground;
     mutex mutWorkingDir;
     Namenode * nn;
     SessionConfig sconf;
+    shared_ptr<BlockRangeCache> blockCache;
     shared_ptr<PeerCache> peerCache;
     std::string clientName;
     std::string tokenService;
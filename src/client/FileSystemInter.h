@@ -36,6 +36,7 @@
 #include "FileStatus.h"
 #include "FileSystemKey.h"
 #include "FileSystemStats.h"
+#include "BlockRangeCache.h"
 #include "PeerCache.h"
 #include "Permission.h"
 #include "server/LocatedBlocks.h"
@@ -487,6 +488,13 @@ public:
      * @return return the peer cache.
      */
     virtual PeerCache& getPeerCache() = 0;
+
+    /**
+     * Get the block range cache shared by the input streams.
+     *
+     * @return return the cache, NULL if it is disabled.
+     */
+    virtual BlockRangeCache * getBlockRangeCache() = 0;
 };
 
 }
@@ -35,10 +35,12 @@
 #include "Logger.h"
 #include "Logger.h"
 #include "Memory.h"
+#include "Metrics.h"
 #include "OutputStream.h"
 #include "server/NamenodeInfo.h"
 #include "SessionConfig.h"
 #include "Thread.h"
+#include "Trace.h"
 #include "XmlConfig.h"
 
 #include <vector>
@@ -172,6 +174,43 @@ private:
     FileSystem * filesystem;
 };
 
+struct HdfsDirectoryInternalWrapper {
+public:
+    HdfsDirectoryInternalWrapper(const Hdfs::DirectoryIterator & it) :
+        iterator(it) {
+        memset(&info, 0, sizeof(info));
+    }
+
+    Hdfs::DirectoryIterator & getIterator() {
+        return iterator;
+    }
+
+    /*
+     * The strings in info point into current, so that no memory is
+     * allocated per entry.
+     */
+    hdfsFileInfo * setCurrent(const Hdfs::FileStatus & status) {
+        current = status;
+        info.mBlockSize = current.getBlockSize();
+        info.mGroup = const_cast<char *>(current.getGroup());
+        info.mKind = current.isDirectory() ?
+                     kObjectKindDirectory : kObjectKindFile;
+        info.mLastAccess = current.getAccessTime() / 1000;
+        info.mLastMod = current.getModificationTime() / 1000;
+        info.mName = const_cast<char *>(current.getPath());
+        info.mOwner = const_cast<char *>(current.getOwner());
+        info.mPermissions = current.getPermission().toShort();
+        info.mReplication = current.getReplication();
+        info.mSize = current.getLength();
+        return &info;
+    }
+
+private:
+    Hdfs::DirectoryIterator iterator;
+    Hdfs::FileStatus current;
+    hdfsFileInfo info;
+};
+
 class DefaultConfig {
 public:
     DefaultConfig() : conf(new Hdfs::Config) {
@@ -876,6 +915,100 @@ int hdfsAvailable(hdfsFS fs, hdfsFile file) {
     return -1;
 }
 
+int hdfsFileSetDropBehind(hdfsFS fs, hdfsFile file, int dropBehind) {
+    PARAMETER_ASSERT(fs && file, -1, EINVAL);
+
+    try {
+        if (file->isInput()) {
+            file->getInputStream().setDropBehind(dropBehind != 0);
+        } else {
+            file->getOutputStream().setDropBehind(dropBehind != 0);
+        }
+
+        return 0;
+    } catch (const std::bad_alloc & e) {
+        SetErrorMessage("Out of memory");
+        errno = ENOMEM;
+    } catch (...) {
+        SetLastException(Hdfs::current_exception());
+        handleException(Hdfs::current_exception());
+    }
+
+    return -1;
+}
+
+int hdfsFileSetReadahead(hdfsFS fs, hdfsFile file, tOffset readahead) {
+    PARAMETER_ASSERT(fs && file, -1, EINVAL);
+    PARAMETER_ASSERT(file->isInput(), -1, EINVAL);
+
+    try {
+        file->getInputStream().setReadahead(readahead);
+        return 0;
+    } catch (const std::bad_alloc & e) {
+        SetErrorMessage("Out of memory");
+        errno = ENOMEM;
+    } catch (...) {
+        SetLastException(Hdfs::current_exception());
+        handleException(Hdfs::current_exception());
+    }
+
+    return -1;
+}
+
+int hdfsFileGetReadStatistics(hdfsFS fs, hdfsFile file,
+                              hdfsReadStatistics * stats) {
+    PARAMETER_ASSERT(fs && file && stats, -1, EINVAL);
+    PARAMETER_ASSERT(file->isInput(), -1, EINVAL);
+
+    try {
+        Hdfs::ReadStatistics s = file->getInputStream().getStatistics();
+        stats->bytesRead = s.getBytesRead();
+        stats->shortCircuitBytesRead = s.getShortCircuitBytesRead();
+        stats->localBytesRead = s.getLocalBytesRead();
+        stats->remoteBytesRead = s.getRemoteBytesRead();
+        stats->cacheBytesRead = s.getCacheBytesRead();
+        stats->blockReaderSetups = s.getBlockReaderSetups();
+        stats->peerCacheHits = s.getPeerCacheHits();
+        stats->checksumTime = s.getChecksumTime();
+        stats->readRetries = s.getReadRetries();
+        stats->datanodeFailovers = s.getDatanodeFailovers();
+        return 0;
+    } catch (const std::bad_alloc & e) {
+        SetErrorMessage("Out of memory");
+        errno = ENOMEM;
+    } catch (...) {
+        SetLastException(Hdfs::current_exception());
+        handleException(Hdfs::current_exception());
+    }
+
+    return -1;
+}
+
+int hdfsFileGetWriteStatistics(hdfsFS fs, hdfsFile file,
+                               hdfsWriteStatistics * stats) {
+    PARAMETER_ASSERT(fs && file && stats, -1, EINVAL);
+    PARAMETER_ASSERT(!file->isInput(), -1, EINVAL);
+
+    try {
+        Hdfs::WriteStatistics s = file->getOutputStream().getStatistics();
+        stats->bytesWritten = s.getBytesWritten();
+        stats->packetsSent = s.getPacketsSent();
+        stats->acksReceived = s.getAcksReceived();
+        stats->totalAckLatency = s.getTotalAckLatency();
+        stats->maxAckLatency = s.getMaxAckLatency();
+        stats->pipelineRecoveries = s.getPipelineRecoveries();
+        return 0;
+    } catch (const std::bad_alloc & e) {
+        SetErrorMessage("Out of memory");
+        errno = ENOMEM;
+    } catch (...) {
+        SetLastException(Hdfs::current_exception());
+        handleException(Hdfs::current_exception());
+    }
+
+    return -1;
+}
+
 int hdfsCopy(hdfsFS srcFS, const char *src, hdfsFS dstFS, const char *dst) {
     PARAMETER_ASSERT(srcFS && dstFS, -1, EINVAL);
     PARAMETER_ASSERT(src && strlen(src) > 0, -1, EINVAL);
@@ -1077,6 +1210,59 @@ void hdfsFreeFileInfo(hdfsFileInfo * infos, int numEntries) {
     delete[] infos;
 }
 
+hdfsDir hdfsOpenDirectory(hdfsFS fs, const char * path) {
+    PARAMETER_ASSERT(fs && path && strlen(path) > 0, NULL, EINVAL);
+    hdfsDir retval = NULL;
+
+    try {
+        retval = new HdfsDirectoryInternalWrapper(
+            fs->getFilesystem().listDirectory(path));
+        /*
+         * fetch the first page now to report errors such as a missing
+         * directory on open, and to start prefetching the next page.
+         */
+        retval->getIterator().hasNext();
+        return retval;
+    } catch (const std::bad_alloc & e) {
+        SetErrorMessage("Out of memory");
+        delete retval;
+        errno = ENOMEM;
+    } catch (...) {
+        SetLastException(Hdfs::current_exception());
+        delete retval;
+        handleException(Hdfs::current_exception());
+    }
+
+    return NULL;
+}
+
+hdfsFileInfo * hdfsReadDirectory(hdfsDir dir) {
+    PARAMETER_ASSERT(dir, NULL, EINVAL);
+
+    try {
+        if (!dir->getIterator().hasNext()) {
+            errno = 0;
+            return NULL;
+        }
+
+        return dir->setCurrent(dir->getIterator().getNext());
+    } catch (const std::bad_alloc & e) {
+        SetErrorMessage("Out of memory");
+        errno = ENOMEM;
+    } catch (...) {
+        SetLastException(Hdfs::current_exception());
+        handleException(Hdfs::current_exception());
+    }
+
+    return NULL;
+}
+
+int hdfsCloseDirectory(hdfsDir dir) {
+    PARAMETER_ASSERT(dir, -1, EINVAL);
+    delete dir;
+    return 0;
+}
+
 char ***hdfsGetHosts(hdfsFS fs, const char *path, tOffset start,
                      tOffset length) {
     PARAMETER_ASSERT(fs && path && strlen(path) > 0, NULL, EINVAL);
@@ -1179,6 +1365,213 @@ tOffset hdfsGetUsed(hdfsFS fs) {
     return -1;
 }
 
+int hdfsGetBlockCacheStats(hdfsFS fs, hdfsBlockCacheStats * stats) {
+    PARAMETER_ASSERT(fs && stats, -1, EINVAL);
+
+    try {
+        Hdfs::BlockCacheStats s = fs->getFilesystem().getBlockCacheStats();
+        stats->capacity = s.getCapacity();
+        stats->cachedBytes = s.getCachedBytes();
+        stats->hits = s.getHits();
+        stats->misses = s.getMisses();
+        stats->hitBytes = s.getHitBytes();
+        stats->missBytes = s.getMissBytes();
+        stats->evictedBytes = s.getEvictedBytes();
+        return 0;
+    } catch (const std::bad_alloc & e) {
+        SetErrorMessage("Out of memory");
+        errno = ENOMEM;
+    } catch (...) {
+        SetLastException(Hdfs::current_exception());
+        handleException(Hdfs::current_exception());
+    }
+
+    return -1;
+}
+
+int hdfsGetMetrics(hdfsMetric ** metrics, int * numMetrics) {
+    PARAMETER_ASSERT(metrics && numMetrics, -1, EINVAL);
+    hdfsMetric * retval = NULL;
+    int size = 0;
+
+    try {
+        std::vector<Hdfs::Internal::MetricSnapshot> snapshot =
+            Hdfs::Internal::MetricsRegistry::GetMetricsRegistry().snapshot();
+        size = snapshot.size();
+        retval = new hdfsMetric[size];
+        memset(retval, 0, sizeof(hdfsMetric) * size);
+
+        for (int i = 0; i < size; ++i) {
+            const Hdfs::Internal::MetricSnapshot & s = snapshot[i];
+            retval[i].name = Strdup(s.name.c_str());
+
+            if (!s.labelName.empty()) {
+                retval[i].labelName = Strdup(s.labelName.c_str());
+                retval[i].labelValue = Strdup(s.labelValue.c_str());
+            }
+
+            retval[i].type = s.type;
+            retval[i].value = s.value;
+            retval[i].count = s.count;
+            retval[i].sum = s.sum;
+            retval[i].max = s.max;
+            retval[i].p50 = s.p50;
+            retval[i].p90 = s.p90;
+            retval[i].p99 = s.p99;
+            retval[i].p999 = s.p999;
+        }
+
+        *metrics = retval;
+        *numMetrics = size;
+        return 0;
+    } catch (const std::bad_alloc & e) {
+        SetErrorMessage("Out of memory");
+        hdfsFreeMetrics(retval, size);
+        errno = ENOMEM;
+    } catch (...) {
+        SetLastException(Hdfs::current_exception());
+        hdfsFreeMetrics(retval, size);
+        handleException(Hdfs::current_exception());
+    }
+
+    return -1;
+}
+
+void hdfsFreeMetrics(hdfsMetric * metrics, int numMetrics) {
+    for (int i = 0; metrics != NULL && i < numMetrics; ++i) {
+        delete [] metrics[i].name;
+        delete [] metrics[i].labelName;
+        delete [] metrics[i].labelValue;
+    }
+
+    delete [] metrics;
+}
+
+char * hdfsDumpMetrics(int format) {
+    PARAMETER_ASSERT(format == HDFS_METRICS_PROMETHEUS || format == HDFS_METRICS_JSON,
+                     NULL, EINVAL);
+
+    try {
+        Hdfs::Internal::MetricsRegistry & registry =
+            Hdfs::Internal::MetricsRegistry::GetMetricsRegistry();
+        std::string dump = format == HDFS_METRICS_JSON ?
+                           registry.toJson() : registry.toPrometheus();
+        return Strdup(dump.c_str());
+    } catch (const std::bad_alloc & e) {
+        SetErrorMessage("Out of memory");
+        errno = ENOMEM;
+    } catch (...) {
+        SetLastException(Hdfs::current_exception());
+        handleException(Hdfs::current_exception());
+    }
+
+    return NULL;
+}
+
+void hdfsFreeMetricsDump(char * dump) {
+    delete [] dump;
+}
+
+/*
+ * Adapt the C trace callback to the trace sink.
+ */
+class TraceCallbackSink: public Hdfs::Internal::TraceSink {
+public:
+    TraceCallbackSink(hdfsTraceCallback callback, void * context) :
+        callback(callback), context(context) {
+    }
+
+    void record(const Hdfs::Internal::TraceRecord & record) {
+        hdfsTraceSpan span;
+        span.traceId = record.traceId;
+        span.spanId = record.spanId;
+        span.parentId = record.parentId;
+        span.name = record.name;
+        span.detail = record.detail;
+        span.startMicros = record.start;
+        span.durationMicros = record.duration;
+        span.threadId = record.threadId;
+        callback(&span, context);
+    }
+
+private:
+    hdfsTraceCallback callback;
+    void * context;
+};
+
+int hdfsSetTraceCallback(hdfsTraceCallback callback, void * context) {
+    try {
+        shared_ptr<Hdfs::Internal::TraceSink> sink;
+
+        if (callback) {
+            sink = shared_ptr<Hdfs::Internal::TraceSink>(
+                       new TraceCallbackSink(callback, context));
+        }
+
+        Hdfs::Internal::Tracer::SetSink(sink);
+        return 0;
+    } catch (const std::bad_alloc & e) {
+        SetErrorMessage("Out of memory");
+        errno = ENOMEM;
+    } catch (...) {
+        SetLastException(Hdfs::current_exception());
+        handleException(Hdfs::current_exception());
+    }
+
+    return -1;
+}
+
+int hdfsEnableTraceBuffer(int capacity) {
+    PARAMETER_ASSERT(capacity >= 0, -1, EINVAL);
+
+    try {
+        shared_ptr<Hdfs::Internal::TraceSink> sink;
+
+        if (capacity > 0) {
+            sink = shared_ptr<Hdfs::Internal::TraceSink>(
+                       new Hdfs::Internal::TraceRingBuffer(capacity));
+        }
+
+        Hdfs::Internal::Tracer::SetSink(sink);
+        return 0;
+    } catch (const std::bad_alloc & e) {
+        SetErrorMessage("Out of memory");
+        errno = ENOMEM;
+    } catch (...) {
+        SetLastException(Hdfs::current_exception());
+        handleException(Hdfs::current_exception());
+    }
+
+    return -1;
+}
+
+char * hdfsDumpTraceBuffer(void) {
+    try {
+        shared_ptr<Hdfs::Internal::TraceSink> sink =
+            Hdfs::Internal::Tracer::GetSink();
+        Hdfs::Internal::TraceRingBuffer * buffer =
+            dynamic_cast<Hdfs::Internal::TraceRingBuffer *>(sink.get());
+
+        if (!buffer) {
+            THROW(Hdfs::InvalidParameter, "The trace buffer is not enabled.");
+        }
+
+        return Strdup(buffer->toChromeTrace().c_str());
+    } catch (const std::bad_alloc & e) {
+        SetErrorMessage("Out of memory");
+        errno = ENOMEM;
+    } catch (...) {
+        SetLastException(Hdfs::current_exception());
+        handleException(Hdfs::current_exception());
+    }
+
+    return NULL;
+}
+
+void hdfsFreeTraceDump(char * dump) {
+    delete [] dump;
+}
+
 int hdfsChown(hdfsFS fs, const char * path, const char * owner,
               const char * group) {
     PARAMETER_ASSERT(fs && path && strlen(path) > 0, -1, EINVAL);
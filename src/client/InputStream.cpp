@@ -97,6 +97,18 @@ int64_t InputStream::tell() {
     return impl->tell();
 }
 
+void InputStream::setDropBehind(bool dropBehind) {
+    impl->setDropBehind(dropBehind);
+}
+
+void InputStream::setReadahead(int64_t readahead) {
+    impl->setReadahead(readahead);
+}
+
+ReadStatistics InputStream::getStatistics() {
+    return impl->getStatistics();
+}
+
 /**
  * Close the sthream.
  */
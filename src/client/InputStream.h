@@ -29,6 +29,7 @@
 #define _HDFS_LIBHDFS3_CLIENT_INPUTSTREAM_H_
 
 #include "FileSystem.h"
+#include "StreamStatistics.h"
 
 namespace Hdfs {
 namespace Internal {
@@ -85,6 +86,32 @@ public:
      */
     int64_t tell();
 
+    /**
+     * Ask the datanodes to drop the blocks read by this stream from
+     * their page cache, overriding dfs.client.cache.drop.behind.reads.
+     * Takes effect from the next block read.
+     * @param dropBehind true to drop behind, false to keep the blocks
+     *  cached whatever the datanodes default to.
+     */
+    void setDropBehind(bool dropBehind);
+
+    /**
+     * Set how many bytes the datanodes should read ahead for this stream,
+     * overriding dfs.client.cache.readahead. Takes effect from the next
+     * block read.
+     * @param readahead the readahead in bytes, negative to leave it to
+     *  the datanodes.
+     */
+    void setReadahead(int64_t readahead);
+
+    /**
+     * Get how many bytes this stream read and where from, and how much
+     * work went into reading them. Take it from the thread using the
+     * stream, the counters are not synchronized.
+     * @return the statistics of this stream.
+     */
+    ReadStatistics getStatistics();
+
     /**
      * Close the stream.
      */
@@ -32,9 +32,12 @@
 #include "InputStreamInter.h"
 #include "LocalBlockReader.h"
 #include "Logger.h"
+#include "Metrics.h"
 #include "RemoteBlockReader.h"
 #include "server/Datanode.h"
+#include "ShortCircuitShm.h"
 #include "Thread.h"
+#include "Trace.h"
 
 #include <algorithm>
 #include <ifaddrs.h>
@@ -125,9 +128,9 @@ unordered_set<std::string> BuildLocalAddrSet() {
 }
 
 InputStreamImpl::InputStreamImpl() :
-    closed(true), localRead(true), readFromUnderConstructedBlock(false), verify(
-        true), maxGetBlockInfoRetry(3), cursor(0), endOfCurBlock(0), lastBlockBeingWrittenLength(
-            0), prefetchSize(0), peerCache(NULL) {
+    closed(true), localRead(true), randomAccess(false), readFromUnderConstructedBlock(false), verify(
+        true), health(NULL), maxGetBlockInfoRetry(3), blockReaderOffset(0), cursor(0), readerBytes(&counters.remoteBytes), endOfCurBlock(0), filledRangeStart(0), lastBlockBeingWrittenLength(
+            0), prefetchSize(0), blockCache(NULL), peerCache(NULL) {
 #ifdef MOCK
     stub = NULL;
 #endif
@@ -210,6 +213,7 @@ int64_t InputStreamImpl::readBlockLength(const LocatedBlock & b) {
  * Getting blocks locations'information from namenode
  */
 void InputStreamImpl::updateBlockInfos() {
+    TraceSpan span("InputStream::updateBlockInfos");
     int retry = maxGetBlockInfoRetry;
 
     for (int i = 0; i < retry; ++i) {
@@ -299,29 +303,54 @@ void InputStreamImpl::seekToBlock(const LocatedBlock & lb) {
     blockReader.reset();
 }
 
-bool InputStreamImpl::choseBestNode() {
-    const std::vector<DatanodeInfo> & nodes = curBlock->getLocations();
+/*
+ * The time to set up a block reader, by the kind of reader.
+ */
+static Histogram & BlockReaderSetupHistogram(bool shortCircuit) {
+    static Histogram & local = MetricsRegistry::GetMetricsRegistry().histogram(
+                                   "hdfs_client_block_reader_setup_microseconds",
+                                   "Time to set up a block reader, failed attempts excluded.",
+                                   "type", "short_circuit");
+    static Histogram & remote = MetricsRegistry::GetMetricsRegistry().histogram(
+                                    "hdfs_client_block_reader_setup_microseconds",
+                                    "Time to set up a block reader, failed attempts excluded.",
+                                    "type", "tcp");
+    return shortCircuit ? local : remote;
+}
 
-    for (size_t i = 0; i < nodes.size(); ++i) {
-        if (std::binary_search(failedNodes.begin(), failedNodes.end(),
-                               nodes[i])) {
-            continue;
-        }
+static const unordered_set<std::string> & GetLocalAddrSet() {
+    static const unordered_set<std::string> LocalAddrSet = BuildLocalAddrSet();
+    return LocalAddrSet;
+}
+
+bool InputStreamImpl::choseBestNode() {
+    int index = ranker.choose(*curBlock, failedNodes, GetLocalAddrSet());
 
-        curNode = nodes[i];
-        return true;
+    if (index < 0) {
+        return false;
     }
 
-    return false;
+    curNode = curBlock->getLocations()[index];
+    return true;
 }
 
 bool InputStreamImpl::isLocalNode() {
-    static const unordered_set<std::string> LocalAddrSet = BuildLocalAddrSet();
+    const unordered_set<std::string> & LocalAddrSet = GetLocalAddrSet();
     bool retval = LocalAddrSet.find(curNode.getIpAddr()) != LocalAddrSet.end();
     return retval;
 }
 
 void InputStreamImpl::setupBlockReader(bool temporaryDisableLocalRead) {
+    setupBlockReader(temporaryDisableLocalRead, cursor);
+}
+
+/*
+ * Setup a block reader for the current block starting at the given position
+ * of the file.
+ */
+void InputStreamImpl::setupBlockReader(bool temporaryDisableLocalRead,
+                                       int64_t position) {
+    TraceSpan span("InputStream::setupBlockReader");
     bool lastReadFromLocal = false;
     exception_ptr lastException;
 
@@ -343,8 +372,9 @@ void InputStreamImpl::setupBlockReader(bool temporaryDisableLocalRead) {
         }
 
         try {
+            steady_clock::time_point start = steady_clock::now();
             int64_t offset, len;
-            offset = cursor - curBlock->getOffset();
+            offset = position - curBlock->getOffset();
             assert(offset >= 0);
             len = curBlock->getNumBytes() - offset;
             assert(len > 0);
@@ -354,7 +384,9 @@ void InputStreamImpl::setupBlockReader(bool temporaryDisableLocalRead) {
                 lastReadFromLocal = true;
 
                 shared_ptr<ReadShortCircuitInfo> info;
-                ReadShortCircuitInfoBuilder builder(curNode, auth, *conf);
+                ReadShortCircuitInfoBuilder builder(curNode, auth, *conf,
+                                                    filesystem->getClientName());
+                builder.setSequential(!randomAccess);
 
                 try {
                     info = builder.fetchOrCreate(*curBlock, curBlock->getToken());
@@ -366,7 +398,8 @@ void InputStreamImpl::setupBlockReader(bool temporaryDisableLocalRead) {
                     assert(info->isValid());
                     blockReader = shared_ptr<BlockReader>(
                         new LocalBlockReader(info, *curBlock, offset, verify,
-                                             *conf, localReaderBuffer));
+                                             *conf, localReaderBuffer, &counters));
+                    readerBytes = &counters.shortCircuitBytes;
                 } catch (...) {
                     if (info) {
                         info->setValid(false);
@@ -379,12 +412,17 @@ void InputStreamImpl::setupBlockReader(bool temporaryDisableLocalRead) {
                 lastReadFromLocal = false;
                 blockReader = shared_ptr<BlockReader>(new RemoteBlockReader(
                     *curBlock, curNode, *peerCache, offset, len,
-                    curBlock->getToken(), clientName, verify, *conf));
+                    curBlock->getToken(), clientName, verify, *conf, &counters));
+                readerBytes = isLocalNode() ? &counters.localBytes : &counters.remoteBytes;
             }
 
+            ++counters.blockReaderSetups;
+            BlockReaderSetupHistogram(lastReadFromLocal).record(
+                duration_cast<microseconds>(steady_clock::now() - start).count());
             break;
         } catch (const HdfsIOException & e) {
             lastException = current_exception();
+            ++counters.retries;
             std::string buffer;
 
             if (lastReadFromLocal) {
@@ -404,9 +442,12 @@ void InputStreamImpl::setupBlockReader(bool temporaryDisableLocalRead) {
                     curNode.formatAddress().c_str(), GetExceptionDetail(e, buffer));
                 failedNodes.push_back(curNode);
                 std::sort(failedNodes.begin(), failedNodes.end());
+                ++counters.failovers;
             }
         }
     }
+
+    randomAccess = false;
 }
 
 void InputStreamImpl::open(shared_ptr<FileSystemInter> fs, const char * path,
@@ -435,7 +476,15 @@ void InputStreamImpl::openInternal(shared_ptr<FileSystemInter> fs, const char *
         prefetchSize = conf->getDefaultBlockSize() * conf->getPrefetchSize();
         localRead = conf->isReadFromLocal();
         maxGetBlockInfoRetry = conf->getMaxGetBlockInfoRetry();
+        health = NULL;
+
+        if (conf->isDatanodeHealthEnabled()) {
+            health = &DatanodeHealth::GetDatanodeHealth();
+        }
+
+        ranker = ReplicaRanker(*conf, health);
         peerCache = &fs->getPeerCache();
+        blockCache = fs->getBlockRangeCache();
         updateBlockInfos();
         closed = false;
     } catch (const HdfsCanceled & e) {
@@ -465,17 +514,130 @@ int32_t InputStreamImpl::read(char * buf, int32_t size) {
     }
 }
 
+/*
+ * Serve a read from the block range cache.
+ * @return the number of bytes read, -1 if the range is not cached.
+ */
+int32_t InputStreamImpl::readFromBlockCache(char * buf, int32_t size) {
+    int64_t offset = cursor - curBlock->getOffset();
+    int64_t start = blockCache->alignOffset(offset);
+    int32_t todo = size < endOfCurBlock - cursor ?
+                   size : static_cast<int32_t>(endOfCurBlock - cursor);
+    int32_t done = blockCache->read(
+                       BlockRangeKey(curBlock->getBlockId(),
+                                     curBlock->getGenerationStamp(), start),
+                       offset - start, buf, todo);
+
+    if (done > 0) {
+        cursor += done;
+    }
+
+    return done;
+}
+
+/*
+ * Serve a read from the range this stream last added to the block range
+ * cache. Sequential reads smaller than a range come back to it, they are
+ * not hits of the cache and must not promote the range.
+ * @return the number of bytes read, -1 if the range does not cover the cursor.
+ */
+int32_t InputStreamImpl::readFromFilledRange(char * buf, int32_t size) {
+    if (!filledRange || cursor < filledRangeStart
+            || cursor >= filledRangeStart + static_cast<int64_t>(filledRange->size())) {
+        return -1;
+    }
+
+    int64_t skip = cursor - filledRangeStart;
+    int32_t todo = size < static_cast<int64_t>(filledRange->size()) - skip ?
+                   size : static_cast<int32_t>(filledRange->size() - skip);
+    memcpy(buf, &(*filledRange)[skip], todo);
+    cursor += todo;
+    return todo;
+}
+
+/*
+ * Read the whole range starting at rangeStart with the block reader, add it
+ * to the block range cache and serve the read from it.
+ * @return the number of bytes read.
+ */
+int32_t InputStreamImpl::fillBlockCache(char * buf, int32_t size, int64_t rangeStart) {
+    int64_t len = endOfCurBlock - rangeStart;
+    len = len < blockCache->getRangeSize() ? len : blockCache->getRangeSize();
+    shared_ptr<std::vector<char> > range(new std::vector<char>(len));
+
+    for (int64_t done = 0; done < len;) {
+        int32_t rc = blockReader->read(&(*range)[done], static_cast<int32_t>(len - done));
+
+        if (rc <= 0) {
+            THROW(HdfsIOException,
+                  "InputStreamImpl: unexpected end of Block: %s at offset %" PRId64 " for file %s.",
+                  curBlock->toString().c_str(), rangeStart + done - curBlock->getOffset(),
+                  path.c_str());
+        }
+
+        done += rc;
+        *readerBytes += rc;
+        blockReaderOffset = rangeStart + done;
+    }
+
+    blockCache->insert(BlockRangeKey(curBlock->getBlockId(),
+                                     curBlock->getGenerationStamp(),
+                                     rangeStart - curBlock->getOffset()),
+                       range);
+    filledRange = range;
+    filledRangeStart = rangeStart;
+    int64_t skip = cursor - rangeStart;
+    int32_t todo = size < len - skip ? size : static_cast<int32_t>(len - skip);
+    memcpy(buf, &(*range)[skip], todo);
+    cursor += todo;
+    return todo;
+}
+
 int32_t InputStreamImpl::readOneBlock(char * buf, int32_t size, bool shouldUpdateMetadataOnFailure) {
     bool temporaryDisableLocalRead = false;
     std::string buffer;
 
     while (true) {
+        /*
+         * The block range cache only holds complete and verified replicas,
+         * a stream which does not verify checksums bypasses it.
+         */
+        bool caching = blockCache && verify && !readFromUnderConstructedBlock;
+        int64_t rangeStart = cursor;
+
+        if (caching) {
+            int32_t done = readFromFilledRange(buf, size);
+
+            if (done > 0) {
+                return done;
+            }
+
+            done = readFromBlockCache(buf, size);
+
+            if (done > 0) {
+                counters.cacheBytes += done;
+                return done;
+            }
+
+            rangeStart = curBlock->getOffset()
+                         + blockCache->alignOffset(cursor - curBlock->getOffset());
+
+            /*
+             * Keep streaming with the block reader only if it stopped where
+             * the range starts.
+             */
+            if (blockReader && blockReaderOffset != rangeStart) {
+                blockReader.reset();
+            }
+        }
+
         try {
             /*
              * Setup block reader here and handle failure.
              */
             if (!blockReader) {
-                setupBlockReader(temporaryDisableLocalRead);
+                setupBlockReader(temporaryDisableLocalRead, rangeStart);
+                blockReaderOffset = rangeStart;
                 temporaryDisableLocalRead = false;
             }
         } catch (const HdfsInvalidBlockToken & e) {
@@ -507,11 +669,16 @@ int32_t InputStreamImpl::readOneBlock(char * buf, int32_t size, bool shouldUpdat
          * Block reader has been setup, read from block reader.
          */
         try {
+            if (caching) {
+                return fillBlockCache(buf, size, rangeStart);
+            }
+
             int32_t todo = size;
             todo = todo < endOfCurBlock - cursor ?
                    todo : static_cast<int32_t>(endOfCurBlock - cursor);
             assert(blockReader);
             todo = blockReader->read(buf, todo);
+            *readerBytes += todo;
             cursor += todo;
             /*
              * Exit the loop and function from here if success.
@@ -539,6 +706,8 @@ int32_t InputStreamImpl::readOneBlock(char * buf, int32_t size, bool shouldUpdat
                 curNode.formatAddress().c_str(), GetExceptionDetail(e, buffer));
         }
 
+        ++counters.retries;
+
         /*
          * Successfully create the block reader but failed to read.
          * Disable the local block reader and try the same node again.
@@ -553,6 +722,7 @@ int32_t InputStreamImpl::readOneBlock(char * buf, int32_t size, bool shouldUpdat
                 curNode.formatAddress().c_str(), path.c_str());
             failedNodes.push_back(curNode);
             std::sort(failedNodes.begin(), failedNodes.end());
+            ++counters.failovers;
         }
 
         blockReader.reset();
@@ -566,6 +736,8 @@ int32_t InputStreamImpl::readOneBlock(char * buf, int32_t size, bool shouldUpdat
  * @return return the number of bytes filled in the buffer, it may less than size.
  */
 int32_t InputStreamImpl::readInternal(char * buf, int32_t size) {
+    TraceSpan span("InputStream::read");
+    TRACE_DETAIL(span, "offset=%" PRId64 " size=%d", cursor, size);
     int updateMetadataOnFailure = conf->getMaxReadBlockRetry();
 
     try {
@@ -624,6 +796,7 @@ int32_t InputStreamImpl::readInternal(char * buf, int32_t size) {
                 lbs.reset();
                 endOfCurBlock = 0;
                 --updateMetadataOnFailure;
+                ++counters.retries;
 
                 try {
                     sleep_for(seconds(1));
@@ -633,6 +806,7 @@ int32_t InputStreamImpl::readInternal(char * buf, int32_t size) {
                 continue;
             }
 
+            counters.bytesRead += retval;
             return retval;
         } while (true);
     } catch (const HdfsCanceled & e) {
@@ -740,7 +914,7 @@ void InputStreamImpl::seekInternal(int64_t pos) {
     }
 
     try {
-        if (blockReader && pos > cursor && pos < endOfCurBlock &&
+        if (blockReader && !blockCache && pos > cursor && pos < endOfCurBlock &&
                 (pos - cursor) < blockReader->available()) {
 
             /*
@@ -771,6 +945,7 @@ void InputStreamImpl::seekInternal(int64_t pos) {
     endOfCurBlock = 0;
     blockReader.reset();
     cursor = pos;
+    randomAccess = true;
 }
 
 /**
@@ -783,6 +958,35 @@ int64_t InputStreamImpl::tell() {
     return cursor;
 }
 
+/**
+ * The hints live in the stream's own copy of the configure,
+ * block readers created afterwards pick them up.
+ */
+void InputStreamImpl::setDropBehind(bool dropBehind) {
+    checkStatus();
+    conf->setCacheDropBehindReads(dropBehind);
+}
+
+void InputStreamImpl::setReadahead(int64_t readahead) {
+    checkStatus();
+    conf->setCacheReadahead(readahead < 0 ? -1 : readahead);
+}
+
+ReadStatistics InputStreamImpl::getStatistics() {
+    ReadStatistics stats;
+    stats.setBytesRead(counters.bytesRead);
+    stats.setShortCircuitBytesRead(counters.shortCircuitBytes);
+    stats.setLocalBytesRead(counters.localBytes);
+    stats.setRemoteBytesRead(counters.remoteBytes);
+    stats.setCacheBytesRead(counters.cacheBytes);
+    stats.setBlockReaderSetups(counters.blockReaderSetups);
+    stats.setPeerCacheHits(counters.peerCacheHits);
+    stats.setChecksumTime(counters.checksumNanos / 1000);
+    stats.setReadRetries(counters.retries);
+    stats.setDatanodeFailovers(counters.failovers);
+    return stats;
+}
+
 /**
  * Close the stream.
  */
@@ -790,7 +994,10 @@ void InputStreamImpl::close() {
     LOG(DEBUG2, "%p close file %s for read", this, path.c_str());
     closed = true;
     localRead = true;
+    randomAccess = false;
     readFromUnderConstructedBlock = false;
+    blockCache = NULL;
+    filledRange.reset();
     verify = true;
     filesystem.reset();
     cursor = 0;
@@ -798,6 +1005,11 @@ void InputStreamImpl::close() {
     lastBlockBeingWrittenLength = 0;
     prefetchSize = 0;
     blockReader.reset();
+
+    if (conf && conf->isShortCircuitShmEnabled()) {
+        ShortCircuitShmManager::FlushAll(*conf);
+    }
+
     curBlock.reset();
     lbs.reset();
     conf.reset();
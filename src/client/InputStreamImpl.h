@@ -30,6 +30,7 @@
 
 #include "platform.h"
 
+#include "BlockRangeCache.h"
 #include "BlockReader.h"
 #include "ExceptionInternal.h"
 #include "FileSystem.h"
@@ -37,11 +38,13 @@
 #include "InputStreamInter.h"
 #include "Memory.h"
 #include "PeerCache.h"
+#include "ReplicaRanker.h"
 #include "rpc/RpcAuth.h"
 #include "server/Datanode.h"
 #include "server/LocatedBlock.h"
 #include "server/LocatedBlocks.h"
 #include "SessionConfig.h"
+#include "StreamCounters.h"
 #include "Unordered.h"
 
 #ifdef MOCK
@@ -96,6 +99,21 @@ public:
      */
     int64_t tell();
 
+    /**
+     * @ref InputStream::setDropBehind
+     */
+    void setDropBehind(bool dropBehind);
+
+    /**
+     * @ref InputStream::setReadahead
+     */
+    void setReadahead(int64_t readahead);
+
+    /**
+     * @ref InputStream::getStatistics
+     */
+    ReadStatistics getStatistics();
+
     /**
      * Close the stream.
      */
@@ -111,6 +129,9 @@ public:
 private:
     bool choseBestNode();
     bool isLocalNode();
+    int32_t fillBlockCache(char * buf, int32_t size, int64_t rangeStart);
+    int32_t readFromBlockCache(char * buf, int32_t size);
+    int32_t readFromFilledRange(char * buf, int32_t size);
     int32_t readInternal(char * buf, int32_t size);
     int32_t readOneBlock(char * buf, int32_t size, bool shouldUpdateMetadataOnFailure);
     int64_t getFileLength();
@@ -122,22 +143,32 @@ private:
     void seekInternal(int64_t pos);
     void seekToBlock(const LocatedBlock & lb);
     void setupBlockReader(bool temporaryDisableLocalRead);
+    void setupBlockReader(bool temporaryDisableLocalRead, int64_t position);
     void updateBlockInfos();
 
 private:
     bool closed;
     bool localRead;
+    bool randomAccess; //the current block reader was set up after a seek.
     bool readFromUnderConstructedBlock;
     bool verify;
+    DatanodeHealth * health;
     DatanodeInfo curNode;
     exception_ptr lastError;
     FileStatus fileInfo;
     int maxGetBlockInfoRetry;
+    int64_t blockReaderOffset; //position of the block reader when caching ranges.
     int64_t cursor;
+    int64_t * readerBytes; //the counter of the current block reader's path.
     int64_t endOfCurBlock;
+    int64_t filledRangeStart; //file offset of filledRange.
     int64_t lastBlockBeingWrittenLength;
     int64_t prefetchSize;
+    BlockRangeCache * blockCache;
+    BlockRangeCache::Range filledRange; //the range this stream last added to the cache.
     PeerCache *peerCache;
+    ReadCounters counters;
+    ReplicaRanker ranker;
     RpcAuth auth;
     shared_ptr<BlockReader> blockReader;
     shared_ptr<FileSystemInter> filesystem;
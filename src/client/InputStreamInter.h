@@ -29,6 +29,7 @@
 #define _HDFS_LIBHDFS3_CLIENT_INPUTSTREAMINTER_H_
 
 #include <Memory.h>
+#include "StreamStatistics.h"
 
 #include <string>
 
@@ -88,6 +89,15 @@ public:
      */
     virtual int64_t tell() = 0;
 
+    virtual void setDropBehind(bool dropBehind) = 0;
+
+    virtual void setReadahead(int64_t readahead) = 0;
+
+    /**
+     * Get the statistics of this stream.
+     */
+    virtual ReadStatistics getStatistics() = 0;
+
     /**
      * Close the stream.
      */
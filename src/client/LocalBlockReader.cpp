@@ -27,11 +27,13 @@
  */
 #include "BigEndian.h"
 #include "datatransfer.pb.h"
+#include "DateTime.h"
 #include "Exception.h"
 #include "ExceptionInternal.h"
 #include "HWCrc32c.h"
 #include "LocalBlockReader.h"
 #include "SWCrc32c.h"
+#include "Trace.h"
 
 #include <inttypes.h>
 #include <limits>
@@ -47,7 +49,8 @@ namespace Internal {
 LocalBlockReader::LocalBlockReader(const shared_ptr<ReadShortCircuitInfo>& info,
                                    const ExtendedBlock& block, int64_t offset,
                                    bool verify, SessionConfig& conf,
-                                   std::vector<char>& buffer)
+                                   std::vector<char>& buffer,
+                                   ReadCounters * counters)
     : verify(verify),
       pbuffer(NULL),
       pMetaBuffer(NULL),
@@ -59,7 +62,12 @@ LocalBlockReader::LocalBlockReader(const shared_ptr<ReadShortCircuitInfo>& info,
       cursor(0),
       length(block.getNumBytes()),
       info(info),
-      buffer(buffer) {
+      buffer(buffer),
+      verifiedKey(info->getKey()),
+      verifiedChunks(NULL),
+      verifiedReplica(block.getGenerationStamp(), info->getMetaDevice(),
+                      info->getMetaInode()),
+      counters(counters) {
     try {
         metaFd = info->getMetaFile();
         dataFd = info->getDataFile();
@@ -111,6 +119,11 @@ LocalBlockReader::LocalBlockReader(const shared_ptr<ReadShortCircuitInfo>& info,
         }
 
         localBufferSize = conf.getLocalReadBufferSize();
+        VerifiedChunkCache & cache = ReadShortCircuitInfoBuilder::GetVerifiedChunkCache();
+
+        if (this->verify && cache.isEnabled() && info->getMetaInode() != 0) {
+            verifiedChunks = &cache;
+        }
 
         if (verify) {
             localBufferSize = (localBufferSize + chunkSize - 1) / chunkSize * chunkSize;
@@ -134,8 +147,24 @@ LocalBlockReader::~LocalBlockReader() {
 void LocalBlockReader::readAndVerify(int32_t bufferSize) {
     assert(true == verify);
     assert(cursor % chunkSize == 0);
+    TraceSpan span("LocalBlockReader::readAndVerify");
+    TRACE_DETAIL(span, "offset=%" PRId64 " len=%d", cursor, bufferSize);
     int chunks = (bufferSize + chunkSize - 1) / chunkSize;
     pbuffer = dataFd->read(buffer, bufferSize);
+
+    if (verifiedChunks && verifiedChunks->isVerified(verifiedKey,
+            verifiedReplica, cursor, cursor + bufferSize)) {
+        metaFd->seek(HEADER_SIZE + checksumSize * (cursor / chunkSize + chunks));
+        verifiedChunks->recordSkipped(bufferSize);
+        return;
+    }
+
+    steady_clock::time_point start;
+
+    if (verifiedChunks || counters) {
+        start = steady_clock::now();
+    }
+
     pMetaBuffer = metaFd->read(metaBuffer, chunks * checksumSize);
 
     for (int i = 0; i < chunks; ++i) {
@@ -156,6 +185,21 @@ void LocalBlockReader::readAndVerify(int32_t bufferSize) {
                   block.toString().c_str());
         }
     }
+
+    if (verifiedChunks || counters) {
+        int64_t elapsed = duration_cast<nanoseconds>(
+                              steady_clock::now() - start).count();
+
+        if (verifiedChunks) {
+            verifiedChunks->addVerified(verifiedKey, verifiedReplica, cursor,
+                                        cursor + bufferSize);
+            verifiedChunks->recordVerified(bufferSize, elapsed);
+        }
+
+        if (counters) {
+            counters->checksumNanos += elapsed;
+        }
+    }
 }
 
 int32_t LocalBlockReader::readInternal(char * buf, int32_t len) {
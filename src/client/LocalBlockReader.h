@@ -34,6 +34,8 @@
 #include "Memory.h"
 #include "ReadShortCircuitInfo.h"
 #include "SessionConfig.h"
+#include "StreamCounters.h"
+#include "VerifiedChunkCache.h"
 
 #include <vector>
 
@@ -44,7 +46,8 @@ class LocalBlockReader: public BlockReader {
 public:
     LocalBlockReader(const shared_ptr<ReadShortCircuitInfo>& info,
                      const ExtendedBlock & block, int64_t offset, bool verify,
-                     SessionConfig & conf, std::vector<char> & buffer);
+                     SessionConfig & conf, std::vector<char> & buffer,
+                     ReadCounters * counters = NULL);
 
     ~LocalBlockReader();
 
@@ -97,6 +100,10 @@ private:
     shared_ptr<ReadShortCircuitInfo> info;
     std::vector<char> & buffer;
     std::vector<char> metaBuffer;
+    ReadShortCircuitInfoKey verifiedKey;
+    VerifiedChunkCache * verifiedChunks; //NULL if not caching verified chunks.
+    VerifiedReplica verifiedReplica;
+    ReadCounters * counters;
 };
 
 }
@@ -86,6 +86,14 @@ void OutputStream::sync() {
     impl->sync();
 }
 
+void OutputStream::setDropBehind(bool dropBehind) {
+    impl->setDropBehind(dropBehind);
+}
+
+WriteStatistics OutputStream::getStatistics() {
+    return impl->getStatistics();
+}
+
 /**
  * close the stream.
  */
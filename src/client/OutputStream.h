@@ -29,6 +29,7 @@
 #define _HDFS_LIBHDFS3_CLIENT_OUTPUTSTREAM_H_
 
 #include "FileSystem.h"
+#include "StreamStatistics.h"
 
 namespace Hdfs {
 
@@ -117,6 +118,24 @@ public:
      */
     void sync();
 
+    /**
+     * Ask the datanodes to drop the blocks written by this stream from
+     * their page cache, overriding dfs.client.cache.drop.behind.writes.
+     * Takes effect from the next block written.
+     * @param dropBehind true to drop behind, false to keep the blocks
+     *  cached whatever the datanodes default to.
+     */
+    void setDropBehind(bool dropBehind);
+
+    /**
+     * Get how many bytes and packets this stream wrote, how long the
+     * datanodes took to acknowledge them and how often the pipeline had
+     * to be recovered. Take it from the thread using the stream, the
+     * counters are not synchronized.
+     * @return the statistics of this stream.
+     */
+    WriteStatistics getStatistics();
+
     /**
      * close the stream.
      */
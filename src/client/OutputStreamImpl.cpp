@@ -38,6 +38,7 @@
 #include "Packet.h"
 #include "PacketHeader.h"
 #include "SWCrc32c.h"
+#include "Trace.h"
 
 #include <cassert>
 #include <inttypes.h>
@@ -273,9 +274,12 @@ void OutputStreamImpl::append(const char * buf, int64_t size) {
     }
 
     checkStatus();
+    TraceSpan span("OutputStream::append");
+    TRACE_DETAIL(span, "offset=%" PRId64 " size=%" PRId64, cursor, size);
 
     try {
         appendInternal(buf, size);
+        counters.bytesWritten += size;
     } catch (...) {
         setError(current_exception());
         throw;
@@ -357,12 +361,14 @@ void OutputStreamImpl::sendPacket(shared_ptr<Packet> packet) {
 
 void OutputStreamImpl::setupPipeline() {
     assert(currentPacket);
+    TraceSpan span("OutputStream::setupPipeline");
 #ifdef MOCK
     pipeline = stub->getPipeline();
 #else
     pipeline = shared_ptr<Pipeline>(new PipelineImpl(isAppend, path.c_str(), *conf, filesystem,
                                     CHECKSUM_TYPE_CRC32C, conf->getDefaultChunkSize(), replication,
-                                    currentPacket->getOffsetInBlock(), packets, lastBlock));
+                                    currentPacket->getOffsetInBlock(), packets, lastBlock,
+                                    &counters));
 #endif
     lastSend = steady_clock::now();
     /*
@@ -401,6 +407,8 @@ void OutputStreamImpl::flushInternal(bool needSync) {
         lastFlushed = cursor;
     }
 
+    TraceSpan span(needSync ? "OutputStream::sync" : "OutputStream::flush");
+
     if (position > 0) {
         appendChunkToPacket(&buffer[0], position);
     }
@@ -436,6 +444,28 @@ int64_t OutputStreamImpl::tell() {
     return cursor;
 }
 
+/**
+ * @ref OutputStream::setDropBehind
+ */
+void OutputStreamImpl::setDropBehind(bool dropBehind) {
+    checkStatus();
+    conf->setCacheDropBehindWrites(dropBehind);
+}
+
+/**
+ * @ref OutputStream::getStatistics
+ */
+WriteStatistics OutputStreamImpl::getStatistics() {
+    WriteStatistics stats;
+    stats.setBytesWritten(counters.bytesWritten);
+    stats.setPacketsSent(counters.packetsSent);
+    stats.setAcksReceived(counters.acksReceived);
+    stats.setTotalAckLatency(counters.totalAckMicros);
+    stats.setMaxAckLatency(counters.maxAckMicros);
+    stats.setPipelineRecoveries(counters.recoveries);
+    return stats;
+}
+
 /**
  * @ref OutputStream::sync
  */
@@ -503,6 +533,8 @@ void OutputStreamImpl::closePipeline() {
         return;
     }
 
+    TraceSpan span("OutputStream::closePipeline");
+
     if (currentPacket) {
         sendPacket(currentPacket);
     }
@@ -529,6 +561,8 @@ void OutputStreamImpl::close() {
         return;
     }
 
+    TraceSpan span("OutputStream::close");
+
     try {
         //pipeline may be broken
         if (!lastError) {
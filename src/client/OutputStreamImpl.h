@@ -40,6 +40,7 @@
 #include "Pipeline.h"
 #include "server/LocatedBlock.h"
 #include "SessionConfig.h"
+#include "StreamCounters.h"
 #include "Thread.h"
 #ifdef MOCK
 #include "PipelineStub.h"
@@ -89,6 +90,16 @@ public:
      */
     int64_t tell();
 
+    /**
+     * @ref OutputStream::setDropBehind
+     */
+    void setDropBehind(bool dropBehind);
+
+    /**
+     * @ref OutputStream::getStatistics
+     */
+    WriteStatistics getStatistics();
+
     /**
      * @ref OutputStream::sync
      */
@@ -158,6 +169,7 @@ private:
     std::string path;
     std::vector<char> buffer;
     steady_clock::time_point lastSend;
+    WriteCounters counters;
     //thread heartBeatSender;
 
     friend class Pipeline;
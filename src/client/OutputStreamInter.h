@@ -32,6 +32,7 @@
 #include "FileSystemInter.h"
 #include "Memory.h"
 #include "Permission.h"
+#include "StreamStatistics.h"
 
 namespace Hdfs {
 namespace Internal {
@@ -82,6 +83,16 @@ public:
      */
     virtual void sync() = 0;
 
+    /**
+     * @ref OutputStream::setDropBehind
+     */
+    virtual void setDropBehind(bool dropBehind) = 0;
+
+    /**
+     * @ref OutputStream::getStatistics
+     */
+    virtual WriteStatistics getStatistics() = 0;
+
     /**
      * close the stream.
      */
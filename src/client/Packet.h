@@ -28,6 +28,8 @@
 #ifndef _HDFS_LIBHDFS3_CLIENT_PACKET_H_
 #define _HDFS_LIBHDFS3_CLIENT_PACKET_H_
 
+#include "DateTime.h"
+
 #include <stdint.h>
 #include <vector>
 
@@ -110,6 +112,17 @@ public:
         return offsetInBlock;
     }
 
+    /**
+     * Record when the packet was last written to the pipeline.
+     */
+    void setSendTime(steady_clock::time_point sendTime) {
+        this->sendTime = sendTime;
+    }
+
+    steady_clock::time_point getSendTime() const {
+        return sendTime;
+    }
+
 private:
     bool lastPacketInBlock; // is this the last packet in block
     bool syncBlock; // sync block to disk?
@@ -123,6 +136,7 @@ private:
     int numChunks; // number of chunks currently in packet
     int64_t offsetInBlock; // offset in block
     int64_t seqno; // sequence number of packet in block
+    steady_clock::time_point sendTime; // when the packet was last sent
     std::vector<char> buffer;
 };
 
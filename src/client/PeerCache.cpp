@@ -25,56 +25,279 @@
  * See the License for the specific language governing permissions and
  * limitations under the License.
  */
+#include <arpa/inet.h>
 #include <inttypes.h>
+#include <string.h>
 
 #include "client/PeerCache.h"
+#include "common/Function.h"
+#include "common/Logger.h"
+#include "common/Metrics.h"
 
 namespace Hdfs {
 namespace Internal {
 
-LruMap<std::string, PeerCache::value_type> PeerCache::Map;
+PeerKey::PeerKey(const DatanodeInfo& datanode)
+    : port(datanode.getXferPort()),
+      uuid(StringHasher(datanode.getDatanodeId())) {
+  const char* ip = datanode.getIpAddr().c_str();
+  memset(addr, 0, sizeof(addr));
+
+  if (inet_pton(AF_INET, ip, addr + 12) == 1) {
+    // IPv4-mapped IPv6 address.
+    addr[10] = addr[11] = 0xff;
+  } else if (inet_pton(AF_INET6, ip, addr) != 1) {
+    // not a numeric address, fall back to its hash.
+    size_t h = StringHasher(datanode.getIpAddr());
+    memcpy(addr, &h, sizeof(h));
+  }
+}
+
+size_t PeerKey::hash_value() const {
+  uint64_t a, b;
+  memcpy(&a, addr, sizeof(a));
+  memcpy(&b, addr + sizeof(a), sizeof(b));
+  size_t values[] = {Int64Hasher(a), Int64Hasher(b), Int32Hasher(port),
+                     Int64Hasher(uuid)};
+  return CombineHasher(values, sizeof(values) / sizeof(values[0]));
+}
+
+PeerPool::PeerPool()
+    : maxSize(16), total(0), reaping(false), running(true) {}
+
+PeerPool::~PeerPool() {
+  {
+    lock_guard<mutex> lock(reaperMut);
+    running = false;
+  }
+
+  cond.notify_all();
+
+  if (reaper.joinable()) {
+    reaper.join();
+  }
+}
+
+void PeerPool::setMaxSize(int size) {
+  maxSize = size;
+
+  for (int i = 0; total > maxSize && i < PEER_CACHE_SHARDS; ++i) {
+    lock_guard<mutex> lock(shards[i].mut);
+
+    while (total > maxSize && evictOldest(shards[i])) {
+    }
+  }
+}
+
+bool PeerPool::take(const PeerKey& key, value_type* value) {
+  Shard& shard = getShard(key);
+  lock_guard<mutex> lock(shard.mut);
+  unordered_map<PeerKey, std::deque<value_type> >::iterator it =
+      shard.peers.find(key);
+
+  if (it == shard.peers.end()) {
+    return false;
+  }
+
+  std::deque<value_type>& peers = it->second;
+  steady_clock::time_point now = steady_clock::now();
+  bool found = false;
+
+  /*
+   * the most recently used socket is the least likely closed by the
+   * datanode.
+   */
+  while (!found && !peers.empty()) {
+    if (peers.back().second > now) {
+      *value = peers.back();
+      found = true;
+    }
+
+    peers.pop_back();
+    --total;
+  }
+
+  if (peers.empty()) {
+    shard.peers.erase(it);
+  }
+
+  return found;
+}
+
+void PeerPool::put(const PeerKey& key, const value_type& value) {
+  if (maxSize <= 0) {
+    return;
+  }
+
+  size_t index = key.hash_value() % PEER_CACHE_SHARDS;
+
+  {
+    lock_guard<mutex> lock(shards[index].mut);
+    shards[index].peers[key].push_back(value);
+    ++total;
+  }
+
+  /*
+   * make room from other shards first, so that the new socket is kept.
+   * Only one shard is locked at a time.
+   */
+  for (size_t i = 1; total > maxSize && i <= PEER_CACHE_SHARDS; ++i) {
+    Shard& shard = shards[(index + i) % PEER_CACHE_SHARDS];
+    lock_guard<mutex> lock(shard.mut);
+
+    while (total > maxSize && evictOldest(shard)) {
+    }
+  }
+
+  startReaper();
+}
+
+/*
+ * @pre Already hold the lock of the shard.
+ */
+bool PeerPool::evictOldest(Shard& shard) {
+  unordered_map<PeerKey, std::deque<value_type> >::iterator it, oldest;
+  oldest = shard.peers.end();
+
+  for (it = shard.peers.begin(); it != shard.peers.end(); ++it) {
+    if (oldest == shard.peers.end() ||
+        it->second.front().second < oldest->second.front().second) {
+      oldest = it;
+    }
+  }
+
+  if (oldest == shard.peers.end()) {
+    return false;
+  }
+
+  oldest->second.pop_front();
+  --total;
+
+  if (oldest->second.empty()) {
+    shard.peers.erase(oldest);
+  }
+
+  return true;
+}
+
+int PeerPool::reapExpired() {
+  int count = 0;
+
+  for (int i = 0; i < PEER_CACHE_SHARDS; ++i) {
+    Shard& shard = shards[i];
+    lock_guard<mutex> lock(shard.mut);
+    steady_clock::time_point now = steady_clock::now();
+    unordered_map<PeerKey, std::deque<value_type> >::iterator it =
+        shard.peers.begin();
+
+    while (it != shard.peers.end()) {
+      std::deque<value_type>& peers = it->second;
+
+      while (!peers.empty() && peers.front().second <= now) {
+        peers.pop_front();
+        --total;
+        ++count;
+      }
+
+      if (peers.empty()) {
+        it = shard.peers.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+
+  return count;
+}
+
+/*
+ * The reaper runs only while there are cached sockets.
+ */
+void PeerPool::startReaper() {
+  lock_guard<mutex> lock(reaperMut);
+
+  if (reaping || !running) {
+    return;
+  }
+
+  if (reaper.joinable()) {
+    reaper.join();
+  }
+
+  try {
+    CREATE_THREAD(reaper, bind(&PeerPool::reap, this));
+    reaping = true;
+  } catch (const std::exception& e) {
+    LOG(WARNING, "PeerCache: failed to start the reaper: %s", e.what());
+  }
+}
+
+void PeerPool::reap() {
+  unique_lock<mutex> lock(reaperMut);
+
+  while (running) {
+    cond.wait_for(lock, milliseconds(1000));
+
+    if (!running) {
+      break;
+    }
+
+    lock.unlock();
+    int count = reapExpired();
+
+    if (count > 0) {
+      LOG(DEBUG1, "PeerCache closed %d expired connection(s).", count);
+    }
+
+    lock.lock();
+
+    if (total == 0) {
+      break;
+    }
+  }
+
+  reaping = false;
+}
+
+PeerPool PeerCache::Pool;
 
 PeerCache::PeerCache(const SessionConfig& conf)
     : cacheSize(conf.getSocketCacheCapacity()),
       expireTimeInterval(conf.getSocketCacheExpiry()) {
-  Map.setMaxSize(cacheSize);
+  Pool.setMaxSize(cacheSize);
 }
 
-std::string PeerCache::buildKey(const DatanodeInfo& datanode) {
-  std::stringstream ss;
-  ss.imbue(std::locale::classic());
-  ss << datanode.getIpAddr() << datanode.getXferPort()
-     << datanode.getDatanodeId();
-  return ss.str();
+static Counter& PeerCacheCounter(bool hit) {
+  static Counter& hits = MetricsRegistry::GetMetricsRegistry().counter(
+      "hdfs_client_peer_cache_hits_total",
+      "Datanode connections reused from the peer cache.");
+  static Counter& misses = MetricsRegistry::GetMetricsRegistry().counter(
+      "hdfs_client_peer_cache_misses_total",
+      "Datanode connection requests the peer cache could not serve.");
+  return hit ? hits : misses;
 }
 
 shared_ptr<Socket> PeerCache::getConnection(const DatanodeInfo& datanode) {
-  std::string key = buildKey(datanode);
   value_type value;
-  int64_t elipsed;
 
-  if (!Map.findAndErase(key, &value)) {
+  if (!Pool.take(PeerKey(datanode), &value)) {
+    PeerCacheCounter(false).add();
     LOG(DEBUG1, "PeerCache miss for datanode %s uuid(%s).",
         datanode.formatAddress().c_str(), datanode.getDatanodeId().c_str());
     return shared_ptr<Socket>();
-  } else if ((elipsed = ToMilliSeconds(value.second, steady_clock::now())) >
-             expireTimeInterval) {
-    LOG(DEBUG1, "PeerCache expire for datanode %s uuid(%s).",
-        datanode.formatAddress().c_str(), datanode.getDatanodeId().c_str());
-    return shared_ptr<Socket>();
   }
 
-  LOG(DEBUG1, "PeerCache hit for datanode %s uuid(%s), elipsed %" PRId64,
-      datanode.formatAddress().c_str(), datanode.getDatanodeId().c_str(),
-      elipsed);
+  PeerCacheCounter(true).add();
+  LOG(DEBUG1, "PeerCache hit for datanode %s uuid(%s).",
+      datanode.formatAddress().c_str(), datanode.getDatanodeId().c_str());
   return value.first;
 }
 
 void PeerCache::addConnection(shared_ptr<Socket> peer,
                               const DatanodeInfo& datanode) {
-  std::string key = buildKey(datanode);
-  value_type value(peer, steady_clock::now());
-  Map.insert(key, value);
+  value_type value(peer,
+                   steady_clock::now() + milliseconds(expireTimeInterval));
+  Pool.put(PeerKey(datanode), value);
   LOG(DEBUG1, "PeerCache add for datanode %s uuid(%s).",
       datanode.formatAddress().c_str(), datanode.getDatanodeId().c_str());
 }
@@ -28,19 +28,114 @@
 #ifndef _HDFS_LIBHDFS3_CLIENT_PEERCACHE_H_
 #define _HDFS_LIBHDFS3_CLIENT_PEERCACHE_H_
 
+#include <deque>
 #include <string>
 #include <utility>
 
+#include "common/Atomic.h"
 #include "common/DateTime.h"
-#include "common/LruMap.h"
+#include "common/Hash.h"
 #include "common/Memory.h"
 #include "common/SessionConfig.h"
+#include "common/Thread.h"
+#include "common/Unordered.h"
 #include "network/Socket.h"
 #include "server/DatanodeInfo.h"
 
+#define PEER_CACHE_SHARDS 16
+
 namespace Hdfs {
 namespace Internal {
 
+/*
+ * Identify a datanode by its binary address, transfer port and a hash of
+ * its uuid, so that building and comparing keys does not allocate.
+ */
+class PeerKey {
+ public:
+  explicit PeerKey(const DatanodeInfo& datanode);
+
+  size_t hash_value() const;
+
+  bool operator==(const PeerKey& other) const {
+    return port == other.port && uuid == other.uuid &&
+           memcmp(addr, other.addr, sizeof(addr)) == 0;
+  }
+
+ private:
+  uint8_t addr[16];
+  uint32_t port;
+  uint64_t uuid;
+};
+}
+}
+
+HDFS_HASH_DEFINE(::Hdfs::Internal::PeerKey);
+
+namespace Hdfs {
+namespace Internal {
+
+/*
+ * Idle sockets to datanodes, several per datanode. The sockets are spread
+ * over shards each with its own lock, the total number is bounded, and
+ * expired sockets are closed by a background thread.
+ */
+class PeerPool {
+ public:
+  // socket and the time it expires.
+  typedef std::pair<shared_ptr<Socket>, steady_clock::time_point> value_type;
+
+  PeerPool();
+
+  ~PeerPool();
+
+  void setMaxSize(int size);
+
+  /*
+   * Take the most recently added socket of the datanode, expired sockets
+   * are dropped on the way.
+   */
+  bool take(const PeerKey& key, value_type* value);
+
+  void put(const PeerKey& key, const value_type& value);
+
+  /*
+   * Drop all expired sockets.
+   * @return the number of sockets dropped.
+   */
+  int reapExpired();
+
+  int size() const {
+    return total;
+  }
+
+ private:
+  struct Shard {
+    mutex mut;
+    unordered_map<PeerKey, std::deque<value_type> > peers;
+  };
+
+  Shard& getShard(const PeerKey& key) {
+    return shards[key.hash_value() % PEER_CACHE_SHARDS];
+  }
+
+  bool evictOldest(Shard& shard);
+
+  void reap();
+
+  void startReaper();
+
+ private:
+  atomic<int> maxSize;
+  atomic<int> total;
+  bool reaping;
+  bool running;
+  condition_variable cond;
+  mutex reaperMut;
+  Shard shards[PEER_CACHE_SHARDS];
+  thread reaper;
+};
+
 class PeerCache {
  public:
   explicit PeerCache(const SessionConfig& conf);
@@ -49,15 +144,12 @@ class PeerCache {
 
   void addConnection(shared_ptr<Socket> peer, const DatanodeInfo& datanode);
 
-  typedef std::pair<shared_ptr<Socket>, steady_clock::time_point> value_type;
-
- private:
-  std::string buildKey(const DatanodeInfo& datanode);
+  typedef PeerPool::value_type value_type;
 
  private:
   const int cacheSize;
   int64_t expireTimeInterval;  // milliseconds
-  static LruMap<std::string, value_type> Map;
+  static PeerPool Pool;
 };
 }
 }
@@ -28,12 +28,14 @@
 #include "DateTime.h"
 #include "Pipeline.h"
 #include "Logger.h"
+#include "Metrics.h"
 #include "Exception.h"
 #include "ExceptionInternal.h"
 #include "OutputStreamInter.h"
 #include "FileSystemInter.h"
 #include "DataTransferProtocolSender.h"
 #include "datatransfer.pb.h"
+#include "Trace.h"
 
 #include <inttypes.h>
 
@@ -42,15 +44,23 @@ namespace Internal {
 
 PipelineImpl::PipelineImpl(bool append, const char * path, const SessionConfig & conf,
                            shared_ptr<FileSystemInter> filesystem, int checksumType, int chunkSize,
-                           int replication, int64_t bytesSent, PacketPool & packetPool, shared_ptr<LocatedBlock> lastBlock) :
+                           int replication, int64_t bytesSent, PacketPool & packetPool, shared_ptr<LocatedBlock> lastBlock,
+                           WriteCounters * counters) :
     checksumType(checksumType), chunkSize(chunkSize), errorIndex(-1), replication(replication), bytesAcked(
-        bytesSent), bytesSent(bytesSent), packetPool(packetPool), filesystem(filesystem), lastBlock(lastBlock), path(
-            path) {
+        bytesSent), bytesSent(bytesSent), packetPool(packetPool), counters(counters), filesystem(filesystem),
+    lastBlock(lastBlock), path(path) {
     canAddDatanode = conf.canAddDatanode();
     blockWriteRetry = conf.getBlockWriteRetry();
     connectTimeout = conf.getOutputConnTimeout();
     readTimeout = conf.getOutputReadTimeout();
     writeTimeout = conf.getOutputWriteTimeout();
+    dropBehind = conf.getCacheDropBehindWrites();
+    health = NULL;
+
+    if (conf.isDatanodeHealthEnabled()) {
+        health = &DatanodeHealth::GetDatanodeHealth();
+    }
+
     clientName = filesystem->getClientName();
 
     if (append) {
@@ -195,6 +205,7 @@ void PipelineImpl::checkPipelineWithReplicas() {
 }
 
 void PipelineImpl::buildForAppendOrRecovery(bool recovery) {
+    TraceSpan span(recovery ? "Pipeline::recover" : "Pipeline::buildForAppend");
     int64_t gs = 0;
     int retry = blockWriteRetry;
     exception_ptr lastException;
@@ -215,6 +226,11 @@ void PipelineImpl::buildForAppendOrRecovery(bool recovery) {
                 (recovery ? "recovery" : "append to"), lastBlock->toString().c_str(),
                 path.c_str(), StageToString(stage));
             excludedNodes.push_back(nodes[errorIndex]);
+
+            if (health) {
+                health->recordFailure(nodes[errorIndex]);
+            }
+
             nodes.erase(nodes.begin() + errorIndex);
 
             if (!storageIDs.empty()) {
@@ -375,11 +391,21 @@ static std::string FormatExcludedNodes(
 }
 
 void PipelineImpl::buildForNewBlock() {
+    TraceSpan span("Pipeline::buildForNewBlock");
     int retryAllocNewBlock = 0, retry = blockWriteRetry;
     LocatedBlock lb;
     std::vector<DatanodeInfo> excludedNodes;
     shared_ptr<LocatedBlock> block = lastBlock;
     std::string buffer;
+    size_t suppressed = 0;
+
+    /*
+     * Do not let the namenode choose datanodes which failed recently.
+     */
+    if (health) {
+        excludedNodes = health->getSuppressedNodes();
+        suppressed = excludedNodes.size();
+    }
 
     do {
         errorIndex = -1;
@@ -409,6 +435,17 @@ void PipelineImpl::buildForNewBlock() {
             LOG(LOG_ERROR,
                 "Failed to allocate a new empty block for file %s, last block %s, excluded nodes %s.\n%s",
                 path.c_str(), lastBlockName, FormatExcludedNodes(excludedNodes).c_str(), GetExceptionDetail(e, buffer));
+
+            /*
+             * The namenode may not have enough datanodes left,
+             * give the suppressed ones another chance.
+             */
+            if (suppressed > 0) {
+                excludedNodes.erase(excludedNodes.begin(), excludedNodes.begin() + suppressed);
+                suppressed = 0;
+                continue;
+            }
+
             throw;
         }
 
@@ -453,6 +490,10 @@ void PipelineImpl::buildForNewBlock() {
             LOG(INFO, "Excluding invalid datanode: %s for block %s for file %s",
                 nodes[errorIndex].formatAddress().c_str(), lastBlock->toString().c_str(), path.c_str());
             excludedNodes.push_back(nodes[errorIndex]);
+
+            if (health) {
+                health->recordFailure(nodes[errorIndex]);
+            }
         } else {
             /*
              * we don't known what happened, no datanode is reported failure, reduce retry count in case of infinite loop.
@@ -510,15 +551,24 @@ void PipelineImpl::checkBadLinkFormat(const std::string & n) {
 }
 
 void PipelineImpl::createBlockOutputStream(const Token & token, int64_t gs, bool recovery) {
+    TraceSpan span("Pipeline::createBlockOutputStream");
+    TRACE_DETAIL(span, "nodes=%d", static_cast<int>(nodes.size()));
     std::string firstBadLink;
     exception_ptr lastError;
     bool needWrapException = true;
 
     try {
+        steady_clock::time_point start = steady_clock::now();
         sock = shared_ptr < Socket > (new TcpSocketImpl);
         reader = shared_ptr<BufferedSocketReader>(new BufferedSocketReaderImpl(*sock));
         sock->connect(nodes[0].getIpAddr().c_str(), nodes[0].getXferPort(),
                       connectTimeout);
+
+        if (health) {
+            health->recordConnect(nodes[0], duration_cast<microseconds>(
+                                      steady_clock::now() - start).count());
+        }
+
         std::vector<DatanodeInfo> targets;
 
         for (size_t i = 1; i < nodes.size(); ++i) {
@@ -529,7 +579,8 @@ void PipelineImpl::createBlockOutputStream(const Token & token, int64_t gs, bool
                                           nodes[0].formatAddress());
         sender.writeBlock(*lastBlock, token, clientName.c_str(), targets,
                           (recovery ? (stage | 0x1) : stage), nodes.size(),
-                          lastBlock->getNumBytes(), bytesSent, gs, checksumType, chunkSize);
+                          lastBlock->getNumBytes(), bytesSent, gs, checksumType, chunkSize,
+                          CachingStrategy(dropBehind, -1));
         int size;
         size = reader->readVarint32(readTimeout);
         std::vector<char> buf(size);
@@ -590,20 +641,33 @@ void PipelineImpl::createBlockOutputStream(const Token & token, int64_t gs, bool
     }
 }
 
+void PipelineImpl::writePacket(Packet & packet) {
+    ConstPacketBuffer b = packet.getBuffer();
+
+    if (!packet.isHeartbeat()) {
+        packet.setSendTime(steady_clock::now());
+
+        if (counters) {
+            ++counters->packetsSent;
+        }
+    }
+
+    sock->writeFully(b.getBuffer(), b.getSize(), writeTimeout);
+    int64_t tmp = packet.getLastByteOffsetBlock();
+    bytesSent = bytesSent > tmp ? bytesSent : tmp;
+}
+
 void PipelineImpl::resend() {
     assert(stage != PIPELINE_CLOSE);
 
     for (size_t i = 0; i < packets.size(); ++i) {
-        ConstPacketBuffer b = packets[i]->getBuffer();
-        sock->writeFully(b.getBuffer(), b.getSize(), writeTimeout);
-        int64_t tmp = packets[i]->getLastByteOffsetBlock();
-        bytesSent = bytesSent > tmp ? bytesSent : tmp;
+        writePacket(*packets[i]);
     }
 }
 
 void PipelineImpl::send(shared_ptr<Packet> packet) {
-    ConstPacketBuffer buffer = packet->getBuffer();
-
+    TraceSpan span("Pipeline::send");
+    TRACE_DETAIL(span, "seqno=%" PRId64, packet->getSeqno());
     if (!packet->isHeartbeat()) {
         packets.push_back(packet);
     }
@@ -623,10 +687,7 @@ void PipelineImpl::send(shared_ptr<Packet> packet) {
                 resend();
             } else {
                 assert(sock);
-                sock->writeFully(buffer.getBuffer(), buffer.getSize(),
-                                 writeTimeout);
-                int64_t tmp = packet->getLastByteOffsetBlock();
-                bytesSent = bytesSent > tmp ? bytesSent : tmp;
+                writePacket(*packet);
             }
 
             checkResponse(false);
@@ -639,6 +700,10 @@ void PipelineImpl::send(shared_ptr<Packet> packet) {
             sock.reset();
         }
 
+        if (counters) {
+            ++counters->recoveries;
+        }
+
         buildForAppendOrRecovery(true);
         failover = true;
 
@@ -668,6 +733,20 @@ void PipelineImpl::processAck(PipelineAck & ack) {
                   packet.getSeqno(), seqno, lastBlock->toString().c_str());
         }
 
+        static Histogram & ackLatency = MetricsRegistry::GetMetricsRegistry().histogram(
+                                            "hdfs_client_packet_ack_microseconds",
+                                            "Time from sending a data packet to receiving its pipeline ack.");
+        int64_t latency = duration_cast<microseconds>(
+                              steady_clock::now() - packet.getSendTime()).count();
+        ackLatency.record(latency);
+
+        if (counters) {
+            ++counters->acksReceived;
+            counters->totalAckMicros += latency;
+            counters->maxAckMicros = latency > counters->maxAckMicros ?
+                                     latency : counters->maxAckMicros;
+        }
+
         int64_t tmp = packet.getLastByteOffsetBlock();
         bytesAcked = tmp > bytesAcked ? tmp : bytesAcked;
         assert(lastBlock);
@@ -730,6 +809,7 @@ void PipelineImpl::flush() {
 }
 
 void PipelineImpl::waitForAcks(bool force) {
+    TraceSpan span("Pipeline::waitForAcks");
     bool failover = false;
 
     while (!packets.empty()) {
@@ -763,6 +843,10 @@ void PipelineImpl::waitForAcks(bool force) {
         }
 
         if (failover) {
+            if (counters) {
+                ++counters->recoveries;
+            }
+
             buildForAppendOrRecovery(true);
 
             if (stage == PIPELINE_CLOSE) {
@@ -775,6 +859,7 @@ void PipelineImpl::waitForAcks(bool force) {
 }
 
 shared_ptr<LocatedBlock> PipelineImpl::close(shared_ptr<Packet> lastPacket) {
+    TraceSpan span("Pipeline::close");
     waitForAcks(true);
     lastPacket->setLastPacketInBlock(true);
     stage = PIPELINE_CLOSE;
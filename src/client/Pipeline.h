@@ -28,6 +28,7 @@
 #ifndef _HDFS_LIBHDFS3_CLIENT_PIPELINE_H_
 #define _HDFS_LIBHDFS3_CLIENT_PIPELINE_H_
 
+#include "DatanodeHealth.h"
 #include "FileSystemInter.h"
 #include "Memory.h"
 #include "network/BufferedSocketReader.h"
@@ -39,6 +40,7 @@
 #include "server/LocatedBlock.h"
 #include "server/Namenode.h"
 #include "SessionConfig.h"
+#include "StreamCounters.h"
 #include "Thread.h"
 
 #include <vector>
@@ -133,7 +135,7 @@ public:
     PipelineImpl(bool append, const char * path, const SessionConfig & conf,
                  shared_ptr<FileSystemInter> filesystem, int checksumType, int chunkSize,
                  int replication, int64_t bytesSent, PacketPool & packetPool,
-                 shared_ptr<LocatedBlock> lastBlock);
+                 shared_ptr<LocatedBlock> lastBlock, WriteCounters * counters = NULL);
 
     /**
      * send all data and wait for all ack.
@@ -162,6 +164,7 @@ private:
     void processAck(PipelineAck & ack);
     void processResponse();
     void resend();
+    void writePacket(Packet & packet);
     void waitForAcks(bool force);
     void transfer(const ExtendedBlock & blk, const DatanodeInfo & src,
                   const std::vector<DatanodeInfo> & targets,
@@ -178,13 +181,16 @@ private:
     int checksumType;
     int chunkSize;
     int connectTimeout;
+    int32_t dropBehind; //negative to leave it to the datanodes.
     int errorIndex;
     int readTimeout;
     int replication;
     int writeTimeout;
     int64_t bytesAcked; //the size of bytes the ack received.
     int64_t bytesSent; //the size of bytes has sent.
+    DatanodeHealth * health;
     PacketPool & packetPool;
+    WriteCounters * counters;
     shared_ptr<BufferedSocketReader> reader;
     shared_ptr<FileSystemInter> filesystem;
     shared_ptr<LocatedBlock> lastBlock;
@@ -26,6 +26,7 @@
  * limitations under the License.
  */
 #include "client/DataTransferProtocolSender.h"
+#include "client/LocalBlockReader.h"
 #include "ReadShortCircuitInfo.h"
 #include "server/Datanode.h"
 #include "datatransfer.pb.h"
@@ -34,15 +35,22 @@
 #include "network/DomainSocket.h"
 #include "SWCrc32c.h"
 #include "HWCrc32c.h"
+#include "Metrics.h"
 #include "StringUtil.h"
+#include "VerifiedChunkCache.h"
 
+#include <algorithm>
 #include <inttypes.h>
+#include <limits>
+#include <sys/stat.h>
 #include <sstream>
 #include <vector>
 
 namespace Hdfs {
 namespace Internal {
 
+// defined first, the file descriptor cache invalidates it when destroyed.
+VerifiedChunkCache ReadShortCircuitInfoBuilder::VerifiedChunks;
 ReadShortCircuitFDCacheType
     ReadShortCircuitInfoBuilder::ReadShortCircuitFDCache;
 BlockLocalPathInfoCacheType
@@ -57,8 +65,17 @@ ReadShortCircuitInfo::~ReadShortCircuitInfo() {
   }
 }
 
+void ReadShortCircuitInfo::setValid(bool valid) {
+  this->valid = valid;
+
+  if (!valid) {
+    ReadShortCircuitInfoBuilder::GetVerifiedChunkCache().invalidate(getKey());
+  }
+}
+
 ReadShortCircuitFDHolder::~ReadShortCircuitFDHolder() {
   if (metafd != -1) {
+    ReadShortCircuitInfoBuilder::GetVerifiedChunkCache().invalidate(key);
     ::close(metafd);
   }
 
@@ -68,8 +85,24 @@ ReadShortCircuitFDHolder::~ReadShortCircuitFDHolder() {
 }
 
 ReadShortCircuitInfoBuilder::ReadShortCircuitInfoBuilder(
-    const DatanodeInfo& dnInfo, const RpcAuth& auth, const SessionConfig& conf)
-    : dnInfo(dnInfo), auth(auth), conf(conf) {}
+    const DatanodeInfo& dnInfo, const RpcAuth& auth, const SessionConfig& conf,
+    const std::string& clientName)
+    : sequential(true),
+      dnInfo(dnInfo),
+      auth(auth),
+      conf(conf),
+      clientName(clientName) {}
+
+static Counter& FDCacheCounter(bool hit) {
+  static Counter& hits = MetricsRegistry::GetMetricsRegistry().counter(
+      "hdfs_client_fd_cache_hits_total",
+      "Short-circuit reads which reused cached file descriptors.");
+  static Counter& misses = MetricsRegistry::GetMetricsRegistry().counter(
+      "hdfs_client_fd_cache_misses_total",
+      "Short-circuit reads which requested file descriptors from the "
+      "datanode.");
+  return hit ? hits : misses;
+}
 
 shared_ptr<ReadShortCircuitInfo> ReadShortCircuitInfoBuilder::fetchOrCreate(
     const ExtendedBlock& block, const Token token) {
@@ -103,19 +136,30 @@ shared_ptr<ReadShortCircuitInfo> ReadShortCircuitInfoBuilder::fetchOrCreate(
     shared_ptr<ReadShortCircuitFDHolder> fds;
 
     // find a pair available file descriptors in cache.
-    if (ReadShortCircuitFDCache.findAndErase(key, &fds)) {
+    if (ReadShortCircuitFDCache.findAndErase(key, &fds) && fds->slot &&
+        !fds->slot->isValid()) {
+      LOG(DEBUG1,
+          "File descriptors of block %s have been revoked by Datanode",
+          block.toString().c_str());
+      fds.reset();
+    }
+
+    if (fds) {
       try {
         LOG(DEBUG1,
             "Get file descriptors from cache for block %s, cache size %zu",
             block.toString().c_str(), ReadShortCircuitFDCache.size());
 
-        return createReadShortCircuitInfo(key, fds);
+        retval = createReadShortCircuitInfo(key, fds);
+        FDCacheCounter(true).add();
+        return retval;
       } catch (...) {
         // failed to create file wrapper from fds, retry with new fds.
       }
     }
 
     // create a new one
+    FDCacheCounter(false).add();
     retval = createReadShortCircuitInfo(key, block, token);
     ReadShortCircuitFDCache.setMaxSize(conf.getMaxFileDescriptorCacheSize());
   }
@@ -180,6 +224,42 @@ void ReadShortCircuitInfoBuilder::invalidBlockLocalPathInfo(
       dnInfo.getXferPort(), block.getBlockId(), block.getPoolId()));
 }
 
+shared_ptr<FileWrapper> ReadShortCircuitInfoBuilder::CreateFileWrapper(
+    const SessionConfig& conf, bool sequential, bool meta) {
+  const std::string& engine = conf.getLocalReadEngine();
+  // the datanode caching hints of the stream apply to its local reads too.
+  bool dropBehind =
+      conf.isLocalReadDropBehind() || conf.isCacheDropBehindReads();
+  int32_t readahead = conf.getLocalReadReadahead();
+
+  if (conf.getCacheReadahead() >= 0) {
+    readahead = static_cast<int32_t>(
+        std::min<int64_t>(conf.getCacheReadahead(),
+                          std::numeric_limits<int32_t>::max()));
+  }
+
+  if (engine == "mmap" || (engine == "auto" && conf.doUseMappedFile())) {
+    return shared_ptr<FileWrapper>(new MappedFileWrapper);
+  }
+
+  if (engine == "stdio") {
+    return shared_ptr<FileWrapper>(new CFileWrapper);
+  }
+
+  if (meta) {
+    // a meta file holds 4 bytes of checksum for every chunk, read ahead
+    // proportionally and never bypass the page cache for it.
+    return shared_ptr<FileWrapper>(
+        new PreadFileWrapper(sequential, readahead / 128, dropBehind, false));
+  }
+
+  // random reads in auto mode are small, the alignment overhead of direct
+  // I/O is only worth paying when scanning.
+  bool direct = conf.isLocalReadDirect() && (sequential || engine == "pread");
+  return shared_ptr<FileWrapper>(
+      new PreadFileWrapper(sequential, readahead, dropBehind, direct));
+}
+
 shared_ptr<ReadShortCircuitInfo>
 ReadShortCircuitInfoBuilder::createReadShortCircuitInfo(
     const ReadShortCircuitInfoKey& key, const BlockLocalPathInfo& info) {
@@ -189,13 +269,8 @@ ReadShortCircuitInfoBuilder::createReadShortCircuitInfo(
   std::string metaFilePath = info.getLocalMetaPath();
   std::string dataFilePath = info.getLocalBlockPath();
 
-  if (conf.doUseMappedFile()) {
-    metaFile = shared_ptr<MappedFileWrapper>(new MappedFileWrapper);
-    dataFile = shared_ptr<MappedFileWrapper>(new MappedFileWrapper);
-  } else {
-    metaFile = shared_ptr<CFileWrapper>(new CFileWrapper);
-    dataFile = shared_ptr<CFileWrapper>(new CFileWrapper);
-  }
+  metaFile = CreateFileWrapper(conf, sequential, true);
+  dataFile = CreateFileWrapper(conf, sequential, false);
 
   if (!metaFile->open(metaFilePath)) {
     THROW(HdfsIOException,
@@ -213,6 +288,12 @@ ReadShortCircuitInfoBuilder::createReadShortCircuitInfo(
   metaFile->seek(0);
 
   shared_ptr<ReadShortCircuitInfo> retval(new ReadShortCircuitInfo(key, true));
+  struct stat st;
+
+  if (0 == stat(metaFilePath.c_str(), &st)) {
+    retval->setMetaIdentity(st.st_dev, st.st_ino);
+  }
+
   retval->setDataFile(dataFile);
   retval->setMetaFile(metaFile);
   return retval;
@@ -241,12 +322,31 @@ ReadShortCircuitInfoBuilder::createReadShortCircuitInfo(
     const ReadShortCircuitInfoKey& key, const ExtendedBlock& block,
     const Token& token) {
   std::string addr = buildDomainSocketAddress(key.dnPort);
+  shared_ptr<ShortCircuitSlot> slot;
+  ShortCircuitSlotId slotId;
+
+  if (conf.isShortCircuitShmEnabled()) {
+    slot = ShortCircuitShmManager::AllocSlot(addr, clientName, conf);
+  }
+
+  if (slot) {
+    slotId = slot->getSlotId();
+  }
+
   DomainSocketImpl sock;
   sock.connect(addr.c_str(), 0, conf.getInputConnTimeout());
   DataTransferProtocolSender sender(sock, conf.getInputWriteTimeout(), addr);
-  sender.requestShortCircuitFds(block, token, MaxReadShortCircuitVersion);
+  sender.requestShortCircuitFds(block, token, MaxReadShortCircuitVersion,
+                                slot ? &slotId : NULL);
   shared_ptr<ReadShortCircuitFDHolder> fds =
       receiveReadShortCircuitFDs(sock, block);
+  fds->key = key;
+
+  if (slot) {
+    slot->setRegistered(true);
+    fds->slot = slot;
+  }
+
   return createReadShortCircuitInfo(key, fds);
 }
 
@@ -338,13 +438,8 @@ ReadShortCircuitInfoBuilder::createReadShortCircuitInfo(
   shared_ptr<FileWrapper> dataFile;
   shared_ptr<FileWrapper> metaFile;
 
-  if (conf.doUseMappedFile()) {
-    metaFile = shared_ptr<MappedFileWrapper>(new MappedFileWrapper);
-    dataFile = shared_ptr<MappedFileWrapper>(new MappedFileWrapper);
-  } else {
-    metaFile = shared_ptr<CFileWrapper>(new CFileWrapper);
-    dataFile = shared_ptr<CFileWrapper>(new CFileWrapper);
-  }
+  metaFile = CreateFileWrapper(conf, sequential, true);
+  dataFile = CreateFileWrapper(conf, sequential, false);
 
   metaFile->open(fds->metafd, false);
   dataFile->open(fds->datafd, false);
@@ -353,6 +448,11 @@ ReadShortCircuitInfoBuilder::createReadShortCircuitInfo(
   metaFile->seek(0);
 
   shared_ptr<ReadShortCircuitInfo> retval(new ReadShortCircuitInfo(key, false));
+  struct stat st;
+
+  if (0 == fstat(fds->metafd, &st)) {
+    retval->setMetaIdentity(st.st_dev, st.st_ino);
+  }
 
   retval->setFdHolder(fds);
   retval->setDataFile(dataFile);
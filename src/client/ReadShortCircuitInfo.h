@@ -30,7 +30,6 @@
 
 #include "FileWrapper.h"
 #include "Hash.h"
-#include "LruMap.h"
 #include "Memory.h"
 #include "network/Socket.h"
 #include "rpc/RpcAuth.h"
@@ -38,6 +37,8 @@
 #include "server/DatanodeInfo.h"
 #include "server/ExtendedBlock.h"
 #include "SessionConfig.h"
+#include "ShardedLruMap.h"
+#include "ShortCircuitShm.h"
 #include "Thread.h"
 #include "Token.h"
 
@@ -67,11 +68,14 @@ struct ReadShortCircuitInfoKey {
 
 struct ReadShortCircuitFDHolder {
  public:
-  ReadShortCircuitFDHolder() : metafd(-1), datafd(-1) {}
+  ReadShortCircuitFDHolder() : metafd(-1), datafd(-1), key(0, 0, "") {}
   ~ReadShortCircuitFDHolder();
 
   int metafd;
   int datafd;
+  ReadShortCircuitInfoKey key;
+  // the shared memory slot the datanode revokes the descriptors through.
+  shared_ptr<ShortCircuitSlot> slot;
 };
 
 class ReadShortCircuitInfo {
@@ -80,6 +84,8 @@ class ReadShortCircuitInfo {
       : legacy(legacy),
         valid(true),
         blockId(key.blockId),
+        metaDevice(0),
+        metaInode(0),
         bpid(key.bpid),
         dnPort(key.dnPort) {}
 
@@ -99,7 +105,10 @@ class ReadShortCircuitInfo {
 
   bool isValid() const { return valid; }
 
-  void setValid(bool valid) { this->valid = valid; }
+  /*
+   * Invalidating also forgets the chunks of the replica verified so far.
+   */
+  void setValid(bool valid);
 
   int64_t getBlockId() const { return blockId; }
 
@@ -117,6 +126,15 @@ class ReadShortCircuitInfo {
     return ReadShortCircuitInfoKey(dnPort, blockId, bpid);
   }
 
+  uint64_t getMetaDevice() const { return metaDevice; }
+
+  uint64_t getMetaInode() const { return metaInode; }
+
+  void setMetaIdentity(uint64_t metaDevice, uint64_t metaInode) {
+    this->metaDevice = metaDevice;
+    this->metaInode = metaInode;
+  }
+
   bool isLegacy() const { return legacy; }
 
   void setLegacy(bool legacy) { this->legacy = legacy; }
@@ -143,23 +161,44 @@ class ReadShortCircuitInfo {
   shared_ptr<FileWrapper> metaFile;
   shared_ptr<ReadShortCircuitFDHolder> fdHolder;
   int64_t blockId;
+  uint64_t metaDevice;
+  uint64_t metaInode;
   std::string bpid;
   uint32_t dnPort;
 };
 
-typedef LruMap<ReadShortCircuitInfoKey, shared_ptr<ReadShortCircuitFDHolder> >
+class VerifiedChunkCache;
+
+typedef ShardedLruMap<ReadShortCircuitInfoKey, shared_ptr<ReadShortCircuitFDHolder> >
     ReadShortCircuitFDCacheType;
-typedef LruMap<ReadShortCircuitInfoKey, BlockLocalPathInfo>
+typedef ShardedLruMap<ReadShortCircuitInfoKey, BlockLocalPathInfo>
     BlockLocalPathInfoCacheType;
 
 class ReadShortCircuitInfoBuilder {
  public:
   ReadShortCircuitInfoBuilder(const DatanodeInfo& dnInfo, const RpcAuth& auth,
-                              const SessionConfig& conf);
+                              const SessionConfig& conf,
+                              const std::string& clientName);
   shared_ptr<ReadShortCircuitInfo> fetchOrCreate(const ExtendedBlock& block,
                                                  const Token token);
   static void release(const ReadShortCircuitInfo& info);
 
+  static VerifiedChunkCache& GetVerifiedChunkCache() { return VerifiedChunks; }
+
+  // hint how the files will be read, see CreateFileWrapper.
+  void setSequential(bool sequential) { this->sequential = sequential; }
+
+  /*
+   * Choose the engine to read a local block or meta file with.
+   * @param conf the session configure.
+   * @param sequential true if the file is expected to be scanned, false for
+   *  random reads.
+   * @param meta true for the meta file of the block.
+   * @return the file wrapper, not opened yet.
+   */
+  static shared_ptr<FileWrapper> CreateFileWrapper(const SessionConfig& conf,
+                                                   bool sequential, bool meta);
+
  private:
   BlockLocalPathInfo getBlockLocalPathInfo(const ExtendedBlock& block,
                                            const Token& token);
@@ -178,10 +217,13 @@ class ReadShortCircuitInfoBuilder {
       Socket& sock, const ExtendedBlock& block);
 
  private:
+  bool sequential;
   DatanodeInfo dnInfo;
   RpcAuth auth;
   SessionConfig conf;
+  std::string clientName;
   static const int MaxReadShortCircuitVersion = 1;
+  static VerifiedChunkCache VerifiedChunks;
   static ReadShortCircuitFDCacheType ReadShortCircuitFDCache;
   static BlockLocalPathInfoCacheType BlockLocalPathInfoCache;
 };
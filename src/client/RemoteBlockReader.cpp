@@ -32,6 +32,7 @@
 #include "HWCrc32c.h"
 #include "RemoteBlockReader.h"
 #include "SWCrc32c.h"
+#include "Trace.h"
 #include "WriteBuffer.h"
 
 #include <inttypes.h>
@@ -45,10 +46,11 @@ RemoteBlockReader::RemoteBlockReader(const ExtendedBlock& eb,
                                      PeerCache& peerCache, int64_t start,
                                      int64_t len, const Token& token,
                                      const char* clientName, bool verify,
-                                     SessionConfig& conf)
+                                     SessionConfig& conf, ReadCounters * counters)
     : sentStatus(false),
       verify(verify),
       binfo(eb),
+      health(NULL),
       datanode(datanode),
       checksumSize(0),
       chunkSize(0),
@@ -57,18 +59,54 @@ RemoteBlockReader::RemoteBlockReader(const ExtendedBlock& eb,
       cursor(start),
       endOffset(len + start),
       lastSeqNo(-1),
-      peerCache(peerCache) {
+      peerCache(peerCache),
+      counters(counters) {
 
     assert(start >= 0);
     readTimeout = conf.getInputReadTimeout();
     writeTimeout = conf.getInputWriteTimeout();
     connTimeout = conf.getInputConnTimeout();
-    sock = getNextPeer(datanode);
+
+    if (conf.isDatanodeHealthEnabled()) {
+        health = &DatanodeHealth::GetDatanodeHealth();
+    }
+
+    {
+        TraceSpan span("RemoteBlockReader::connect");
+        TRACE_DETAIL(span, "%s", datanode.formatAddress().c_str());
+
+        sock = getNextPeer(datanode);
+    }
+
     in = shared_ptr<BufferedSocketReader>(new BufferedSocketReaderImpl(*sock));
     sender = shared_ptr<DataTransferProtocol>(new DataTransferProtocolSender(
         *sock, writeTimeout, datanode.formatAddress()));
-    sender->readBlock(eb, token, clientName, start, len);
-    checkResponse();
+    TraceSpan request("RemoteBlockReader::readBlock");
+    TRACE_DETAIL(request, "block=%" PRId64 " start=%" PRId64 " len=%" PRId64,
+                 eb.getBlockId(), start, len);
+    /*
+     * If checksums are not verified, do not let the datanode read the meta
+     * file and send them.
+     */
+    steady_clock::time_point requested = steady_clock::now();
+
+    try {
+        sender->readBlock(eb, token, clientName, start, len, verify,
+                          CachingStrategy(conf.getCacheDropBehindReads(),
+                                          conf.getCacheReadahead()));
+        checkResponse();
+    } catch (const HdfsTimeoutException & e) {
+        if (health) {
+            health->recordFailure(datanode);
+        }
+
+        throw;
+    }
+
+    if (health) {
+        health->recordFirstByte(datanode, duration_cast<microseconds>(
+                                    steady_clock::now() - requested).count());
+    }
 }
 
 RemoteBlockReader::~RemoteBlockReader() {
@@ -84,16 +122,36 @@ shared_ptr<Socket> RemoteBlockReader::getNextPeer(const DatanodeInfo& dn) {
     try {
         sock = peerCache.getConnection(dn);
 
+        if (sock && counters) {
+            ++counters->peerCacheHits;
+        }
+
         if (!sock) {
+            steady_clock::time_point start = steady_clock::now();
             sock = shared_ptr<Socket>(new TcpSocketImpl);
             sock->connect(dn.getIpAddr().c_str(), dn.getXferPort(),
                           connTimeout);
             sock->setNoDelay(true);
+
+            if (health) {
+                health->recordConnect(dn, duration_cast<microseconds>(
+                                          steady_clock::now() - start).count());
+            }
         }
     } catch (const HdfsTimeoutException & e) {
+        if (health) {
+            health->recordConnectFailure(dn);
+        }
+
         NESTED_THROW(HdfsIOException,
                      "RemoteBlockReader: Failed to connect to %s",
                      dn.formatAddress().c_str());
+    } catch (const HdfsNetworkException & e) {
+        if (health) {
+            health->recordConnectFailure(dn);
+        }
+
+        throw;
     }
 
     return sock;
@@ -208,8 +266,10 @@ shared_ptr<PacketHeader> RemoteBlockReader::readPacketHeader() {
 
 void RemoteBlockReader::readNextPacket() {
     assert(position >= size);
+    TraceSpan span("RemoteBlockReader::readPacket");
     lastHeader = readPacketHeader();
     int dataSize = lastHeader->getDataLen();
+    TRACE_DETAIL(span, "seqno=%" PRId64 " len=%d", lastHeader->getSeqno(), dataSize);
     int64_t pendingAhead = 0;
 
     if (!lastHeader->sanityCheck(lastSeqNo)) {
@@ -220,21 +280,32 @@ void RemoteBlockReader::readNextPacket() {
     assert(dataSize > 0 || lastHeader->getPacketLen() == sizeof(int32_t));
 
     if (dataSize > 0) {
-        int chunks = (dataSize + chunkSize - 1) / chunkSize;
+        /*
+         * Without checksums, the datanode reports CHECKSUM_NULL and
+         * the packet has no checksum section.
+         */
+        int chunks = checksumSize > 0 ? (dataSize + chunkSize - 1) / chunkSize : 0;
         int checksumLen = chunks * checksumSize;
-        size = checksumLen + dataSize;
-        assert(size == lastHeader->getPacketLen() - static_cast<int>(sizeof(int32_t)));
-        buffer.resize(size);
-        in->readFully(&buffer[0], size, readTimeout);
-        lastSeqNo = lastHeader->getSeqno();
 
         if (lastHeader->getPacketLen() != static_cast<int>(sizeof(int32_t)) + dataSize + checksumLen) {
             THROW(HdfsIOException, "Invalid Packet, packetLen is %d, dataSize is %d, checksum size is %d",
                   lastHeader->getPacketLen(), dataSize, checksumLen);
         }
 
+        size = checksumLen + dataSize;
+        buffer.resize(size);
+        in->readFully(&buffer[0], size, readTimeout);
+        lastSeqNo = lastHeader->getSeqno();
+
         if (verify) {
-            verifyChecksum(chunks);
+            if (counters) {
+                steady_clock::time_point start = steady_clock::now();
+                verifyChecksum(chunks);
+                counters->checksumNanos += duration_cast<nanoseconds>(
+                                               steady_clock::now() - start).count();
+            } else {
+                verifyChecksum(chunks);
+            }
         }
 
         /*
@@ -287,6 +358,7 @@ void RemoteBlockReader::sendStatus() {
 }
 
 void RemoteBlockReader::verifyChecksum(int chunks) {
+    TraceSpan span("RemoteBlockReader::verifyChecksum");
     int dataSize = lastHeader->getDataLen();
     char * pchecksum = &buffer[0];
     char * pdata = &buffer[0] + (chunks * checksumSize);
@@ -331,6 +403,10 @@ int32_t RemoteBlockReader::read(char * buf, int32_t len) {
         cursor += todo;
         return todo;
     } catch (const HdfsTimeoutException & e) {
+        if (health) {
+            health->recordFailure(datanode);
+        }
+
         NESTED_THROW(HdfsIOException, "RemoteBlockReader: failed to read Block: %s from Datanode: %s.",
                      binfo.toString().c_str(), datanode.formatAddress().c_str());
     } catch (const HdfsNetworkException & e) {
@@ -361,6 +437,10 @@ void RemoteBlockReader::skip(int64_t len) {
             todo -= batch;
         }
     } catch (const HdfsTimeoutException & e) {
+        if (health) {
+            health->recordFailure(datanode);
+        }
+
         NESTED_THROW(HdfsIOException, "RemoteBlockReader: failed to read Block: %s from Datanode: %s.",
                      binfo.toString().c_str(), datanode.formatAddress().c_str());
     } catch (const HdfsNetworkException & e) {
@@ -30,6 +30,7 @@
 
 #include "BlockReader.h"
 #include "Checksum.h"
+#include "DatanodeHealth.h"
 #include "DataTransferProtocol.h"
 #include "Memory.h"
 #include "network/BufferedSocketReader.h"
@@ -39,6 +40,7 @@
 #include "server/DatanodeInfo.h"
 #include "server/LocatedBlocks.h"
 #include "SessionConfig.h"
+#include "StreamCounters.h"
 
 namespace Hdfs {
 namespace Internal {
@@ -48,7 +50,7 @@ public:
     RemoteBlockReader(const ExtendedBlock& eb, DatanodeInfo& datanode,
                       PeerCache& peerCache, int64_t start, int64_t len,
                       const Token& token, const char* clientName, bool verify,
-                      SessionConfig& conf);
+                      SessionConfig& conf, ReadCounters * counters = NULL);
 
     ~RemoteBlockReader();
 
@@ -86,6 +88,7 @@ private:
     bool sentStatus;
     bool verify; //verify checksum or not.
     const ExtendedBlock & binfo;
+    DatanodeHealth * health;
     DatanodeInfo & datanode;
     int checksumSize;
     int chunkSize;
@@ -98,6 +101,7 @@ private:
     int64_t endOffset; //offset in block requested to read to.
     int64_t lastSeqNo; //segno of the last chunk received
     PeerCache& peerCache;
+    ReadCounters * counters;
     shared_ptr<BufferedSocketReader> in;
     shared_ptr<Checksum> checksum;
     shared_ptr<DataTransferProtocol> sender;
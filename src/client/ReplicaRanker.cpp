@@ -0,0 +1,128 @@
+/********************************************************************
+ * Copyright (c) 2013 - 2014, Pivotal Inc.
+ * All rights reserved.
+ *
+ * Author: Zhanwei Wang
+ ********************************************************************/
+/********************************************************************
+ * 2014 -
+ * open source under Apache License Version 2.0
+ ********************************************************************/
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "ReplicaRanker.h"
+
+#include <algorithm>
+
+namespace Hdfs {
+namespace Internal {
+
+ReplicaRanker::ReplicaRanker() :
+    health(NULL), cachedWeight(4), fastStorageWeight(2), localWeight(8), sameRackWeight(1) {
+}
+
+ReplicaRanker::ReplicaRanker(const SessionConfig & conf,
+                             DatanodeHealth * health) :
+    health(health),
+    cachedWeight(conf.getReplicaCachedWeight()),
+    fastStorageWeight(conf.getReplicaFastStorageWeight()),
+    localWeight(conf.getReplicaLocalWeight()),
+    sameRackWeight(conf.getReplicaSameRackWeight()) {
+}
+
+int32_t ReplicaRanker::score(const LocatedBlock & lb, size_t index,
+                             const unordered_set<std::string> & localAddrs) const {
+    const DatanodeInfo & node = lb.getLocations()[index];
+    int32_t retval = 0;
+
+    if (localAddrs.find(node.getIpAddr()) != localAddrs.end()) {
+        retval += localWeight;
+    } else if (!localRack.empty() && node.getLocation() == localRack) {
+        retval += sameRackWeight;
+    }
+
+    if (lb.isCached(index)) {
+        retval += cachedWeight;
+    }
+
+    StorageType type = lb.getStorageType(index);
+
+    if (type == STORAGE_SSD || type == STORAGE_RAM_DISK) {
+        retval += fastStorageWeight;
+    }
+
+    return retval;
+}
+
+int ReplicaRanker::choose(const LocatedBlock & lb,
+                          const std::vector<DatanodeInfo> & failedNodes,
+                          const unordered_set<std::string> & localAddrs) {
+    int retval = choose(lb, failedNodes, localAddrs, health != NULL);
+
+    if (retval < 0 && health) {
+        retval = choose(lb, failedNodes, localAddrs, false);
+    }
+
+    return retval;
+}
+
+int ReplicaRanker::choose(const LocatedBlock & lb,
+                          const std::vector<DatanodeInfo> & failedNodes,
+                          const unordered_set<std::string> & localAddrs,
+                          bool avoidSuppressed) {
+    const std::vector<DatanodeInfo> & nodes = lb.getLocations();
+
+    /*
+     * The rack of this host is only known from a datanode running on it.
+     */
+    for (size_t i = 0; localRack.empty() && i < nodes.size(); ++i) {
+        if (localAddrs.find(nodes[i].getIpAddr()) != localAddrs.end()) {
+            localRack = nodes[i].getLocation();
+        }
+    }
+
+    int retval = -1;
+    int32_t best = -1;
+    int64_t bestLatency = -1;
+
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        if (std::binary_search(failedNodes.begin(), failedNodes.end(),
+                               nodes[i])) {
+            continue;
+        }
+
+        if (avoidSuppressed && health->isSuppressed(nodes[i])) {
+            continue;
+        }
+
+        int32_t s = score(lb, i, localAddrs);
+        int64_t latency = health ? health->getExpectedLatency(nodes[i]) : -1;
+
+        if (s > best || (s == best && latency >= 0 && bestLatency >= 0
+                         && latency * 2 < bestLatency)) {
+            best = s;
+            bestLatency = latency;
+            retval = static_cast<int>(i);
+        }
+    }
+
+    return retval;
+}
+
+}
+}
@@ -0,0 +1,118 @@
+/********************************************************************
+ * Copyright (c) 2013 - 2014, Pivotal Inc.
+ * All rights reserved.
+ *
+ * Author: Zhanwei Wang
+ ********************************************************************/
+/********************************************************************
+ * 2014 -
+ * open source under Apache License Version 2.0
+ ********************************************************************/
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef _HDFS_LIBHDFS3_CLIENT_REPLICARANKER_H_
+#define _HDFS_LIBHDFS3_CLIENT_REPLICARANKER_H_
+
+#include "DatanodeHealth.h"
+#include "server/DatanodeInfo.h"
+#include "server/LocatedBlock.h"
+#include "SessionConfig.h"
+#include "Unordered.h"
+
+#include <string>
+#include <vector>
+
+namespace Hdfs {
+namespace Internal {
+
+/**
+ * Rank the replicas of a block to choose the datanode to read from.
+ *
+ * A replica scores the weight of each property it has: on this host,
+ * cached in memory by the namenode, on SSD or RAM_DISK storage and on
+ * the rack of this host. The highest score wins, ties keep the order
+ * of the namenode, which sorts the replicas by network distance.
+ *
+ * With a datanode health table, suppressed datanodes are only chosen if
+ * nothing else is left, and of two replicas with the same score the one
+ * known to be more than twice as fast wins.
+ */
+class ReplicaRanker {
+public:
+    /**
+     * Construct a ranker with the default weights.
+     */
+    ReplicaRanker();
+
+    /**
+     * Construct a ranker with the weights of the session.
+     * @param conf the session configure.
+     * @param health the datanode health table to consult, NULL for none.
+     */
+    explicit ReplicaRanker(const SessionConfig & conf,
+                           DatanodeHealth * health = NULL);
+
+    /**
+     * Choose the replica to read.
+     * @param lb the block to be read.
+     * @param failedNodes the sorted datanodes not to be chosen.
+     * @param localAddrs the addresses of this host.
+     * @return the index of the chosen replica in the locations of the block,
+     *  -1 if every replica failed.
+     */
+    int choose(const LocatedBlock & lb,
+               const std::vector<DatanodeInfo> & failedNodes,
+               const unordered_set<std::string> & localAddrs);
+
+    /**
+     * Score a replica.
+     * @param lb the block.
+     * @param index the index of the replica in the locations of the block.
+     * @param localAddrs the addresses of this host.
+     * @return the score of the replica.
+     */
+    int32_t score(const LocatedBlock & lb, size_t index,
+                  const unordered_set<std::string> & localAddrs) const;
+
+    /**
+     * @return the network location of this host if a local replica
+     *  has been seen, else empty.
+     */
+    const std::string & getLocalRack() const {
+        return localRack;
+    }
+
+private:
+    int choose(const LocatedBlock & lb,
+               const std::vector<DatanodeInfo> & failedNodes,
+               const unordered_set<std::string> & localAddrs,
+               bool avoidSuppressed);
+
+private:
+    DatanodeHealth * health;
+    int32_t cachedWeight;
+    int32_t fastStorageWeight;
+    int32_t localWeight;
+    int32_t sameRackWeight;
+    std::string localRack;
+};
+
+}
+}
+
+#endif /* _HDFS_LIBHDFS3_CLIENT_REPLICARANKER_H_ */
@@ -0,0 +1,463 @@
+/********************************************************************
+ * Copyright (c) 2013 - 2014, Pivotal Inc.
+ * All rights reserved.
+ *
+ * Author: Zhanwei Wang
+ ********************************************************************/
+/********************************************************************
+ * 2014 -
+ * open source under Apache License Version 2.0
+ ********************************************************************/
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "ShortCircuitShm.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "client/DataTransferProtocolSender.h"
+#include "datatransfer.pb.h"
+#include "Exception.h"
+#include "ExceptionInternal.h"
+#include "Logger.h"
+#include "network/BufferedSocketReader.h"
+#include "network/DomainSocket.h"
+
+namespace Hdfs {
+namespace Internal {
+
+mutex ShortCircuitShmManager::ManagersMutex;
+unordered_map<std::string, shared_ptr<ShortCircuitShmManager> >
+    ShortCircuitShmManager::Managers;
+
+static void ReadResponse(Socket& sock, ::google::protobuf::Message* resp,
+                         int timeout, const std::string& path) {
+  BufferedSocketReaderImpl in(sock, 0);  // disable buffer
+  int32_t size = in.readVarint32(timeout);
+
+  if (size <= 0 || size > 1024 * 1024) {
+    THROW(HdfsIOException,
+          "ShortCircuitShmManager get a invalid response size: %d from "
+          "Datanode: %s",
+          size, path.c_str());
+  }
+
+  std::vector<char> buffer(size);
+  in.readFully(&buffer[0], size, timeout);
+
+  if (!resp->ParseFromArray(&buffer[0], size)) {
+    THROW(HdfsIOException,
+          "ShortCircuitShmManager cannot parse %s from Datanode: %s",
+          resp->GetTypeName().c_str(), path.c_str());
+  }
+}
+
+std::string ShortCircuitShmId::toString() const {
+  char buffer[40];
+  snprintf(buffer, sizeof(buffer), "%016" PRIx64 "%016" PRIx64,
+           static_cast<uint64_t>(hi), static_cast<uint64_t>(lo));
+  return buffer;
+}
+
+ShortCircuitShm::ShortCircuitShm(const ShortCircuitShmId& id, int fd,
+                                 const shared_ptr<Socket>& sock)
+    : disconnected(false),
+      base(NULL),
+      fd(fd),
+      numAllocated(0),
+      numSlots(0),
+      id(id),
+      sock(sock),
+      length(0) {
+  struct stat st;
+
+  if (fstat(fd, &st) != 0 || st.st_size < SlotSize) {
+    int err = errno;
+    ::close(fd);
+    THROW(HdfsIOException,
+          "ShortCircuitShm: invalid shared memory segment %s, %s",
+          id.toString().c_str(), GetSystemErrorInfo(err));
+  }
+
+  length = st.st_size;
+  void* addr = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+  if (addr == MAP_FAILED) {
+    int err = errno;
+    ::close(fd);
+    THROW(HdfsIOException,
+          "ShortCircuitShm: cannot map shared memory segment %s, %s",
+          id.toString().c_str(), GetSystemErrorInfo(err));
+  }
+
+  base = static_cast<char*>(addr);
+  numSlots = length / SlotSize;
+  allocated.resize(numSlots, false);
+}
+
+ShortCircuitShm::~ShortCircuitShm() {
+  munmap(base, length);
+  ::close(fd);
+}
+
+int32_t ShortCircuitShm::allocSlot() {
+  for (int32_t i = 0; i < numSlots; ++i) {
+    if (!allocated[i]) {
+      allocated[i] = true;
+      ++numAllocated;
+      memset(base + i * SlotSize, 0, SlotSize);
+      __atomic_store_n(getFlags(i), ValidFlag, __ATOMIC_SEQ_CST);
+      return i;
+    }
+  }
+
+  return -1;
+}
+
+void ShortCircuitShm::freeSlot(int32_t idx) {
+  assert(idx >= 0 && idx < numSlots && allocated[idx]);
+  __atomic_store_n(getFlags(idx), 0, __ATOMIC_SEQ_CST);
+  allocated[idx] = false;
+  --numAllocated;
+}
+
+bool ShortCircuitShm::isSlotValid(int32_t idx) const {
+  return __atomic_load_n(getFlags(idx), __ATOMIC_ACQUIRE) & ValidFlag;
+}
+
+bool ShortCircuitShm::isSlotAnchorable(int32_t idx) const {
+  return __atomic_load_n(getFlags(idx), __ATOMIC_ACQUIRE) & AnchorableFlag;
+}
+
+void ShortCircuitShm::invalidateAll() {
+  for (int32_t i = 0; i < numSlots; ++i) {
+    if (allocated[i]) {
+      __atomic_fetch_and(getFlags(i), ~ValidFlag, __ATOMIC_SEQ_CST);
+    }
+  }
+}
+
+bool ShortCircuitShm::isDisconnected() {
+  if (!disconnected) {
+    try {
+      // the datanode never writes to the socket of a segment, it is
+      // readable only when the datanode closed it.
+      if (sock->poll(true, false, 0)) {
+        disconnect();
+      }
+    } catch (const HdfsException& e) {
+      disconnect();
+    }
+  }
+
+  return disconnected;
+}
+
+void ShortCircuitShm::disconnect() {
+  disconnected = true;
+  sock->close();
+  invalidateAll();
+}
+
+ShortCircuitSlot::~ShortCircuitSlot() {
+  manager->releaseSlot(shm, idx, registered);
+}
+
+shared_ptr<ShortCircuitShmManager> ShortCircuitShmManager::GetManager(
+    const std::string& path) {
+  lock_guard<mutex> lock(ManagersMutex);
+  shared_ptr<ShortCircuitShmManager>& manager = Managers[path];
+
+  if (!manager) {
+    manager = shared_ptr<ShortCircuitShmManager>(
+        new ShortCircuitShmManager(path));
+  }
+
+  return manager;
+}
+
+shared_ptr<ShortCircuitSlot> ShortCircuitShmManager::AllocSlot(
+    const std::string& path, const std::string& clientName,
+    const SessionConfig& conf) {
+  shared_ptr<ShortCircuitShmManager> manager = GetManager(path);
+  shared_ptr<ShortCircuitShm> shm;
+  int32_t idx = -1;
+
+  try {
+    shm = manager->allocSlot(clientName, conf, &idx);
+  } catch (const HdfsCanceled& e) {
+    throw;
+  } catch (const HdfsException& e) {
+    std::string buffer;
+    LOG(WARNING,
+        "ShortCircuitShmManager: failed to allocate a shared memory slot "
+        "from Datanode %s, read without it. %s",
+        path.c_str(), GetExceptionDetail(e, buffer));
+  }
+
+  if (!shm) {
+    return shared_ptr<ShortCircuitSlot>();
+  }
+
+  return shared_ptr<ShortCircuitSlot>(
+      new ShortCircuitSlot(manager, shm, idx));
+}
+
+shared_ptr<ShortCircuitShm> ShortCircuitShmManager::allocSlot(
+    const std::string& clientName, const SessionConfig& conf, int32_t* idx) {
+  flushPendingReleases(conf);
+  lock_guard<mutex> lock(mut);
+
+  if (disabled) {
+    return shared_ptr<ShortCircuitShm>();
+  }
+
+  for (size_t i = 0; i < segments.size();) {
+    if (segments[i]->isDisconnected()) {
+      // dropSegment erases the element, keep the segment alive.
+      shared_ptr<ShortCircuitShm> shm = segments[i];
+      LOG(INFO,
+          "ShortCircuitShmManager: Datanode %s closed shared memory "
+          "segment %s",
+          path.c_str(), shm->getId().toString().c_str());
+      dropSegment(shm);
+      continue;
+    }
+
+    if (!segments[i]->isFull()) {
+      *idx = segments[i]->allocSlot();
+      return segments[i];
+    }
+
+    ++i;
+  }
+
+  if (steady_clock::now() < retryTime) {
+    return shared_ptr<ShortCircuitShm>();
+  }
+
+  shared_ptr<ShortCircuitShm> shm;
+
+  try {
+    shm = requestSegment(clientName, conf);
+  } catch (const HdfsCanceled& e) {
+    throw;
+  } catch (const HdfsException& e) {
+    retryTime = steady_clock::now() +
+                milliseconds(conf.getShortCircuitShmRetryInterval());
+    throw;
+  }
+
+  if (shm) {
+    segments.push_back(shm);
+    *idx = shm->allocSlot();
+  }
+
+  return shm;
+}
+
+shared_ptr<ShortCircuitShm> ShortCircuitShmManager::requestSegment(
+    const std::string& clientName, const SessionConfig& conf) {
+  shared_ptr<DomainSocketImpl> sock(new DomainSocketImpl);
+  sock->connect(path.c_str(), 0, conf.getInputConnTimeout());
+  DataTransferProtocolSender sender(*sock, conf.getInputWriteTimeout(), path);
+  sender.requestShortCircuitShm(clientName.c_str());
+  ShortCircuitShmResponseProto resp;
+
+  try {
+    ReadResponse(*sock, &resp, conf.getInputReadTimeout(), path);
+  } catch (const HdfsEndOfStream& e) {
+    // datanodes without shared memory support close the connection on
+    // an unknown op.
+    resp.set_status(Status::DT_PROTO_ERROR_UNSUPPORTED);
+  }
+
+  if (resp.status() == Status::DT_PROTO_ERROR_UNSUPPORTED) {
+    LOG(WARNING,
+        "ShortCircuitShmManager: Datanode %s does not support shared "
+        "memory segments, read short-circuit without them. %s",
+        path.c_str(), resp.has_error() ? resp.error().c_str() : "");
+    disabled = true;
+    return shared_ptr<ShortCircuitShm>();
+  }
+
+  if (resp.status() != Status::DT_PROTO_SUCCESS || !resp.has_id()) {
+    THROW(HdfsIOException,
+          "ShortCircuitShmManager: Datanode %s failed to allocate a shared "
+          "memory segment, %s",
+          path.c_str(), resp.has_error() ? resp.error().c_str()
+                                         : "check Datanode's log for more "
+                                           "information");
+  }
+
+  int fd = -1;
+  char buffer[1];
+  sock->receiveFileDescriptors(&fd, 1, buffer, sizeof(buffer));
+
+  if (fd == -1) {
+    THROW(HdfsIOException,
+          "ShortCircuitShmManager: failed to receive shared memory segment "
+          "from Datanode %s",
+          path.c_str());
+  }
+
+  shared_ptr<ShortCircuitShm> shm(new ShortCircuitShm(
+      ShortCircuitShmId(resp.id().hi(), resp.id().lo()), fd, sock));
+  LOG(DEBUG1,
+      "ShortCircuitShmManager: got shared memory segment %s with %d slots "
+      "from Datanode %s",
+      shm->getId().toString().c_str(), shm->getNumSlots(), path.c_str());
+  return shm;
+}
+
+void ShortCircuitShmManager::releaseSlot(
+    const shared_ptr<ShortCircuitShm>& shm, int32_t idx, bool registered) {
+  lock_guard<mutex> lock(mut);
+
+  if (registered && !shm->isDisconnected()) {
+    pendingReleases.push_back(std::make_pair(shm, idx));
+  } else {
+    shm->freeSlot(idx);
+  }
+}
+
+void ShortCircuitShmManager::FlushAll(const SessionConfig& conf) {
+  std::vector<shared_ptr<ShortCircuitShmManager> > managers;
+  {
+    lock_guard<mutex> lock(ManagersMutex);
+    unordered_map<std::string, shared_ptr<ShortCircuitShmManager> >::iterator
+        it = Managers.begin();
+
+    for (; it != Managers.end(); ++it) {
+      managers.push_back(it->second);
+    }
+  }
+
+  for (size_t i = 0; i < managers.size(); ++i) {
+    managers[i]->flushPendingReleases(conf);
+  }
+}
+
+void ShortCircuitShmManager::flushPendingReleases(const SessionConfig& conf) {
+  std::vector<PendingRelease> releases;
+  {
+    lock_guard<mutex> lock(mut);
+
+    for (size_t i = 0; i < pendingReleases.size(); ++i) {
+      if (pendingReleases[i].first->isDisconnected()) {
+        pendingReleases[i].first->freeSlot(pendingReleases[i].second);
+      } else {
+        releases.push_back(pendingReleases[i]);
+      }
+    }
+
+    pendingReleases.clear();
+  }
+
+  if (releases.empty()) {
+    return;
+  }
+
+  // talk to the datanode without the lock, the slots stay allocated until
+  // the datanode has let them go.
+  std::vector<PendingRelease> released;
+  std::vector<shared_ptr<ShortCircuitShm> > failed;
+  size_t i = 0;
+
+  try {
+    DomainSocketImpl sock;
+    sock.connect(path.c_str(), 0, conf.getInputConnTimeout());
+    DataTransferProtocolSender sender(sock, conf.getInputWriteTimeout(), path);
+
+    for (; i < releases.size(); ++i) {
+      shared_ptr<ShortCircuitShm> shm = releases[i].first;
+      int32_t idx = releases[i].second;
+      sender.releaseShortCircuitFds(ShortCircuitSlotId(shm->getId(), idx));
+      ReleaseShortCircuitAccessResponseProto resp;
+      ReadResponse(sock, &resp, conf.getInputReadTimeout(), path);
+
+      if (resp.status() != Status::DT_PROTO_SUCCESS) {
+        LOG(WARNING,
+            "ShortCircuitShmManager: Datanode %s failed to release slot %d "
+            "of shared memory segment %s, %s",
+            path.c_str(), idx, shm->getId().toString().c_str(),
+            resp.has_error() ? resp.error().c_str() : "");
+        failed.push_back(shm);
+        continue;
+      }
+
+      released.push_back(releases[i]);
+    }
+  } catch (const HdfsCanceled& e) {
+    throw;
+  } catch (const HdfsException& e) {
+    std::string buffer;
+    LOG(WARNING,
+        "ShortCircuitShmManager: failed to release shared memory slots to "
+        "Datanode %s. %s",
+        path.c_str(), GetExceptionDetail(e, buffer));
+
+    // the datanode frees the slots when the segment is closed.
+    for (; i < releases.size(); ++i) {
+      failed.push_back(releases[i].first);
+    }
+  }
+
+  lock_guard<mutex> lock(mut);
+
+  for (size_t j = 0; j < released.size(); ++j) {
+    released[j].first->freeSlot(released[j].second);
+  }
+
+  for (size_t j = 0; j < failed.size(); ++j) {
+    dropSegment(failed[j]);
+  }
+}
+
+void ShortCircuitShmManager::dropSegment(
+    const shared_ptr<ShortCircuitShm>& shm) {
+  shm->disconnect();
+
+  for (size_t i = 0; i < segments.size(); ++i) {
+    if (segments[i] == shm) {
+      segments.erase(segments.begin() + i);
+      break;
+    }
+  }
+}
+
+bool ShortCircuitShmManager::isDisabled() {
+  lock_guard<mutex> lock(mut);
+  return disabled;
+}
+
+size_t ShortCircuitShmManager::getNumSegments() {
+  lock_guard<mutex> lock(mut);
+  return segments.size();
+}
+
+size_t ShortCircuitShmManager::getNumPendingReleases() {
+  lock_guard<mutex> lock(mut);
+  return pendingReleases.size();
+}
+}
+}
@@ -0,0 +1,261 @@
+/********************************************************************
+ * Copyright (c) 2013 - 2014, Pivotal Inc.
+ * All rights reserved.
+ *
+ * Author: Zhanwei Wang
+ ********************************************************************/
+/********************************************************************
+ * 2014 -
+ * open source under Apache License Version 2.0
+ ********************************************************************/
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef _HDFS_LIBHDFS3_CLIENT_SHORTCIRCUITSHM_H_
+#define _HDFS_LIBHDFS3_CLIENT_SHORTCIRCUITSHM_H_
+
+#include <stdint.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "common/DateTime.h"
+#include "common/Memory.h"
+#include "common/SessionConfig.h"
+#include "common/Thread.h"
+#include "common/Unordered.h"
+#include "network/Socket.h"
+
+namespace Hdfs {
+namespace Internal {
+
+/*
+ * Identify a shared memory segment handed out by a datanode.
+ */
+struct ShortCircuitShmId {
+  ShortCircuitShmId() : hi(0), lo(0) {}
+
+  ShortCircuitShmId(int64_t hi, int64_t lo) : hi(hi), lo(lo) {}
+
+  bool operator==(const ShortCircuitShmId& other) const {
+    return hi == other.hi && lo == other.lo;
+  }
+
+  std::string toString() const;
+
+  int64_t hi;
+  int64_t lo;
+};
+
+/*
+ * Identify a slot within a shared memory segment.
+ */
+struct ShortCircuitSlotId {
+  ShortCircuitSlotId() : slotIdx(-1) {}
+
+  ShortCircuitSlotId(const ShortCircuitShmId& shmId, int32_t slotIdx)
+      : shmId(shmId), slotIdx(slotIdx) {}
+
+  ShortCircuitShmId shmId;
+  int32_t slotIdx;
+};
+
+/*
+ * A shared memory segment created by a datanode and mapped by the client.
+ * The segment is divided into fixed size slots, one per replica whose file
+ * descriptors the client holds. The datanode revokes a replica by clearing
+ * the valid flag of its slot, so the client can tell whether cached file
+ * descriptors are still usable without a round trip.
+ *
+ * The datanode keeps the segment as long as the domain socket it was
+ * requested on stays open. Not thread safe, the owning
+ * ShortCircuitShmManager serializes slot allocation.
+ */
+class ShortCircuitShm {
+ public:
+  static const int SlotSize = 64;
+  static const uint64_t ValidFlag = 1ull << 63;
+  static const uint64_t AnchorableFlag = 1ull << 62;
+
+  /*
+   * Map the segment and take the ownership of the file descriptor and of
+   * the socket the segment was received on.
+   */
+  ShortCircuitShm(const ShortCircuitShmId& id, int fd,
+                  const shared_ptr<Socket>& sock);
+
+  ~ShortCircuitShm();
+
+  /*
+   * Allocate a free slot and mark it valid.
+   * @return the slot index, or -1 if the segment is full.
+   */
+  int32_t allocSlot();
+
+  void freeSlot(int32_t idx);
+
+  bool isSlotValid(int32_t idx) const;
+
+  bool isSlotAnchorable(int32_t idx) const;
+
+  /*
+   * Clear the valid flag of all slots, used when the datanode is gone.
+   */
+  void invalidateAll();
+
+  /*
+   * Check whether the datanode closed the socket of the segment.
+   */
+  bool isDisconnected();
+
+  void disconnect();
+
+  bool isFull() const { return numAllocated == numSlots; }
+
+  bool isEmpty() const { return numAllocated == 0; }
+
+  int32_t getNumSlots() const { return numSlots; }
+
+  const ShortCircuitShmId& getId() const { return id; }
+
+ private:
+  ShortCircuitShm(const ShortCircuitShm& other);
+  ShortCircuitShm& operator=(const ShortCircuitShm& other);
+
+  uint64_t* getFlags(int32_t idx) const {
+    return reinterpret_cast<uint64_t*>(base + idx * SlotSize);
+  }
+
+ private:
+  bool disconnected;
+  char* base;
+  int fd;
+  int32_t numAllocated;
+  int32_t numSlots;
+  ShortCircuitShmId id;
+  shared_ptr<Socket> sock;
+  size_t length;
+  std::vector<bool> allocated;
+};
+
+class ShortCircuitShmManager;
+
+/*
+ * A slot held by the client for one replica. The slot goes back to its
+ * manager when destroyed, which tells the datanode to release the replica
+ * the next time it is contacted.
+ */
+class ShortCircuitSlot {
+ public:
+  ShortCircuitSlot(const shared_ptr<ShortCircuitShmManager>& manager,
+                   const shared_ptr<ShortCircuitShm>& shm, int32_t idx)
+      : registered(false), idx(idx), manager(manager), shm(shm) {}
+
+  ~ShortCircuitSlot();
+
+  bool isValid() const { return shm->isSlotValid(idx); }
+
+  bool isAnchorable() const { return shm->isSlotAnchorable(idx); }
+
+  ShortCircuitSlotId getSlotId() const {
+    return ShortCircuitSlotId(shm->getId(), idx);
+  }
+
+  /*
+   * Mark the slot as known by the datanode, it has to be released
+   * explicitly once the client is done with it.
+   */
+  void setRegistered(bool registered) { this->registered = registered; }
+
+ private:
+  ShortCircuitSlot(const ShortCircuitSlot& other);
+  ShortCircuitSlot& operator=(const ShortCircuitSlot& other);
+
+ private:
+  bool registered;
+  int32_t idx;
+  shared_ptr<ShortCircuitShmManager> manager;
+  shared_ptr<ShortCircuitShm> shm;
+};
+
+/*
+ * The shared memory segments of one datanode, identified by the path of
+ * its domain socket. New segments are requested when all the existing ones
+ * are full, after a failed request no new segment is asked for until the
+ * retry interval has passed. Released slots are queued and returned to the
+ * datanode the next time a slot is allocated or FlushAll is called, so no
+ * network I/O happens when a slot is destroyed.
+ */
+class ShortCircuitShmManager {
+ public:
+  explicit ShortCircuitShmManager(const std::string& path)
+      : disabled(false), path(path) {}
+
+  /*
+   * Allocate a slot from the segments of the datanode listening on path.
+   * @return the slot, or an empty pointer if the datanode does not support
+   * shared memory segments.
+   */
+  static shared_ptr<ShortCircuitSlot> AllocSlot(const std::string& path,
+                                                const std::string& clientName,
+                                                const SessionConfig& conf);
+
+  static shared_ptr<ShortCircuitShmManager> GetManager(
+      const std::string& path);
+
+  /*
+   * Return the queued slots of all datanodes, called when a stream or a
+   * filesystem is closed so that an idle client does not pin replicas.
+   */
+  static void FlushAll(const SessionConfig& conf);
+
+  void releaseSlot(const shared_ptr<ShortCircuitShm>& shm, int32_t idx,
+                   bool registered);
+
+  bool isDisabled();
+
+  size_t getNumSegments();
+
+  size_t getNumPendingReleases();
+
+ private:
+  shared_ptr<ShortCircuitShm> allocSlot(const std::string& clientName,
+                                        const SessionConfig& conf,
+                                        int32_t* idx);
+  shared_ptr<ShortCircuitShm> requestSegment(const std::string& clientName,
+                                             const SessionConfig& conf);
+  void flushPendingReleases(const SessionConfig& conf);
+  void dropSegment(const shared_ptr<ShortCircuitShm>& shm);
+
+ private:
+  typedef std::pair<shared_ptr<ShortCircuitShm>, int32_t> PendingRelease;
+
+  bool disabled;
+  mutex mut;
+  std::string path;
+  std::vector<PendingRelease> pendingReleases;
+  std::vector<shared_ptr<ShortCircuitShm> > segments;
+  steady_clock::time_point retryTime;
+
+  static mutex ManagersMutex;
+  static unordered_map<std::string, shared_ptr<ShortCircuitShmManager> >
+      Managers;
+};
+}
+}
+
+#endif /* _HDFS_LIBHDFS3_CLIENT_SHORTCIRCUITSHM_H_ */
@@ -0,0 +1,81 @@
+/********************************************************************
+ * Copyright (c) 2013 - 2014, Pivotal Inc.
+ * All rights reserved.
+ *
+ * Author: Zhanwei Wang
+ ********************************************************************/
+/********************************************************************
+ * 2014 -
+ * open source under Apache License Version 2.0
+ ********************************************************************/
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef _HDFS_LIBHDFS3_CLIENT_STREAMCOUNTERS_H_
+#define _HDFS_LIBHDFS3_CLIENT_STREAMCOUNTERS_H_
+
+#include <stdint.h>
+
+namespace Hdfs {
+namespace Internal {
+
+/*
+ * Counters kept inline by an input stream and the block readers it sets up.
+ * They are plain integers updated by the thread using the stream, see
+ * ReadStatistics for their meaning.
+ */
+struct ReadCounters {
+    ReadCounters() :
+        bytesRead(0), shortCircuitBytes(0), localBytes(0), remoteBytes(0),
+        cacheBytes(0), blockReaderSetups(0), peerCacheHits(0),
+        checksumNanos(0), retries(0), failovers(0) {
+    }
+
+    int64_t bytesRead;
+    int64_t shortCircuitBytes;
+    int64_t localBytes;
+    int64_t remoteBytes;
+    int64_t cacheBytes;
+    int64_t blockReaderSetups;
+    int64_t peerCacheHits;
+    int64_t checksumNanos;
+    int64_t retries;
+    int64_t failovers;
+};
+
+/*
+ * Counters kept inline by an output stream and its pipelines, see
+ * WriteStatistics for their meaning.
+ */
+struct WriteCounters {
+    WriteCounters() :
+        bytesWritten(0), packetsSent(0), acksReceived(0),
+        totalAckMicros(0), maxAckMicros(0), recoveries(0) {
+    }
+
+    int64_t bytesWritten;
+    int64_t packetsSent;
+    int64_t acksReceived;
+    int64_t totalAckMicros;
+    int64_t maxAckMicros;
+    int64_t recoveries;
+};
+
+}
+}
+
+#endif /* _HDFS_LIBHDFS3_CLIENT_STREAMCOUNTERS_H_ */
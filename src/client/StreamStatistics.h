@@ -0,0 +1,286 @@
+/********************************************************************
+ * Copyright (c) 2013 - 2014, Pivotal Inc.
+ * All rights reserved.
+ *
+ * Author: Zhanwei Wang
+ ********************************************************************/
+/********************************************************************
+ * 2014 -
+ * open source under Apache License Version 2.0
+ ********************************************************************/
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef _HDFS_LIBHDFS3_CLIENT_STREAMSTATISTICS_H_
+#define _HDFS_LIBHDFS3_CLIENT_STREAMSTATISTICS_H_
+
+#include <stdint.h>
+
+namespace Hdfs {
+
+/**
+ * Statistics of an input stream.
+ */
+class ReadStatistics {
+public:
+    /**
+     * To construct an empty ReadStatistics.
+     */
+    ReadStatistics() :
+        bytesRead(0), shortCircuitBytesRead(0), localBytesRead(0),
+        remoteBytesRead(0), cacheBytesRead(0), blockReaderSetups(0),
+        peerCacheHits(0), checksumTime(0), readRetries(0),
+        datanodeFailovers(0) {
+    }
+
+    /**
+     * Return the number of bytes returned to the caller.
+     * @return the bytes read.
+     */
+    int64_t getBytesRead() const {
+        return bytesRead;
+    }
+
+    void setBytesRead(int64_t bytesRead) {
+        this->bytesRead = bytesRead;
+    }
+
+    /**
+     * Return the number of bytes read from local replicas with short-circuit reads.
+     * @return the short-circuit bytes.
+     */
+    int64_t getShortCircuitBytesRead() const {
+        return shortCircuitBytesRead;
+    }
+
+    void setShortCircuitBytesRead(int64_t shortCircuitBytesRead) {
+        this->shortCircuitBytesRead = shortCircuitBytesRead;
+    }
+
+    /**
+     * Return the number of bytes read over TCP from a datanode on this host.
+     * @return the local TCP bytes.
+     */
+    int64_t getLocalBytesRead() const {
+        return localBytesRead;
+    }
+
+    void setLocalBytesRead(int64_t localBytesRead) {
+        this->localBytesRead = localBytesRead;
+    }
+
+    /**
+     * Return the number of bytes read over TCP from datanodes on other hosts.
+     * @return the remote bytes.
+     */
+    int64_t getRemoteBytesRead() const {
+        return remoteBytesRead;
+    }
+
+    void setRemoteBytesRead(int64_t remoteBytesRead) {
+        this->remoteBytesRead = remoteBytesRead;
+    }
+
+    /**
+     * Return the number of bytes served from the block range cache.
+     * @return the cached bytes.
+     */
+    int64_t getCacheBytesRead() const {
+        return cacheBytesRead;
+    }
+
+    void setCacheBytesRead(int64_t cacheBytesRead) {
+        this->cacheBytesRead = cacheBytesRead;
+    }
+
+    /**
+     * Return the number of block readers set up.
+     * @return the number of block reader setups.
+     */
+    int64_t getBlockReaderSetups() const {
+        return blockReaderSetups;
+    }
+
+    void setBlockReaderSetups(int64_t blockReaderSetups) {
+        this->blockReaderSetups = blockReaderSetups;
+    }
+
+    /**
+     * Return the number of remote block readers which reused a cached connection.
+     * @return the number of peer cache hits.
+     */
+    int64_t getPeerCacheHits() const {
+        return peerCacheHits;
+    }
+
+    void setPeerCacheHits(int64_t peerCacheHits) {
+        this->peerCacheHits = peerCacheHits;
+    }
+
+    /**
+     * Return the time spent verifying checksums.
+     * @return the checksum time in microseconds.
+     */
+    int64_t getChecksumTime() const {
+        return checksumTime;
+    }
+
+    void setChecksumTime(int64_t checksumTime) {
+        this->checksumTime = checksumTime;
+    }
+
+    /**
+     * Return the number of failed block reader setups and reads which were retried.
+     * @return the number of retries.
+     */
+    int64_t getReadRetries() const {
+        return readRetries;
+    }
+
+    void setReadRetries(int64_t readRetries) {
+        this->readRetries = readRetries;
+    }
+
+    /**
+     * Return the number of times the stream gave up on a datanode and moved to another replica.
+     * @return the number of failovers.
+     */
+    int64_t getDatanodeFailovers() const {
+        return datanodeFailovers;
+    }
+
+    void setDatanodeFailovers(int64_t datanodeFailovers) {
+        this->datanodeFailovers = datanodeFailovers;
+    }
+
+private:
+    int64_t bytesRead;
+    int64_t shortCircuitBytesRead;
+    int64_t localBytesRead;
+    int64_t remoteBytesRead;
+    int64_t cacheBytesRead;
+    int64_t blockReaderSetups;
+    int64_t peerCacheHits;
+    int64_t checksumTime;
+    int64_t readRetries;
+    int64_t datanodeFailovers;
+};
+
+/**
+ * Statistics of an output stream.
+ */
+class WriteStatistics {
+public:
+    /**
+     * To construct an empty WriteStatistics.
+     */
+    WriteStatistics() :
+        bytesWritten(0), packetsSent(0), acksReceived(0), totalAckLatency(0),
+        maxAckLatency(0), pipelineRecoveries(0) {
+    }
+
+    /**
+     * Return the number of bytes appended to the stream.
+     * @return the bytes written.
+     */
+    int64_t getBytesWritten() const {
+        return bytesWritten;
+    }
+
+    void setBytesWritten(int64_t bytesWritten) {
+        this->bytesWritten = bytesWritten;
+    }
+
+    /**
+     * Return the number of data packets sent to the pipeline, resent packets included.
+     * @return the number of packets sent.
+     */
+    int64_t getPacketsSent() const {
+        return packetsSent;
+    }
+
+    void setPacketsSent(int64_t packetsSent) {
+        this->packetsSent = packetsSent;
+    }
+
+    /**
+     * Return the number of data packets acknowledged by the pipeline.
+     * @return the number of acks.
+     */
+    int64_t getAcksReceived() const {
+        return acksReceived;
+    }
+
+    void setAcksReceived(int64_t acksReceived) {
+        this->acksReceived = acksReceived;
+    }
+
+    /**
+     * Return the sum of the time between sending a packet and receiving its ack.
+     * @return the total ack latency in microseconds.
+     */
+    int64_t getTotalAckLatency() const {
+        return totalAckLatency;
+    }
+
+    void setTotalAckLatency(int64_t totalAckLatency) {
+        this->totalAckLatency = totalAckLatency;
+    }
+
+    /**
+     * Return the longest time between sending a packet and receiving its ack.
+     * @return the maximum ack latency in microseconds.
+     */
+    int64_t getMaxAckLatency() const {
+        return maxAckLatency;
+    }
+
+    void setMaxAckLatency(int64_t maxAckLatency) {
+        this->maxAckLatency = maxAckLatency;
+    }
+
+    /**
+     * Return the number of times the pipeline was rebuilt after a datanode failure.
+     * @return the number of pipeline recoveries.
+     */
+    int64_t getPipelineRecoveries() const {
+        return pipelineRecoveries;
+    }
+
+    void setPipelineRecoveries(int64_t pipelineRecoveries) {
+        this->pipelineRecoveries = pipelineRecoveries;
+    }
+
+    /**
+     * Return the average time between sending a packet and receiving its ack.
+     * @return the average ack latency in microseconds.
+     */
+    double getAverageAckLatency() const {
+        return acksReceived > 0 ? static_cast<double>(totalAckLatency) / acksReceived : 0;
+    }
+
+private:
+    int64_t bytesWritten;
+    int64_t packetsSent;
+    int64_t acksReceived;
+    int64_t totalAckLatency;
+    int64_t maxAckLatency;
+    int64_t pipelineRecoveries;
+};
+
+}
+#endif /* _HDFS_LIBHDFS3_CLIENT_STREAMSTATISTICS_H_ */
@@ -0,0 +1,169 @@
+/********************************************************************
+ * Copyright (c) 2013 - 2014, Pivotal Inc.
+ * All rights reserved.
+ *
+ * Author: Zhanwei Wang
+ ********************************************************************/
+/********************************************************************
+ * 2014 -
+ * open source under Apache License Version 2.0
+ ********************************************************************/
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "VerifiedChunkCache.h"
+#include "common/Metrics.h"
+
+namespace Hdfs {
+namespace Internal {
+
+static Counter& VerifiedBytesCounter() {
+  static Counter& counter = MetricsRegistry::GetMetricsRegistry().counter(
+      "hdfs_client_checksum_verified_bytes_total",
+      "Bytes of local replicas whose checksum has been computed.");
+  return counter;
+}
+
+static Counter& SkippedBytesCounter() {
+  static Counter& counter = MetricsRegistry::GetMetricsRegistry().counter(
+      "hdfs_client_checksum_skipped_bytes_total",
+      "Bytes of local replicas read without computing the checksum again.");
+  return counter;
+}
+
+static Counter& SavedNanosCounter() {
+  static Counter& counter = MetricsRegistry::GetMetricsRegistry().counter(
+      "hdfs_client_checksum_saved_nanoseconds_total",
+      "Estimated checksum computing time saved by the verified chunk "
+      "cache.");
+  return counter;
+}
+
+VerifiedChunkCache::VerifiedChunkCache()
+    : maxSize(0), skippedBytes(0), verifiedBytes(0), verifyNanos(0),
+      entries(0, VERIFIED_CHUNK_CACHE_SHARDS) {}
+
+void VerifiedChunkCache::setMaxSize(int size) {
+  lock_guard<mutex> lock(configureMut);
+  maxSize = size;
+  entries.setMaxSize(size);
+}
+
+void VerifiedChunkCache::configure(int size) {
+  lock_guard<mutex> lock(configureMut);
+
+  if (size > maxSize) {
+    maxSize = size;
+    entries.setMaxSize(size);
+  }
+}
+
+void VerifiedChunkCache::recordVerified(int64_t bytes, int64_t nanos) {
+  verifiedBytes += bytes;
+  verifyNanos += nanos;
+  VerifiedBytesCounter().add(bytes);
+}
+
+void VerifiedChunkCache::recordSkipped(int64_t bytes) {
+  int64_t verified = verifiedBytes;
+  skippedBytes += bytes;
+  SkippedBytesCounter().add(bytes);
+
+  if (verified > 0) {
+    SavedNanosCounter().add(static_cast<int64_t>(
+        static_cast<double>(bytes) * verifyNanos / verified));
+  }
+}
+
+bool VerifiedChunkCache::isVerified(const ReadShortCircuitInfoKey& key,
+                                    const VerifiedReplica& replica,
+                                    int64_t start, int64_t end) {
+  shared_ptr<Entry> entry;
+
+  if (!entries.find(key, &entry)) {
+    return false;
+  }
+
+  lock_guard<mutex> lock(entry->mut);
+
+  if (!(entry->replica == replica)) {
+    return false;
+  }
+
+  std::map<int64_t, int64_t>::iterator it = entry->ranges.upper_bound(start);
+
+  if (it == entry->ranges.begin()) {
+    return false;
+  }
+
+  --it;
+  return it->first <= start && end <= it->second;
+}
+
+void VerifiedChunkCache::addVerified(const ReadShortCircuitInfoKey& key,
+                                     const VerifiedReplica& replica,
+                                     int64_t start, int64_t end) {
+  shared_ptr<Entry> entry;
+
+  if (!entries.find(key, &entry) || !(entry->replica == replica)) {
+    entry = shared_ptr<Entry>(new Entry(replica));
+    entries.insert(key, entry);
+  }
+
+  lock_guard<mutex> lock(entry->mut);
+  std::map<int64_t, int64_t>& ranges = entry->ranges;
+
+  // merge with the ranges overlapping or adjacent to [start, end).
+  std::map<int64_t, int64_t>::iterator it = ranges.upper_bound(start);
+
+  if (it != ranges.begin()) {
+    std::map<int64_t, int64_t>::iterator prev = it;
+    --prev;
+
+    if (prev->second >= start) {
+      start = prev->first;
+      end = end > prev->second ? end : prev->second;
+      it = prev;
+    }
+  }
+
+  while (it != ranges.end() && it->first <= end) {
+    end = end > it->second ? end : it->second;
+    ranges.erase(it++);
+  }
+
+  ranges[start] = end;
+}
+
+void VerifiedChunkCache::invalidate(const ReadShortCircuitInfoKey& key) {
+  entries.erase(key);
+}
+
+VerifiedChunkCacheStats VerifiedChunkCache::getStats() const {
+  VerifiedChunkCacheStats stats;
+  stats.verifiedBytes = verifiedBytes;
+  stats.verifyNanos = verifyNanos;
+  stats.skippedBytes = skippedBytes;
+  stats.savedNanos =
+      stats.verifiedBytes > 0
+          ? static_cast<int64_t>(static_cast<double>(stats.skippedBytes) *
+                                 stats.verifyNanos / stats.verifiedBytes)
+          : 0;
+  return stats;
+}
+}
+}
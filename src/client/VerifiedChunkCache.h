@@ -0,0 +1,132 @@
+/********************************************************************
+ * Copyright (c) 2013 - 2014, Pivotal Inc.
+ * All rights reserved.
+ *
+ * Author: Zhanwei Wang
+ ********************************************************************/
+/********************************************************************
+ * 2014 -
+ * open source under Apache License Version 2.0
+ ********************************************************************/
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef _HDFS_LIBHDFS3_CLIENT_VERIFIEDCHUNKCACHE_H_
+#define _HDFS_LIBHDFS3_CLIENT_VERIFIEDCHUNKCACHE_H_
+
+#include <map>
+
+#include "common/Atomic.h"
+#include "common/Memory.h"
+#include "common/ShardedLruMap.h"
+#include "common/Thread.h"
+#include "ReadShortCircuitInfo.h"
+
+// lookups happen once per read buffer, a few shards are enough.
+#define VERIFIED_CHUNK_CACHE_SHARDS 4
+
+namespace Hdfs {
+namespace Internal {
+
+/*
+ * Identify the replica whose chunks have been verified. A new generation
+ * stamp or another meta file means the replica changed on disk.
+ */
+struct VerifiedReplica {
+  VerifiedReplica() : generationStamp(0), metaDevice(0), metaInode(0) {}
+
+  VerifiedReplica(int64_t generationStamp, uint64_t metaDevice,
+                  uint64_t metaInode)
+      : generationStamp(generationStamp),
+        metaDevice(metaDevice),
+        metaInode(metaInode) {}
+
+  bool operator==(const VerifiedReplica& other) const {
+    return generationStamp == other.generationStamp &&
+           metaDevice == other.metaDevice && metaInode == other.metaInode;
+  }
+
+  int64_t generationStamp;
+  uint64_t metaDevice;
+  uint64_t metaInode;
+};
+
+struct VerifiedChunkCacheStats {
+  int64_t verifiedBytes;  // bytes whose checksum has been computed.
+  int64_t verifyNanos;    // time spent computing them.
+  int64_t skippedBytes;   // bytes read without computing the checksum.
+  int64_t savedNanos;     // estimated time saved by skipping them.
+};
+
+/*
+ * Process-wide record of the byte ranges of local replicas whose checksum
+ * has been verified, so that other readers of the same replica can skip
+ * computing it again. The bytes verified and skipped, and the time saved,
+ * are exported through the metrics registry.
+ */
+class VerifiedChunkCache {
+ public:
+  VerifiedChunkCache();
+
+  // the maximum number of replicas to remember, 0 disables the cache.
+  void setMaxSize(int size);
+
+  // size the cache when a file system connects, the largest size wins.
+  void configure(int size);
+
+  bool isEnabled() const { return maxSize > 0; }
+
+  /*
+   * Check whether the range [start, end) of the replica has been verified.
+   */
+  bool isVerified(const ReadShortCircuitInfoKey& key,
+                  const VerifiedReplica& replica, int64_t start, int64_t end);
+
+  void addVerified(const ReadShortCircuitInfoKey& key,
+                   const VerifiedReplica& replica, int64_t start, int64_t end);
+
+  void invalidate(const ReadShortCircuitInfoKey& key);
+
+  void recordVerified(int64_t bytes, int64_t nanos);
+
+  void recordSkipped(int64_t bytes);
+
+  VerifiedChunkCacheStats getStats() const;
+
+  size_t size() { return entries.size(); }
+
+ private:
+  struct Entry {
+    explicit Entry(const VerifiedReplica& replica) : replica(replica) {}
+
+    mutex mut;
+    VerifiedReplica replica;
+    std::map<int64_t, int64_t> ranges;  // disjoint [start, end).
+  };
+
+ private:
+  atomic<int> maxSize;
+  atomic<int64_t> skippedBytes;
+  atomic<int64_t> verifiedBytes;
+  atomic<int64_t> verifyNanos;
+  mutex configureMut;
+  ShardedLruMap<ReadShortCircuitInfoKey, shared_ptr<Entry> > entries;
+};
+}
+}
+
+#endif /* _HDFS_LIBHDFS3_CLIENT_VERIFIEDCHUNKCACHE_H_ */
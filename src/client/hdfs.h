@@ -68,6 +68,9 @@ typedef struct HdfsFileSystemInternalWrapper * hdfsFS;
 struct HdfsFileInternalWrapper;
 typedef struct HdfsFileInternalWrapper * hdfsFile;
 
+struct HdfsDirectoryInternalWrapper;
+typedef struct HdfsDirectoryInternalWrapper * hdfsDir;
+
 struct hdfsBuilder;
 
 /**
@@ -410,6 +413,77 @@ int hdfsSync(hdfsFS fs, hdfsFile file);
  */
 int hdfsAvailable(hdfsFS fs, hdfsFile file);
 
+/**
+ * hdfsFileSetDropBehind - Ask the datanodes to drop the blocks
+ * read or written through this file from their page cache.
+ * Takes effect from the next block.
+ * @param fs The configured filesystem handle.
+ * @param file The file handle.
+ * @param dropBehind Non-zero to drop behind, zero to keep the blocks
+ * cached even if the datanodes drop behind by default.
+ * @return Returns 0 on success, -1 on error.
+ */
+int hdfsFileSetDropBehind(hdfsFS fs, hdfsFile file, int dropBehind);
+
+/**
+ * hdfsFileSetReadahead - Set how many bytes the datanodes read ahead
+ * for a file opened for read. Takes effect from the next block.
+ * @param fs The configured filesystem handle.
+ * @param file The file handle.
+ * @param readahead The readahead in bytes, negative to leave it to
+ * the datanodes.
+ * @return Returns 0 on success, -1 on error.
+ */
+int hdfsFileSetReadahead(hdfsFS fs, hdfsFile file, tOffset readahead);
+
+/**
+ * Statistics of a file opened for read.
+ */
+typedef struct {
+    int64_t bytesRead; /* bytes returned to the caller */
+    int64_t shortCircuitBytesRead; /* bytes read with short-circuit reads */
+    int64_t localBytesRead; /* bytes read over TCP from this host */
+    int64_t remoteBytesRead; /* bytes read over TCP from other hosts */
+    int64_t cacheBytesRead; /* bytes served from the block range cache */
+    int64_t blockReaderSetups; /* block readers set up */
+    int64_t peerCacheHits; /* block readers reusing a cached connection */
+    int64_t checksumTime; /* microseconds spent verifying checksums */
+    int64_t readRetries; /* failed setups and reads which were retried */
+    int64_t datanodeFailovers; /* times the file moved to another replica */
+} hdfsReadStatistics;
+
+/**
+ * hdfsFileGetReadStatistics - Get the statistics of a file opened for read.
+ * @param fs The configured filesystem handle.
+ * @param file The file handle.
+ * @param stats The statistics to fill.
+ * @return Returns 0 on success, -1 on error.
+ */
+int hdfsFileGetReadStatistics(hdfsFS fs, hdfsFile file,
+                              hdfsReadStatistics * stats);
+
+/**
+ * Statistics of a file opened for write.
+ */
+typedef struct {
+    int64_t bytesWritten; /* bytes appended to the file */
+    int64_t packetsSent; /* data packets sent, resent packets included */
+    int64_t acksReceived; /* data packets acknowledged */
+    int64_t totalAckLatency; /* sum of the microseconds from send to ack */
+    int64_t maxAckLatency; /* the longest microseconds from send to ack */
+    int64_t pipelineRecoveries; /* pipelines rebuilt after a failure */
+} hdfsWriteStatistics;
+
+/**
+ * hdfsFileGetWriteStatistics - Get the statistics of a file opened for write.
+ * @param fs The configured filesystem handle.
+ * @param file The file handle.
+ * @param stats The statistics to fill.
+ * @return Returns 0 on success, -1 on error.
+ */
+int hdfsFileGetWriteStatistics(hdfsFS fs, hdfsFile file,
+                               hdfsWriteStatistics * stats);
+
 /**
  * hdfsCopy - Copy file from one filesystem to another.
  * @param srcFS The handle to source filesystem.
@@ -533,6 +607,36 @@ hdfsFileInfo * hdfsGetPathInfo(hdfsFS fs, const char * path);
  */
 void hdfsFreeFileInfo(hdfsFileInfo * infos, int numEntries);
 
+/**
+ * hdfsOpenDirectory - Open a directory to stream its entries page by page.
+ * Unlike hdfsListDirectory, memory usage does not grow with the size of
+ * the directory, and the next page is fetched in background while the
+ * caller consumes the current one.
+ * hdfsCloseDirectory should be called to release the handle.
+ * @param fs The configured filesystem handle.
+ * @param path The path of the directory.
+ * @return Returns a directory handle; NULL on error.
+ */
+hdfsDir hdfsOpenDirectory(hdfsFS fs, const char * path);
+
+/**
+ * hdfsReadDirectory - Get the next entry of an opened directory.
+ * The returned hdfsFileInfo is owned by the directory handle and stays
+ * valid until the next call of hdfsReadDirectory or hdfsCloseDirectory.
+ * Do not call hdfsFreeFileInfo on it.
+ * @param dir The directory handle returned by hdfsOpenDirectory.
+ * @return Returns the next entry; NULL at the end of the directory with
+ * errno set to 0, or NULL on error.
+ */
+hdfsFileInfo * hdfsReadDirectory(hdfsDir dir);
+
+/**
+ * hdfsCloseDirectory - Close a directory handle.
+ * @param dir The directory handle returned by hdfsOpenDirectory.
+ * @return Returns 0 on success, -1 on error.
+ */
+int hdfsCloseDirectory(hdfsDir dir);
+
 /**
  * hdfsGetHosts - Get hostnames where a particular block (determined by
  * pos & blocksize) of a file is stored. The last element in the array
@@ -580,6 +684,149 @@ tOffset hdfsGetCapacity(hdfsFS fs);
  */
 tOffset hdfsGetUsed(hdfsFS fs);
 
+/**
+ * Statistics of the client side block range cache of a filesystem.
+ */
+typedef struct {
+    int64_t capacity; /* the byte budget, 0 if the cache is disabled */
+    int64_t cachedBytes; /* the bytes held by the cache */
+    int64_t hits; /* reads served from the cache */
+    int64_t misses; /* reads which fetched a range from a datanode */
+    int64_t hitBytes; /* bytes served from the cache */
+    int64_t missBytes; /* bytes fetched from datanodes into the cache */
+    int64_t evictedBytes; /* bytes evicted from the cache */
+} hdfsBlockCacheStats;
+
+/**
+ * hdfsGetBlockCacheStats - Get the statistics of the client side block
+ * range cache, enabled by "input.block-cache.size".
+ * @param fs The configured filesystem handle.
+ * @param stats The statistics to fill.
+ * @return Returns 0 on success, -1 on error.
+ */
+int hdfsGetBlockCacheStats(hdfsFS fs, hdfsBlockCacheStats * stats);
+
+/**
+ * The kinds of client metrics.
+ */
+enum hdfsMetricType {
+    HDFS_METRIC_COUNTER = 0,
+    HDFS_METRIC_GAUGE = 1,
+    HDFS_METRIC_HISTOGRAM = 2
+};
+
+/**
+ * A snapshot of one process wide client metric.
+ */
+typedef struct {
+    char * name; /* the metric name */
+    char * labelName; /* the label name, NULL if the metric has no label */
+    char * labelValue; /* the label value, NULL if the metric has no label */
+    int type; /* one of hdfsMetricType */
+    int64_t value; /* the value of a counter or gauge */
+    int64_t count; /* the values recorded by a histogram */
+    int64_t sum; /* the sum of the values recorded by a histogram */
+    int64_t max; /* the largest value recorded by a histogram */
+    int64_t p50; /* the estimated percentiles of a histogram */
+    int64_t p90;
+    int64_t p99;
+    int64_t p999;
+} hdfsMetric;
+
+/**
+ * hdfsGetMetrics - Take a snapshot of the process wide client metrics:
+ * RPC latency per method, block reader setup and packet ack latency,
+ * peer cache and file descriptor cache hits, checksum bytes verified and
+ * skipped by the verified chunk cache. Latencies are in microseconds.
+ * @param metrics Set to the metrics, free them with hdfsFreeMetrics.
+ * @param numMetrics Set to the number of metrics.
+ * @return Returns 0 on success, -1 on error.
+ */
+int hdfsGetMetrics(hdfsMetric ** metrics, int * numMetrics);
+
+/**
+ * hdfsFreeMetrics - Free the metrics returned by hdfsGetMetrics.
+ * @param metrics The metrics.
+ * @param numMetrics The number of metrics.
+ */
+void hdfsFreeMetrics(hdfsMetric * metrics, int numMetrics);
+
+/**
+ * The formats of hdfsDumpMetrics.
+ */
+enum hdfsMetricsFormat {
+    HDFS_METRICS_PROMETHEUS = 0,
+    HDFS_METRICS_JSON = 1
+};
+
+/**
+ * hdfsDumpMetrics - Format the process wide client metrics.
+ * @param format One of hdfsMetricsFormat. In the Prometheus text format
+ * histograms are exported as summaries.
+ * @return Returns the text, free it with hdfsFreeMetricsDump, NULL on error.
+ */
+char * hdfsDumpMetrics(int format);
+
+/**
+ * hdfsFreeMetricsDump - Free the text returned by hdfsDumpMetrics.
+ * @param dump The text.
+ */
+void hdfsFreeMetricsDump(char * dump);
+
+/**
+ * A sampled tracing span. Spans started by the same thread nest, a read
+ * traces down to the block reader and datanode packets, a write down to
+ * the pipeline and its acks.
+ */
+typedef struct {
+    uint64_t traceId; /* the span id of the root span */
+    uint64_t spanId;
+    uint64_t parentId; /* 0 for a root span */
+    const char * name;
+    const char * detail; /* empty if the span has no detail */
+    int64_t startMicros; /* on a monotonic clock */
+    int64_t durationMicros;
+    int64_t threadId;
+} hdfsTraceSpan;
+
+/**
+ * Called on the thread which ends a sampled span. The span is only valid
+ * during the call.
+ */
+typedef void (*hdfsTraceCallback)(const hdfsTraceSpan * span, void * context);
+
+/**
+ * hdfsSetTraceCallback - Send the sampled spans to a callback. The fraction
+ * of traces sampled is set by "dfs.client.trace.sample-rate" when a
+ * filesystem configured with it is connected, the last one wins. Replace
+ * the trace buffer if any.
+ * @param callback The callback, NULL to stop tracing.
+ * @param context Passed to the callback.
+ * @return Returns 0 on success, -1 on error.
+ */
+int hdfsSetTraceCallback(hdfsTraceCallback callback, void * context);
+
+/**
+ * hdfsEnableTraceBuffer - Keep the last sampled spans in a buffer, to be
+ * dumped by hdfsDumpTraceBuffer. Replace the trace callback if any.
+ * @param capacity The number of spans kept, 0 to stop tracing.
+ * @return Returns 0 on success, -1 on error.
+ */
+int hdfsEnableTraceBuffer(int capacity);
+
+/**
+ * hdfsDumpTraceBuffer - Format the buffered spans in the Chrome trace
+ * event format, which chrome://tracing and Perfetto load.
+ * @return Returns the text, free it with hdfsFreeTraceDump, NULL on error.
+ */
+char * hdfsDumpTraceBuffer(void);
+
+/**
+ * hdfsFreeTraceDump - Free the text returned by hdfsDumpTraceBuffer.
+ * @param dump The text.
+ */
+void hdfsFreeTraceDump(char * dump);
+
 /**
  * Change the user and/or group of a file or directory.
  *
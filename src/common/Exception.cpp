@@ -26,11 +26,19 @@
  * limitations under the License.
  */
 #include "Exception.h"
+#include "StackPrinter.h"
+#include "Thread.h"
 
 #include <sstream>
 
 namespace Hdfs {
 
+/*
+ * Guards the lazily built detail of exceptions, which may be shared
+ * between threads through an exception_ptr.
+ */
+static Internal::mutex DetailMutex;
+
 const char * HdfsIOException::ReflexName = "java.io.IOException";
 
 const char * AlreadyBeingCreatedException::ReflexName =
@@ -88,9 +96,25 @@ const char *RecoveryInProgressException::ReflexName =
 
 HdfsException::HdfsException(const std::string & arg, const char * file,
                              int line, const char * stack) :
-    std::runtime_error(arg) {
-    std::ostringstream ss;
-    ss << file << ": " << line << ": " << arg << std::endl << stack;
-    detail = ss.str();
+    std::runtime_error(arg), file(file), line(line), stack(stack) {
+}
+
+const char * HdfsException::msg() const {
+    Internal::lock_guard<Internal::mutex> lock(DetailMutex);
+
+    if (detail.empty()) {
+        std::ostringstream ss;
+        ss << file << ": " << line << ": " << what() << std::endl;
+
+        if (frames.empty()) {
+            ss << stack;
+        } else {
+            ss << Internal::SymbolizeStack(frames);
+        }
+
+        detail = ss.str();
+    }
+
+    return detail.c_str();
 }
 }
@@ -30,6 +30,7 @@
 
 #include <stdexcept>
 #include <string>
+#include <vector>
 
 namespace Hdfs {
 
@@ -41,12 +42,28 @@ public:
     ~HdfsException() throw () {
     }
 
-    virtual const char * msg() const {
-        return detail.c_str();
+    /**
+     * Get where the exception was thrown, its message and the stack.
+     * A stack attached by setStackFrames is symbolized on the first call.
+     */
+    virtual const char * msg() const;
+
+    /**
+     * Attach the raw return addresses of the stack which threw.
+     * @param frames The return addresses, innermost first.
+     */
+    void setStackFrames(const std::vector<void *> & frames) {
+        this->frames = frames;
     }
 
 protected:
-    std::string detail;
+    mutable std::string detail;
+
+private:
+    std::string file;
+    int line;
+    std::string stack;
+    std::vector<void *> frames;
 };
 
 class HdfsIOException: public HdfsException {
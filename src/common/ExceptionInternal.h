@@ -37,6 +37,7 @@
 #include <unistd.h>
 #include <string>
 #include <sstream>
+#include <vector>
 
 #include "Function.h"
 #include "StackPrinter.h"
@@ -152,6 +153,30 @@ using std::rethrow_if_nested;
 }  //  namespace Hdfs
 #endif  //  define nested exception
 
+namespace Hdfs {
+
+class HdfsEndOfStream;
+
+namespace Internal {
+
+/**
+ * Whether THROW captures the stack of an exception. The end of a stream
+ * is thrown on every read at EOF and caught right away, so it is thrown
+ * without a stack.
+ */
+template<typename THROWABLE>
+struct CaptureStackOnThrow {
+    static const bool value = true;
+};
+
+template<>
+struct CaptureStackOnThrow<HdfsEndOfStream> {
+    static const bool value = false;
+};
+
+}  //  namespace Internal
+}  //  namespace Hdfs
+
 #ifdef NEED_BOOST
 namespace Hdfs {
 namespace Internal {
@@ -178,14 +203,18 @@ void ThrowException(bool nested, const char * f, int l,
     vsnprintf(&buffer[offset], size + 1, fmt, ap);
     va_end(ap);
 
+    THROWABLE e(buffer.c_str(), SkipPathPrefix(f), l, "");
+
+    if (CaptureStackOnThrow<THROWABLE>::value) {
+        std::vector<void *> frames;
+        Hdfs::Internal::CaptureStack(1, STACK_DEPTH, frames);
+        e.setStackFrames(frames);
+    }
+
     if (!nested) {
-        boost::throw_exception(
-            THROWABLE(buffer.c_str(), SkipPathPrefix(f), l,
-                      Hdfs::Internal::PrintStack(1, STACK_DEPTH).c_str()));
+        boost::throw_exception(e);
     } else {
-        Hdfs::throw_with_nested(
-            THROWABLE(buffer.c_str(), SkipPathPrefix(f), l,
-                      Hdfs::Internal::PrintStack(1, STACK_DEPTH).c_str()));
+        Hdfs::throw_with_nested(e);
     }
 
     throw std::logic_error("should not reach here.");
@@ -221,13 +250,18 @@ void ThrowException(bool nested, const char * f, int l,
     vsnprintf(&buffer[offset], size + 1, fmt, ap);
     va_end(ap);
 
+    THROWABLE e(buffer.c_str(), SkipPathPrefix(f), l, "");
+
+    if (CaptureStackOnThrow<THROWABLE>::value) {
+        std::vector<void *> frames;
+        Hdfs::Internal::CaptureStack(1, STACK_DEPTH, frames);
+        e.setStackFrames(frames);
+    }
+
     if (!nested) {
-        throw THROWABLE(buffer.c_str(), SkipPathPrefix(f), l,
-                        Hdfs::Internal::PrintStack(1, STACK_DEPTH).c_str());
+        throw e;
     } else {
-        Hdfs::throw_with_nested(
-            THROWABLE(buffer.c_str(), SkipPathPrefix(f), l,
-                      Hdfs::Internal::PrintStack(1, STACK_DEPTH).c_str()));
+        Hdfs::throw_with_nested(e);
     }
 
     throw std::logic_error("should not reach here.");
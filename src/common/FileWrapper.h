@@ -28,9 +28,9 @@
 #ifndef _HDFS_LIBHDFS3_COMMON_FILEWRAPPER_H_
 #define _HDFS_LIBHDFS3_COMMON_FILEWRAPPER_H_
 
-#include <string>
 #include <cassert>
 #include <cstdio>
+#include <stdint.h>
 #include <string>
 #include <vector>
 
@@ -89,6 +89,51 @@ private:
     std::string path;
 };
 
+/*
+ * Read a file with pread, without stdio buffering.
+ *
+ * A sequential reader asks the kernel to read ahead a window of the file
+ * and optionally drops the pages it has read behind, so that large scans
+ * do not evict the page cache. With direct I/O the page cache is bypassed
+ * entirely and reads go through an aligned buffer.
+ */
+class PreadFileWrapper: public FileWrapper {
+public:
+    PreadFileWrapper(bool sequential, int64_t readahead, bool dropBehind,
+                     bool direct);
+    ~PreadFileWrapper();
+    bool open(int fd, bool delegate);
+    bool open(const std::string & path);
+    void close();
+    const char * read(std::vector<char> & buffer, int32_t size);
+    void copy(char * buffer, int32_t size);
+    void seek(int64_t offset);
+
+    bool isDirect() const {
+        return directFd >= 0;
+    }
+
+private:
+    void advise();
+    void openInternal();
+    void readDirect(char * buffer, int32_t size);
+
+private:
+    bool delegate;
+    bool direct;
+    bool dropBehind;
+    bool sequential;
+    char * alignedBuffer;
+    int directFd;
+    int fd;
+    int64_t dropped; //pages before it have been dropped.
+    int64_t offset;
+    int64_t readahead;
+    int64_t readaheadEnd; //pages before it have been requested.
+    size_t alignedBufferSize;
+    std::string path;
+};
+
 }
 }
 
@@ -30,20 +30,303 @@
 #include "Logger.h"
 
 #include <cassert>
+#include <cerrno>
 #include <cstdarg>
 #include <cstdio>
 #include <cstring>
 #include <sstream>
+#include <stdint.h>
+#include <string>
 #include <sys/time.h>
 #include <unistd.h>
 #include <vector>
 
+#include "Atomic.h"
 #include "DateTime.h"
+#include "Function.h"
 #include "Thread.h"
 
 namespace Hdfs {
 namespace Internal {
 
+/*
+ * Number of queued messages before the asynchronous writer starts
+ * dropping, must be a power of 2.
+ */
+static const size_t LogQueueSize = 8192;
+
+/*
+ * Flush the asynchronous writer's batch once it grows beyond this.
+ */
+static const size_t LogBatchSize = 64 * 1024;
+
+static void WriteFully(int fd, const char * buffer, size_t size) {
+    while (size > 0) {
+        ssize_t rc = write(fd, buffer, size);
+
+        if (rc < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            return;
+        }
+
+        buffer += rc;
+        size -= rc;
+    }
+}
+
+/*
+ * Bounded multi-producer single-consumer queue of formatted lines.
+ * Each slot carries a sequence number telling whether it is free for
+ * the producer at position pos (sequence == pos) or holds the message
+ * for the consumer at position pos (sequence == pos + 1).
+ */
+class LogQueue {
+public:
+    LogQueue() :
+        head(0), tail(0) {
+    }
+
+    void init(size_t capacity) {
+        assert((capacity & (capacity - 1)) == 0);
+
+        if (!slots.empty()) {
+            return;
+        }
+
+        std::vector<Slot> tmp(capacity);
+
+        for (size_t i = 0; i < capacity; ++i) {
+            tmp[i].sequence = i;
+        }
+
+        slots.swap(tmp);
+    }
+
+    bool push(std::string & line) {
+        size_t mask = slots.size() - 1;
+        size_t pos = tail;
+
+        for (;;) {
+            Slot & slot = slots[pos & mask];
+            size_t seq = slot.sequence;
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+
+            if (diff == 0) {
+                if (tail.compare_exchange_weak(pos, pos + 1)) {
+                    slot.line.swap(line);
+                    slot.sequence = pos + 1;
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = tail;
+            }
+        }
+    }
+
+    /*
+     * Only the drain thread (or whoever stopped it) may call pop() and empty().
+     */
+    bool pop(std::string & line) {
+        size_t mask = slots.size() - 1;
+        Slot & slot = slots[head & mask];
+
+        if (slot.sequence != head + 1) {
+            return false;
+        }
+
+        line.swap(slot.line);
+        slot.line.clear();
+        slot.sequence = head + mask + 1;
+        ++head;
+        return true;
+    }
+
+    bool empty() const {
+        return slots[head & (slots.size() - 1)].sequence != head + 1;
+    }
+
+private:
+    struct Slot {
+        Slot() :
+            sequence(0) {
+        }
+
+        Slot(const Slot & other) :
+            sequence(static_cast<size_t>(other.sequence)), line(other.line) {
+        }
+
+        atomic<size_t> sequence;
+        std::string line;
+    };
+
+    std::vector<Slot> slots;
+    size_t head;
+    atomic<size_t> tail;
+};
+
+/*
+ * Background writer used by Logger in asynchronous mode. Callers only
+ * take its mutex to wake the drain thread up when it has gone to sleep.
+ */
+class AsyncLogWriter {
+public:
+    AsyncLogWriter() :
+        running(false), sleeping(false), stopping(false), dropped(0) {
+    }
+
+    ~AsyncLogWriter() {
+        stop(-1);
+    }
+
+    bool isRunning() const {
+        return running;
+    }
+
+    unsigned long getDropped() const {
+        return dropped;
+    }
+
+    void start(const int * fd) {
+        lock_guard<mutex> lock(controlMutex);
+
+        if (running) {
+            return;
+        }
+
+        queue.init(LogQueueSize);
+        stopping = false;
+        output = fd;
+        CREATE_THREAD(worker, bind(&AsyncLogWriter::drain, this));
+        running = true;
+    }
+
+    void stop(int fd) {
+        lock_guard<mutex> lock(controlMutex);
+
+        if (!running) {
+            return;
+        }
+
+        running = false;
+        {
+            lock_guard<mutex> wakeLock(wakeMutex);
+            stopping = true;
+            wakeup.notify_one();
+        }
+        worker.join();
+
+        if (fd >= 0) {
+            /*
+             * pick up whatever was queued while the drain thread was exiting
+             */
+            std::string batch, line;
+
+            while (queue.pop(line)) {
+                batch += line;
+            }
+
+            WriteFully(fd, batch.data(), batch.size());
+        }
+    }
+
+    /*
+     * @return false if the writer is not running or its queue is full,
+     *         in the latter case the message is counted as dropped.
+     */
+    bool enqueue(std::string & line) {
+        if (!running) {
+            return false;
+        }
+
+        if (!queue.push(line)) {
+            ++dropped;
+            return true;
+        }
+
+        if (sleeping) {
+            lock_guard<mutex> lock(wakeMutex);
+            wakeup.notify_one();
+        }
+
+        return true;
+    }
+
+private:
+    void drain() {
+        std::string batch, line;
+        unsigned long reported = 0;
+
+        for (;;) {
+            while (queue.pop(line)) {
+                batch += line;
+
+                if (batch.size() >= LogBatchSize) {
+                    WriteFully(*output, batch.data(), batch.size());
+                    batch.clear();
+                }
+            }
+
+            unsigned long current = dropped;
+
+            if (current != reported) {
+                char buffer[128];
+                snprintf(buffer, sizeof(buffer),
+                         "%lu log messages dropped, asynchronous log queue is full\n",
+                         current - reported);
+                batch += buffer;
+                reported = current;
+            }
+
+            if (!batch.empty()) {
+                WriteFully(*output, batch.data(), batch.size());
+                batch.clear();
+            }
+
+            unique_lock<mutex> lock(wakeMutex);
+
+            if (stopping) {
+                return;
+            }
+
+            sleeping = true;
+
+            /*
+             * producers check sleeping after pushing, so either they see
+             * it set or we see their message here; the timeout is only a
+             * safety net.
+             */
+            if (queue.empty()) {
+                wakeup.wait_for(lock, milliseconds(100));
+            }
+
+            sleeping = false;
+        }
+    }
+
+private:
+    atomic<bool> running;
+    atomic<bool> sleeping;
+    bool stopping;
+    atomic<unsigned long> dropped;
+    const int * output;
+    LogQueue queue;
+    mutex controlMutex;
+    mutex wakeMutex;
+    condition_variable wakeup;
+    thread worker;
+};
+
+/*
+ * Defined before RootLogger so that it is still alive when RootLogger is
+ * destroyed and drains it.
+ */
+static AsyncLogWriter AsyncWriter;
+
 Logger RootLogger;
 
 static mutex LoggerMutex;
@@ -66,6 +349,9 @@ Logger::Logger() :
 }
 
 Logger::~Logger() {
+    if (this == &RootLogger) {
+        AsyncWriter.stop(fd);
+    }
 }
 
 void Logger::setOutputFd(int f) {
@@ -76,6 +362,29 @@ void Logger::setLogSeverity(LogSeverity l) {
     severity = l;
 }
 
+void Logger::setAsync(bool async) {
+    /*
+     * there is a single background writer and it serves RootLogger only
+     */
+    if (this != &RootLogger) {
+        return;
+    }
+
+    if (async) {
+        AsyncWriter.start(&fd);
+    } else {
+        AsyncWriter.stop(fd);
+    }
+}
+
+bool Logger::isAsync() const {
+    return this == &RootLogger && AsyncWriter.isRunning();
+}
+
+unsigned long Logger::getDroppedMessages() const {
+    return this == &RootLogger ? AsyncWriter.getDropped() : 0;
+}
+
 void Logger::printf(LogSeverity s, const char * fmt, ...) {
     va_list ap;
 
@@ -85,26 +394,49 @@ void Logger::printf(LogSeverity s, const char * fmt, ...) {
 
     try {
         call_once(Once, InitProcessId);
-        std::vector<char> buffer;
+        char stackBuffer[1024];
+        std::vector<char> heapBuffer;
+        char * buffer = stackBuffer;
         struct tm tm_time;
         struct timeval tval;
         memset(&tval, 0, sizeof(tval));
         gettimeofday(&tval, NULL);
         localtime_r(&tval.tv_sec, &tm_time);
-        //determine buffer size
-        va_start(ap, fmt);
-        int size = vsnprintf(&buffer[0], buffer.size(), fmt, ap);
-        va_end(ap);
-        //100 is enough for prefix
-        buffer.resize(size + 100);
-        size = snprintf(&buffer[0], buffer.size(), "%04d-%02d-%02d %02d:%02d:%02d.%06ld, %s, %s ", tm_time.tm_year + 1900,
-                        1 + tm_time.tm_mon, tm_time.tm_mday, tm_time.tm_hour,
-                        tm_time.tm_min, tm_time.tm_sec, static_cast<long>(tval.tv_usec), ProcessId, SeverityName[s]);
+        int prefix = snprintf(buffer, sizeof(stackBuffer), "%04d-%02d-%02d %02d:%02d:%02d.%06ld, %s, %s ", tm_time.tm_year + 1900,
+                              1 + tm_time.tm_mon, tm_time.tm_mday, tm_time.tm_hour,
+                              tm_time.tm_min, tm_time.tm_sec, static_cast<long>(tval.tv_usec), ProcessId, SeverityName[s]);
+        //the prefix always fits, leave room for the trailing newline
         va_start(ap, fmt);
-        size += vsnprintf(&buffer[size], buffer.size() - size, fmt, ap);
+        int size = vsnprintf(buffer + prefix, sizeof(stackBuffer) - prefix - 1, fmt, ap);
         va_end(ap);
+
+        if (size < 0) {
+            return;
+        }
+
+        if (static_cast<size_t>(prefix + size + 1) >= sizeof(stackBuffer)) {
+            //long message, format it again into a large enough buffer
+            heapBuffer.resize(prefix + size + 2);
+            memcpy(&heapBuffer[0], stackBuffer, prefix);
+            buffer = &heapBuffer[0];
+            va_start(ap, fmt);
+            vsnprintf(buffer + prefix, size + 1, fmt, ap);
+            va_end(ap);
+        }
+
+        size += prefix;
+        buffer[size++] = '\n';
+
+        if (AsyncWriter.isRunning() && this == &RootLogger) {
+            std::string line(buffer, size);
+
+            if (AsyncWriter.enqueue(line)) {
+                return;
+            }
+        }
+
         lock_guard<mutex> lock(LoggerMutex);
-        dprintf(fd, "%s\n", &buffer[0]);
+        WriteFully(fd, buffer, size);
         return;
     } catch (const std::exception & e) {
         dprintf(fd, "%s:%d %s %s", __FILE__, __LINE__,
@@ -115,4 +447,3 @@ void Logger::printf(LogSeverity s, const char * fmt, ...) {
 
 }
 }
-
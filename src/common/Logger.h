@@ -51,6 +51,31 @@ public:
 
     void setLogSeverity(LogSeverity l);
 
+    /**
+     * Check whether a message of the given severity would be written.
+     * LOG() calls it before evaluating its arguments.
+     */
+    bool isEnabled(LogSeverity s) const {
+        return s <= severity && fd >= 0;
+    }
+
+    /**
+     * Hand formatted messages to a background thread instead of
+     * writing them on the calling thread. Messages are dropped and
+     * counted when the queue is full.
+     * @param async true to enable the background writer, false to
+     *        drain it and go back to synchronous writes.
+     */
+    void setAsync(bool async);
+
+    bool isAsync() const;
+
+    /**
+     * @return the number of messages dropped because the asynchronous
+     *         queue was full.
+     */
+    unsigned long getDroppedMessages() const;
+
     void printf(LogSeverity s, const char * fmt, ...) __attribute__((format(printf, 3, 4)));
 
 private:
@@ -64,6 +89,10 @@ extern Logger RootLogger;
 }
 
 #define LOG(s, fmt, ...) \
-    Hdfs::Internal::RootLogger.printf(s, fmt, ##__VA_ARGS__)
+    do { \
+        if (Hdfs::Internal::RootLogger.isEnabled(s)) { \
+            Hdfs::Internal::RootLogger.printf(s, fmt, ##__VA_ARGS__); \
+        } \
+    } while (0)
 
 #endif /* _HDFS_LIBHDFS3_COMMON_LOGGER_H_ */
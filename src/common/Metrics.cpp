@@ -0,0 +1,409 @@
+/********************************************************************
+ * Copyright (c) 2013 - 2014, Pivotal Inc.
+ * All rights reserved.
+ *
+ * Author: Zhanwei Wang
+ ********************************************************************/
+/********************************************************************
+ * 2014 -
+ * open source under Apache License Version 2.0
+ ********************************************************************/
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "Metrics.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <inttypes.h>
+
+namespace Hdfs {
+namespace Internal {
+
+const size_t MetricsRegistry::TableSize;
+once_flag MetricsRegistry::once;
+shared_ptr<MetricsRegistry> MetricsRegistry::registry;
+
+Histogram::Histogram() :
+    count(0), sum(0), max(0) {
+    for (int i = 0; i < NumBuckets; ++i) {
+        buckets[i] = 0;
+    }
+}
+
+int Histogram::BucketIndex(int64_t value) {
+    if (value < SubBuckets) {
+        return value < 0 ? 0 : static_cast<int>(value);
+    }
+
+    int exponent = 63 - __builtin_clzll(static_cast<unsigned long long>(value));
+
+    if (exponent > MaxExponent) {
+        return NumBuckets - 1;
+    }
+
+    return (exponent - SubBucketBits + 1) * SubBuckets
+           + static_cast<int>((value >> (exponent - SubBucketBits)) & (SubBuckets - 1));
+}
+
+int64_t Histogram::BucketUpperBound(int index) {
+    if (index < SubBuckets) {
+        return index;
+    }
+
+    int exponent = index / SubBuckets + SubBucketBits - 1;
+    int64_t width = static_cast<int64_t>(1) << (exponent - SubBucketBits);
+    return (SubBuckets + index % SubBuckets) * width + width - 1;
+}
+
+void Histogram::record(int64_t value) {
+    value = value < 0 ? 0 : value;
+    ++buckets[BucketIndex(value)];
+    ++count;
+    sum += value;
+    int64_t current = max;
+
+    while (value > current && !max.compare_exchange_weak(current, value)) {
+    }
+}
+
+void Histogram::getBuckets(std::vector<int64_t> & result) const {
+    result.resize(NumBuckets);
+
+    for (int i = 0; i < NumBuckets; ++i) {
+        result[i] = buckets[i];
+    }
+}
+
+int64_t Histogram::Percentile(const std::vector<int64_t> & buckets, double q) {
+    int64_t total = 0;
+
+    for (size_t i = 0; i < buckets.size(); ++i) {
+        total += buckets[i];
+    }
+
+    if (total == 0) {
+        return 0;
+    }
+
+    int64_t rank = static_cast<int64_t>(q * total + 0.5);
+    rank = rank < 1 ? 1 : rank;
+    int64_t seen = 0;
+
+    for (size_t i = 0; i < buckets.size(); ++i) {
+        seen += buckets[i];
+
+        if (seen >= rank) {
+            return BucketUpperBound(i);
+        }
+    }
+
+    return BucketUpperBound(buckets.size() - 1);
+}
+
+/*
+ * FNV-1a, hashing the C strings avoids building a std::string per lookup.
+ */
+static uint64_t HashMetric(int type, const char * name, const char * labelValue) {
+    uint64_t h = 14695981039346656037ULL ^ type;
+
+    for (const char * p = name; *p; ++p) {
+        h = (h ^ static_cast<unsigned char>(*p)) * 1099511628211ULL;
+    }
+
+    h = (h ^ 0xff) * 1099511628211ULL;
+
+    for (const char * p = labelValue; p && *p; ++p) {
+        h = (h ^ static_cast<unsigned char>(*p)) * 1099511628211ULL;
+    }
+
+    return h;
+}
+
+MetricsRegistry & MetricsRegistry::GetMetricsRegistry() {
+    call_once(once, &MetricsRegistry::CreateSingleton);
+    assert(registry);
+    return *registry;
+}
+
+void MetricsRegistry::CreateSingleton() {
+    registry = shared_ptr<MetricsRegistry>(new MetricsRegistry());
+}
+
+MetricsRegistry::MetricsRegistry() {
+    for (size_t i = 0; i < TableSize; ++i) {
+        table[i] = NULL;
+    }
+
+    overflow[METRIC_HISTOGRAM].histogram = shared_ptr<Histogram>(new Histogram);
+}
+
+MetricsRegistry::~MetricsRegistry() {
+    for (size_t i = 0; i < TableSize; ++i) {
+        delete table[i].load();
+    }
+}
+
+MetricsRegistry::Entry * MetricsRegistry::find(MetricType type, const char * name,
+        const char * help, const char * labelName, const char * labelValue) {
+    assert(name != NULL);
+    labelName = labelName ? labelName : "";
+    labelValue = labelValue ? labelValue : "";
+    size_t start = HashMetric(type, name, labelValue) % TableSize;
+    bool locked = false;
+    unique_lock<mutex> lock(mut, defer_lock_t());
+
+    /*
+     * Entries are only ever added, so a miss seen without the lock is
+     * confirmed by probing again with it.
+     */
+    for (;;) {
+        for (size_t i = 0; i < TableSize; ++i) {
+            atomic<Entry *> & slot = table[(start + i) % TableSize];
+            Entry * e = slot;
+
+            if (e == NULL) {
+                if (!locked) {
+                    break;
+                }
+
+                e = new Entry;
+                e->type = type;
+                e->name = name;
+                e->help = help ? help : "";
+                e->labelName = labelName;
+                e->labelValue = labelValue;
+
+                if (type == METRIC_HISTOGRAM) {
+                    e->histogram = shared_ptr<Histogram>(new Histogram);
+                }
+
+                slot = e;
+                return e;
+            }
+
+            if (e->type == type && e->name == name && e->labelValue == labelValue) {
+                return e;
+            }
+        }
+
+        if (locked) {
+            return &overflow[type];
+        }
+
+        lock.lock();
+        locked = true;
+    }
+}
+
+Counter & MetricsRegistry::counter(const char * name, const char * help,
+                                   const char * labelName, const char * labelValue) {
+    return find(METRIC_COUNTER, name, help, labelName, labelValue)->counter;
+}
+
+Gauge & MetricsRegistry::gauge(const char * name, const char * help,
+                               const char * labelName, const char * labelValue) {
+    return find(METRIC_GAUGE, name, help, labelName, labelValue)->gauge;
+}
+
+Histogram & MetricsRegistry::histogram(const char * name, const char * help,
+                                       const char * labelName, const char * labelValue) {
+    return *find(METRIC_HISTOGRAM, name, help, labelName, labelValue)->histogram;
+}
+
+static bool CompareSnapshot(const MetricSnapshot & a, const MetricSnapshot & b) {
+    if (a.name != b.name) {
+        return a.name < b.name;
+    }
+
+    return a.labelValue < b.labelValue;
+}
+
+std::vector<MetricSnapshot> MetricsRegistry::snapshot() const {
+    std::vector<MetricSnapshot> result;
+    std::vector<int64_t> buckets;
+
+    for (size_t i = 0; i < TableSize; ++i) {
+        const Entry * e = table[i];
+
+        if (e == NULL) {
+            continue;
+        }
+
+        MetricSnapshot s;
+        s.type = e->type;
+        s.name = e->name;
+        s.help = e->help;
+        s.labelName = e->labelName;
+        s.labelValue = e->labelValue;
+
+        switch (e->type) {
+        case METRIC_COUNTER:
+            s.value = e->counter.get();
+            break;
+
+        case METRIC_GAUGE:
+            s.value = e->gauge.get();
+            break;
+
+        case METRIC_HISTOGRAM:
+            /*
+             * The buckets, count and sum are read one after another while
+             * other threads record, so they may disagree by a few values.
+             */
+            e->histogram->getBuckets(buckets);
+            s.count = e->histogram->getCount();
+            s.sum = e->histogram->getSum();
+            s.max = e->histogram->getMax();
+            s.p50 = std::min(s.max, Histogram::Percentile(buckets, 0.5));
+            s.p90 = std::min(s.max, Histogram::Percentile(buckets, 0.9));
+            s.p99 = std::min(s.max, Histogram::Percentile(buckets, 0.99));
+            s.p999 = std::min(s.max, Histogram::Percentile(buckets, 0.999));
+            break;
+        }
+
+        result.push_back(s);
+    }
+
+    std::sort(result.begin(), result.end(), CompareSnapshot);
+    return result;
+}
+
+/*
+ * Escape a string for a Prometheus label value or a JSON string, both
+ * use backslash escapes.
+ */
+static std::string Escape(const std::string & str) {
+    std::string result;
+    result.reserve(str.size());
+
+    for (size_t i = 0; i < str.size(); ++i) {
+        unsigned char c = str[i];
+
+        if (c == '"' || c == '\\') {
+            result += '\\';
+            result += c;
+        } else if (c == '\n') {
+            result += "\\n";
+        } else if (c < 0x20) {
+            char buffer[8];
+            snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+            result += buffer;
+        } else {
+            result += c;
+        }
+    }
+
+    return result;
+}
+
+static void AppendSample(std::string & out, const MetricSnapshot & s,
+                         const char * suffix, const char * quantile,
+                         int64_t value) {
+    char buffer[32];
+    out += s.name;
+    out += suffix;
+
+    if (!s.labelName.empty() || quantile) {
+        out += "{";
+
+        if (!s.labelName.empty()) {
+            out += s.labelName + "=\"" + Escape(s.labelValue) + "\"";
+        }
+
+        if (quantile) {
+            out += s.labelName.empty() ? "" : ",";
+            out += "quantile=\"";
+            out += quantile;
+            out += "\"";
+        }
+
+        out += "}";
+    }
+
+    snprintf(buffer, sizeof(buffer), " %" PRId64 "\n", value);
+    out += buffer;
+}
+
+std::string MetricsRegistry::toPrometheus() const {
+    static const char * TypeName[] = { "counter", "gauge", "summary" };
+    std::vector<MetricSnapshot> metrics = snapshot();
+    std::string out;
+
+    for (size_t i = 0; i < metrics.size(); ++i) {
+        const MetricSnapshot & s = metrics[i];
+
+        if (i == 0 || metrics[i - 1].name != s.name) {
+            if (!s.help.empty()) {
+                out += "# HELP " + s.name + " " + s.help + "\n";
+            }
+
+            out += "# TYPE " + s.name + " " + TypeName[s.type] + "\n";
+        }
+
+        if (s.type != METRIC_HISTOGRAM) {
+            AppendSample(out, s, "", NULL, s.value);
+            continue;
+        }
+
+        AppendSample(out, s, "", "0.5", s.p50);
+        AppendSample(out, s, "", "0.9", s.p90);
+        AppendSample(out, s, "", "0.99", s.p99);
+        AppendSample(out, s, "", "0.999", s.p999);
+        AppendSample(out, s, "_sum", NULL, s.sum);
+        AppendSample(out, s, "_count", NULL, s.count);
+    }
+
+    return out;
+}
+
+std::string MetricsRegistry::toJson() const {
+    static const char * TypeName[] = { "counter", "gauge", "histogram" };
+    std::vector<MetricSnapshot> metrics = snapshot();
+    std::string out = "{\"metrics\":[";
+    char buffer[256];
+
+    for (size_t i = 0; i < metrics.size(); ++i) {
+        const MetricSnapshot & s = metrics[i];
+        out += i == 0 ? "{" : ",{";
+        out += "\"name\":\"" + Escape(s.name) + "\",\"type\":\"" + TypeName[s.type] + "\"";
+
+        if (!s.labelName.empty()) {
+            out += ",\"labels\":{\"" + Escape(s.labelName) + "\":\"" + Escape(s.labelValue) + "\"}";
+        }
+
+        if (s.type != METRIC_HISTOGRAM) {
+            snprintf(buffer, sizeof(buffer), ",\"value\":%" PRId64 "}", s.value);
+        } else {
+            snprintf(buffer, sizeof(buffer),
+                     ",\"count\":%" PRId64 ",\"sum\":%" PRId64 ",\"max\":%" PRId64
+                     ",\"p50\":%" PRId64 ",\"p90\":%" PRId64 ",\"p99\":%" PRId64
+                     ",\"p999\":%" PRId64 "}", s.count, s.sum, s.max, s.p50, s.p90,
+                     s.p99, s.p999);
+        }
+
+        out += buffer;
+    }
+
+    out += "]}";
+    return out;
+}
+
+}
+}
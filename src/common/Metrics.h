@@ -0,0 +1,267 @@
+/********************************************************************
+ * Copyright (c) 2013 - 2014, Pivotal Inc.
+ * All rights reserved.
+ *
+ * Author: Zhanwei Wang
+ ********************************************************************/
+/********************************************************************
+ * 2014 -
+ * open source under Apache License Version 2.0
+ ********************************************************************/
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef _HDFS_LIBHDFS3_COMMON_METRICS_H_
+#define _HDFS_LIBHDFS3_COMMON_METRICS_H_
+
+#include "Atomic.h"
+#include "Memory.h"
+#include "Thread.h"
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace Hdfs {
+namespace Internal {
+
+enum MetricType {
+    METRIC_COUNTER = 0, METRIC_GAUGE = 1, METRIC_HISTOGRAM = 2
+};
+
+/**
+ * A monotonically increasing value.
+ */
+class Counter {
+public:
+    Counter() :
+        value(0) {
+    }
+
+    void add(int64_t n = 1) {
+        value += n;
+    }
+
+    int64_t get() const {
+        return value;
+    }
+
+private:
+    atomic<int64_t> value;
+};
+
+/**
+ * A value which goes up and down.
+ */
+class Gauge {
+public:
+    Gauge() :
+        value(0) {
+    }
+
+    void set(int64_t v) {
+        value = v;
+    }
+
+    void add(int64_t n) {
+        value += n;
+    }
+
+    int64_t get() const {
+        return value;
+    }
+
+private:
+    atomic<int64_t> value;
+};
+
+/**
+ * Increase a gauge for the lifetime of the object.
+ */
+class ScopedGaugeIncrement {
+public:
+    explicit ScopedGaugeIncrement(Gauge & gauge) :
+        gauge(gauge) {
+        gauge.add(1);
+    }
+
+    ~ScopedGaugeIncrement() {
+        gauge.add(-1);
+    }
+
+private:
+    Gauge & gauge;
+};
+
+/**
+ * A log-linear histogram of non negative values, usually microseconds.
+ * Every power of two is split into 8 buckets, so a value is known to
+ * within 12.5%. Recording is a few atomic additions.
+ */
+class Histogram {
+public:
+    static const int SubBucketBits = 3;
+    static const int SubBuckets = 1 << SubBucketBits;
+    static const int MaxExponent = 40;
+    static const int NumBuckets = (MaxExponent - SubBucketBits + 2) * SubBuckets;
+
+    Histogram();
+
+    void record(int64_t value);
+
+    int64_t getCount() const {
+        return count;
+    }
+
+    int64_t getSum() const {
+        return sum;
+    }
+
+    int64_t getMax() const {
+        return max;
+    }
+
+    /**
+     * Estimate a percentile from a snapshot of the bucket counts.
+     * @param buckets the bucket counts, see getBuckets.
+     * @param q the quantile between 0 and 1.
+     * @return the upper bound of the bucket holding the quantile.
+     */
+    static int64_t Percentile(const std::vector<int64_t> & buckets, double q);
+
+    void getBuckets(std::vector<int64_t> & buckets) const;
+
+    static int BucketIndex(int64_t value);
+
+    static int64_t BucketUpperBound(int index);
+
+private:
+    atomic<int64_t> count;
+    atomic<int64_t> sum;
+    atomic<int64_t> max;
+    atomic<int64_t> buckets[NumBuckets];
+};
+
+/**
+ * A copy of one metric taken by MetricsRegistry::snapshot.
+ */
+struct MetricSnapshot {
+    MetricSnapshot() :
+        type(METRIC_COUNTER), value(0), count(0), sum(0), max(0), p50(0),
+        p90(0), p99(0), p999(0) {
+    }
+
+    MetricType type;
+    std::string name;
+    std::string help;
+    std::string labelName; //empty if the metric has no label.
+    std::string labelValue;
+    int64_t value; //counters and gauges.
+    int64_t count; //the rest are for histograms.
+    int64_t sum;
+    int64_t max;
+    int64_t p50;
+    int64_t p90;
+    int64_t p99;
+    int64_t p999;
+};
+
+/**
+ * A process wide registry of counters, gauges and histograms.
+ *
+ * A metric is identified by its name and an optional label, such as the
+ * RPC method. The first lookup of a metric registers it under a mutex,
+ * later lookups only read an open addressing table, so neither lookup nor
+ * recording allocates or locks once the metric exists. Metrics are never
+ * removed. Call sites with a fixed name keep the reference in a function
+ * local static.
+ */
+class MetricsRegistry {
+public:
+    MetricsRegistry();
+
+    ~MetricsRegistry();
+
+    /**
+     * @return the registry shared by the process.
+     */
+    static MetricsRegistry & GetMetricsRegistry();
+
+    /**
+     * Find or register a metric.
+     * @param name the metric name.
+     * @param help a description of the metric, used when it is registered.
+     * @param labelName the label name, NULL if the metric has no label.
+     * @param labelValue the label value.
+     * @return the metric.
+     */
+    Counter & counter(const char * name, const char * help,
+                      const char * labelName = NULL, const char * labelValue = NULL);
+
+    Gauge & gauge(const char * name, const char * help,
+                  const char * labelName = NULL, const char * labelValue = NULL);
+
+    Histogram & histogram(const char * name, const char * help,
+                          const char * labelName = NULL, const char * labelValue = NULL);
+
+    /**
+     * Copy all metrics, sorted by name and label.
+     */
+    std::vector<MetricSnapshot> snapshot() const;
+
+    /**
+     * Format all metrics in the Prometheus text format. Histograms are
+     * exported as summaries with their 0.5, 0.9, 0.99 and 0.999 quantiles.
+     */
+    std::string toPrometheus() const;
+
+    /**
+     * Format all metrics as a JSON object.
+     */
+    std::string toJson() const;
+
+private:
+    struct Entry {
+        MetricType type;
+        std::string name;
+        std::string help;
+        std::string labelName;
+        std::string labelValue;
+        Counter counter;
+        Gauge gauge;
+        shared_ptr<Histogram> histogram;
+    };
+
+    Entry * find(MetricType type, const char * name, const char * help,
+                 const char * labelName, const char * labelValue);
+    static void CreateSingleton();
+
+private:
+    static const size_t TableSize = 1024;
+
+    atomic<Entry *> table[TableSize];
+    Entry overflow[3]; //returned once the table is full.
+    mutex mut;
+
+    static once_flag once;
+    static shared_ptr<MetricsRegistry> registry;
+};
+
+}
+}
+
+#endif /* _HDFS_LIBHDFS3_COMMON_METRICS_H_ */
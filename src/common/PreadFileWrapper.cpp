@@ -0,0 +1,250 @@
+/********************************************************************
+ * Copyright (c) 2013 - 2014, Pivotal Inc.
+ * All rights reserved.
+ *
+ * Author: Zhanwei Wang
+ ********************************************************************/
+/********************************************************************
+ * 2014 -
+ * open source under Apache License Version 2.0
+ ********************************************************************/
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <string>
+
+#include "Atomic.h"
+#include "Exception.h"
+#include "ExceptionInternal.h"
+#include "FileWrapper.h"
+#include "Logger.h"
+
+#define DIRECT_IO_ALIGNMENT 4096
+
+namespace Hdfs {
+namespace Internal {
+
+PreadFileWrapper::PreadFileWrapper(bool sequential, int64_t readahead,
+                                   bool dropBehind, bool direct) :
+    delegate(true), direct(direct), dropBehind(dropBehind),
+    sequential(sequential), alignedBuffer(NULL), directFd(-1), fd(-1),
+    dropped(0), offset(0), readahead(sequential ? readahead : 0),
+    readaheadEnd(0), alignedBufferSize(0) {
+}
+
+PreadFileWrapper::~PreadFileWrapper() {
+    close();
+    free(alignedBuffer);
+}
+
+bool PreadFileWrapper::open(int fd, bool delegate) {
+    char buffer[64];
+    snprintf(buffer, sizeof(buffer), "FileDescriptor %d", fd);
+    this->fd = fd;
+    this->delegate = delegate;
+    path = buffer;
+    openInternal();
+    return true;
+}
+
+bool PreadFileWrapper::open(const std::string & path) {
+    fd = ::open(path.c_str(), O_RDONLY);
+
+    if (fd < 0) {
+        return false;
+    }
+
+    this->path = path;
+    delegate = true;
+    openInternal();
+    return true;
+}
+
+void PreadFileWrapper::openInternal() {
+    offset = dropped = readaheadEnd = 0;
+    posix_fadvise(fd, 0, 0,
+                  sequential ? POSIX_FADV_SEQUENTIAL : POSIX_FADV_RANDOM);
+
+    if (direct) {
+        /*
+         * Open a new file description, O_DIRECT set on the given
+         * descriptor would also change the descriptors it was dup'ed from.
+         */
+        char buffer[64];
+        snprintf(buffer, sizeof(buffer), "/proc/self/fd/%d", fd);
+        directFd = ::open(buffer, O_RDONLY | O_DIRECT);
+
+        /*
+         * Descriptors passed by the datanode usually cannot be reopened,
+         * warn once so a disabled direct read does not go unnoticed.
+         */
+        if (directFd < 0) {
+            static atomic<bool> warned(false);
+            LogSeverity severity = warned.exchange(true) ? DEBUG1 : WARNING;
+            LOG(severity,
+                "PreadFileWrapper cannot open file \"%s\" with O_DIRECT, "
+                "fall back to buffered read: %s", path.c_str(),
+                GetSystemErrorInfo(errno));
+        }
+    }
+}
+
+void PreadFileWrapper::close() {
+    if (directFd >= 0) {
+        ::close(directFd);
+        directFd = -1;
+    }
+
+    if (fd >= 0 && delegate) {
+        ::close(fd);
+    }
+
+    fd = -1;
+    delegate = true;
+    path.clear();
+}
+
+const char * PreadFileWrapper::read(std::vector<char> & buffer, int32_t size) {
+    buffer.resize(size);
+    copy(&buffer[0], size);
+    return &buffer[0];
+}
+
+void PreadFileWrapper::copy(char * buffer, int32_t size) {
+    assert(fd >= 0);
+
+    if (directFd >= 0) {
+        readDirect(buffer, size);
+        offset += size;
+        return;
+    }
+
+    int32_t todo = size;
+    ssize_t done;
+
+    while (todo > 0) {
+        done = pread(fd, buffer + (size - todo), todo, offset);
+
+        if (done < 0) {
+            if (EINTR == errno) {
+                continue;
+            }
+
+            THROW(HdfsIOException, "Cannot read file \"%s\", %s.", path.c_str(),
+                  GetSystemErrorInfo(errno));
+        } else if (0 == done) {
+            THROW(HdfsIOException, "Cannot read file \"%s\", End of file.",
+                  path.c_str());
+        }
+
+        todo -= done;
+        offset += done;
+    }
+
+    advise();
+}
+
+void PreadFileWrapper::readDirect(char * buffer, int32_t size) {
+    int64_t start = offset / DIRECT_IO_ALIGNMENT * DIRECT_IO_ALIGNMENT;
+    int64_t end = (offset + size + DIRECT_IO_ALIGNMENT - 1)
+                  / DIRECT_IO_ALIGNMENT * DIRECT_IO_ALIGNMENT;
+    size_t length = static_cast<size_t>(end - start);
+
+    if (alignedBufferSize < length) {
+        free(alignedBuffer);
+        alignedBuffer = NULL;
+        alignedBufferSize = 0;
+
+        if (posix_memalign(reinterpret_cast<void **>(&alignedBuffer),
+                           DIRECT_IO_ALIGNMENT, length)) {
+            alignedBuffer = NULL;
+            THROW(HdfsIOException, "Cannot allocate %zu bytes aligned buffer to read file \"%s\".",
+                  length, path.c_str());
+        }
+
+        alignedBufferSize = length;
+    }
+
+    size_t needed = static_cast<size_t>(offset + size - start);
+    size_t done = 0, from;
+    ssize_t rc;
+
+    while (done < needed) {
+        /*
+         * O_DIRECT requires an aligned offset, continue a short read from
+         * the start of the page it ended in.
+         */
+        from = done / DIRECT_IO_ALIGNMENT * DIRECT_IO_ALIGNMENT;
+        rc = pread(directFd, alignedBuffer + from, length - from, start + from);
+
+        if (rc < 0) {
+            if (EINTR == errno) {
+                continue;
+            }
+
+            THROW(HdfsIOException, "Cannot read file \"%s\", %s.", path.c_str(),
+                  GetSystemErrorInfo(errno));
+        } else if (from + rc <= done) {
+            THROW(HdfsIOException, "Cannot read file \"%s\", End of file.",
+                  path.c_str());
+        }
+
+        done = from + rc;
+    }
+
+    memcpy(buffer, alignedBuffer + (offset - start), size);
+}
+
+void PreadFileWrapper::advise() {
+    if (readahead > 0 && offset + readahead / 2 >= readaheadEnd) {
+        int64_t start = offset > readaheadEnd ? offset : readaheadEnd;
+        posix_fadvise(fd, start, offset + readahead - start,
+                      POSIX_FADV_WILLNEED);
+        readaheadEnd = offset + readahead;
+    }
+
+    /*
+     * Drop pages in batches, every call drops at least a readahead window
+     * or 1MB.
+     */
+    int64_t batch = readahead > 1024 * 1024 ? readahead : 1024 * 1024;
+
+    if (dropBehind && offset - dropped >= batch) {
+        posix_fadvise(fd, dropped, offset - dropped, POSIX_FADV_DONTNEED);
+        dropped = offset;
+    }
+}
+
+void PreadFileWrapper::seek(int64_t offset) {
+    assert(offset >= 0);
+    this->offset = offset;
+    dropped = offset;
+
+    if (offset > readaheadEnd || offset + readahead < readaheadEnd) {
+        readaheadEnd = offset;
+    }
+}
+
+}
+}
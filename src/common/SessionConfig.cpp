@@ -48,6 +48,17 @@ static void CheckRangeGE(const char * key, T const & value, T const & target) {
     }
 }
 
+template<typename T>
+static void CheckRange(const char * key, T const & value, T const & min, T const & max) {
+    if (!(value >= min && value <= max)) {
+        std::stringstream ss;
+        ss.imbue(std::locale::classic());
+        ss << "Invalid configure item: \"" << key << "\", value: " << value
+           << ", expected value should be between " << min << " and " << max;
+        THROW(HdfsConfigInvalid, "%s", ss.str().c_str());
+    }
+}
+
 template<typename T>
 static void CheckMultipleOf(const char * key, const T & value, int unit) {
     if (value <= 0 || value % unit != 0) {
@@ -55,6 +66,33 @@ static void CheckMultipleOf(const char * key, const T & value, int unit) {
     }
 }
 
+/*
+ * @return -1 if the key is not set, otherwise 1 for true and 0 for false.
+ */
+static int32_t GetOptionalBool(const Config & conf, const char * key) {
+    if (NULL == conf.getString(key, NULL)) {
+        return -1;
+    }
+
+    return conf.getBool(key) ? 1 : 0;
+}
+
+static void CheckConnectionPolicy(const char * key, const std::string & value) {
+    if (value != "round-robin" && value != "least-outstanding") {
+        THROW(HdfsConfigInvalid, "Invalid configure item: \"%s\", value: %s, "
+              "expected value should be \"round-robin\" or \"least-outstanding\"",
+              key, value.c_str());
+    }
+}
+
+static void CheckLocalReadEngine(const char * key, const std::string & value) {
+    if (value != "auto" && value != "stdio" && value != "mmap" && value != "pread") {
+        THROW(HdfsConfigInvalid, "Invalid configure item: \"%s\", value: %s, "
+              "expected value should be \"auto\", \"stdio\", \"mmap\" or \"pread\"",
+              key, value.c_str());
+    }
+}
+
 SessionConfig::SessionConfig(const Config & conf) {
     ConfigDefault<bool> boolValues [] = {
         {
@@ -69,6 +107,20 @@ SessionConfig::SessionConfig(const Config & conf) {
             &useMappedFile, "input.localread.mappedfile", false
         }, {
             &legacyLocalBlockReader, "dfs.client.use.legacy.blockreader.local", false
+        }, {
+            &shortCircuitShm, "dfs.client.read.shortcircuit.shm.enabled", true
+        }, {
+            &localReadDropBehind, "input.localread.drop-behind", false
+        }, {
+            &localReadDirect, "input.localread.direct", false
+        }, {
+            &datanodeHealth, "dfs.client.datanode.health.enabled", true
+        }, {
+            &logAsync, "dfs.client.log.async", false
+        }, {
+            &prefetchListing, "dfs.client.listing.prefetch", false
+        }, {
+            &parallelProbe, "dfs.client.failover.parallel-probe", false
         }
     };
     ConfigDefault<int32_t> i32Values[] = {
@@ -126,17 +178,56 @@ SessionConfig::SessionConfig(const Config & conf) {
             &heartBeatInterval, "output.heeartbeat.interval", 10 * 1000
         }, {
             &rpcMaxHARetry, "dfs.client.failover.max.attempts", 15, bind(CheckRangeGE<int32_t>, _1, _2, 0)
+        }, {
+            &observerRetryInterval, "dfs.client.failover.observer.retry.interval", 10 * 1000, bind(CheckRangeGE<int32_t>, _1, _2, 0)
+        }, {
+            &probeTimeout, "dfs.client.failover.probe.timeout", 2 * 1000, bind(CheckRangeGE<int32_t>, _1, _2, 1)
         }, {
             &maxFileDescriptorCacheSize, "dfs.client.read.shortcircuit.streams.cache.size", 256, bind(CheckRangeGE<int32_t>, _1, _2, 0)
+        }, {
+            &shortCircuitShmRetryInterval, "dfs.client.read.shortcircuit.shm.retry.interval", 600 * 1000, bind(CheckRangeGE<int32_t>, _1, _2, 0)
         }, {
             &socketCacheExpiry, "dfs.client.socketcache.expiryMsec", 3000, bind(CheckRangeGE<int32_t>, _1, _2, 0)
         }, {
             &socketCacheCapacity, "dfs.client.socketcache.capacity", 16, bind(CheckRangeGE<int32_t>, _1, _2, 0)
+        }, {
+            &rpcConnectionsPerServer, "rpc.client.connections.per.server", 1, bind(CheckRangeGE<int32_t>, _1, _2, 1)
+        }, {
+            &localReadReadahead, "input.localread.readahead", 4 * 1024 * 1024, bind(CheckRangeGE<int32_t>, _1, _2, 0)
+        }, {
+            &verifiedChunkCacheSize, "input.localread.verified-cache.size", 0, bind(CheckRangeGE<int32_t>, _1, _2, 0)
+        }, {
+            &blockCacheRangeSize, "input.block-cache.range-size", 64 * 1024, bind(CheckMultipleOf<int32_t>, _1, _2, 512)
+        }, {
+            &replicaLocalWeight, "input.replica.weight.local", 8, bind(CheckRangeGE<int32_t>, _1, _2, 0)
+        }, {
+            &replicaCachedWeight, "input.replica.weight.cached", 4, bind(CheckRangeGE<int32_t>, _1, _2, 0)
+        }, {
+            &replicaFastStorageWeight, "input.replica.weight.fast-storage", 2, bind(CheckRangeGE<int32_t>, _1, _2, 0)
+        }, {
+            &replicaSameRackWeight, "input.replica.weight.same-rack", 1, bind(CheckRangeGE<int32_t>, _1, _2, 0)
+        }, {
+            &datanodeSuppressMin, "dfs.client.datanode.health.suppress.min", 5 * 1000, bind(CheckRangeGE<int32_t>, _1, _2, 0)
+        }, {
+            &datanodeSuppressMax, "dfs.client.datanode.health.suppress.max", 300 * 1000, bind(CheckRangeGE<int32_t>, _1, _2, 0)
+        }, {
+            &datanodeFailureHalfLife, "dfs.client.datanode.health.failure.half-life", 60 * 1000, bind(CheckRangeGE<int32_t>, _1, _2, 1)
+        }, {
+            &datanodeProbeInterval, "dfs.client.datanode.health.probe.interval", 10 * 1000, bind(CheckRangeGE<int32_t>, _1, _2, 0)
         }
     };
     ConfigDefault<int64_t> i64Values [] = {
         {
             &defaultBlockSize, "dfs.default.blocksize", 64 * 1024 * 1024, bind(CheckMultipleOf<int64_t>, _1, _2, 512)
+        }, {
+            &cacheReadahead, "dfs.client.cache.readahead", -1, bind(CheckRangeGE<int64_t>, _1, _2, -1)
+        }, {
+            &blockCacheSize, "input.block-cache.size", 0, bind(CheckRangeGE<int64_t>, _1, _2, 0)
+        }
+    };
+    ConfigDefault<double> doubleValues [] = {
+        {
+            &traceSampleRate, "dfs.client.trace.sample-rate", 0, bind(CheckRange<double>, _1, _2, 0, 1)
         }
     };
     ConfigDefault<std::string> strValues [] = {
@@ -144,7 +235,9 @@ SessionConfig::SessionConfig(const Config & conf) {
         {&rpcAuthMethod, "hadoop.security.authentication", "simple" },
         {&kerberosCachePath, "hadoop.security.kerberos.ticket.cache.path", "" },
         {&logSeverity, "dfs.client.log.severity", "INFO" },
-        {&domainSocketPath, "dfs.domain.socket.path", ""}
+        {&domainSocketPath, "dfs.domain.socket.path", ""},
+        {&rpcConnectionPolicy, "rpc.client.connection.policy", "round-robin", CheckConnectionPolicy },
+        {&localReadEngine, "input.localread.engine", "auto", CheckLocalReadEngine }
     };
 
     for (size_t i = 0; i < ARRAYSIZE(boolValues); ++i) {
@@ -174,6 +267,15 @@ SessionConfig::SessionConfig(const Config & conf) {
         }
     }
 
+    for (size_t i = 0; i < ARRAYSIZE(doubleValues); ++i) {
+        *doubleValues[i].variable = conf.getDouble(doubleValues[i].key,
+                                                   doubleValues[i].value);
+
+        if (doubleValues[i].check) {
+            doubleValues[i].check(doubleValues[i].key, *doubleValues[i].variable);
+        }
+    }
+
     for (size_t i = 0; i < ARRAYSIZE(strValues); ++i) {
         *strValues[i].variable = conf.getString(strValues[i].key,
                                                 strValues[i].value);
@@ -182,6 +284,12 @@ SessionConfig::SessionConfig(const Config & conf) {
             strValues[i].check(strValues[i].key, *strValues[i].variable);
         }
     }
+
+    /*
+     * the datanodes decide unless the client asks either way.
+     */
+    cacheDropBehindReads = GetOptionalBool(conf, "dfs.client.cache.drop.behind.reads");
+    cacheDropBehindWrites = GetOptionalBool(conf, "dfs.client.cache.drop.behind.writes");
 }
 
 }
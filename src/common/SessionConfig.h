@@ -61,6 +61,10 @@ public:
         return rpcConnectTimeout;
     }
 
+    void setRpcConnectTimeout(int32_t rpcConnectTimeout) {
+        this->rpcConnectTimeout = rpcConnectTimeout;
+    }
+
     int32_t getRpcMaxIdleTime() const {
         return rpcMaxIdleTime;
     }
@@ -81,14 +85,38 @@ public:
         return rpcReadTimeout;
     }
 
+    void setRpcReadTimeout(int32_t rpcReadTimeout) {
+        this->rpcReadTimeout = rpcReadTimeout;
+    }
+
     bool isRpcTcpNoDelay() const {
         return rpcTcpNoDelay;
     }
 
+    int32_t getRpcConnectionsPerServer() const {
+        return rpcConnectionsPerServer;
+    }
+
+    void setRpcConnectionsPerServer(int32_t rpcConnectionsPerServer) {
+        this->rpcConnectionsPerServer = rpcConnectionsPerServer;
+    }
+
+    const std::string & getRpcConnectionPolicy() const {
+        return rpcConnectionPolicy;
+    }
+
+    void setRpcConnectionPolicy(const std::string & rpcConnectionPolicy) {
+        this->rpcConnectionPolicy = rpcConnectionPolicy;
+    }
+
     int32_t getRpcWriteTimeout() const {
         return rpcWriteTimeout;
     }
 
+    void setRpcWriteTimeout(int32_t rpcWriteTimeout) {
+        this->rpcWriteTimeout = rpcWriteTimeout;
+    }
+
     /*
      * FileSystem configure
      */
@@ -104,6 +132,14 @@ public:
         return defaultBlockSize;
     }
 
+    bool doesPrefetchListing() const {
+        return prefetchListing;
+    }
+
+    void setPrefetchListing(bool prefetchListing) {
+        this->prefetchListing = prefetchListing;
+    }
+
     /*
      * InputStream configure
      */
@@ -111,6 +147,10 @@ public:
         return localReadBufferSize;
     }
 
+    void setLocalReadBufferSize(int32_t localReadBufferSize) {
+        this->localReadBufferSize = localReadBufferSize;
+    }
+
     int32_t getInputReadTimeout() const {
         return inputReadTimeout;
     }
@@ -204,6 +244,30 @@ public:
         this->kerberosCachePath = kerberosCachePath;
     }
 
+    int32_t getObserverRetryInterval() const {
+        return observerRetryInterval;
+    }
+
+    void setObserverRetryInterval(int32_t observerRetryInterval) {
+        this->observerRetryInterval = observerRetryInterval;
+    }
+
+    bool doesParallelProbe() const {
+        return parallelProbe;
+    }
+
+    void setParallelProbe(bool parallelProbe) {
+        this->parallelProbe = parallelProbe;
+    }
+
+    int32_t getProbeTimeout() const {
+        return probeTimeout;
+    }
+
+    void setProbeTimeout(int32_t probeTimeout) {
+        this->probeTimeout = probeTimeout;
+    }
+
     int32_t getRpcSocketLingerTimeout() const {
         return rpcSocketLingerTimeout;
     }
@@ -227,6 +291,22 @@ public:
         this->logSeverity = logSeverityLevel;
     }
 
+    bool isLogAsync() const {
+        return logAsync;
+    }
+
+    void setLogAsync(bool logAsync) {
+        this->logAsync = logAsync;
+    }
+
+    double getTraceSampleRate() const {
+        return traceSampleRate;
+    }
+
+    void setTraceSampleRate(double traceSampleRate) {
+        this->traceSampleRate = traceSampleRate;
+    }
+
     int32_t getPacketPoolSize() const {
         return packetPoolSize;
     }
@@ -275,6 +355,172 @@ public:
         this->useMappedFile = useMappedFile;
     }
 
+    const std::string & getLocalReadEngine() const {
+        return localReadEngine;
+    }
+
+    void setLocalReadEngine(const std::string & localReadEngine) {
+        this->localReadEngine = localReadEngine;
+    }
+
+    int32_t getLocalReadReadahead() const {
+        return localReadReadahead;
+    }
+
+    void setLocalReadReadahead(int32_t localReadReadahead) {
+        this->localReadReadahead = localReadReadahead;
+    }
+
+    bool isLocalReadDropBehind() const {
+        return localReadDropBehind;
+    }
+
+    void setLocalReadDropBehind(bool localReadDropBehind) {
+        this->localReadDropBehind = localReadDropBehind;
+    }
+
+    bool isLocalReadDirect() const {
+        return localReadDirect;
+    }
+
+    void setLocalReadDirect(bool localReadDirect) {
+        this->localReadDirect = localReadDirect;
+    }
+
+    int64_t getBlockCacheSize() const {
+        return blockCacheSize;
+    }
+
+    void setBlockCacheSize(int64_t blockCacheSize) {
+        this->blockCacheSize = blockCacheSize;
+    }
+
+    int32_t getBlockCacheRangeSize() const {
+        return blockCacheRangeSize;
+    }
+
+    void setBlockCacheRangeSize(int32_t blockCacheRangeSize) {
+        this->blockCacheRangeSize = blockCacheRangeSize;
+    }
+
+    int32_t getReplicaLocalWeight() const {
+        return replicaLocalWeight;
+    }
+
+    void setReplicaLocalWeight(int32_t replicaLocalWeight) {
+        this->replicaLocalWeight = replicaLocalWeight;
+    }
+
+    int32_t getReplicaCachedWeight() const {
+        return replicaCachedWeight;
+    }
+
+    void setReplicaCachedWeight(int32_t replicaCachedWeight) {
+        this->replicaCachedWeight = replicaCachedWeight;
+    }
+
+    int32_t getReplicaFastStorageWeight() const {
+        return replicaFastStorageWeight;
+    }
+
+    void setReplicaFastStorageWeight(int32_t replicaFastStorageWeight) {
+        this->replicaFastStorageWeight = replicaFastStorageWeight;
+    }
+
+    int32_t getReplicaSameRackWeight() const {
+        return replicaSameRackWeight;
+    }
+
+    void setReplicaSameRackWeight(int32_t replicaSameRackWeight) {
+        this->replicaSameRackWeight = replicaSameRackWeight;
+    }
+
+    bool isDatanodeHealthEnabled() const {
+        return datanodeHealth;
+    }
+
+    void setDatanodeHealthEnabled(bool datanodeHealth) {
+        this->datanodeHealth = datanodeHealth;
+    }
+
+    int32_t getDatanodeSuppressMin() const {
+        return datanodeSuppressMin;
+    }
+
+    void setDatanodeSuppressMin(int32_t datanodeSuppressMin) {
+        this->datanodeSuppressMin = datanodeSuppressMin;
+    }
+
+    int32_t getDatanodeSuppressMax() const {
+        return datanodeSuppressMax;
+    }
+
+    void setDatanodeSuppressMax(int32_t datanodeSuppressMax) {
+        this->datanodeSuppressMax = datanodeSuppressMax;
+    }
+
+    int32_t getDatanodeFailureHalfLife() const {
+        return datanodeFailureHalfLife;
+    }
+
+    void setDatanodeFailureHalfLife(int32_t datanodeFailureHalfLife) {
+        this->datanodeFailureHalfLife = datanodeFailureHalfLife;
+    }
+
+    int32_t getDatanodeProbeInterval() const {
+        return datanodeProbeInterval;
+    }
+
+    void setDatanodeProbeInterval(int32_t datanodeProbeInterval) {
+        this->datanodeProbeInterval = datanodeProbeInterval;
+    }
+
+    bool isCacheDropBehindReads() const {
+        return cacheDropBehindReads > 0;
+    }
+
+    /**
+     * @return 1 to drop behind, 0 not to, -1 to leave it to the datanodes.
+     */
+    int32_t getCacheDropBehindReads() const {
+        return cacheDropBehindReads;
+    }
+
+    void setCacheDropBehindReads(bool cacheDropBehindReads) {
+        this->cacheDropBehindReads = cacheDropBehindReads ? 1 : 0;
+    }
+
+    int64_t getCacheReadahead() const {
+        return cacheReadahead;
+    }
+
+    void setCacheReadahead(int64_t cacheReadahead) {
+        this->cacheReadahead = cacheReadahead;
+    }
+
+    bool isCacheDropBehindWrites() const {
+        return cacheDropBehindWrites > 0;
+    }
+
+    /**
+     * @return 1 to drop behind, 0 not to, -1 to leave it to the datanodes.
+     */
+    int32_t getCacheDropBehindWrites() const {
+        return cacheDropBehindWrites;
+    }
+
+    void setCacheDropBehindWrites(bool cacheDropBehindWrites) {
+        this->cacheDropBehindWrites = cacheDropBehindWrites ? 1 : 0;
+    }
+
+    int32_t getVerifiedChunkCacheSize() const {
+        return verifiedChunkCacheSize;
+    }
+
+    void setVerifiedChunkCacheSize(int32_t verifiedChunkCacheSize) {
+        this->verifiedChunkCacheSize = verifiedChunkCacheSize;
+    }
+
     bool isLegacyLocalBlockReader() const {
         return legacyLocalBlockReader;
     }
@@ -283,6 +529,22 @@ public:
         this->legacyLocalBlockReader = legacyLocalBlockReader;
     }
 
+    bool isShortCircuitShmEnabled() const {
+        return shortCircuitShm;
+    }
+
+    void setShortCircuitShmEnabled(bool shortCircuitShm) {
+        this->shortCircuitShm = shortCircuitShm;
+    }
+
+    int32_t getShortCircuitShmRetryInterval() const {
+        return shortCircuitShmRetryInterval;
+    }
+
+    void setShortCircuitShmRetryInterval(int32_t shortCircuitShmRetryInterval) {
+        this->shortCircuitShmRetryInterval = shortCircuitShmRetryInterval;
+    }
+
     const std::string& getDomainSocketPath() const {
         return domainSocketPath;
     }
@@ -318,10 +580,14 @@ public:
     int32_t rpcWriteTimeout;
     int32_t rpcMaxRetryOnConnect;
     int32_t rpcMaxHARetry;
+    int32_t observerRetryInterval;
+    int32_t probeTimeout;
     int32_t rpcSocketLingerTimeout;
     int32_t rpcTimeout;
+    int32_t rpcConnectionsPerServer;
     bool rpcTcpNoDelay;
     std::string rpcAuthMethod;
+    std::string rpcConnectionPolicy;
 
     /*
      * FileSystem configure
@@ -329,6 +595,15 @@ public:
     std::string defaultUri;
     std::string kerberosCachePath;
     std::string logSeverity;
+    bool logAsync;
+    double traceSampleRate;
+    bool prefetchListing;
+    bool parallelProbe;
+    bool datanodeHealth;
+    int32_t datanodeFailureHalfLife;
+    int32_t datanodeProbeInterval;
+    int32_t datanodeSuppressMax;
+    int32_t datanodeSuppressMin;
     int32_t defaultReplica;
     int64_t defaultBlockSize;
 
@@ -339,23 +614,39 @@ public:
     bool readFromLocal;
     bool notRetryAnotherNode;
     bool legacyLocalBlockReader;
+    bool shortCircuitShm;
+    bool localReadDirect;
+    bool localReadDropBehind;
+    int32_t blockCacheRangeSize;
+    int32_t cacheDropBehindReads;
     int32_t inputConnTimeout;
     int32_t inputReadTimeout;
     int32_t inputWriteTimeout;
     int32_t localReadBufferSize;
+    int32_t localReadReadahead;
     int32_t maxFileDescriptorCacheSize;
     int32_t maxGetBlockInfoRetry;
     int32_t maxLocalBlockInfoCacheSize;
     int32_t maxReadBlockRetry;
+    int32_t shortCircuitShmRetryInterval;
     int32_t prefetchSize;
+    int32_t replicaCachedWeight;
+    int32_t replicaFastStorageWeight;
+    int32_t replicaLocalWeight;
+    int32_t replicaSameRackWeight;
     int32_t socketCacheCapacity;
     int32_t socketCacheExpiry;
+    int32_t verifiedChunkCacheSize;
+    int64_t blockCacheSize;
+    int64_t cacheReadahead;
     std::string domainSocketPath;
+    std::string localReadEngine;
 
     /*
      * OutputStream configure
      */
     bool addDatanode;
+    int32_t cacheDropBehindWrites;
     int32_t chunkSize;
     int32_t packetSize;
     int32_t blockWriteRetry; //retry on block not replicated yet.
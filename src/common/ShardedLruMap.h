@@ -0,0 +1,289 @@
+/********************************************************************
+ * Copyright (c) 2013 - 2014, Pivotal Inc.
+ * All rights reserved.
+ *
+ * Author: Zhanwei Wang
+ ********************************************************************/
+/********************************************************************
+ * 2014 -
+ * open source under Apache License Version 2.0
+ ********************************************************************/
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef _HDFS_LIBHDFS3_COMMON_SHARDEDLRUMAP_H_
+#define _HDFS_LIBHDFS3_COMMON_SHARDEDLRUMAP_H_
+
+#include "Atomic.h"
+#include "Memory.h"
+#include "Thread.h"
+#include "Unordered.h"
+
+#include <cassert>
+#include <vector>
+
+#define SHARDED_LRU_MAP_DEFAULT_SHARDS 16
+
+namespace Hdfs {
+namespace Internal {
+
+/**
+ * A concurrent cache with the same interface as LruMap.
+ *
+ * Keys are spread over shards, each with its own lock. Each shard
+ * approximates LRU with the CLOCK algorithm: a lookup only sets a
+ * referenced bit instead of reordering a list, and entries live in a
+ * fixed ring of slots, so no list node is allocated per insert.
+ *
+ * The capacity is split evenly between shards, each shard keeps at least
+ * one entry unless the capacity is 0, so a capacity smaller than the number
+ * of shards may be exceeded by up to one entry per shard.
+ *
+ * An entry taken by findAndErase and inserted again, as a file descriptor
+ * returned after a read, keeps its referenced bit.
+ */
+template <typename K, typename V>
+class ShardedLruMap {
+public:
+    typedef K KeyType;
+    typedef V ValueType;
+
+public:
+    ShardedLruMap() : count(0), maxSize(0) {
+        init(1000, SHARDED_LRU_MAP_DEFAULT_SHARDS);
+    }
+
+    ShardedLruMap(size_t size, size_t numShards = SHARDED_LRU_MAP_DEFAULT_SHARDS) :
+        count(0), maxSize(0) {
+        init(size, numShards);
+    }
+
+    /*
+     * Only a changed size locks the shards, so it is cheap to call with
+     * the configured size on every miss.
+     */
+    void setMaxSize(size_t s) {
+        if (maxSize == s) {
+            return;
+        }
+
+        lock_guard<mutex> resizing(resizeMut);
+        maxSize = s;
+
+        for (size_t i = 0; i < shards.size(); ++i) {
+            lock_guard<mutex> lock(shards[i]->mut);
+            setCapacity(*shards[i], getShardCapacity(s, i));
+        }
+    }
+
+    void insert(const KeyType& key, const ValueType& value) {
+        Shard& shard = getShard(key);
+        lock_guard<mutex> lock(shard.mut);
+
+        if (shard.ring.empty()) {
+            return;
+        }
+
+        typename MapType::iterator it = shard.map.find(key);
+
+        if (it != shard.map.end()) {
+            it->second.value = value;
+            it->second.referenced = true;
+            return;
+        }
+
+        if (shard.freeSlots.empty()) {
+            evictOne(shard);
+        }
+
+        size_t slot = shard.freeSlots.back();
+        shard.freeSlots.pop_back();
+        it = shard.map.insert(std::make_pair(key, Entry(value, slot))).first;
+        it->second.referenced = shard.taken.erase(key) > 0;
+        shard.ring[slot] = &*it;
+        ++count;
+    }
+
+    void erase(const KeyType& key) {
+        Shard& shard = getShard(key);
+        lock_guard<mutex> lock(shard.mut);
+        typename MapType::iterator it = shard.map.find(key);
+
+        if (it != shard.map.end()) {
+            eraseInternal(shard, it);
+        }
+    }
+
+    bool find(const KeyType& key, ValueType* value) {
+        return findAndEraseInternal(key, value, false);
+    }
+
+    bool findAndErase(const KeyType& key, ValueType* value) {
+        return findAndEraseInternal(key, value, true);
+    }
+
+    size_t size() {
+        return count;
+    }
+
+private:
+    struct Entry {
+        Entry(const ValueType& value, size_t slot) :
+            value(value), slot(slot), referenced(false) {
+        }
+
+        ValueType value;
+        size_t slot;
+        bool referenced;
+    };
+
+    typedef unordered_map<K, Entry> MapType;
+
+    struct Shard {
+        Shard() : hand(0) {
+        }
+
+        mutex mut;
+        MapType map;
+        unordered_set<K> taken; //keys removed by findAndErase.
+        size_t hand;
+        std::vector<size_t> freeSlots;
+        std::vector<typename MapType::value_type*> ring;
+    };
+
+private:
+    void init(size_t size, size_t numShards) {
+        numShards = numShards > 0 ? numShards : 1;
+        maxSize = size + 1;
+
+        for (size_t i = 0; i < numShards; ++i) {
+            shards.push_back(shared_ptr<Shard>(new Shard));
+        }
+
+        setMaxSize(size);
+    }
+
+    size_t getShardCapacity(size_t size, size_t index) const {
+        if (size == 0) {
+            return 0;
+        }
+
+        size_t capacity = size / shards.size() + (index < size % shards.size() ? 1 : 0);
+        return capacity > 0 ? capacity : 1;
+    }
+
+    Shard& getShard(const KeyType& key) {
+        size_t h = hasher(key);
+        h ^= h >> 17;
+        return *shards[h % shards.size()];
+    }
+
+    bool findAndEraseInternal(const KeyType& key, ValueType* value,
+                              bool erase) {
+        Shard& shard = getShard(key);
+        lock_guard<mutex> lock(shard.mut);
+        typename MapType::iterator it = shard.map.find(key);
+
+        if (it == shard.map.end()) {
+            return false;
+        }
+
+        *value = it->second.value;
+
+        if (erase) {
+            /*
+             * Forget the taken keys never inserted again.
+             */
+            if (shard.taken.size() >= shard.ring.size()) {
+                shard.taken.clear();
+            }
+
+            shard.taken.insert(key);
+            eraseInternal(shard, it);
+        } else {
+            it->second.referenced = true;
+        }
+
+        return true;
+    }
+
+    void eraseInternal(Shard& shard, typename MapType::iterator it) {
+        shard.ring[it->second.slot] = NULL;
+        shard.freeSlots.push_back(it->second.slot);
+        shard.map.erase(it);
+        --count;
+    }
+
+    /*
+     * Advance the clock hand to the first entry not referenced since the
+     * hand last passed it, clearing the referenced bits on the way.
+     */
+    void evictOne(Shard& shard) {
+        assert(!shard.map.empty());
+
+        while (true) {
+            typename MapType::value_type* entry = shard.ring[shard.hand];
+            shard.hand = (shard.hand + 1) % shard.ring.size();
+
+            if (entry == NULL) {
+                continue;
+            }
+
+            if (entry->second.referenced) {
+                entry->second.referenced = false;
+            } else {
+                eraseInternal(shard, shard.map.find(entry->first));
+                return;
+            }
+        }
+    }
+
+    void setCapacity(Shard& shard, size_t capacity) {
+        if (capacity == shard.ring.size()) {
+            return;
+        }
+
+        while (shard.map.size() > capacity) {
+            evictOne(shard);
+        }
+
+        size_t slot = 0;
+        shard.ring.assign(capacity, NULL);
+        shard.freeSlots.clear();
+        shard.hand = 0;
+
+        for (typename MapType::iterator it = shard.map.begin();
+                it != shard.map.end(); ++it, ++slot) {
+            it->second.slot = slot;
+            shard.ring[slot] = &*it;
+        }
+
+        for (size_t i = capacity; i > slot; --i) {
+            shard.freeSlots.push_back(i - 1);
+        }
+    }
+
+private:
+    atomic<size_t> count;
+    atomic<size_t> maxSize;
+    mutex resizeMut;
+    typename MapType::hasher hasher;
+    std::vector<shared_ptr<Shard> > shards;
+};
+}
+}
+#endif /* _HDFS_LIBHDFS3_COMMON_SHARDEDLRUMAP_H_ */
@@ -664,10 +664,13 @@ static const std::string SymbolizeAndDemangle(void * pc) {
 
 #endif
 
-const std::string PrintStack(int skip, int maxDepth) {
-    std::ostringstream ss;
-    std::vector<void *> stack;
+void ATTRIBUTE_NOINLINE CaptureStack(int skip, int maxDepth,
+                                    std::vector<void *> & stack) {
     GetStack(skip + 1, maxDepth, stack);
+}
+
+const std::string SymbolizeStack(const std::vector<void *> & stack) {
+    std::ostringstream ss;
 
     for (size_t i = 0; i < stack.size(); ++i) {
         ss << SymbolizeAndDemangle(stack[i]) << std::endl;
@@ -676,6 +679,12 @@ const std::string PrintStack(int skip, int maxDepth) {
     return ss.str();
 }
 
+const std::string PrintStack(int skip, int maxDepth) {
+    std::vector<void *> stack;
+    GetStack(skip + 1, maxDepth, stack);
+    return SymbolizeStack(stack);
+}
+
 }
 }
 
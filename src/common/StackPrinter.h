@@ -31,6 +31,7 @@
 #include "platform.h"
 
 #include <string>
+#include <vector>
 
 #ifndef DEFAULT_STACK_PREFIX
 #define DEFAULT_STACK_PREFIX "\t@\t"
@@ -39,6 +40,20 @@
 namespace Hdfs {
 namespace Internal {
 
+/**
+ * Capture the return addresses of the current stack without
+ * symbolizing them, cheap enough to be done on every throw.
+ * @param skip The number of innermost frames to skip, besides this one.
+ * @param maxDepth The maximum number of frames to capture.
+ * @param stack Set to the return addresses, innermost first.
+ */
+extern void CaptureStack(int skip, int maxDepth, std::vector<void *> & stack);
+
+/**
+ * Symbolize a stack captured by CaptureStack, one frame per line.
+ */
+extern const std::string SymbolizeStack(const std::vector<void *> & stack);
+
 extern const std::string PrintStack(int skip, int maxDepth);
 
 }
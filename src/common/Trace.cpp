@@ -0,0 +1,244 @@
+/********************************************************************
+ * Copyright (c) 2013 - 2014, Pivotal Inc.
+ * All rights reserved.
+ *
+ * Author: Zhanwei Wang
+ ********************************************************************/
+/********************************************************************
+ * 2014 -
+ * open source under Apache License Version 2.0
+ ********************************************************************/
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "platform.h"
+
+#include "DateTime.h"
+#include "Trace.h"
+
+#include <cassert>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <inttypes.h>
+#include <unistd.h>
+
+namespace Hdfs {
+namespace Internal {
+
+atomic<bool> Tracer::Enabled(false);
+
+static mutex TracerMutex;
+static shared_ptr<TraceSink> Sink;
+static double SampleRate = 0;
+
+static atomic<uint64_t> SampleThreshold(0); //SampleRate scaled to 2^53.
+static atomic<uint64_t> NextSpanId(1);
+static atomic<int64_t> NextThreadId(1);
+
+static THREAD_LOCAL TraceSpan * CurrentSpan = NULL;
+static THREAD_LOCAL int64_t ThreadId = 0;
+static THREAD_LOCAL uint64_t RandomState = 0;
+
+static int64_t NowMicros() {
+    return duration_cast<microseconds>(
+               steady_clock::now().time_since_epoch()).count();
+}
+
+/*
+ * A xorshift generator per thread, good enough to pick the sampled traces
+ * without any lock. Return 53 random bits.
+ */
+static uint64_t NextRandom() {
+    if (RandomState == 0) {
+        RandomState = static_cast<uint64_t>(NowMicros()) * 2654435761ULL
+                      + static_cast<uint64_t>(ThreadId) + 1;
+    }
+
+    RandomState ^= RandomState << 13;
+    RandomState ^= RandomState >> 7;
+    RandomState ^= RandomState << 17;
+    return RandomState >> 11;
+}
+
+void Tracer::SetSink(shared_ptr<TraceSink> sink) {
+    lock_guard<mutex> lock(TracerMutex);
+    Sink = sink;
+    Update();
+}
+
+shared_ptr<TraceSink> Tracer::GetSink() {
+    lock_guard<mutex> lock(TracerMutex);
+    return Sink;
+}
+
+void Tracer::SetSampleRate(double rate) {
+    lock_guard<mutex> lock(TracerMutex);
+    SampleRate = rate < 0 ? 0 : (rate > 1 ? 1 : rate);
+    SampleThreshold = static_cast<uint64_t>(SampleRate * 9007199254740992.0);
+    Update();
+}
+
+double Tracer::GetSampleRate() {
+    lock_guard<mutex> lock(TracerMutex);
+    return SampleRate;
+}
+
+/*
+ * Must hold TracerMutex.
+ */
+void Tracer::Update() {
+    Enabled = Sink && SampleRate > 0;
+}
+
+void TraceSpan::begin(const char * name) {
+    parent = CurrentSpan;
+
+    if (parent) {
+        if (parent->state != Sampled) {
+            state = Suppressed;
+            CurrentSpan = this;
+            return;
+        }
+    } else if (NextRandom() >= SampleThreshold) {
+        state = Suppressed;
+        CurrentSpan = this;
+        return;
+    }
+
+    if (ThreadId == 0) {
+        ThreadId = NextThreadId++;
+    }
+
+    state = Sampled;
+    record.spanId = NextSpanId++;
+    record.parentId = parent ? parent->record.spanId : 0;
+    record.traceId = parent ? parent->record.traceId : record.spanId;
+    record.name = name;
+    record.detail[0] = 0;
+    record.threadId = ThreadId;
+    record.duration = 0;
+    record.start = NowMicros();
+    CurrentSpan = this;
+}
+
+void TraceSpan::end() {
+    assert(CurrentSpan == this);
+    CurrentSpan = parent;
+
+    if (state != Sampled) {
+        return;
+    }
+
+    record.duration = NowMicros() - record.start;
+    shared_ptr<TraceSink> sink = Tracer::GetSink();
+
+    if (sink) {
+        sink->record(record);
+    }
+}
+
+void TraceSpan::setDetail(const char * fmt, ...) {
+    if (state != Sampled) {
+        return;
+    }
+
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(record.detail, sizeof(record.detail), fmt, ap);
+    va_end(ap);
+}
+
+TraceRingBuffer::TraceRingBuffer(size_t capacity) :
+    next(0), size(0), records(capacity > 0 ? capacity : 1) {
+}
+
+void TraceRingBuffer::record(const TraceRecord & span) {
+    lock_guard<mutex> lock(mut);
+    records[next] = span;
+    next = (next + 1) % records.size();
+    size = size < records.size() ? size + 1 : size;
+}
+
+std::vector<TraceRecord> TraceRingBuffer::getRecords() const {
+    lock_guard<mutex> lock(mut);
+    std::vector<TraceRecord> result;
+    result.reserve(size);
+    size_t first = (next + records.size() - size) % records.size();
+
+    for (size_t i = 0; i < size; ++i) {
+        result.push_back(records[(first + i) % records.size()]);
+    }
+
+    return result;
+}
+
+/*
+ * Escape a string for a JSON string.
+ */
+static std::string Escape(const char * str) {
+    std::string result;
+
+    for (; *str; ++str) {
+        unsigned char c = *str;
+
+        if (c == '"' || c == '\\') {
+            result += '\\';
+            result += c;
+        } else if (c < 0x20) {
+            char buffer[8];
+            snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+            result += buffer;
+        } else {
+            result += c;
+        }
+    }
+
+    return result;
+}
+
+std::string TraceRingBuffer::toChromeTrace() const {
+    std::vector<TraceRecord> spans = getRecords();
+    std::string out = "{\"traceEvents\":[";
+    char buffer[256];
+    int pid = getpid();
+
+    for (size_t i = 0; i < spans.size(); ++i) {
+        const TraceRecord & s = spans[i];
+        out += i == 0 ? "{" : ",{";
+        out += "\"name\":\"" + Escape(s.name) + "\",\"cat\":\"hdfs\",\"ph\":\"X\"";
+        snprintf(buffer, sizeof(buffer),
+                 ",\"ts\":%" PRId64 ",\"dur\":%" PRId64 ",\"pid\":%d,\"tid\":%" PRId64
+                 ",\"args\":{\"trace_id\":%" PRIu64 ",\"span_id\":%" PRIu64
+                 ",\"parent_id\":%" PRIu64,
+                 s.start, s.duration, pid, s.threadId, s.traceId, s.spanId,
+                 s.parentId);
+        out += buffer;
+
+        if (s.detail[0]) {
+            out += ",\"detail\":\"" + Escape(s.detail) + "\"";
+        }
+
+        out += "}}";
+    }
+
+    out += "],\"displayTimeUnit\":\"ms\"}";
+    return out;
+}
+
+}
+}
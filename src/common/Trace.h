@@ -0,0 +1,186 @@
+/********************************************************************
+ * Copyright (c) 2013 - 2014, Pivotal Inc.
+ * All rights reserved.
+ *
+ * Author: Zhanwei Wang
+ ********************************************************************/
+/********************************************************************
+ * 2014 -
+ * open source under Apache License Version 2.0
+ ********************************************************************/
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef _HDFS_LIBHDFS3_COMMON_TRACE_H_
+#define _HDFS_LIBHDFS3_COMMON_TRACE_H_
+
+#include "Atomic.h"
+#include "Memory.h"
+#include "Thread.h"
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace Hdfs {
+namespace Internal {
+
+/**
+ * A finished span handed to the trace sink.
+ */
+struct TraceRecord {
+    uint64_t traceId; //the span id of the root span.
+    uint64_t spanId;
+    uint64_t parentId; //0 for a root span.
+    const char * name; //a string literal.
+    char detail[64];
+    int64_t start; //microseconds on the steady clock.
+    int64_t duration; //microseconds.
+    int64_t threadId;
+};
+
+/**
+ * Receives the sampled spans, on the thread which ends them.
+ */
+class TraceSink {
+public:
+    virtual ~TraceSink() {
+    }
+
+    virtual void record(const TraceRecord & span) = 0;
+};
+
+/**
+ * A sink keeping the last spans in a ring buffer, and dumping them in the
+ * Chrome trace event format (chrome://tracing, Perfetto).
+ */
+class TraceRingBuffer: public TraceSink {
+public:
+    explicit TraceRingBuffer(size_t capacity);
+
+    void record(const TraceRecord & span);
+
+    /**
+     * @return the buffered spans, oldest first.
+     */
+    std::vector<TraceRecord> getRecords() const;
+
+    std::string toChromeTrace() const;
+
+private:
+    size_t next;
+    size_t size;
+    std::vector<TraceRecord> records;
+    mutable mutex mut;
+};
+
+/**
+ * Process wide tracing configure. Tracing is on once a sink is set and the
+ * sample rate is above 0. Each root span, a span started while no other
+ * span is active on the thread, is sampled with the sample rate, and its
+ * children follow its decision.
+ */
+class Tracer {
+public:
+    /**
+     * @param sink the sink, NULL to stop tracing.
+     */
+    static void SetSink(shared_ptr<TraceSink> sink);
+
+    static shared_ptr<TraceSink> GetSink();
+
+    /**
+     * @param rate the fraction of root spans to sample, between 0 and 1.
+     */
+    static void SetSampleRate(double rate);
+
+    static double GetSampleRate();
+
+    static bool IsEnabled() {
+        return Enabled;
+    }
+
+private:
+    static void Update();
+
+private:
+    static atomic<bool> Enabled;
+    friend class TraceSpan;
+};
+
+/**
+ * A span covering the lifetime of the object. Spans nest on a thread, the
+ * innermost active span is the parent of the next one. When tracing is
+ * off, constructing a span costs one branch.
+ */
+class TraceSpan {
+public:
+    explicit TraceSpan(const char * name) :
+        state(Inactive) {
+        if (Tracer::Enabled) {
+            begin(name);
+        }
+    }
+
+    ~TraceSpan() {
+        if (state != Inactive) {
+            end();
+        }
+    }
+
+    /**
+     * Annotate the span, use TRACE_DETAIL to skip the call when the span
+     * is not sampled.
+     */
+    void setDetail(const char * fmt, ...) __attribute__((format(printf, 2, 3)));
+
+    bool isSampled() const {
+        return state == Sampled;
+    }
+
+private:
+    TraceSpan(const TraceSpan & other);
+    TraceSpan & operator =(const TraceSpan & other);
+
+    void begin(const char * name);
+    void end();
+
+private:
+    enum State {
+        Inactive, Suppressed, Sampled
+    };
+
+    State state;
+    TraceSpan * parent;
+    TraceRecord record;
+};
+
+}
+}
+
+/**
+ * Annotate a span, the arguments are neither evaluated nor formatted
+ * unless the span is sampled.
+ */
+#define TRACE_DETAIL(span, fmt, ...) \
+    do { \
+        if ((span).isSampled()) { \
+            (span).setDetail(fmt, ##__VA_ARGS__); \
+        } \
+    } while (0)
+
+#endif /* _HDFS_LIBHDFS3_COMMON_TRACE_H_ */
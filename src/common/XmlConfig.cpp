@@ -107,7 +107,7 @@ static double StrToDouble(const char * str) {
     }
 
     if (ERANGE == errno || retval > std::numeric_limits<double>::max()
-            || retval < std::numeric_limits<double>::min()) {
+            || retval < -std::numeric_limits<double>::max()) {
         THROW(HdfsBadNumFoumat, "Underflow/Overflow int64_t type: %s", str);
     }
 
@@ -33,11 +33,13 @@
 namespace Hdfs {
 namespace Internal {
 
+class AlignmentContext;
+
 class RpcCall {
 public:
     RpcCall(bool idemp, std::string n, google::protobuf::Message * req,
             google::protobuf::Message * resp) :
-        idempotent(idemp), name(n), request(req), response(resp) {
+        idempotent(idemp), name(n), request(req), response(resp), alignment(NULL) {
     }
 
     bool isIdempotent() const {
@@ -72,11 +74,20 @@ public:
         this->response = response;
     }
 
+    AlignmentContext * getAlignmentContext() const {
+        return alignment;
+    }
+
+    void setAlignmentContext(AlignmentContext * alignment) {
+        this->alignment = alignment;
+    }
+
 private:
     bool idempotent;
     std::string name;
     google::protobuf::Message * request;
     google::protobuf::Message * response;
+    AlignmentContext * alignment;
 };
 
 }
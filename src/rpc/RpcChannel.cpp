@@ -25,10 +25,12 @@
  * See the License for the specific language governing permissions and
  * limitations under the License.
  */
+#include "AlignmentContext.h"
 #include "Exception.h"
 #include "ExceptionInternal.h"
 #include "IpcConnectionContext.pb.h"
 #include "Logger.h"
+#include "Metrics.h"
 #include "RpcChannel.h"
 #include "RpcClient.h"
 #include "RpcContentWrapper.h"
@@ -36,6 +38,7 @@
 #include "RpcHeader.pb.h"
 #include "server/RpcHelper.h"
 #include "Thread.h"
+#include "Trace.h"
 #include "WriteBuffer.h"
 
 #include <google/protobuf/io/coded_stream.h>
@@ -44,6 +47,7 @@
 #define RPC_HEADER_VERSION 9
 #define SERIALIZATION_TYPE_PROTOBUF 0
 #define CONNECTION_CONTEXT_CALL_ID -3
+#define RPC_MAX_RETAINED_BUFFER_SIZE (1024 * 1024)
 
 using namespace ::google::protobuf;
 using namespace google::protobuf::io;
@@ -51,6 +55,50 @@ using namespace google::protobuf::io;
 namespace Hdfs {
 namespace Internal {
 
+/*
+ * Record the latency of an RPC call per method, and count the call as
+ * failed unless it is marked done before leaving the scope.
+ */
+class RpcCallMetrics {
+public:
+    explicit RpcCallMetrics(const char * method) :
+        done(false), method(method), start(steady_clock::now()) {
+        InFlight().add(1);
+    }
+
+    ~RpcCallMetrics() {
+        MetricsRegistry & metrics = MetricsRegistry::GetMetricsRegistry();
+        InFlight().add(-1);
+        metrics.histogram("hdfs_client_rpc_latency_microseconds",
+                          "Latency of RPC calls to the namenode, retries included.",
+                          "method", method).record(
+                              duration_cast<microseconds>(steady_clock::now() - start).count());
+
+        if (!done) {
+            metrics.counter("hdfs_client_rpc_failures_total",
+                            "RPC calls which failed or returned a server exception.",
+                            "method", method).add();
+        }
+    }
+
+    void setDone() {
+        done = true;
+    }
+
+private:
+    static Gauge & InFlight() {
+        static Gauge & inFlight = MetricsRegistry::GetMetricsRegistry().gauge(
+                                      "hdfs_client_rpc_calls_in_flight",
+                                      "RPC calls waiting for a response.");
+        return inFlight;
+    }
+
+private:
+    bool done;
+    const char * method;
+    steady_clock::time_point start;
+};
+
 RpcChannelImpl::RpcChannelImpl(const RpcChannelKey & k, RpcClient & c) :
     refs(0), available(false), key(k), client(c) {
     sock = shared_ptr<Socket>(new TcpSocketImpl);
@@ -421,6 +469,9 @@ exception_ptr RpcChannelImpl::invokeInternal(RpcRemoteCallPtr remote) {
 
 void RpcChannelImpl::invoke(const RpcCall & call) {
     assert(refs > 0);
+    RpcCallMetrics metrics(call.getName());
+    TraceSpan span("RpcChannel::invoke");
+    TRACE_DETAIL(span, "%s", call.getName());
     RpcRemoteCallPtr remote;
     exception_ptr lastError;
 
@@ -500,6 +551,7 @@ void RpcChannelImpl::invoke(const RpcCall & call) {
     }
 
     remote->check();
+    metrics.setDone();
 }
 
 void RpcChannelImpl::shutdown(exception_ptr reason) {
@@ -523,14 +575,23 @@ void RpcChannelImpl::wakeupOneCaller(int32_t id) {
 }
 
 void RpcChannelImpl::sendRequest(RpcRemoteCallPtr remote) {
-    WriteBuffer buffer;
     assert(true == available);
-    remote->serialize(key.getProtocol(), buffer);
-    sock->writeFully(buffer.getBuffer(0), buffer.getDataSize(0),
+    /*
+     * the whole frame is serialized into one buffer reused by every call
+     * on this channel and sent with a single write.
+     */
+    sendBuffer.setBufferDataSize(0);
+    remote->serialize(key.getProtocol(), sendBuffer, sendHeaders);
+    size_t size = sendBuffer.getDataSize(0);
+    sock->writeFully(sendBuffer.getBuffer(0), size,
                      key.getConf().getWriteTimeout());
     uint32_t id = remote->getIdentity();
     pendingCalls[id] = remote;
     lastActivity = lastIdle = steady_clock::now();
+
+    if (size > RPC_MAX_RETAINED_BUFFER_SIZE) {
+        sendBuffer = WriteBuffer();
+    }
 }
 
 void RpcChannelImpl::cleanupPendingCalls(exception_ptr reason) {
@@ -760,10 +821,47 @@ static exception_ptr HandlerRpcResponseException(exception_ptr e) {
     return retval;
 }
 
+/*
+ * Do not keep a large receive buffer around after a large response.
+ */
+class ReleaseLargeBuffer {
+public:
+    ReleaseLargeBuffer(std::vector<char> & buffer) :
+        buffer(buffer) {
+    }
+
+    ~ReleaseLargeBuffer() {
+        if (buffer.capacity() > RPC_MAX_RETAINED_BUFFER_SIZE) {
+            std::vector<char>().swap(buffer);
+        }
+    }
+
+private:
+    std::vector<char> & buffer;
+};
+
+static void UpdateAlignmentContext(RpcRemoteCallPtr rc,
+                                   const RpcResponseHeaderProto & header) {
+    AlignmentContext * alignment = rc->getCall().getAlignmentContext();
+
+    if (alignment && header.has_stateid()) {
+        alignment->updateResponseState(header.stateid());
+    }
+}
+
 void RpcChannelImpl::readOneResponse(bool writeLock) {
+    /*
+     * writeLock is set when called from checkOneResponse, this thread is
+     * then the only reader of the channel and has to take writeMut to look
+     * up the pending call. Reuse the receive buffer and header only in
+     * that case, the connection setup path uses local ones.
+     */
+    std::vector<char> localBuffer;
+    RpcResponseHeaderProto localHeader;
+    std::vector<char> & buffer = writeLock ? recvBuffer : localBuffer;
+    RpcResponseHeaderProto & curRespHeader = writeLock ? recvHeader : localHeader;
+    ReleaseLargeBuffer release(buffer);
     int readTimeout = key.getConf().getReadTimeout();
-    std::vector<char> buffer(128);
-    RpcResponseHeaderProto curRespHeader;
     RpcResponseHeaderProto::RpcStatusProto status;
     uint32_t headerSize = 0, bodySize = 0;
     in->readBigEndianInt32(readTimeout);
@@ -796,6 +894,7 @@ void RpcChannelImpl::readOneResponse(bool writeLock) {
             rc = getPendingCall(curRespHeader.callid());
         }
 
+        UpdateAlignmentContext(rc, curRespHeader);
         bodySize = in->readVarint32(readTimeout);
         buffer.resize(bodySize);
 
@@ -827,6 +926,8 @@ void RpcChannelImpl::readOneResponse(bool writeLock) {
                 rc = getPendingCall(curRespHeader.callid());
             }
 
+            UpdateAlignmentContext(rc, curRespHeader);
+
             try {
                 THROW(HdfsRpcServerException, "%s: %s",
                       errClass.c_str(), errMessage.c_str());
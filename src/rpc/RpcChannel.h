@@ -89,6 +89,12 @@ public:
      * Add reference count to this channel.
      */
     virtual void addRef() = 0;
+
+    /**
+     * Get the number of callers which are using this channel.
+     * @return the reference count.
+     */
+    virtual int getRefCount() = 0;
 };
 
 /**
@@ -141,6 +147,14 @@ public:
         ++refs;
     }
 
+    /**
+     * Get the number of callers which are using this channel.
+     * @return the reference count.
+     */
+    int getRefCount() {
+        return refs;
+    }
+
 private:
     /**
      * Setup the RPC connection.
@@ -265,6 +279,10 @@ private:
     shared_ptr<BufferedSocketReader> in;
     shared_ptr<SaslClient> saslClient;
     shared_ptr<Socket> sock;
+    RpcRequestHeaders sendHeaders; // protected by writeMut
+    RpcResponseHeaderProto recvHeader; // protected by readMut
+    std::vector<char> recvBuffer; // protected by readMut
+    WriteBuffer sendBuffer; // protected by writeMut
     steady_clock::time_point lastActivity; // ping is a kind of activity, lastActivity will be updated after ping
     steady_clock::time_point lastIdle; // ping cannot change idle state. If there is still pending calls, lastIdle is always "NOW".
     unordered_map<int32_t, RpcRemoteCallPtr> pendingCalls;
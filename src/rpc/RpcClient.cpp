@@ -85,12 +85,21 @@ void RpcClientImpl::clean() {
                     break;
                 }
 
-                unordered_map<RpcChannelKey, shared_ptr<RpcChannel> >::iterator s, e;
+                unordered_map<RpcChannelKey, RpcChannelPool>::iterator s, e;
                 e = allChannels.end();
 
                 for (s = allChannels.begin(); s != e;) {
-                    if (s->second->checkIdle()) {
-                        s->second.reset();
+                    std::vector<shared_ptr<RpcChannel> > & channels = s->second.channels;
+
+                    for (size_t i = 0; i < channels.size();) {
+                        if (channels[i]->checkIdle()) {
+                            channels.erase(channels.begin() + i);
+                        } else {
+                            ++i;
+                        }
+                    }
+
+                    if (channels.empty()) {
                         s = allChannels.erase(s);
                     } else {
                         ++s;
@@ -116,11 +125,13 @@ void RpcClientImpl::clean() {
 void RpcClientImpl::close() {
     lock_guard<mutex> lock(mut);
     running = false;
-    unordered_map<RpcChannelKey, shared_ptr<RpcChannel> >::iterator s, e;
+    unordered_map<RpcChannelKey, RpcChannelPool>::iterator s, e;
     e = allChannels.end();
 
     for (s = allChannels.begin(); s != e; ++s) {
-        s->second->waitForExit();
+        for (size_t i = 0; i < s->second.channels.size(); ++i) {
+            s->second.channels[i]->waitForExit();
+        }
     }
 
     allChannels.clear();
@@ -145,16 +156,7 @@ RpcChannel & RpcClientImpl::getChannel(const RpcAuth & auth,
                   key.getServer().getHost().c_str(), key.getServer().getPort().c_str());
         }
 
-        unordered_map<RpcChannelKey, shared_ptr<RpcChannel> >::iterator it;
-        it = allChannels.find(key);
-
-        if (it != allChannels.end()) {
-            rc = it->second;
-        } else {
-            rc = createChannelInternal(key);
-            allChannels[key] = rc;
-        }
-
+        rc = chooseChannel(allChannels[key], key);
         rc->addRef();
 
         if (!cleaning) {
@@ -177,6 +179,45 @@ RpcChannel & RpcClientImpl::getChannel(const RpcAuth & auth,
     return *rc;
 }
 
+/*
+ * Spread the calls to the same server over up to
+ * rpc.client.connections.per.server connections, so that a large
+ * response does not hold up the calls queued behind it.
+ * @pre Already hold the lock.
+ */
+shared_ptr<RpcChannel> RpcClientImpl::chooseChannel(RpcChannelPool & pool,
+        const RpcChannelKey & key) {
+    std::vector<shared_ptr<RpcChannel> > & channels = pool.channels;
+    size_t max = key.getConf().getConnectionsPerServer();
+
+    if (key.getConf().isLeastOutstanding()) {
+        /*
+         * open a new connection only if all existing ones are busy.
+         */
+        shared_ptr<RpcChannel> rc;
+        int minRefs = 0;
+
+        for (size_t i = 0; i < channels.size(); ++i) {
+            int refs = channels[i]->getRefCount();
+
+            if (!rc || refs < minRefs) {
+                rc = channels[i];
+                minRefs = refs;
+            }
+        }
+
+        if (rc && (minRefs == 0 || channels.size() >= max)) {
+            return rc;
+        }
+    } else if (channels.size() >= max) {
+        return channels[pool.next++ % channels.size()];
+    }
+
+    shared_ptr<RpcChannel> rc = createChannelInternal(key);
+    channels.push_back(rc);
+    return rc;
+}
+
 shared_ptr<RpcChannel> RpcClientImpl::createChannelInternal(
     const RpcChannelKey & key) {
     shared_ptr<RpcChannel> channel;
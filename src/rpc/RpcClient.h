@@ -48,6 +48,18 @@
 namespace Hdfs {
 namespace Internal {
 
+/**
+ * The RPC channels connected to the same server with the same key.
+ */
+struct RpcChannelPool {
+    RpcChannelPool() :
+        next(0) {
+    }
+
+    std::vector<shared_ptr<RpcChannel> > channels;
+    size_t next;
+};
+
 class RpcClient {
 public:
     /**
@@ -138,6 +150,9 @@ private:
     shared_ptr<RpcChannel> createChannelInternal(
         const RpcChannelKey & key);
 
+    shared_ptr<RpcChannel> chooseChannel(RpcChannelPool & pool,
+                                         const RpcChannelKey & key);
+
     void clean();
 
 private:
@@ -148,7 +163,7 @@ private:
     mutex mut;
     std::string clientId;
     thread cleaner;
-    unordered_map<RpcChannelKey, shared_ptr<RpcChannel> > allChannels;
+    unordered_map<RpcChannelKey, RpcChannelPool> allChannels;
 
 #ifdef MOCK
 private:
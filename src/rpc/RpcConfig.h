@@ -47,6 +47,8 @@ public:
         tcpNoDelay = conf.isRpcTcpNoDelay();
         lingerTimeout = conf.getRpcSocketLingerTimeout();
         rpcTimeout = conf.getRpcTimeout();
+        connectionsPerServer = conf.getRpcConnectionsPerServer();
+        leastOutstanding = conf.getRpcConnectionPolicy() == "least-outstanding";
     }
 
     size_t hash_value() const;
@@ -123,6 +125,22 @@ public:
         this->rpcTimeout = rpcTimeout;
     }
 
+    int getConnectionsPerServer() const {
+        return connectionsPerServer;
+    }
+
+    void setConnectionsPerServer(int connectionsPerServer) {
+        this->connectionsPerServer = connectionsPerServer;
+    }
+
+    bool isLeastOutstanding() const {
+        return leastOutstanding;
+    }
+
+    void setLeastOutstanding(bool leastOutstanding) {
+        this->leastOutstanding = leastOutstanding;
+    }
+
     bool operator ==(const RpcConfig & other) const {
         return this->maxIdleTime == other.maxIdleTime
                && this->pingTimeout == other.pingTimeout
@@ -132,7 +150,9 @@ public:
                && this->maxRetryOnConnect == other.maxRetryOnConnect
                && this->tcpNoDelay == other.tcpNoDelay
                && this->lingerTimeout == other.lingerTimeout
-               && this->rpcTimeout == other.rpcTimeout;
+               && this->rpcTimeout == other.rpcTimeout
+               && this->connectionsPerServer == other.connectionsPerServer
+               && this->leastOutstanding == other.leastOutstanding;
     }
 
 private:
@@ -144,7 +164,9 @@ private:
     int maxRetryOnConnect;
     int lingerTimeout;
     int rpcTimeout;
+    int connectionsPerServer;
     bool tcpNoDelay;
+    bool leastOutstanding;
 };
 
 }
@@ -36,27 +36,30 @@ namespace Hdfs {
 namespace Internal {
 
 RpcContentWrapper::RpcContentWrapper(Message * header, Message * msg) :
-    header(header), msg(msg) {
+    header(header), msg(msg), headerLen(-1), msgLen(0) {
 }
 
 int RpcContentWrapper::getLength() {
-    int headerLen, msgLen = 0;
-    headerLen = header->ByteSize();
-    msgLen = msg == NULL ? 0 : msg->ByteSize();
+    if (headerLen < 0) {
+        headerLen = header->ByteSize();
+        msgLen = msg == NULL ? 0 : msg->ByteSize();
+    }
+
     return headerLen + CodedOutputStream::VarintSize32(headerLen)
            + (msg == NULL ?
               0 : msgLen + CodedOutputStream::VarintSize32(msgLen));
 }
 
 void RpcContentWrapper::writeTo(WriteBuffer & buffer) {
-    int size = header->ByteSize();
-    buffer.writeVarint32(size);
-    header->SerializeToArray(buffer.alloc(size), size);
+    getLength();
+    buffer.writeVarint32(headerLen);
+    header->SerializeWithCachedSizesToArray(
+        reinterpret_cast<unsigned char *>(buffer.alloc(headerLen)));
 
     if (msg != NULL) {
-        size = msg->ByteSize();
-        buffer.writeVarint32(size);
-        msg->SerializeToArray(buffer.alloc(size), size);
+        buffer.writeVarint32(msgLen);
+        msg->SerializeWithCachedSizesToArray(
+            reinterpret_cast<unsigned char *>(buffer.alloc(msgLen)));
     }
 }
 
@@ -46,6 +46,13 @@ public:
 public:
     ::google::protobuf::Message * header;
     ::google::protobuf::Message * msg;
+
+private:
+    /*
+     * computing the size walks the whole message, do it only once.
+     */
+    int headerLen;
+    int msgLen;
 };
 
 }
@@ -25,6 +25,7 @@
  * See the License for the specific language governing permissions and
  * limitations under the License.
  */
+#include "AlignmentContext.h"
 #include "Memory.h"
 #include "ProtobufRpcEngine.pb.h"
 #include "RpcCall.h"
@@ -43,14 +44,21 @@ namespace Hdfs {
 namespace Internal {
 
 void RpcRemoteCall::serialize(const RpcProtocolInfo & protocol,
-                              WriteBuffer & buffer) {
-    RpcRequestHeaderProto rpcHeader;
+                              WriteBuffer & buffer, RpcRequestHeaders & headers) {
+    RpcRequestHeaderProto & rpcHeader = headers.rpcHeader;
+    rpcHeader.Clear();
     rpcHeader.set_callid(identity);
     rpcHeader.set_clientid(clientId);
     rpcHeader.set_retrycount(-1);
     rpcHeader.set_rpckind(RPC_PROTOCOL_BUFFER);
     rpcHeader.set_rpcop(RpcRequestHeaderProto_OperationProto_RPC_FINAL_PACKET);
-    RequestHeaderProto requestHeader;
+
+    if (call.getAlignmentContext()) {
+        rpcHeader.set_stateid(call.getAlignmentContext()->getLastSeenStateId());
+    }
+
+    RequestHeaderProto & requestHeader = headers.requestHeader;
+    requestHeader.Clear();
     requestHeader.set_methodname(call.getName());
     requestHeader.set_declaringclassprotocolname(protocol.getProtocol());
     requestHeader.set_clientprotocolversion(protocol.getVersion());
@@ -59,7 +67,8 @@ void RpcRemoteCall::serialize(const RpcProtocolInfo & protocol,
     int size = CodedOutputStream::VarintSize32(rpcHeaderLen) + rpcHeaderLen + wrapper.getLength();
     buffer.writeBigEndian(size);
     buffer.writeVarint32(rpcHeaderLen);
-    rpcHeader.SerializeToArray(buffer.alloc(rpcHeaderLen), rpcHeaderLen);
+    rpcHeader.SerializeWithCachedSizesToArray(
+        reinterpret_cast<unsigned char *>(buffer.alloc(rpcHeaderLen)));
     wrapper.writeTo(buffer);
 }
 
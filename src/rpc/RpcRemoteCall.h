@@ -31,7 +31,9 @@
 #include "DateTime.h"
 #include "ExceptionInternal.h"
 #include "Memory.h"
+#include "ProtobufRpcEngine.pb.h"
 #include "RpcCall.h"
+#include "RpcHeader.pb.h"
 #include "RpcProtocolInfo.h"
 #include "Thread.h"
 #include "WriteBuffer.h"
@@ -44,6 +46,15 @@ namespace Internal {
 class RpcRemoteCall;
 typedef shared_ptr<RpcRemoteCall> RpcRemoteCallPtr;
 
+/**
+ * The request headers reused by a channel for every call,
+ * the strings in them keep their storage between calls.
+ */
+struct RpcRequestHeaders {
+    RpcRequestHeaderProto rpcHeader;
+    RequestHeaderProto requestHeader;
+};
+
 class RpcRemoteCall {
 public:
     RpcRemoteCall(const RpcCall & c, int32_t id, const std::string & clientId) :
@@ -60,7 +71,7 @@ public:
     }
 
     virtual void serialize(const RpcProtocolInfo & protocol,
-                           WriteBuffer & buffer);
+                           WriteBuffer & buffer, RpcRequestHeaders & headers);
 
     const int32_t getIdentity() const {
         return identity;
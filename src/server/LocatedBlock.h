@@ -37,6 +37,16 @@
 namespace Hdfs {
 namespace Internal {
 
+/**
+ * Types of storage media a replica can be on, see StorageTypeProto.
+ */
+enum StorageType {
+    STORAGE_DISK = 1,
+    STORAGE_SSD = 2,
+    STORAGE_ARCHIVE = 3,
+    STORAGE_RAM_DISK = 4
+};
+
 /**
  * Associates a block with the Datanodes that contain its replicas
  * and other block metadata (E.g. the file offset associated with this
@@ -104,11 +114,37 @@ public:
         this->storageIDs = sid;
     }
 
+    /**
+     * @param index the index of the replica in locations.
+     * @return true if the namenode reports the replica cached in memory.
+     */
+    bool isCached(size_t index) const {
+        return index < cached.size() && cached[index];
+    }
+
+    std::vector<bool> & mutableCached() {
+        return cached;
+    }
+
+    /**
+     * @param index the index of the replica in locations.
+     * @return the storage type of the replica, disk if unknown.
+     */
+    StorageType getStorageType(size_t index) const {
+        return index < storageTypes.size() ? storageTypes[index] : STORAGE_DISK;
+    }
+
+    std::vector<StorageType> & mutableStorageTypes() {
+        return storageTypes;
+    }
+
 private:
     int64_t offset;
     bool corrupt;
     std::vector<DatanodeInfo> locs;
+    std::vector<bool> cached;
     std::vector<std::string> storageIDs;
+    std::vector<StorageType> storageTypes;
     Token token;
 };
 
@@ -586,6 +586,16 @@ public:
     //Idempotent
     virtual std::vector<int64_t> getFsStats() /* throw (HdfsIOException) */ = 0;
 
+    /**
+     * Catch up with the latest namespace state of the active namenode,
+     * the state id in the reply is what an observer namenode has to
+     * reach before serving the next read.
+     *
+     * @throw HdfsIOException
+     */
+    //Idempotent
+    virtual void msync() /* throw (HdfsIOException) */ = 0;
+
     /**
      * Dumps namenode data structures into specified file. If the file
      * already exists, then append.
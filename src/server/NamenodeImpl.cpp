@@ -44,8 +44,9 @@ namespace Hdfs {
 namespace Internal {
 
 NamenodeImpl::NamenodeImpl(const char * host, const char * port, const std::string & tokenService,
-                           const SessionConfig & c, const RpcAuth & a) :
-    auth(a), client(RpcClient::getClient()), conf(c), protocol(
+                           const SessionConfig & c, const RpcAuth & a,
+                           shared_ptr<AlignmentContext> alignment) :
+    auth(a), alignment(alignment), client(RpcClient::getClient()), conf(c), protocol(
         NAMENODE_VERSION, NAMENODE_PROTOCOL, DELEGATION_TOKEN_KIND), server(tokenService, host, port) {
 }
 
@@ -54,9 +55,11 @@ NamenodeImpl::~NamenodeImpl() {
 
 void NamenodeImpl::invoke(const RpcCall & call) {
     RpcChannel & channel = client.getChannel(auth, protocol, server, conf);
+    RpcCall aligned(call);
+    aligned.setAlignmentContext(alignment.get());
 
     try {
-        channel.invoke(call);
+        channel.invoke(aligned);
     } catch (...) {
         channel.close(false);
         throw;
@@ -513,6 +516,18 @@ void NamenodeImpl::renewLease(const std::string & clientName)
     return false;
 }*/
 
+//Idempotent
+void NamenodeImpl::msync() /* throw (HdfsIOException) */{
+    try {
+        MsyncRequestProto request;
+        MsyncResponseProto response;
+        invoke(RpcCall(true, "msync", &request, &response));
+    } catch (const HdfsRpcServerException & e) {
+        UnWrapper<HdfsIOException> unwrapper(e);
+        unwrapper.unwrap(__FILE__, __LINE__);
+    }
+}
+
 //Idempotent
 std::vector<int64_t> NamenodeImpl::getFsStats() { /* throw (HdfsIOException) */
     try {
@@ -28,7 +28,9 @@
 #ifndef _HDFS_LIBHDFS3_SERVER_NAMENODEIMPL_H_
 #define _HDFS_LIBHDFS3_SERVER_NAMENODEIMPL_H_
 
+#include "Memory.h"
 #include "Namenode.h"
+#include "rpc/AlignmentContext.h"
 
 namespace Hdfs {
 namespace Internal {
@@ -36,7 +38,8 @@ namespace Internal {
 class NamenodeImpl: public Namenode {
 public:
     NamenodeImpl(const char * host, const char * port, const std::string & tokenService, const SessionConfig & c,
-                 const RpcAuth & a);
+                 const RpcAuth & a,
+                 shared_ptr<AlignmentContext> alignment = shared_ptr<AlignmentContext>());
 
     ~NamenodeImpl();
 
@@ -155,6 +158,9 @@ public:
     bool recoverLease(const std::string & src, const std::string & clientName)
     /* throw (HdfsIOException) */;
 
+    //Idempotent
+    void msync() /* throw (HdfsIOException) */;
+
     //Idempotent
     std::vector<int64_t> getFsStats() /* throw (HdfsIOException) */;
 
@@ -229,6 +235,7 @@ private:
 
 private:
     RpcAuth auth;
+    shared_ptr<AlignmentContext> alignment;
     RpcClient & client;
     RpcConfig conf;
     RpcProtocolInfo protocol;
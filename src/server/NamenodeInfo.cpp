@@ -41,14 +41,13 @@ NamenodeInfo::NamenodeInfo() {
 
 const char * DFS_NAMESERVICES = "dfs.nameservices";
 const char * DFS_NAMENODE_HA = "dfs.ha.namenodes";
+const char * DFS_NAMENODE_HA_OBSERVER = "dfs.ha.observer.namenodes";
 const char * DFS_NAMENODE_RPC_ADDRESS_KEY = "dfs.namenode.rpc-address";
 const char * DFS_NAMENODE_HTTP_ADDRESS_KEY = "dfs.namenode.http-address";
 
-std::vector<NamenodeInfo> NamenodeInfo::GetHANamenodeInfo(
-    const std::string & service, const Config & conf) {
+static std::vector<NamenodeInfo> GetNamenodeInfo(const std::string & service,
+        const std::string & strNameNodes, const Config & conf) {
     std::vector<NamenodeInfo> retval;
-    std::string strNameNodes = StringTrim(
-                                   conf.getString(std::string(DFS_NAMENODE_HA) + "." + service));
     std::vector<std::string> nns = StringSplit(strNameNodes, ",");
     retval.resize(nns.size());
 
@@ -65,4 +64,23 @@ std::vector<NamenodeInfo> NamenodeInfo::GetHANamenodeInfo(
 
     return retval;
 }
+
+std::vector<NamenodeInfo> NamenodeInfo::GetHANamenodeInfo(
+    const std::string & service, const Config & conf) {
+    std::string strNameNodes = StringTrim(
+                                   conf.getString(std::string(DFS_NAMENODE_HA) + "." + service));
+    return GetNamenodeInfo(service, strNameNodes, conf);
+}
+
+std::vector<NamenodeInfo> NamenodeInfo::GetObserverNamenodeInfo(
+    const std::string & service, const Config & conf) {
+    std::string strNameNodes = StringTrim(
+                                   conf.getString(std::string(DFS_NAMENODE_HA_OBSERVER) + "." + service, ""));
+
+    if (strNameNodes.empty()) {
+        return std::vector<NamenodeInfo>();
+    }
+
+    return GetNamenodeInfo(service, strNameNodes, conf);
+}
 }
@@ -57,6 +57,13 @@ public:
 
     static std::vector<NamenodeInfo> GetHANamenodeInfo(const std::string & service, const Config & conf);
 
+    /**
+     * Get the observer namenodes of a name service, which are the namenode ids
+     * listed in "dfs.ha.observer.namenodes.<service>".
+     * @return return an empty vector if no observer is configured.
+     */
+    static std::vector<NamenodeInfo> GetObserverNamenodeInfo(const std::string & service, const Config & conf);
+
 private:
     std::string rpc_addr;
     std::string http_addr;
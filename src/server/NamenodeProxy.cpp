@@ -27,11 +27,13 @@
  */
 #include "Exception.h"
 #include "ExceptionInternal.h"
+#include "Function.h"
 #include "Logger.h"
 #include "NamenodeImpl.h"
 #include "NamenodeProxy.h"
 #include "StringUtil.h"
 
+#include <map>
 #include <string>
 
 #include <sys/fcntl.h>
@@ -147,9 +149,118 @@ static void SetInitNamenodeIndex(const std::string & id, uint32_t index) {
     }
 }
 
-NamenodeProxy::NamenodeProxy(const std::vector<NamenodeInfo> & namenodeInfos, const std::string & tokenService,
+/*
+ * The active Namenode found by the last parallel probe, shared by
+ * all NamenodeProxy of the same cluster in this process.
+ */
+class ActiveNamenodeEntry {
+public:
+    ActiveNamenodeEntry() :
+        generation(0), index(0) {
+    }
+
+    uint64_t get(uint32_t & index) {
+        lock_guard<mutex> lock(mut);
+        index = this->index;
+        return generation;
+    }
+
+    uint64_t set(uint32_t index) {
+        lock_guard<mutex> lock(mut);
+        this->index = index;
+        return ++generation;
+    }
+
+public:
+    /*
+     * only one probe of the cluster is in flight at a time.
+     */
+    mutex probeMut;
+
+private:
+    mutex mut;
+    uint64_t generation;
+    uint32_t index;
+};
+
+static mutex ActiveNamenodeTableMut;
+static std::map<std::string, shared_ptr<ActiveNamenodeEntry> > ActiveNamenodeTable;
+
+static shared_ptr<ActiveNamenodeEntry> GetActiveNamenodeEntry(const std::string & id) {
+    lock_guard<mutex> lock(ActiveNamenodeTableMut);
+    shared_ptr<ActiveNamenodeEntry> & entry = ActiveNamenodeTable[id];
+
+    if (!entry) {
+        entry = shared_ptr<ActiveNamenodeEntry>(new ActiveNamenodeEntry);
+    }
+
+    return entry;
+}
+
+/*
+ * The namespace state id seen by any NamenodeProxy of the same cluster
+ * in this process, a write through one FileSystem is visible to reads
+ * from observers through another.
+ */
+static mutex AlignmentContextTableMut;
+static std::map<std::string, shared_ptr<AlignmentContext> > AlignmentContextTable;
+
+static shared_ptr<AlignmentContext> GetAlignmentContext(const std::string & id) {
+    lock_guard<mutex> lock(AlignmentContextTableMut);
+    shared_ptr<AlignmentContext> & context = AlignmentContextTable[id];
+
+    if (!context) {
+        context = shared_ptr<AlignmentContext>(new AlignmentContext);
+    }
+
+    return context;
+}
+
+struct ProbeResult {
+    ProbeResult(int pending) :
+        pending(pending), winner(-1) {
+    }
+
+    condition_variable cond;
+    mutex mut;
+    int pending;
+    int winner;
+};
+
+/*
+ * A standby Namenode rejects getFsStats, so any reply means it is active.
+ */
+static void ProbeNamenode(shared_ptr<Namenode> namenode, int index,
+                          shared_ptr<ProbeResult> result) {
+    bool active = false;
+
+    try {
+        namenode->getFsStats();
+        active = true;
+    } catch (const HdfsException & e) {
+        std::string buffer;
+        LOG(DEBUG1, "NamenodeProxy: Namenode %d is not active:\n%s", index,
+            GetExceptionDetail(e, buffer));
+    } catch (...) {
+    }
+
+    lock_guard<mutex> lock(result->mut);
+
+    if (active && result->winner < 0) {
+        result->winner = index;
+    }
+
+    --result->pending;
+    result->cond.notify_all();
+}
+
+NamenodeProxy::NamenodeProxy(const std::vector<NamenodeInfo> & namenodeInfos,
+                             const std::vector<NamenodeInfo> & observerInfos,
+                             const std::string & tokenService,
                              const SessionConfig & c, const RpcAuth & a) :
-    clusterid(tokenService), currentNamenode(0) {
+    parallelProbe(c.doesParallelProbe()), observerRetryInterval(c.getObserverRetryInterval()),
+    probeTimeout(c.getProbeTimeout()), synced(false), clusterid(tokenService), currentNamenode(0),
+    nextObserver(0), probeGeneration(0) {
     if (namenodeInfos.size() == 1) {
         enableNamenodeHA = false;
         maxNamenodeHARetry = 0;
@@ -158,6 +269,13 @@ NamenodeProxy::NamenodeProxy(const std::vector<NamenodeInfo> & namenodeInfos, co
         maxNamenodeHARetry = c.getRpcMaxHaRetry();
     }
 
+    /*
+     * the state id is only tracked when there is an observer to read from.
+     */
+    if (!observerInfos.empty()) {
+        alignment = GetAlignmentContext(clusterid);
+    }
+
     for (size_t i = 0; i < namenodeInfos.size(); ++i) {
         std::vector<std::string> nninfo = StringSplit(namenodeInfos[i].getRpcAddr(), ":");
 
@@ -168,15 +286,60 @@ NamenodeProxy::NamenodeProxy(const std::vector<NamenodeInfo> & namenodeInfos, co
 
         namenodes.push_back(
             shared_ptr<Namenode>(
-                new NamenodeImpl(nninfo[0].c_str(), nninfo[1].c_str(), clusterid, c, a)));
+                new NamenodeImpl(nninfo[0].c_str(), nninfo[1].c_str(), clusterid, c, a, alignment)));
+    }
+
+    for (size_t i = 0; i < observerInfos.size(); ++i) {
+        std::vector<std::string> nninfo = StringSplit(observerInfos[i].getRpcAddr(), ":");
+
+        if (nninfo.size() != 2) {
+            THROW(InvalidParameter, "Cannot create namenode proxy, observer %s does not contain host or port",
+                  observerInfos[i].getRpcAddr().c_str());
+        }
+
+        observers.push_back(
+            shared_ptr<Namenode>(
+                new NamenodeImpl(nninfo[0].c_str(), nninfo[1].c_str(), clusterid, c, a, alignment)));
     }
 
+    observerRetryTime.resize(observers.size());
+
     if (enableNamenodeHA) {
         currentNamenode = GetInitNamenodeIndex(clusterid) % namenodeInfos.size();
     }
+
+    if (enableNamenodeHA && parallelProbe) {
+        /*
+         * probes fail fast instead of retrying a dead Namenode.
+         */
+        SessionConfig pc(c);
+        pc.setRpcConnectTimeout(std::min(probeTimeout, c.getRpcConnectTimeout()));
+        pc.setRpcReadTimeout(std::min(probeTimeout, c.getRpcReadTimeout()));
+        pc.setRpcWriteTimeout(std::min(probeTimeout, c.getRpcWriteTimeout()));
+        pc.setRpcTimeout(probeTimeout);
+        pc.setRpcMaxRetryOnConnect(1);
+
+        for (size_t i = 0; i < namenodeInfos.size(); ++i) {
+            std::vector<std::string> nninfo = StringSplit(namenodeInfos[i].getRpcAddr(), ":");
+            probes.push_back(
+                shared_ptr<Namenode>(
+                    new NamenodeImpl(nninfo[0].c_str(), nninfo[1].c_str(), clusterid, pc, a)));
+        }
+
+        /*
+         * prefer what another FileSystem in this process has already found.
+         */
+        uint32_t index;
+        probeGeneration = GetActiveNamenodeEntry(clusterid)->get(index);
+
+        if (probeGeneration > 0) {
+            currentNamenode = index % namenodeInfos.size();
+        }
+    }
 }
 
 NamenodeProxy::~NamenodeProxy() {
+    joinProbeThreads();
 }
 
 shared_ptr<Namenode> NamenodeProxy::getActiveNamenode(uint32_t & oldValue) {
@@ -191,6 +354,10 @@ shared_ptr<Namenode> NamenodeProxy::getActiveNamenode(uint32_t & oldValue) {
 }
 
 void NamenodeProxy::failoverToNextNamenode(uint32_t oldValue) {
+    if (parallelProbe && enableNamenodeHA && failoverByProbing(oldValue)) {
+        return;
+    }
+
     lock_guard<mutex> lock(mut);
 
     if (oldValue != currentNamenode) {
@@ -203,6 +370,159 @@ void NamenodeProxy::failoverToNextNamenode(uint32_t oldValue) {
     SetInitNamenodeIndex(clusterid, currentNamenode);
 }
 
+void NamenodeProxy::joinProbeThreads() {
+    for (size_t i = 0; i < probeThreads.size(); ++i) {
+        if (probeThreads[i]->joinable()) {
+            probeThreads[i]->join();
+        }
+    }
+
+    probeThreads.clear();
+}
+
+/*
+ * Probe all Namenodes concurrently and return the index of the first
+ * one which replies as active, or -1 if none does within the probe timeout.
+ * The probes still running are left behind and joined on the next round.
+ */
+int NamenodeProxy::probeNamenodes() {
+    joinProbeThreads();
+    shared_ptr<ProbeResult> result(new ProbeResult(probes.size()));
+
+    for (size_t i = 0; i < probes.size(); ++i) {
+        shared_ptr<thread> t(new thread);
+
+        try {
+            CREATE_THREAD(*t, bind(&ProbeNamenode, probes[i], static_cast<int>(i), result));
+            probeThreads.push_back(t);
+        } catch (const std::exception & e) {
+            LOG(WARNING, "NamenodeProxy: Failed to start probing Namenode %d: %s",
+                static_cast<int>(i), e.what());
+            lock_guard<mutex> lock(result->mut);
+            --result->pending;
+        }
+    }
+
+    unique_lock<mutex> lock(result->mut);
+    steady_clock::time_point deadline = steady_clock::now() + milliseconds(probeTimeout);
+
+    while (result->winner < 0 && result->pending > 0) {
+        steady_clock::time_point now = steady_clock::now();
+
+        if (now >= deadline) {
+            break;
+        }
+
+        result->cond.wait_for(lock, duration_cast<milliseconds>(deadline - now));
+    }
+
+    return result->winner;
+}
+
+/*
+ * Fail over to the active Namenode found by probing all Namenodes at once,
+ * instead of trying them one by one. A result found by another NamenodeProxy
+ * since this one last looked is adopted without probing again.
+ * Return false if no active Namenode was found.
+ */
+bool NamenodeProxy::failoverByProbing(uint32_t oldValue) {
+    shared_ptr<ActiveNamenodeEntry> entry = GetActiveNamenodeEntry(clusterid);
+    lock_guard<mutex> probeLock(entry->probeMut);
+    uint32_t index;
+    uint64_t generation;
+
+    {
+        lock_guard<mutex> lock(mut);
+
+        if (oldValue != currentNamenode) {
+            //already failover in another thread.
+            return true;
+        }
+    }
+
+    generation = entry->get(index);
+
+    if (generation == probeGeneration || index == oldValue) {
+        int winner = probeNamenodes();
+
+        if (winner < 0) {
+            LOG(WARNING, "NamenodeProxy: No active Namenode found by probing in %d ms.",
+                probeTimeout);
+            return false;
+        }
+
+        index = winner;
+        generation = entry->set(index);
+        SetInitNamenodeIndex(clusterid, index);
+    }
+
+    lock_guard<mutex> lock(mut);
+    probeGeneration = generation;
+
+    if (oldValue == currentNamenode && !namenodes.empty()) {
+        currentNamenode = index % namenodes.size();
+    }
+
+    return true;
+}
+
+/*
+ * Before the first read from an observer, learn the latest state id from
+ * the active Namenode, otherwise the observer may serve a namespace older
+ * than what other clients have written. Observers are skipped until it
+ * succeeds.
+ */
+bool NamenodeProxy::syncWithActive() {
+    if (synced) {
+        return true;
+    }
+
+    try {
+        msync();
+    } catch (const HdfsException & e) {
+        std::string buffer;
+        LOG(WARNING, "NamenodeProxy: Failed to msync with the active Namenode, "
+            "read from it instead:\n%s", GetExceptionDetail(e, buffer));
+        return false;
+    }
+
+    synced = true;
+    return true;
+}
+
+/*
+ * Choose the observers in turn to spread the read load,
+ * skip the ones which failed recently.
+ */
+shared_ptr<Namenode> NamenodeProxy::getObserverNamenode(size_t & index) {
+    lock_guard<mutex> lock(mut);
+    steady_clock::time_point now = steady_clock::now();
+
+    for (size_t i = 0; i < observers.size(); ++i) {
+        index = nextObserver++ % observers.size();
+
+        if (observerRetryTime[index] <= now) {
+            return observers[index];
+        }
+    }
+
+    return shared_ptr<Namenode>();
+}
+
+void NamenodeProxy::failoverFromObserver(size_t index, const HdfsException & e) {
+    std::string buffer;
+    {
+        lock_guard<mutex> lock(mut);
+
+        if (index < observerRetryTime.size()) {
+            observerRetryTime[index] = steady_clock::now()
+                                       + milliseconds(observerRetryInterval);
+        }
+    }
+    LOG(WARNING, "NamenodeProxy: Failed to read from observer Namenode, "
+        "fall back to the active Namenode:\n%s", GetExceptionDetail(e, buffer));
+}
+
 static void HandleHdfsFailoverException(const HdfsFailoverException & e) {
     try {
         Hdfs::rethrow_if_nested(e);
@@ -239,8 +559,39 @@ static void HandleHdfsFailoverException(const HdfsFailoverException & e) {
     } while (true); \
     } while (0)
 
+/*
+ * Try a read-only call on an observer Namenode first. The call falls
+ * through to the active Namenode if no observer is available, or the
+ * observer is lagging behind, in transition, or unreachable.
+ * Errors of the call itself such as FileNotFoundException are not retried.
+ */
+#define NAMENODE_OBSERVER_READ_BEGIN() \
+    do { \
+        size_t __index = 0; \
+        shared_ptr<Namenode> observer = getObserverNamenode(__index); \
+        if (observer && syncWithActive()) { \
+            try { \
+                (void)0
+
+#define NAMENODE_OBSERVER_READ_END() \
+            } catch (const NameNodeStandbyException & e) { \
+                failoverFromObserver(__index, e); \
+            } catch (const HdfsFailoverException & e) { \
+                failoverFromObserver(__index, e); \
+            } catch (const HdfsTimeoutException & e) { \
+                failoverFromObserver(__index, e); \
+            } catch (const HdfsIOException & e) { \
+                failoverFromObserver(__index, e); \
+            } \
+        } \
+    } while (0)
+
 void NamenodeProxy::getBlockLocations(const std::string & src, int64_t offset,
                                       int64_t length, LocatedBlocks & lbs) {
+    NAMENODE_OBSERVER_READ_BEGIN();
+    observer->getBlockLocations(src, offset, length, lbs);
+    return;
+    NAMENODE_OBSERVER_READ_END();
     NAMENODE_HA_RETRY_BEGIN();
     namenode->getBlockLocations(src, offset, length, lbs);
     NAMENODE_HA_RETRY_END();
@@ -389,6 +740,9 @@ bool NamenodeProxy::mkdirs(const std::string & src, const Permission & masked,
 bool NamenodeProxy::getListing(const std::string & src,
                                const std::string & startAfter, bool needLocation,
                                std::vector<FileStatus> & dl) {
+    NAMENODE_OBSERVER_READ_BEGIN();
+    return observer->getListing(src, startAfter, needLocation, dl);
+    NAMENODE_OBSERVER_READ_END();
     NAMENODE_HA_RETRY_BEGIN();
     return namenode->getListing(src, startAfter, needLocation, dl);
     NAMENODE_HA_RETRY_END();
@@ -419,6 +773,12 @@ std::vector<int64_t> NamenodeProxy::getFsStats() {
     return std::vector<int64_t>();
 }
 
+void NamenodeProxy::msync() {
+    NAMENODE_HA_RETRY_BEGIN();
+    namenode->msync();
+    NAMENODE_HA_RETRY_END();
+}
+
 /*void NamenodeProxy::metaSave(const std::string & filename) {
     NAMENODE_HA_RETRY_BEGIN();
     namenode->metaSave(filename);
@@ -426,6 +786,9 @@ std::vector<int64_t> NamenodeProxy::getFsStats() {
 }*/
 
 FileStatus NamenodeProxy::getFileInfo(const std::string & src, bool *exist) {
+    NAMENODE_OBSERVER_READ_BEGIN();
+    return observer->getFileInfo(src, exist);
+    NAMENODE_OBSERVER_READ_END();
     NAMENODE_HA_RETRY_BEGIN();
     return namenode->getFileInfo(src, exist);
     NAMENODE_HA_RETRY_END();
@@ -528,6 +891,8 @@ void NamenodeProxy::cancelDelegationToken(const Token & token) {
 void NamenodeProxy::close() {
     lock_guard<mutex> lock(mut);
     namenodes.clear();
+    observers.clear();
+    observerRetryTime.clear();
 }
 
 }
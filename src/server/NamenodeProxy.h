@@ -28,9 +28,12 @@
 #ifndef _HDFS_LIBHDFS3_SERVER_NAMENODEPROXY_H_
 #define _HDFS_LIBHDFS3_SERVER_NAMENODEPROXY_H_
 
+#include "Atomic.h"
+#include "DateTime.h"
 #include "Memory.h"
 #include "Namenode.h"
 #include "NamenodeInfo.h"
+#include "rpc/AlignmentContext.h"
 #include "Thread.h"
 
 namespace Hdfs {
@@ -38,7 +41,9 @@ namespace Internal {
 
 class NamenodeProxy: public Namenode {
 public:
-    NamenodeProxy(const std::vector<NamenodeInfo> & namenodeInfos, const std::string & tokenService,
+    NamenodeProxy(const std::vector<NamenodeInfo> & namenodeInfos,
+                  const std::vector<NamenodeInfo> & observerInfos,
+                  const std::string & tokenService,
                   const SessionConfig & c, const RpcAuth & a);
     ~NamenodeProxy();
 
@@ -111,6 +116,8 @@ public:
 
     std::vector<int64_t> getFsStats();
 
+    void msync();
+
     void metaSave(const std::string & filename);
 
     FileStatus getFileInfo(const std::string & src, bool *exist);
@@ -148,14 +155,31 @@ public:
 private:
     shared_ptr<Namenode> getActiveNamenode(uint32_t & oldValue);
     void failoverToNextNamenode(uint32_t oldValue);
+    bool failoverByProbing(uint32_t oldValue);
+    int probeNamenodes();
+    void joinProbeThreads();
+    bool syncWithActive();
+    shared_ptr<Namenode> getObserverNamenode(size_t & index);
+    void failoverFromObserver(size_t index, const HdfsException & e);
 
 private:
     bool enableNamenodeHA;
+    bool parallelProbe;
     int maxNamenodeHARetry;
+    int observerRetryInterval;
+    int probeTimeout;
+    atomic<bool> synced;
     mutex mut;
+    shared_ptr<AlignmentContext> alignment;
     std::string clusterid;
     std::vector<shared_ptr<Namenode> > namenodes;
+    std::vector<shared_ptr<Namenode> > observers;
+    std::vector<shared_ptr<Namenode> > probes;
+    std::vector<shared_ptr<thread> > probeThreads;
+    std::vector<steady_clock::time_point> observerRetryTime;
     uint32_t currentNamenode;
+    size_t nextObserver;
+    uint64_t probeGeneration;
 };
 
 }
@@ -67,10 +67,14 @@ public:
     void ATTRIBUTE_NORETURN ATTRIBUTE_NOINLINE unwrap(const char * file,
             int line) {
         if (e.getErrClass() == T1::ReflexName) {
+            std::vector<void *> frames;
+            CaptureStack(1, STACK_DEPTH, frames);
+            T1 unwrapped(e.getErrMsg(), SkipPathPrefix(file), line, "");
+            unwrapped.setStackFrames(frames);
 #ifdef NEED_BOOST
-            boost::throw_exception(T1(e.getErrMsg(), SkipPathPrefix(file), line, PrintStack(1, STACK_DEPTH).c_str()));
+            boost::throw_exception(unwrapped);
 #else
-            throw T1(e.getErrMsg(), SkipPathPrefix(file), line, PrintStack(1, STACK_DEPTH).c_str());
+            throw unwrapped;
 #endif
         } else {
             BaseType::unwrap(file, line);
@@ -147,6 +151,20 @@ static inline shared_ptr<LocatedBlock> Convert(const LocatedBlockProto & proto)
         }
     }
 
+    if (proto.iscached_size() == proto.locs_size()) {
+        std::vector<bool> & cached = lb->mutableCached();
+        cached.assign(proto.iscached().begin(), proto.iscached().end());
+    }
+
+    if (proto.storagetypes_size() == proto.locs_size()) {
+        std::vector<StorageType> & types = lb->mutableStorageTypes();
+        types.resize(proto.storagetypes_size());
+
+        for (int i = 0; i < proto.storagetypes_size(); ++i) {
+            types[i] = static_cast<StorageType>(proto.storagetypes(i));
+        }
+    }
+
     Convert(*lb, proto.b());
     lb->setOffset(proto.offset());
     lb->setCorrupt(proto.corrupt());
@@ -813,6 +813,61 @@ TEST_F(TestCInterface, TestListDirectory_Success) {
     hdfsFreeFileInfo(info, num);
 }
 
+TEST_F(TestCInterface, TestOpenDirectory_InvalidInput) {
+    hdfsDir dir = NULL;
+    //test invalid input
+    dir = hdfsOpenDirectory(NULL, BASE_DIR);
+    EXPECT_TRUE(dir == NULL && EINVAL == errno);
+    dir = hdfsOpenDirectory(fs, NULL);
+    EXPECT_TRUE(dir == NULL && EINVAL == errno);
+    dir = hdfsOpenDirectory(fs, "");
+    EXPECT_TRUE(dir == NULL && EINVAL == errno);
+    dir = hdfsOpenDirectory(fs, BASE_DIR"NOTEXIST");
+    EXPECT_TRUE(dir == NULL);
+    EXPECT_EQ(ENOENT, errno);
+    EXPECT_TRUE(NULL == hdfsReadDirectory(NULL) && EINVAL == errno);
+    EXPECT_TRUE(-1 == hdfsCloseDirectory(NULL) && EINVAL == errno);
+}
+
+TEST_F(TestCInterface, TestOpenDirectory_Success) {
+    hdfsDir dir;
+    hdfsFileInfo * info;
+    int num = 0, numFiles = 3000;
+    //empty dir
+    ASSERT_EQ(0, hdfsCreateDirectory(fs, BASE_DIR"/emptyStream"));
+    dir = hdfsOpenDirectory(fs, BASE_DIR"/emptyStream");
+    ASSERT_TRUE(NULL != dir);
+    EXPECT_TRUE(NULL == hdfsReadDirectory(dir));
+    EXPECT_EQ(0, errno);
+    EXPECT_EQ(0, hdfsCloseDirectory(dir));
+    ASSERT_EQ(0, hdfsCreateDirectory(fs, BASE_DIR"/testOpenDirectoryDir"));
+    char path[1024];
+
+    for (int i = 0 ; i < numFiles ; ++i) {
+        sprintf(path, "%s/File%d", BASE_DIR"/testOpenDirectoryDir", i);
+        ASSERT_TRUE(CreateFile(fs, path, 0, 0));
+    }
+
+    dir = hdfsOpenDirectory(fs, BASE_DIR"/testOpenDirectoryDir");
+    ASSERT_TRUE(NULL != dir);
+
+    while (NULL != (info = hdfsReadDirectory(dir))) {
+        EXPECT_EQ(kObjectKindFile, info->mKind);
+        EXPECT_EQ(0, info->mSize);
+        EXPECT_TRUE(NULL != strstr(info->mName, "/testOpenDirectoryDir/File"));
+        ++num;
+    }
+
+    EXPECT_EQ(0, errno);
+    EXPECT_EQ(numFiles, num);
+    EXPECT_EQ(0, hdfsCloseDirectory(dir));
+    //close before reaching the end
+    dir = hdfsOpenDirectory(fs, BASE_DIR"/testOpenDirectoryDir");
+    ASSERT_TRUE(NULL != dir);
+    EXPECT_TRUE(NULL != hdfsReadDirectory(dir));
+    EXPECT_EQ(0, hdfsCloseDirectory(dir));
+}
+
 TEST_F(TestCInterface, TestGetPathInfo_InvalidInput) {
     hdfsFileInfo * info = NULL;
     //test invalid input
@@ -0,0 +1,246 @@
+/********************************************************************
+ * Copyright (c) 2013 - 2014, Pivotal Inc.
+ * All rights reserved.
+ *
+ * Author: Zhanwei Wang
+ ********************************************************************/
+/********************************************************************
+ * 2014 -
+ * open source under Apache License Version 2.0
+ ********************************************************************/
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "gtest/gtest.h"
+
+#include "client/BlockRangeCache.h"
+#include "client/InputStreamImpl.h"
+#include "XmlConfig.h"
+
+#include <vector>
+
+using namespace Hdfs;
+using namespace Hdfs::Internal;
+
+static BlockRangeCache::Range MakeRange(size_t size, char fill) {
+    return BlockRangeCache::Range(new std::vector<char>(size, fill));
+}
+
+static bool IsCached(BlockRangeCache & cache, int64_t offset) {
+    char c;
+    return cache.read(BlockRangeKey(1, 1001, offset), 0, &c, 1) == 1;
+}
+
+TEST(TestBlockRangeCache, ReadCachedRange) {
+    BlockRangeCache cache(1024 * 1024, 4096);
+    char buf[4096];
+    EXPECT_EQ(-1, cache.read(BlockRangeKey(1, 1001, 0), 0, buf, sizeof(buf)));
+    cache.insert(BlockRangeKey(1, 1001, 0), MakeRange(4096, 'a'));
+    EXPECT_EQ(4000, cache.read(BlockRangeKey(1, 1001, 0), 96, buf, sizeof(buf)));
+    EXPECT_EQ('a', buf[3999]);
+    EXPECT_EQ(100, cache.read(BlockRangeKey(1, 1001, 0), 0, buf, 100));
+    // another generation stamp of the same block is not served.
+    EXPECT_EQ(-1, cache.read(BlockRangeKey(1, 1002, 0), 0, buf, sizeof(buf)));
+    EXPECT_EQ(4096, cache.alignOffset(5000));
+    BlockCacheStats stats = cache.getStats();
+    EXPECT_EQ(2, stats.getHits());
+    EXPECT_EQ(2, stats.getMisses());
+    EXPECT_EQ(4100, stats.getHitBytes());
+    EXPECT_EQ(4096, stats.getMissBytes());
+    EXPECT_EQ(4096, stats.getCachedBytes());
+    EXPECT_DOUBLE_EQ(0.5, stats.getHitRatio());
+}
+
+TEST(TestBlockRangeCache, ByteBudget) {
+    BlockRangeCache cache(10 * 1024, 1024);
+
+    for (int i = 0; i < 20; ++i) {
+        cache.insert(BlockRangeKey(1, 1001, i * 1024), MakeRange(1024, 'a'));
+    }
+
+    BlockCacheStats stats = cache.getStats();
+    EXPECT_EQ(10 * 1024, stats.getCachedBytes());
+    EXPECT_EQ(10 * 1024, stats.getEvictedBytes());
+    EXPECT_FALSE(IsCached(cache, 0));
+    EXPECT_TRUE(IsCached(cache, 19 * 1024));
+    // larger than the budget, never cached.
+    cache.insert(BlockRangeKey(2, 1001, 0), MakeRange(11 * 1024, 'a'));
+    EXPECT_EQ(10 * 1024, cache.getStats().getCachedBytes());
+}
+
+TEST(TestBlockRangeCache, ScanResistant) {
+    BlockRangeCache cache(10 * 1024, 1024);
+
+    // read the hot ranges twice to protect them.
+    for (int i = 0; i < 4; ++i) {
+        cache.insert(BlockRangeKey(1, 1001, i * 1024), MakeRange(1024, 'h'));
+        EXPECT_TRUE(IsCached(cache, i * 1024));
+    }
+
+    // a scan reads every range once.
+    for (int i = 0; i < 100; ++i) {
+        cache.insert(BlockRangeKey(2, 1001, i * 1024), MakeRange(1024, 's'));
+    }
+
+    for (int i = 0; i < 4; ++i) {
+        EXPECT_TRUE(IsCached(cache, i * 1024));
+    }
+}
+
+TEST(TestBlockRangeCache, ReplaceShorterRange) {
+    BlockRangeCache cache(1024 * 1024, 4096);
+    char buf[4096];
+    cache.insert(BlockRangeKey(1, 1001, 0), MakeRange(100, 'a'));
+    EXPECT_EQ(-1, cache.read(BlockRangeKey(1, 1001, 0), 100, buf, sizeof(buf)));
+    cache.insert(BlockRangeKey(1, 1001, 0), MakeRange(200, 'b'));
+    EXPECT_EQ(100, cache.read(BlockRangeKey(1, 1001, 0), 100, buf, sizeof(buf)));
+    EXPECT_EQ('b', buf[0]);
+    EXPECT_EQ(200, cache.getStats().getCachedBytes());
+}
+
+/*
+ * A block reader over an in memory block which counts the bytes read.
+ */
+class MemoryBlockReader: public BlockReader {
+public:
+    MemoryBlockReader(const std::vector<char> & data, int64_t offset) :
+        bytesRead(0), offset(offset), data(data) {
+    }
+
+    int64_t available() {
+        return data.size() - offset;
+    }
+
+    int32_t read(char * buf, int32_t size) {
+        int32_t todo = std::min<int64_t>(size, data.size() - offset);
+        memcpy(buf, &data[offset], todo);
+        offset += todo;
+        bytesRead += todo;
+        return todo;
+    }
+
+    void skip(int64_t len) {
+        offset += len;
+    }
+
+public:
+    int64_t bytesRead;
+
+private:
+    int64_t offset;
+    const std::vector<char> & data;
+};
+
+TEST(TestBlockRangeCache, InputStreamReadsThroughCache) {
+    std::vector<char> data(10000);
+
+    for (size_t i = 0; i < data.size(); ++i) {
+        data[i] = static_cast<char>(i * 7);
+    }
+
+    BlockRangeCache cache(1024 * 1024, 4096);
+    InputStreamImpl ins;
+    LocatedBlock * lb = new LocatedBlock(0);
+    lb->setBlockId(1);
+    lb->setGenerationStamp(1001);
+    lb->setNumBytes(data.size());
+    ins.curBlock = shared_ptr<LocatedBlock>(lb);
+    ins.endOfCurBlock = data.size();
+    ins.blockCache = &cache;
+    ins.cursor = 5000;
+    MemoryBlockReader * reader = new MemoryBlockReader(data, 4096);
+    ins.blockReader = shared_ptr<BlockReader>(reader);
+    char buf[8192];
+    EXPECT_EQ(-1, ins.readFromBlockCache(buf, 100));
+    // the whole aligned range is fetched and the read served from it.
+    EXPECT_EQ(100, ins.fillBlockCache(buf, 100, 4096));
+    EXPECT_EQ(0, memcmp(buf, &data[5000], 100));
+    EXPECT_EQ(4096, reader->bytesRead);
+    EXPECT_EQ(8192, ins.blockReaderOffset);
+    EXPECT_EQ(5100, ins.cursor);
+    // the rest of the range comes from the stream's own copy.
+    EXPECT_EQ(3092, ins.readFromFilledRange(buf, sizeof(buf)));
+    EXPECT_EQ(0, memcmp(buf, &data[5100], 3092));
+    EXPECT_EQ(8192, ins.cursor);
+    // the last range is shorter than the range size.
+    EXPECT_EQ(1808, ins.fillBlockCache(buf, sizeof(buf), 8192));
+    EXPECT_EQ(0, memcmp(buf, &data[8192], 1808));
+    EXPECT_EQ(10000, ins.cursor);
+    ins.cursor = 4200;
+    EXPECT_EQ(100, ins.readFromBlockCache(buf, 100));
+    EXPECT_EQ(0, memcmp(buf, &data[4200], 100));
+    EXPECT_EQ(4096 + 1808, reader->bytesRead);
+    // bytes fetched into the cache are accounted to the reader's path.
+    EXPECT_EQ(4096 + 1808, ins.getStatistics().getRemoteBytesRead());
+}
+
+TEST(TestBlockRangeCache, SmallSequentialReadsDoNotPromote) {
+    std::vector<char> data(64 * 1024, 'x');
+    BlockRangeCache cache(1024 * 1024, 64 * 1024);
+    InputStreamImpl ins;
+    LocatedBlock * lb = new LocatedBlock(0);
+    lb->setBlockId(1);
+    lb->setGenerationStamp(1001);
+    lb->setNumBytes(data.size());
+    ins.curBlock = shared_ptr<LocatedBlock>(lb);
+    ins.endOfCurBlock = data.size();
+    ins.blockCache = &cache;
+    MemoryBlockReader * reader = new MemoryBlockReader(data, 0);
+    ins.blockReader = shared_ptr<BlockReader>(reader);
+    char buf[4096];
+
+    for (int i = 0; i < 16; ++i) {
+        EXPECT_EQ(4096, ins.readOneBlock(buf, sizeof(buf), false));
+    }
+
+    EXPECT_EQ(64 * 1024, reader->bytesRead);
+    EXPECT_EQ(64 * 1024, ins.cursor);
+    // one fill, no hit, and the range stays in probation.
+    EXPECT_FALSE(cache.entries.find(BlockRangeKey(1, 1001, 0))->second.isProtected);
+    EXPECT_EQ(0, cache.getStats().getHits());
+    EXPECT_EQ(0, ins.getStatistics().getCacheBytesRead());
+}
+
+TEST(TestBlockRangeCache, UnverifiedStreamBypassesCache) {
+    std::vector<char> data(10000, 'x');
+    BlockRangeCache cache(1024 * 1024, 4096);
+    InputStreamImpl ins;
+    LocatedBlock * lb = new LocatedBlock(0);
+    lb->setBlockId(1);
+    lb->setGenerationStamp(1001);
+    lb->setNumBytes(data.size());
+    ins.curBlock = shared_ptr<LocatedBlock>(lb);
+    ins.endOfCurBlock = data.size();
+    ins.blockCache = &cache;
+    ins.cursor = 5000;
+    ins.verify = false;
+    MemoryBlockReader * reader = new MemoryBlockReader(data, 5000);
+    ins.blockReader = shared_ptr<BlockReader>(reader);
+    char buf[100];
+    EXPECT_EQ(100, ins.readOneBlock(buf, sizeof(buf), false));
+    EXPECT_EQ(100, reader->bytesRead);
+    EXPECT_FALSE(IsCached(cache, 4096));
+    // a verifying stream fills the cache.
+    ins.verify = true;
+    ins.cursor = 5000;
+    ins.blockReaderOffset = 4096;
+    reader = new MemoryBlockReader(data, 4096);
+    ins.blockReader = shared_ptr<BlockReader>(reader);
+    EXPECT_EQ(100, ins.readOneBlock(buf, sizeof(buf), false));
+    EXPECT_EQ(4096, reader->bytesRead);
+    EXPECT_TRUE(IsCached(cache, 4096));
+}
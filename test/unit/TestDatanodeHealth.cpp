@@ -0,0 +1,206 @@
+/********************************************************************
+ * Copyright (c) 2013 - 2014, Pivotal Inc.
+ * All rights reserved.
+ *
+ * Author: Zhanwei Wang
+ ********************************************************************/
+/********************************************************************
+ * 2014 -
+ * open source under Apache License Version 2.0
+ ********************************************************************/
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "gtest/gtest.h"
+
+#include "client/DatanodeHealth.h"
+#include "client/ReplicaRanker.h"
+#include "XmlConfig.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace Hdfs;
+using namespace Hdfs::Internal;
+
+static DatanodeInfo MakeDatanode(const char * ip, int port) {
+    DatanodeInfo dn;
+    dn.setIpAddr(ip);
+    dn.setHostName(ip);
+    dn.setXferPort(port);
+    dn.setDatanodeId(ip);
+    return dn;
+}
+
+static void Configure(DatanodeHealth & health, int suppressMin, int probeInterval) {
+    Config c;
+    c.set("dfs.client.datanode.health.suppress.min", suppressMin);
+    c.set("dfs.client.datanode.health.suppress.max", 60 * 1000);
+    c.set("dfs.client.datanode.health.probe.interval", probeInterval);
+    c.set("input.connect.timeout", 1000);
+    SessionConfig conf(c);
+    health.configure(conf);
+}
+
+TEST(TestDatanodeHealth, SuppressAfterFailure) {
+    DatanodeHealth health;
+    Configure(health, 60 * 1000, 0);
+    DatanodeInfo dn = MakeDatanode("10.0.0.1", 50010);
+    EXPECT_FALSE(health.isSuppressed(dn));
+    health.recordFailure(dn);
+    EXPECT_TRUE(health.isSuppressed(dn));
+    EXPECT_FALSE(health.isSuppressed(MakeDatanode("10.0.0.1", 50011)));
+    ASSERT_EQ(1u, health.getSuppressedNodes().size());
+    EXPECT_EQ("10.0.0.1:50010", health.getSuppressedNodes()[0].getXferAddr());
+    // accepting connections does not prove a timed out node works.
+    health.recordConnect(dn, 100);
+    health.recordProbe(dn, 100);
+    EXPECT_TRUE(health.isSuppressed(dn));
+}
+
+TEST(TestDatanodeHealth, ProbeLiftsConnectFailure) {
+    DatanodeHealth health;
+    Configure(health, 60 * 1000, 0);
+    DatanodeInfo dn = MakeDatanode("10.0.0.1", 50010);
+    health.recordConnectFailure(dn);
+    EXPECT_TRUE(health.isSuppressed(dn));
+    health.recordConnect(dn, 100);
+    EXPECT_TRUE(health.isSuppressed(dn));
+    health.recordProbe(dn, 100);
+    EXPECT_FALSE(health.isSuppressed(dn));
+    EXPECT_TRUE(health.getSuppressedNodes().empty());
+}
+
+TEST(TestDatanodeHealth, SuppressionExpires) {
+    DatanodeHealth health;
+    Configure(health, 20, 0);
+    DatanodeInfo dn = MakeDatanode("10.0.0.1", 50010);
+    health.recordFailure(dn);
+    EXPECT_TRUE(health.isSuppressed(dn));
+    usleep(60 * 1000);
+    EXPECT_FALSE(health.isSuppressed(dn));
+}
+
+TEST(TestDatanodeHealth, BackoffGrowsWithRecentFailures) {
+    DatanodeHealth health;
+    Configure(health, 1000, 0);
+    DatanodeInfo dn = MakeDatanode("10.0.0.1", 50010);
+
+    for (int i = 0; i < 4; ++i) {
+        health.recordFailure(dn);
+    }
+
+    DatanodeHealth::NodeHealth & h = health.nodes[dn.getXferAddr()];
+    int64_t left = duration_cast<milliseconds>(
+                       h.suppressedUntil - steady_clock::now()).count();
+    EXPECT_GT(left, 7000);
+    EXPECT_LE(left, 8000);
+}
+
+TEST(TestDatanodeHealth, ExpectedLatency) {
+    DatanodeHealth health;
+    DatanodeInfo dn = MakeDatanode("10.0.0.1", 50010);
+    EXPECT_EQ(-1, health.getExpectedLatency(dn));
+    health.recordConnect(dn, 1000);
+    EXPECT_EQ(-1, health.getExpectedLatency(dn));
+    health.recordFirstByte(dn, 3000);
+    EXPECT_EQ(4000, health.getExpectedLatency(dn));
+    health.recordConnect(dn, 5000);
+    EXPECT_EQ(5000, health.getExpectedLatency(dn));
+}
+
+TEST(TestDatanodeHealth, ProbeLiftsSuppression) {
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    ASSERT_EQ(0, ::bind(fd, (struct sockaddr *) &addr, sizeof(addr)));
+    ASSERT_EQ(0, ::listen(fd, 4));
+    socklen_t len = sizeof(addr);
+    getsockname(fd, (struct sockaddr *) &addr, &len);
+    DatanodeHealth health;
+    Configure(health, 60 * 1000, 20);
+    DatanodeInfo dn = MakeDatanode("127.0.0.1", ntohs(addr.sin_port));
+    health.recordConnectFailure(dn);
+    EXPECT_TRUE(health.isSuppressed(dn));
+
+    for (int i = 0; i < 100 && health.isSuppressed(dn); ++i) {
+        usleep(10 * 1000);
+    }
+
+    EXPECT_FALSE(health.isSuppressed(dn));
+    ::close(fd);
+}
+
+TEST(TestDatanodeHealth, ProbeKeepsTimedOutNodeSuppressed) {
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    ASSERT_EQ(0, ::bind(fd, (struct sockaddr *) &addr, sizeof(addr)));
+    ASSERT_EQ(0, ::listen(fd, 16));
+    socklen_t len = sizeof(addr);
+    getsockname(fd, (struct sockaddr *) &addr, &len);
+    DatanodeHealth health;
+    Configure(health, 60 * 1000, 20);
+    DatanodeInfo dn = MakeDatanode("127.0.0.1", ntohs(addr.sin_port));
+    DatanodeInfo other = MakeDatanode("127.0.0.1", 1);
+    // keep the prober running while the node accepts connections but its
+    // reads keep timing out.
+    health.recordConnectFailure(other);
+    health.recordConnectFailure(dn);
+
+    for (int i = 0; i < 5; ++i) {
+        health.recordFailure(dn);
+        usleep(20 * 1000);
+    }
+
+    usleep(100 * 1000);
+    EXPECT_TRUE(health.isSuppressed(dn));
+    ::close(fd);
+}
+
+TEST(TestDatanodeHealth, RankerAvoidsSuppressedNodes) {
+    DatanodeHealth health;
+    Configure(health, 60 * 1000, 0);
+    Config c;
+    SessionConfig conf(c);
+    ReplicaRanker ranker(conf, &health);
+    LocatedBlock lb;
+    lb.mutableLocations().push_back(MakeDatanode("10.0.0.1", 50010));
+    lb.mutableLocations().push_back(MakeDatanode("10.0.0.2", 50010));
+    lb.mutableLocations().push_back(MakeDatanode("10.0.0.3", 50010));
+    unordered_set<std::string> localAddrs;
+    std::vector<DatanodeInfo> failedNodes;
+    EXPECT_EQ(0, ranker.choose(lb, failedNodes, localAddrs));
+    health.recordFailure(lb.getLocations()[0]);
+    EXPECT_EQ(1, ranker.choose(lb, failedNodes, localAddrs));
+    // a much faster replica wins a tie.
+    health.recordConnect(lb.getLocations()[1], 10000);
+    health.recordFirstByte(lb.getLocations()[1], 10000);
+    health.recordConnect(lb.getLocations()[2], 1000);
+    health.recordFirstByte(lb.getLocations()[2], 1000);
+    EXPECT_EQ(2, ranker.choose(lb, failedNodes, localAddrs));
+    // only suppressed replicas are left.
+    health.recordFailure(lb.getLocations()[1]);
+    health.recordFailure(lb.getLocations()[2]);
+    EXPECT_EQ(0, ranker.choose(lb, failedNodes, localAddrs));
+}
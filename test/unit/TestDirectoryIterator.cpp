@@ -0,0 +1,226 @@
+/********************************************************************
+ * Copyright (c) 2013 - 2014, Pivotal Inc.
+ * All rights reserved.
+ *
+ * Author: Zhanwei Wang
+ ********************************************************************/
+/********************************************************************
+ * 2014 -
+ * open source under Apache License Version 2.0
+ ********************************************************************/
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+
+#include "client/DirectoryIterator.h"
+#include "client/FileSystemImpl.h"
+#include "DateTime.h"
+#include "Exception.h"
+#include "ExceptionInternal.h"
+#include "MockNamenode.h"
+#include "Thread.h"
+#include "XmlConfig.h"
+
+#include <cstdio>
+
+using namespace Hdfs;
+using namespace Hdfs::Internal;
+using namespace Hdfs::Mock;
+using namespace testing;
+
+class ListingPages {
+public:
+    ListingPages(int numEntries, int pageSize) :
+        failAt(-1), hold(false), numEntries(numEntries), pageSize(pageSize),
+        waiting(0) {
+    }
+
+    bool getListing(const std::string & src, const std::string & startAfter,
+                    bool needLocation, std::vector<FileStatus> & dl) {
+        int start = 0;
+
+        if (!startAfter.empty()) {
+            start = atoi(startAfter.c_str() + startAfter.find_last_of('f') + 1) + 1;
+        }
+
+        if (start == failAt) {
+            THROW(HdfsIOException, "injected failure");
+        }
+
+        if (start > 0) {
+            holdPage();
+        }
+
+        for (int i = start; i < numEntries && i < start + pageSize; ++i) {
+            char name[64];
+            snprintf(name, sizeof(name), "/dir/f%06d", i);
+            FileStatus status;
+            status.setPath(name);
+            dl.push_back(status);
+        }
+
+        return start + pageSize < numEntries;
+    }
+
+    /*
+     * Keep the requests for pages but the first pending until release,
+     * give up after a while in case nobody releases them.
+     */
+    void setHold(bool hold) {
+        lock_guard<mutex> lock(mut);
+        this->hold = hold;
+        cond.notify_all();
+    }
+
+    int getWaiting() {
+        lock_guard<mutex> lock(mut);
+        return waiting;
+    }
+
+    void waitForRequest() {
+        unique_lock<mutex> lock(mut);
+
+        while (waiting == 0) {
+            cond.wait(lock);
+        }
+    }
+
+private:
+    void holdPage() {
+        unique_lock<mutex> lock(mut);
+        steady_clock::time_point deadline = steady_clock::now() + seconds(10);
+        ++waiting;
+        cond.notify_all();
+
+        while (hold && steady_clock::now() < deadline) {
+            cond.wait_for(lock, milliseconds(100));
+        }
+
+        --waiting;
+    }
+
+public:
+    int failAt;
+
+private:
+    bool hold;
+    condition_variable cond;
+    int numEntries;
+    int pageSize;
+    int waiting;
+    mutex mut;
+};
+
+class TestDirectoryIterator: public ::testing::Test {
+public:
+    TestDirectoryIterator() :
+        fs(FileSystemKey("hdfs://localhost:9000", "user"), Config()),
+        namenode(new NiceMock<MockNamenode>) {
+        fs.nn = namenode;
+    }
+
+protected:
+    FileSystemImpl fs;
+    NiceMock<MockNamenode> * namenode;
+};
+
+static void VerifyListing(DirectoryIterator & it, int numEntries) {
+    int count = 0;
+
+    while (it.hasNext()) {
+        char name[64];
+        snprintf(name, sizeof(name), "/dir/f%06d", count++);
+        EXPECT_STREQ(name, it.getNext().getPath());
+    }
+
+    EXPECT_EQ(numEntries, count);
+    EXPECT_THROW(it.getNext(), HdfsIOException);
+}
+
+TEST_F(TestDirectoryIterator, ListWithoutPrefetch) {
+    ListingPages pages(10, 3);
+    EXPECT_CALL(*namenode, getListing(_, _, _, _)).WillRepeatedly(
+        Invoke(&pages, &ListingPages::getListing));
+    DirectoryIterator it(&fs, "/dir", false, false);
+    VerifyListing(it, 10);
+}
+
+TEST_F(TestDirectoryIterator, ListWithPrefetch) {
+    ListingPages pages(1000, 7);
+    EXPECT_CALL(*namenode, getListing(_, _, _, _)).WillRepeatedly(
+        Invoke(&pages, &ListingPages::getListing));
+    DirectoryIterator it(&fs, "/dir", false, true);
+    VerifyListing(it, 1000);
+}
+
+TEST_F(TestDirectoryIterator, CopyWhilePrefetching) {
+    ListingPages pages(20, 4);
+    EXPECT_CALL(*namenode, getListing(_, _, _, _)).WillRepeatedly(
+        Invoke(&pages, &ListingPages::getListing));
+    DirectoryIterator it(&fs, "/dir", false, true);
+    ASSERT_TRUE(it.hasNext());
+    DirectoryIterator copy(it);
+    VerifyListing(it, 20);
+    VerifyListing(copy, 20);
+    copy = DirectoryIterator(&fs, "/dir", false, true);
+    ASSERT_TRUE(copy.hasNext());
+    copy = it;
+    EXPECT_FALSE(copy.hasNext());
+    // wait for the abandoned prefetch, it still reads pages.
+    fs.disconnect();
+}
+
+TEST_F(TestDirectoryIterator, PrefetchFailure) {
+    ListingPages pages(20, 4);
+    pages.failAt = 8;
+    EXPECT_CALL(*namenode, getListing(_, _, _, _)).WillRepeatedly(
+        Invoke(&pages, &ListingPages::getListing));
+    DirectoryIterator it(&fs, "/dir", false, true);
+
+    for (int i = 0; i < 8; ++i) {
+        ASSERT_TRUE(it.hasNext());
+        it.getNext();
+    }
+
+    EXPECT_THROW(it.hasNext(), HdfsIOException);
+    pages.failAt = -1;
+    ASSERT_TRUE(it.hasNext());
+    EXPECT_STREQ("/dir/f000008", it.getNext().getPath());
+    it = DirectoryIterator();
+    // wait for the abandoned prefetch, it still reads pages.
+    fs.disconnect();
+}
+
+TEST_F(TestDirectoryIterator, CloseDoesNotWaitForPrefetch) {
+    ListingPages pages(20, 4);
+    pages.setHold(true);
+    EXPECT_CALL(*namenode, getListing(_, _, _, _)).WillRepeatedly(
+        Invoke(&pages, &ListingPages::getListing));
+    {
+        DirectoryIterator it(&fs, "/dir", false, true);
+        ASSERT_TRUE(it.hasNext());
+        pages.waitForRequest();
+    }
+    // the iterator is gone while the prefetch is still pending.
+    EXPECT_EQ(1, pages.getWaiting());
+    pages.setHold(false);
+    // the abandoned request is over before the namenode goes away.
+    fs.disconnect();
+    EXPECT_EQ(0, pages.getWaiting());
+}
@@ -120,3 +120,33 @@ TEST(TestException, NestedErrorDetails) {
         std::cout << GetExceptionDetail(e, buffer) << std::endl;
     }
 }
+
+TEST(TestException, SymbolizeStackLazily) {
+    try {
+        THROW(HdfsIOException, "hello world %d", 123);
+    } catch (const HdfsException & e) {
+        EXPECT_FALSE(e.frames.empty());
+        EXPECT_TRUE(e.detail.empty());
+        std::string detail = e.msg();
+        EXPECT_EQ(0u, detail.find("TestException.cpp: "));
+        EXPECT_NE(std::string::npos, detail.find("hello world 123"));
+        EXPECT_NE(std::string::npos, detail.find(DEFAULT_STACK_PREFIX));
+        EXPECT_EQ(detail, e.msg());
+        return;
+    }
+
+    ASSERT_TRUE(false);
+}
+
+TEST(TestException, EndOfStreamWithoutStack) {
+    try {
+        THROW(HdfsEndOfStream, "end of stream %d", 123);
+    } catch (const HdfsEndOfStream & e) {
+        EXPECT_TRUE(e.frames.empty());
+        EXPECT_NE(std::string::npos,
+                  std::string(e.msg()).find("end of stream 123"));
+        return;
+    }
+
+    ASSERT_TRUE(false);
+}
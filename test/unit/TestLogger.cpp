@@ -0,0 +1,147 @@
+/********************************************************************
+ * Copyright (c) 2013 - 2014, Pivotal Inc.
+ * All rights reserved.
+ *
+ * Author: Zhanwei Wang
+ ********************************************************************/
+/********************************************************************
+ * 2014 -
+ * open source under Apache License Version 2.0
+ ********************************************************************/
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "gtest/gtest.h"
+
+#include "Function.h"
+#include "Logger.h"
+#include "Memory.h"
+#include "Thread.h"
+
+#include <cstdio>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+using namespace Hdfs;
+using namespace Hdfs::Internal;
+
+class TestLogger: public ::testing::Test {
+public:
+    virtual void SetUp() {
+        file = tmpfile();
+        ASSERT_TRUE(file != NULL);
+        RootLogger.setOutputFd(fileno(file));
+        RootLogger.setLogSeverity(INFO);
+    }
+
+    virtual void TearDown() {
+        RootLogger.setAsync(false);
+        RootLogger.setOutputFd(STDERR_FILENO);
+        RootLogger.setLogSeverity(DEFAULT_LOG_LEVEL);
+        fclose(file);
+    }
+
+    std::vector<std::string> readLines() {
+        std::vector<std::string> lines;
+        std::string content;
+        char buffer[4096];
+        size_t rc;
+        rewind(file);
+
+        while ((rc = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+            content.append(buffer, rc);
+        }
+
+        size_t start = 0, end;
+
+        while ((end = content.find('\n', start)) != std::string::npos) {
+            lines.push_back(content.substr(start, end - start));
+            start = end + 1;
+        }
+
+        return lines;
+    }
+
+protected:
+    FILE * file;
+};
+
+static int Evaluated = 0;
+
+static int CountEvaluation() {
+    return ++Evaluated;
+}
+
+TEST_F(TestLogger, DisabledSeverityDoesNotEvaluateArguments) {
+    Evaluated = 0;
+    LOG(DEBUG1, "value %d", CountEvaluation());
+    EXPECT_EQ(0, Evaluated);
+    LOG(INFO, "value %d", CountEvaluation());
+    EXPECT_EQ(1, Evaluated);
+    std::vector<std::string> lines = readLines();
+    ASSERT_EQ(1u, lines.size());
+    EXPECT_NE(std::string::npos, lines[0].find("INFO value 1"));
+}
+
+TEST_F(TestLogger, LongMessage) {
+    std::string message(5000, 'x');
+    LOG(INFO, "%s|end", message.c_str());
+    std::vector<std::string> lines = readLines();
+    ASSERT_EQ(1u, lines.size());
+    EXPECT_NE(std::string::npos, lines[0].find(message + "|end"));
+}
+
+static void LogMessages(int id, int count) {
+    for (int i = 0; i < count; ++i) {
+        LOG(INFO, "thread %d message %d", id, i);
+    }
+}
+
+TEST_F(TestLogger, AsyncDeliversMessages) {
+    const int threads = 4, count = 1000;
+    unsigned long dropped = RootLogger.getDroppedMessages();
+    RootLogger.setAsync(true);
+    EXPECT_TRUE(RootLogger.isAsync());
+    std::vector<shared_ptr<thread> > workers;
+
+    for (int i = 0; i < threads; ++i) {
+        workers.push_back(shared_ptr<thread>(new thread(bind(&LogMessages, i, count))));
+    }
+
+    for (size_t i = 0; i < workers.size(); ++i) {
+        workers[i]->join();
+    }
+
+    RootLogger.setAsync(false);
+    EXPECT_FALSE(RootLogger.isAsync());
+    dropped = RootLogger.getDroppedMessages() - dropped;
+    std::vector<std::string> lines = readLines();
+    size_t messages = 0;
+
+    for (size_t i = 0; i < lines.size(); ++i) {
+        if (lines[i].find("INFO thread ") != std::string::npos) {
+            ++messages;
+        }
+    }
+
+    EXPECT_EQ(static_cast<size_t>(threads * count), messages + dropped);
+    // synchronous writes still work once the writer is stopped.
+    LOG(INFO, "after async");
+    lines = readLines();
+    EXPECT_NE(std::string::npos, lines.back().find("INFO after async"));
+}
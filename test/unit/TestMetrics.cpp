@@ -0,0 +1,122 @@
+/********************************************************************
+ * Copyright (c) 2013 - 2014, Pivotal Inc.
+ * All rights reserved.
+ *
+ * Author: Zhanwei Wang
+ ********************************************************************/
+/********************************************************************
+ * 2014 -
+ * open source under Apache License Version 2.0
+ ********************************************************************/
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "gtest/gtest.h"
+
+#include "Metrics.h"
+
+#include <string>
+
+using namespace Hdfs::Internal;
+
+TEST(TestMetrics, HistogramBuckets) {
+    for (int64_t v = 0; v < 100000; v += 7) {
+        int index = Histogram::BucketIndex(v);
+        EXPECT_LE(v, Histogram::BucketUpperBound(index));
+
+        if (index > 0) {
+            EXPECT_GT(v, Histogram::BucketUpperBound(index - 1));
+        }
+    }
+
+    EXPECT_EQ(Histogram::NumBuckets - 1, Histogram::BucketIndex(INT64_MAX));
+    EXPECT_EQ(0, Histogram::BucketIndex(-1));
+}
+
+TEST(TestMetrics, HistogramPercentiles) {
+    Histogram h;
+
+    for (int64_t v = 1; v <= 1000; ++v) {
+        h.record(v);
+    }
+
+    EXPECT_EQ(1000, h.getCount());
+    EXPECT_EQ(500500, h.getSum());
+    EXPECT_EQ(1000, h.getMax());
+    std::vector<int64_t> buckets;
+    h.getBuckets(buckets);
+    // within the 12.5% precision of a bucket.
+    int64_t p50 = Histogram::Percentile(buckets, 0.5);
+    EXPECT_GE(p50, 500);
+    EXPECT_LE(p50, 500 * 9 / 8);
+    int64_t p99 = Histogram::Percentile(buckets, 0.99);
+    EXPECT_GE(p99, 990);
+    EXPECT_LE(p99, 990 * 9 / 8);
+}
+
+TEST(TestMetrics, RegistryLookup) {
+    MetricsRegistry registry;
+    Counter & c = registry.counter("test_total", "A test counter.", "method", "a");
+    c.add(3);
+    EXPECT_EQ(&c, &registry.counter("test_total", NULL, "method", "a"));
+    EXPECT_NE(&c, &registry.counter("test_total", NULL, "method", "b"));
+    EXPECT_EQ(3, registry.counter("test_total", NULL, "method", "a").get());
+    registry.gauge("test_gauge", "A test gauge.").set(-2);
+    registry.histogram("test_latency", "A test histogram.").record(100);
+    std::vector<MetricSnapshot> snapshot = registry.snapshot();
+    ASSERT_EQ(4u, snapshot.size());
+    EXPECT_EQ("test_gauge", snapshot[0].name);
+    EXPECT_EQ(-2, snapshot[0].value);
+    EXPECT_EQ("test_latency", snapshot[1].name);
+    EXPECT_EQ(1, snapshot[1].count);
+    EXPECT_EQ(100, snapshot[1].p50);
+    EXPECT_EQ("a", snapshot[2].labelValue);
+    EXPECT_EQ("A test counter.", snapshot[2].help);
+    EXPECT_EQ(3, snapshot[2].value);
+    EXPECT_EQ("b", snapshot[3].labelValue);
+}
+
+TEST(TestMetrics, RegistryOverflow) {
+    MetricsRegistry registry;
+    char name[32];
+
+    for (size_t i = 0; i < MetricsRegistry::TableSize; ++i) {
+        snprintf(name, sizeof(name), "test_%zu", i);
+        registry.counter(name, NULL).add();
+    }
+
+    Counter & overflow = registry.counter("test_overflow", NULL);
+    EXPECT_EQ(&overflow, &registry.counter("test_another_overflow", NULL));
+    EXPECT_EQ(MetricsRegistry::TableSize, registry.snapshot().size());
+}
+
+TEST(TestMetrics, Export) {
+    MetricsRegistry registry;
+    registry.counter("test_total", "A test counter.", "method", "get\"File").add(2);
+    registry.histogram("test_latency", "A test histogram.").record(10);
+    std::string text = registry.toPrometheus();
+    EXPECT_NE(std::string::npos, text.find("# TYPE test_total counter\n"));
+    EXPECT_NE(std::string::npos, text.find("test_total{method=\"get\\\"File\"} 2\n"));
+    EXPECT_NE(std::string::npos, text.find("# TYPE test_latency summary\n"));
+    EXPECT_NE(std::string::npos, text.find("test_latency{quantile=\"0.99\"} 10\n"));
+    EXPECT_NE(std::string::npos, text.find("test_latency_count 1\n"));
+    std::string json = registry.toJson();
+    EXPECT_EQ("{\"metrics\":[{\"name\":\"test_latency\",\"type\":\"histogram\","
+              "\"count\":1,\"sum\":10,\"max\":10,\"p50\":10,\"p90\":10,\"p99\":10,\"p999\":10},"
+              "{\"name\":\"test_total\",\"type\":\"counter\",\"labels\":{\"method\":\"get\\\"File\"},"
+              "\"value\":2}]}", json);
+}
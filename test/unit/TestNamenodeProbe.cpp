@@ -0,0 +1,186 @@
+/********************************************************************
+ * Copyright (c) 2013 - 2014, Pivotal Inc.
+ * All rights reserved.
+ *
+ * Author: Zhanwei Wang
+ ********************************************************************/
+/********************************************************************
+ * 2014 -
+ * open source under Apache License Version 2.0
+ ********************************************************************/
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+
+#include "Exception.h"
+#include "ExceptionInternal.h"
+#include "MockNamenode.h"
+#include "server/NamenodeProxy.h"
+#include "SessionConfig.h"
+#include "XmlConfig.h"
+
+#include <unistd.h>
+
+using namespace Hdfs;
+using namespace Hdfs::Internal;
+using namespace Hdfs::Mock;
+using namespace testing;
+
+static std::vector<NamenodeInfo> MakeNamenodeInfos(int count) {
+    std::vector<NamenodeInfo> infos(count);
+
+    for (int i = 0; i < count; ++i) {
+        char addr[64];
+        snprintf(addr, sizeof(addr), "nn%d:9000", i);
+        infos[i].setRpcAddr(addr);
+    }
+
+    return infos;
+}
+
+static void ThrowStandby() {
+    THROW(NameNodeStandbyException, "Operation category READ is not supported in state standby");
+}
+
+static void ThrowConnectFailure() {
+    THROW(HdfsNetworkConnectException, "Connection refused");
+}
+
+static std::vector<int64_t> DelayedFsStats() {
+    usleep(500 * 1000);
+    return std::vector<int64_t>(6);
+}
+
+class TestNamenodeProbe: public ::testing::Test {
+public:
+    TestNamenodeProbe() {
+        char id[64];
+        snprintf(id, sizeof(id), "test_namenode_probe_%d_%s", getpid(),
+                 ::testing::UnitTest::GetInstance()->current_test_info()->name());
+        clusterid = id;
+        unlink(("/tmp/" + clusterid).c_str());
+        Config conf;
+        conf.set("dfs.client.failover.parallel-probe", true);
+        conf.set("dfs.client.failover.probe.timeout", 1000);
+        sconf = shared_ptr<SessionConfig>(new SessionConfig(conf));
+    }
+
+    ~TestNamenodeProbe() {
+        unlink(("/tmp/" + clusterid).c_str());
+    }
+
+    shared_ptr<NamenodeProxy> createProxy(std::vector<NiceMock<MockNamenode> *> & namenodes,
+                                          std::vector<NiceMock<MockNamenode> *> & probes) {
+        shared_ptr<NamenodeProxy> proxy(new NamenodeProxy(MakeNamenodeInfos(3),
+                                        std::vector<NamenodeInfo>(), clusterid, *sconf, RpcAuth()));
+
+        for (size_t i = 0; i < proxy->namenodes.size(); ++i) {
+            namenodes.push_back(new NiceMock<MockNamenode>);
+            proxy->namenodes[i] = shared_ptr<Namenode>(namenodes[i]);
+            probes.push_back(new NiceMock<MockNamenode>);
+            proxy->probes[i] = shared_ptr<Namenode>(probes[i]);
+        }
+
+        return proxy;
+    }
+
+protected:
+    std::string clusterid;
+    shared_ptr<SessionConfig> sconf;
+};
+
+TEST_F(TestNamenodeProbe, FailoverToProbedNamenode) {
+    std::vector<NiceMock<MockNamenode> *> namenodes, probes;
+    shared_ptr<NamenodeProxy> proxy = createProxy(namenodes, probes);
+    EXPECT_CALL(*namenodes[0], getFsStats()).Times(1).WillOnce(
+        DoAll(InvokeWithoutArgs(&ThrowStandby), Return(std::vector<int64_t>())));
+    EXPECT_CALL(*namenodes[1], getFsStats()).Times(0);
+    EXPECT_CALL(*namenodes[2], getFsStats()).Times(1).WillOnce(Return(std::vector<int64_t>(6)));
+    EXPECT_CALL(*probes[0], getFsStats()).WillRepeatedly(
+        DoAll(InvokeWithoutArgs(&ThrowStandby), Return(std::vector<int64_t>())));
+    EXPECT_CALL(*probes[1], getFsStats()).WillRepeatedly(
+        DoAll(InvokeWithoutArgs(&ThrowConnectFailure), Return(std::vector<int64_t>())));
+    EXPECT_CALL(*probes[2], getFsStats()).Times(1).WillOnce(Return(std::vector<int64_t>(6)));
+    EXPECT_NO_THROW(proxy->getFsStats());
+    EXPECT_EQ(2u, proxy->currentNamenode);
+}
+
+TEST_F(TestNamenodeProbe, FirstReplyWins) {
+    std::vector<NiceMock<MockNamenode> *> namenodes, probes;
+    shared_ptr<NamenodeProxy> proxy = createProxy(namenodes, probes);
+    EXPECT_CALL(*namenodes[0], getFsStats()).Times(1).WillOnce(
+        DoAll(InvokeWithoutArgs(&ThrowStandby), Return(std::vector<int64_t>())));
+    EXPECT_CALL(*namenodes[1], getFsStats()).Times(1).WillOnce(Return(std::vector<int64_t>(6)));
+    EXPECT_CALL(*probes[0], getFsStats()).WillRepeatedly(
+        DoAll(InvokeWithoutArgs(&ThrowStandby), Return(std::vector<int64_t>())));
+    EXPECT_CALL(*probes[1], getFsStats()).WillRepeatedly(Return(std::vector<int64_t>(6)));
+    EXPECT_CALL(*probes[2], getFsStats()).WillRepeatedly(Invoke(&DelayedFsStats));
+    EXPECT_NO_THROW(proxy->getFsStats());
+    EXPECT_EQ(1u, proxy->currentNamenode);
+}
+
+TEST_F(TestNamenodeProbe, ShareActiveNamenodeInProcess) {
+    std::vector<NiceMock<MockNamenode> *> namenodes1, probes1, namenodes2, probes2;
+    shared_ptr<NamenodeProxy> proxy1 = createProxy(namenodes1, probes1);
+    shared_ptr<NamenodeProxy> proxy2 = createProxy(namenodes2, probes2);
+    EXPECT_CALL(*namenodes1[0], getFsStats()).Times(1).WillOnce(
+        DoAll(InvokeWithoutArgs(&ThrowStandby), Return(std::vector<int64_t>())));
+    EXPECT_CALL(*namenodes1[2], getFsStats()).Times(1).WillOnce(Return(std::vector<int64_t>(6)));
+    EXPECT_CALL(*probes1[2], getFsStats()).WillRepeatedly(Return(std::vector<int64_t>(6)));
+    EXPECT_CALL(*probes1[0], getFsStats()).WillRepeatedly(
+        DoAll(InvokeWithoutArgs(&ThrowStandby), Return(std::vector<int64_t>())));
+    EXPECT_CALL(*probes1[1], getFsStats()).WillRepeatedly(
+        DoAll(InvokeWithoutArgs(&ThrowStandby), Return(std::vector<int64_t>())));
+    EXPECT_NO_THROW(proxy1->getFsStats());
+    /*
+     * the second proxy adopts the probed result without probing again.
+     */
+    EXPECT_CALL(*namenodes2[0], getFsStats()).Times(1).WillOnce(
+        DoAll(InvokeWithoutArgs(&ThrowStandby), Return(std::vector<int64_t>())));
+    EXPECT_CALL(*namenodes2[2], getFsStats()).Times(1).WillOnce(Return(std::vector<int64_t>(6)));
+    EXPECT_CALL(*probes2[0], getFsStats()).Times(0);
+    EXPECT_CALL(*probes2[1], getFsStats()).Times(0);
+    EXPECT_CALL(*probes2[2], getFsStats()).Times(0);
+    EXPECT_NO_THROW(proxy2->getFsStats());
+    /*
+     * a new proxy starts with the shared active Namenode.
+     */
+    std::vector<NiceMock<MockNamenode> *> namenodes3, probes3;
+    shared_ptr<NamenodeProxy> proxy3 = createProxy(namenodes3, probes3);
+    EXPECT_EQ(2u, proxy3->currentNamenode);
+}
+
+TEST_F(TestNamenodeProbe, NoActiveNamenodeFound) {
+    std::vector<NiceMock<MockNamenode> *> namenodes, probes;
+    shared_ptr<NamenodeProxy> proxy = createProxy(namenodes, probes);
+    EXPECT_CALL(*namenodes[0], getFsStats()).Times(1).WillOnce(
+        DoAll(InvokeWithoutArgs(&ThrowStandby), Return(std::vector<int64_t>())));
+    EXPECT_CALL(*namenodes[1], getFsStats()).Times(1).WillOnce(Return(std::vector<int64_t>(6)));
+
+    for (size_t i = 0; i < probes.size(); ++i) {
+        EXPECT_CALL(*probes[i], getFsStats()).WillRepeatedly(
+            DoAll(InvokeWithoutArgs(&ThrowStandby), Return(std::vector<int64_t>())));
+    }
+
+    /*
+     * fall back to try the next Namenode.
+     */
+    EXPECT_NO_THROW(proxy->getFsStats());
+    EXPECT_EQ(1u, proxy->currentNamenode);
+}
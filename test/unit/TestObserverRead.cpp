@@ -0,0 +1,194 @@
+/********************************************************************
+ * Copyright (c) 2013 - 2014, Pivotal Inc.
+ * All rights reserved.
+ *
+ * Author: Zhanwei Wang
+ ********************************************************************/
+/********************************************************************
+ * 2014 -
+ * open source under Apache License Version 2.0
+ ********************************************************************/
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+
+#include "Exception.h"
+#include "ExceptionInternal.h"
+#include "MockNamenode.h"
+#include "rpc/AlignmentContext.h"
+#include "server/NamenodeProxy.h"
+#include "SessionConfig.h"
+#include "XmlConfig.h"
+
+using namespace Hdfs;
+using namespace Hdfs::Internal;
+using namespace Hdfs::Mock;
+using namespace testing;
+
+static std::vector<NamenodeInfo> MakeNamenodeInfos(const char * host, int count) {
+    std::vector<NamenodeInfo> infos(count);
+
+    for (int i = 0; i < count; ++i) {
+        char addr[64];
+        snprintf(addr, sizeof(addr), "%s%d:9000", host, i);
+        infos[i].setRpcAddr(addr);
+    }
+
+    return infos;
+}
+
+static void ThrowStandby() {
+    THROW(NameNodeStandbyException, "Operation category READ is not supported in state standby");
+}
+
+static void ThrowFileNotFound() {
+    THROW(FileNotFoundException, "file not found");
+}
+
+class TestObserverRead: public ::testing::Test {
+public:
+    TestObserverRead() :
+        active(new NiceMock<MockNamenode>) {
+        Config conf;
+        conf.set("dfs.client.failover.observer.retry.interval", 60 * 1000);
+        SessionConfig sconf(conf);
+        proxy = shared_ptr<NamenodeProxy>(new NamenodeProxy(
+            MakeNamenodeInfos("active", 1), MakeNamenodeInfos("observer", 2),
+            "test_observer_read", sconf, RpcAuth()));
+        proxy->namenodes[0] = shared_ptr<Namenode>(active);
+
+        for (size_t i = 0; i < proxy->observers.size(); ++i) {
+            observers.push_back(new NiceMock<MockNamenode>);
+            proxy->observers[i] = shared_ptr<Namenode>(observers[i]);
+        }
+    }
+
+protected:
+    NiceMock<MockNamenode> * active;
+    shared_ptr<NamenodeProxy> proxy;
+    std::vector<NiceMock<MockNamenode> *> observers;
+};
+
+TEST_F(TestObserverRead, ReadFromObserver) {
+    bool exist;
+    EXPECT_CALL(*active, getFileInfo(_, _)).Times(0);
+    EXPECT_CALL(*observers[0], getFileInfo(_, _)).Times(1).WillOnce(Return(FileStatus()));
+    EXPECT_CALL(*observers[1], getFileInfo(_, _)).Times(1).WillOnce(Return(FileStatus()));
+    EXPECT_NO_THROW(proxy->getFileInfo("/file", &exist));
+    EXPECT_NO_THROW(proxy->getFileInfo("/file", &exist));
+}
+
+TEST_F(TestObserverRead, WriteToActive) {
+    EXPECT_CALL(*active, mkdirs(_, _, _)).Times(1).WillOnce(Return(true));
+    EXPECT_CALL(*observers[0], mkdirs(_, _, _)).Times(0);
+    EXPECT_CALL(*observers[1], mkdirs(_, _, _)).Times(0);
+    EXPECT_TRUE(proxy->mkdirs("/dir", Permission(0755), true));
+}
+
+TEST_F(TestObserverRead, FallbackToActive) {
+    bool exist;
+    EXPECT_CALL(*observers[0], getFileInfo(_, _)).Times(1).WillOnce(
+        DoAll(InvokeWithoutArgs(&ThrowStandby), Return(FileStatus())));
+    EXPECT_CALL(*observers[1], getFileInfo(_, _)).Times(2).WillRepeatedly(Return(FileStatus()));
+    EXPECT_CALL(*active, getFileInfo(_, _)).Times(1).WillOnce(Return(FileStatus()));
+    EXPECT_NO_THROW(proxy->getFileInfo("/file", &exist));
+    /*
+     * the first observer is backed off now.
+     */
+    EXPECT_NO_THROW(proxy->getFileInfo("/file", &exist));
+    EXPECT_NO_THROW(proxy->getFileInfo("/file", &exist));
+}
+
+TEST_F(TestObserverRead, ApplicationErrorNotRetried) {
+    std::vector<FileStatus> dl;
+    EXPECT_CALL(*observers[0], getListing(_, _, _, _)).Times(1).WillOnce(
+        DoAll(InvokeWithoutArgs(&ThrowFileNotFound), Return(false)));
+    EXPECT_CALL(*active, getListing(_, _, _, _)).Times(0);
+    EXPECT_THROW(proxy->getListing("/dir", "", false, dl), FileNotFoundException);
+}
+
+TEST_F(TestObserverRead, AllObserversUnavailable) {
+    LocatedBlocksImpl lbs;
+    EXPECT_CALL(*observers[0], getBlockLocations(_, _, _, _)).Times(1).WillOnce(
+        InvokeWithoutArgs(&ThrowStandby));
+    EXPECT_CALL(*observers[1], getBlockLocations(_, _, _, _)).Times(1).WillOnce(
+        InvokeWithoutArgs(&ThrowStandby));
+    EXPECT_CALL(*active, getBlockLocations(_, _, _, _)).Times(3);
+    EXPECT_NO_THROW(proxy->getBlockLocations("/file", 0, 1024, lbs));
+    EXPECT_NO_THROW(proxy->getBlockLocations("/file", 0, 1024, lbs));
+    EXPECT_NO_THROW(proxy->getBlockLocations("/file", 0, 1024, lbs));
+}
+
+TEST_F(TestObserverRead, MsyncBeforeFirstObserverRead) {
+    bool exist;
+    {
+        InSequence s;
+        EXPECT_CALL(*active, msync()).Times(1);
+        EXPECT_CALL(*observers[0], getFileInfo(_, _)).Times(1).WillOnce(Return(FileStatus()));
+        EXPECT_CALL(*observers[1], getFileInfo(_, _)).Times(1).WillOnce(Return(FileStatus()));
+    }
+    EXPECT_NO_THROW(proxy->getFileInfo("/file", &exist));
+    EXPECT_NO_THROW(proxy->getFileInfo("/file", &exist));
+}
+
+static void ThrowIOException() {
+    THROW(HdfsIOException, "msync failed");
+}
+
+TEST_F(TestObserverRead, MsyncFailureReadsFromActive) {
+    bool exist;
+    EXPECT_CALL(*active, msync()).Times(2).WillOnce(InvokeWithoutArgs(&ThrowIOException))
+    .WillOnce(Return());
+    EXPECT_CALL(*active, getFileInfo(_, _)).Times(1).WillOnce(Return(FileStatus()));
+    EXPECT_CALL(*observers[0], getFileInfo(_, _)).Times(0);
+    EXPECT_CALL(*observers[1], getFileInfo(_, _)).Times(1).WillOnce(Return(FileStatus()));
+    EXPECT_NO_THROW(proxy->getFileInfo("/file", &exist));
+    EXPECT_NO_THROW(proxy->getFileInfo("/file", &exist));
+}
+
+TEST_F(TestObserverRead, StateIdSharedByCluster) {
+    Config conf;
+    SessionConfig sconf(conf);
+    NamenodeProxy other(MakeNamenodeInfos("active", 1), MakeNamenodeInfos("observer", 2),
+                        "test_observer_read", sconf, RpcAuth());
+    NamenodeProxy another(MakeNamenodeInfos("active", 1), MakeNamenodeInfos("observer", 2),
+                          "test_observer_read_other", sconf, RpcAuth());
+    ASSERT_TRUE(proxy->alignment.get() != NULL);
+    EXPECT_EQ(proxy->alignment.get(), other.alignment.get());
+    EXPECT_NE(proxy->alignment.get(), another.alignment.get());
+}
+
+TEST(TestAlignmentContext, UpdateResponseState) {
+    AlignmentContext context;
+    EXPECT_EQ(0, context.getLastSeenStateId());
+    context.updateResponseState(10);
+    EXPECT_EQ(10, context.getLastSeenStateId());
+    context.updateResponseState(5);
+    EXPECT_EQ(10, context.getLastSeenStateId());
+}
+
+TEST(TestObserverNamenodeInfo, GetObserverNamenodeInfo) {
+    Config conf;
+    EXPECT_TRUE(NamenodeInfo::GetObserverNamenodeInfo("phdcluster", conf).empty());
+    conf.set("dfs.ha.observer.namenodes.phdcluster", "nn3");
+    conf.set("dfs.namenode.rpc-address.phdcluster.nn3", "odw:9000");
+    std::vector<NamenodeInfo> infos = NamenodeInfo::GetObserverNamenodeInfo("phdcluster", conf);
+    ASSERT_EQ(1u, infos.size());
+    EXPECT_EQ("odw:9000", infos[0].getRpcAddr());
+}
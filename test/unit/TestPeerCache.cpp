@@ -0,0 +1,130 @@
+/********************************************************************
+ * Copyright (c) 2013 - 2014, Pivotal Inc.
+ * All rights reserved.
+ *
+ * Author: Zhanwei Wang
+ ********************************************************************/
+/********************************************************************
+ * 2014 -
+ * open source under Apache License Version 2.0
+ ********************************************************************/
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+
+#include "client/PeerCache.h"
+#include "MockSocket.h"
+#include "XmlConfig.h"
+
+using namespace Hdfs;
+using namespace Hdfs::Internal;
+using namespace testing;
+
+static DatanodeInfo MakeDatanode(const char * ip, int port, const char * uuid) {
+    DatanodeInfo dn;
+    dn.setIpAddr(ip);
+    dn.setXferPort(port);
+    dn.setDatanodeId(uuid);
+    return dn;
+}
+
+static PeerPool::value_type MakePeer(int expire) {
+    return PeerPool::value_type(shared_ptr<Socket>(new NiceMock<MockSocket>),
+                                steady_clock::now() + milliseconds(expire));
+}
+
+TEST(TestPeerCache, PeerKey) {
+    EXPECT_TRUE(PeerKey(MakeDatanode("10.0.0.1", 50010, "a")) ==
+                PeerKey(MakeDatanode("10.0.0.1", 50010, "a")));
+    EXPECT_EQ(PeerKey(MakeDatanode("10.0.0.1", 50010, "a")).hash_value(),
+              PeerKey(MakeDatanode("10.0.0.1", 50010, "a")).hash_value());
+    EXPECT_FALSE(PeerKey(MakeDatanode("10.0.0.1", 50010, "a")) ==
+                 PeerKey(MakeDatanode("10.0.0.2", 50010, "a")));
+    EXPECT_FALSE(PeerKey(MakeDatanode("10.0.0.1", 50010, "a")) ==
+                 PeerKey(MakeDatanode("10.0.0.1", 50011, "a")));
+    EXPECT_FALSE(PeerKey(MakeDatanode("10.0.0.1", 50010, "a")) ==
+                 PeerKey(MakeDatanode("10.0.0.1", 50010, "b")));
+    EXPECT_TRUE(PeerKey(MakeDatanode("::1", 50010, "a")) ==
+                PeerKey(MakeDatanode("::1", 50010, "a")));
+    EXPECT_FALSE(PeerKey(MakeDatanode("dn1", 50010, "a")) ==
+                 PeerKey(MakeDatanode("dn2", 50010, "a")));
+}
+
+TEST(TestPeerCache, MultipleConnectionsPerDatanode) {
+    Config conf;
+    SessionConfig sconf(conf);
+    PeerCache cache(sconf);
+    DatanodeInfo dn = MakeDatanode("10.0.1.1", 50010, "multiple");
+    shared_ptr<Socket> socks[3];
+
+    for (int i = 0; i < 3; ++i) {
+        socks[i] = shared_ptr<Socket>(new NiceMock<MockSocket>);
+        cache.addConnection(socks[i], dn);
+    }
+
+    EXPECT_EQ(socks[2], cache.getConnection(dn));
+    EXPECT_EQ(socks[1], cache.getConnection(dn));
+    EXPECT_EQ(socks[0], cache.getConnection(dn));
+    EXPECT_FALSE(cache.getConnection(dn));
+}
+
+TEST(TestPeerCache, ExpiredConnection) {
+    Config conf;
+    conf.set("dfs.client.socketcache.expiryMsec", 100);
+    SessionConfig sconf(conf);
+    PeerCache cache(sconf);
+    DatanodeInfo dn = MakeDatanode("10.0.1.2", 50010, "expired");
+    cache.addConnection(shared_ptr<Socket>(new NiceMock<MockSocket>), dn);
+    sleep_for(milliseconds(200));
+    EXPECT_FALSE(cache.getConnection(dn));
+}
+
+TEST(TestPeerCache, BoundedTotal) {
+    PeerPool pool;
+    pool.setMaxSize(4);
+    PeerKey first(MakeDatanode("10.0.2.1", 50010, "bounded"));
+    pool.put(first, MakePeer(10000));
+
+    for (int i = 0; i < 5; ++i) {
+        char ip[32];
+        snprintf(ip, sizeof(ip), "10.0.2.%d", i + 2);
+        pool.put(PeerKey(MakeDatanode(ip, 50010, "bounded")), MakePeer(10000 + i + 1));
+        EXPECT_LE(pool.size(), 4);
+    }
+
+    PeerPool::value_type value;
+    EXPECT_FALSE(pool.take(first, &value));
+    EXPECT_TRUE(pool.take(PeerKey(MakeDatanode("10.0.2.6", 50010, "bounded")), &value));
+    pool.setMaxSize(1);
+    EXPECT_EQ(1, pool.size());
+    pool.setMaxSize(0);
+    pool.put(first, MakePeer(10000));
+    EXPECT_EQ(0, pool.size());
+}
+
+TEST(TestPeerCache, ReapExpiredConnections) {
+    PeerPool pool;
+    PeerKey key(MakeDatanode("10.0.3.1", 50010, "reaper"));
+    pool.put(key, MakePeer(100));
+    pool.put(key, MakePeer(100));
+    pool.put(key, MakePeer(60 * 1000));
+    EXPECT_EQ(3, pool.size());
+    sleep_for(milliseconds(1500));
+    EXPECT_EQ(1, pool.size());
+}
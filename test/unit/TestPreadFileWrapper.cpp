@@ -0,0 +1,122 @@
+/********************************************************************
+ * Copyright (c) 2013 - 2014, Pivotal Inc.
+ * All rights reserved.
+ *
+ * Author: Zhanwei Wang
+ ********************************************************************/
+/********************************************************************
+ * 2014 -
+ * open source under Apache License Version 2.0
+ ********************************************************************/
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "gtest/gtest.h"
+
+#include "client/ReadShortCircuitInfo.h"
+#include "FileWrapper.h"
+#include "XmlConfig.h"
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <vector>
+
+using namespace Hdfs;
+using namespace Hdfs::Internal;
+
+class TestPreadFileWrapper: public ::testing::Test {
+public:
+    void SetUp() {
+        char name[] = "/tmp/libhdfs3-pread-test-XXXXXX";
+        fd = mkstemp(name);
+        ASSERT_NE(-1, fd);
+        path = name;
+        content.resize(3 * 1024 * 1024 + 123);
+
+        for (size_t i = 0; i < content.size(); ++i) {
+            content[i] = static_cast<char>(i * 7 + i / 4096);
+        }
+
+        ASSERT_EQ(static_cast<ssize_t>(content.size()),
+                  ::write(fd, &content[0], content.size()));
+    }
+
+    void TearDown() {
+        ::close(fd);
+        ::unlink(path.c_str());
+    }
+
+    void verify(FileWrapper & file) {
+        std::vector<char> buffer;
+        const char * data = file.read(buffer, 1000);
+        EXPECT_EQ(0, memcmp(data, &content[0], 1000));
+        file.seek(4095);
+        data = file.read(buffer, 8193);
+        EXPECT_EQ(0, memcmp(data, &content[4095], 8193));
+        std::vector<char> copied(2 * 1024 * 1024);
+        file.copy(&copied[0], copied.size());
+        EXPECT_EQ(0, memcmp(&copied[0], &content[4095 + 8193], copied.size()));
+        file.seek(content.size() - 100);
+        data = file.read(buffer, 100);
+        EXPECT_EQ(0, memcmp(data, &content[content.size() - 100], 100));
+        EXPECT_THROW(file.read(buffer, 1), HdfsIOException);
+    }
+
+protected:
+    int fd;
+    std::string path;
+    std::vector<char> content;
+};
+
+TEST_F(TestPreadFileWrapper, Sequential) {
+    PreadFileWrapper file(true, 1024 * 1024, true, false);
+    ASSERT_TRUE(file.open(fd, false));
+    EXPECT_FALSE(file.isDirect());
+    verify(file);
+}
+
+TEST_F(TestPreadFileWrapper, Random) {
+    PreadFileWrapper file(false, 1024 * 1024, false, false);
+    ASSERT_TRUE(file.open(path));
+    verify(file);
+}
+
+TEST_F(TestPreadFileWrapper, Direct) {
+    // falls back to buffered read if the file system does not support it.
+    PreadFileWrapper file(true, 0, false, true);
+    ASSERT_TRUE(file.open(fd, false));
+    verify(file);
+}
+
+TEST(TestReadShortCircuitInfoBuilder, CreateFileWrapper) {
+    Config c;
+    SessionConfig conf(c);
+    shared_ptr<FileWrapper> file = ReadShortCircuitInfoBuilder::CreateFileWrapper(conf, true, false);
+    EXPECT_TRUE(dynamic_cast<PreadFileWrapper *>(file.get()) != NULL);
+    conf.setUseMappedFile(true);
+    file = ReadShortCircuitInfoBuilder::CreateFileWrapper(conf, false, false);
+    EXPECT_TRUE(dynamic_cast<MappedFileWrapper *>(file.get()) != NULL);
+    conf.setLocalReadEngine("stdio");
+    file = ReadShortCircuitInfoBuilder::CreateFileWrapper(conf, true, true);
+    EXPECT_TRUE(dynamic_cast<CFileWrapper *>(file.get()) != NULL);
+    conf.setLocalReadEngine("pread");
+    file = ReadShortCircuitInfoBuilder::CreateFileWrapper(conf, false, true);
+    EXPECT_TRUE(dynamic_cast<PreadFileWrapper *>(file.get()) != NULL);
+    c.set("input.localread.engine", "bogus");
+    EXPECT_THROW(SessionConfig bad(c), HdfsConfigInvalid);
+}
@@ -0,0 +1,329 @@
+/********************************************************************
+ * Copyright (c) 2013 - 2014, Pivotal Inc.
+ * All rights reserved.
+ *
+ * Author: Zhanwei Wang
+ ********************************************************************/
+/********************************************************************
+ * 2014 -
+ * open source under Apache License Version 2.0
+ ********************************************************************/
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "gtest/gtest.h"
+
+#include "BigEndian.h"
+#include "client/PacketHeader.h"
+#include "client/RemoteBlockReader.h"
+#include "datatransfer.pb.h"
+#include "SWCrc32c.h"
+#include "Thread.h"
+#include "XmlConfig.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <vector>
+
+using namespace Hdfs;
+using namespace Hdfs::Internal;
+
+#define CHUNK_SIZE 512
+
+/*
+ * A stand-in datanode serving one read request over TCP. Checksums are
+ * sent only if the client asks for them.
+ */
+class ReadBlockDatanodeStub {
+public:
+    explicit ReadBlockDatanodeStub(const std::vector<char> & data) :
+        sendChecksums(true), hasCachingStrategy(false), hasDropBehind(false), dropBehind(false),
+        readahead(-1), clientStatus(-1), bytesSent(0), data(data) {
+        listenFd = ::socket(AF_INET, SOCK_STREAM, 0);
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = 0;
+        EXPECT_EQ(0, ::bind(listenFd, (struct sockaddr *) &addr, sizeof(addr)));
+        EXPECT_EQ(0, ::listen(listenFd, 1));
+        socklen_t len = sizeof(addr);
+        getsockname(listenFd, (struct sockaddr *) &addr, &len);
+        port = ntohs(addr.sin_port);
+        worker = thread(bind(&ReadBlockDatanodeStub::run, this));
+    }
+
+    ~ReadBlockDatanodeStub() {
+        join();
+        ::close(listenFd);
+    }
+
+    void join() {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+
+    int getPort() const {
+        return port;
+    }
+
+public:
+    bool sendChecksums;
+    bool hasCachingStrategy;
+    bool hasDropBehind;
+    bool dropBehind;
+    int64_t readahead;
+    int clientStatus;
+    size_t bytesSent;
+
+private:
+    static bool ReadFully(int fd, char * buffer, size_t size) {
+        while (size > 0) {
+            ssize_t rc = ::read(fd, buffer, size);
+
+            if (rc <= 0) {
+                return false;
+            }
+
+            buffer += rc;
+            size -= rc;
+        }
+
+        return true;
+    }
+
+    static bool ReadDelimited(int fd, ::google::protobuf::Message * msg) {
+        uint32_t size = 0;
+        char c;
+
+        for (int shift = 0;; shift += 7) {
+            if (!ReadFully(fd, &c, 1)) {
+                return false;
+            }
+
+            size |= static_cast<uint32_t>(c & 0x7F) << shift;
+
+            if (!(c & 0x80)) {
+                break;
+            }
+        }
+
+        std::vector<char> body(size + 1);
+        return ReadFully(fd, &body[0], size) && msg->ParseFromArray(&body[0], size);
+    }
+
+    static void AppendDelimited(std::string & buffer,
+                                const ::google::protobuf::Message & msg) {
+        std::string body = msg.SerializeAsString();
+        uint32_t size = body.size();
+
+        do {
+            char c = size & 0x7F;
+            size >>= 7;
+            buffer.push_back(size ? (c | 0x80) : c);
+        } while (size);
+
+        buffer += body;
+    }
+
+    static void AppendPacket(std::string & buffer, int64_t offset, int64_t seqno,
+                             const char * data, int size, bool checksums) {
+        std::string checksum;
+
+        for (int i = 0; checksums && i < size; i += CHUNK_SIZE) {
+            SWCrc32c crc;
+            crc.update(data + i, std::min(CHUNK_SIZE, size - i));
+            char value[4];
+            WriteBigEndian32ToArray(crc.getValue(), value);
+            checksum.append(value, sizeof(value));
+        }
+
+        PacketHeader header(sizeof(int32_t) + checksum.size() + size, offset,
+                            seqno, size == 0, size);
+        std::vector<char> headerBuffer(PacketHeader::GetPkgHeaderSize());
+        header.writeInBuffer(&headerBuffer[0], headerBuffer.size());
+        buffer.append(&headerBuffer[0], headerBuffer.size());
+        buffer += checksum;
+        buffer.append(data, size);
+    }
+
+    void run() {
+        int fd = ::accept(listenFd, NULL, NULL);
+        char header[3];
+        OpReadBlockProto req;
+        ASSERT_TRUE(ReadFully(fd, header, sizeof(header)));
+        ASSERT_EQ(81, header[2]);
+        ASSERT_TRUE(ReadDelimited(fd, &req));
+        sendChecksums = req.sendchecksums();
+        hasCachingStrategy = req.has_cachingstrategy();
+        hasDropBehind = req.cachingstrategy().has_dropbehind();
+        dropBehind = req.cachingstrategy().dropbehind();
+        readahead = req.cachingstrategy().has_readahead() ?
+                    req.cachingstrategy().readahead() : -1;
+
+        BlockOpResponseProto resp;
+        resp.set_status(Status::DT_PROTO_SUCCESS);
+        ReadOpChecksumInfoProto * info = resp.mutable_readopchecksuminfo();
+        info->mutable_checksum()->set_type(sendChecksums ?
+                                           ChecksumTypeProto::CHECKSUM_CRC32C : ChecksumTypeProto::CHECKSUM_NULL);
+        info->mutable_checksum()->set_bytesperchecksum(CHUNK_SIZE);
+        info->set_chunkoffset(0);
+        std::string buffer;
+        AppendDelimited(buffer, resp);
+        size_t packetSize = 4 * CHUNK_SIZE;
+        int64_t seqno = 0;
+
+        for (size_t offset = 0; offset < data.size(); offset += packetSize) {
+            AppendPacket(buffer, offset, seqno++, &data[offset],
+                         std::min(packetSize, data.size() - offset), sendChecksums);
+        }
+
+        AppendPacket(buffer, data.size(), seqno, NULL, 0, false);
+        bytesSent = buffer.size();
+        ASSERT_EQ(static_cast<ssize_t>(buffer.size()), ::write(fd, buffer.data(), buffer.size()));
+        ClientReadStatusProto status;
+
+        if (ReadDelimited(fd, &status)) {
+            clientStatus = status.status();
+        }
+
+        ::close(fd);
+    }
+
+private:
+    int listenFd;
+    int port;
+    std::vector<char> data;
+    thread worker;
+};
+
+static std::vector<char> MakeData() {
+    std::vector<char> data(10 * CHUNK_SIZE + 100);
+
+    for (size_t i = 0; i < data.size(); ++i) {
+        data[i] = static_cast<char>(rand());
+    }
+
+    return data;
+}
+
+static void ReadBlock(ReadBlockDatanodeStub & stub, const std::vector<char> & data,
+                      bool verify, SessionConfig & conf,
+                      ReadCounters * counters = NULL) {
+    PeerCache cache(conf);
+    ExtendedBlock block;
+    block.setBlockId(360001);
+    block.setPoolId("pool");
+    block.setNumBytes(data.size());
+    DatanodeInfo dn;
+    dn.setIpAddr("127.0.0.1");
+    dn.setXferPort(stub.getPort());
+    dn.setDatanodeId("stub");
+    std::vector<char> result(data.size());
+    RemoteBlockReader reader(block, dn, cache, 0, data.size(), Token(),
+                             "test-client", verify, conf, counters);
+    size_t done = 0;
+
+    while (done < result.size()) {
+        int32_t rc = reader.read(&result[done], result.size() - done);
+        ASSERT_GT(rc, 0);
+        done += rc;
+    }
+
+    EXPECT_EQ(0, memcmp(&result[0], &data[0], data.size()));
+    stub.join();
+    // do not keep the connection to the stub.
+    reader.sentStatus = false;
+}
+
+static void ReadBlock(ReadBlockDatanodeStub & stub, const std::vector<char> & data,
+                      bool verify) {
+    Config c;
+    SessionConfig conf(c);
+    ReadBlock(stub, data, verify, conf);
+}
+
+TEST(TestRemoteBlockReader, ReadWithChecksums) {
+    std::vector<char> data = MakeData();
+    ReadBlockDatanodeStub stub(data);
+    ReadBlock(stub, data, true);
+    EXPECT_TRUE(stub.sendChecksums);
+    EXPECT_EQ(Status::DT_PROTO_CHECKSUM_OK, stub.clientStatus);
+}
+
+TEST(TestRemoteBlockReader, ReadWithoutChecksums) {
+    std::vector<char> data = MakeData();
+    ReadBlockDatanodeStub withChecksums(data);
+    ReadBlock(withChecksums, data, true);
+    ReadBlockDatanodeStub stub(data);
+    ReadBlock(stub, data, false);
+    EXPECT_FALSE(stub.sendChecksums);
+    EXPECT_EQ(Status::DT_PROTO_SUCCESS, stub.clientStatus);
+    // one 4 bytes checksum per chunk is not sent.
+    EXPECT_EQ(withChecksums.bytesSent - 11 * sizeof(int32_t), stub.bytesSent);
+}
+
+TEST(TestRemoteBlockReader, CountChecksumTime) {
+    std::vector<char> data = MakeData();
+    ReadBlockDatanodeStub stub(data);
+    Config c;
+    SessionConfig conf(c);
+    ReadCounters counters;
+    ReadBlock(stub, data, true, conf, &counters);
+    EXPECT_GT(counters.checksumNanos, 0);
+    // the connection was not taken from the peer cache.
+    EXPECT_EQ(0, counters.peerCacheHits);
+}
+
+TEST(TestRemoteBlockReader, NoCachingStrategyByDefault) {
+    std::vector<char> data = MakeData();
+    ReadBlockDatanodeStub stub(data);
+    ReadBlock(stub, data, true);
+    EXPECT_FALSE(stub.hasCachingStrategy);
+}
+
+TEST(TestRemoteBlockReader, SendCachingStrategy) {
+    std::vector<char> data = MakeData();
+    ReadBlockDatanodeStub stub(data);
+    Config c;
+    c.set("dfs.client.cache.drop.behind.reads", true);
+    c.set("dfs.client.cache.readahead", 8 * 1024 * 1024);
+    SessionConfig conf(c);
+    ReadBlock(stub, data, true, conf);
+    EXPECT_TRUE(stub.hasCachingStrategy);
+    EXPECT_TRUE(stub.dropBehind);
+    EXPECT_EQ(8 * 1024 * 1024, stub.readahead);
+}
+
+TEST(TestRemoteBlockReader, SendExplicitNoDropBehind) {
+    std::vector<char> data = MakeData();
+    ReadBlockDatanodeStub stub(data);
+    Config c;
+    SessionConfig conf(c);
+    EXPECT_EQ(-1, conf.getCacheDropBehindReads());
+    conf.setCacheDropBehindReads(false);
+    ReadBlock(stub, data, true, conf);
+    EXPECT_TRUE(stub.hasCachingStrategy);
+    EXPECT_TRUE(stub.hasDropBehind);
+    EXPECT_FALSE(stub.dropBehind);
+    EXPECT_EQ(-1, stub.readahead);
+}
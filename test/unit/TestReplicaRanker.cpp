@@ -0,0 +1,128 @@
+/********************************************************************
+ * Copyright (c) 2013 - 2014, Pivotal Inc.
+ * All rights reserved.
+ *
+ * Author: Zhanwei Wang
+ ********************************************************************/
+/********************************************************************
+ * 2014 -
+ * open source under Apache License Version 2.0
+ ********************************************************************/
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "gtest/gtest.h"
+
+#include "client/ReplicaRanker.h"
+#include "XmlConfig.h"
+
+#include <algorithm>
+
+using namespace Hdfs;
+using namespace Hdfs::Internal;
+
+static DatanodeInfo MakeDatanode(const char * ip, const char * rack) {
+    DatanodeInfo dn;
+    dn.setIpAddr(ip);
+    dn.setXferPort(50010);
+    dn.setDatanodeId(ip);
+    dn.setLocation(rack);
+    return dn;
+}
+
+class TestReplicaRanker: public ::testing::Test {
+public:
+    TestReplicaRanker() {
+        localAddrs.insert("10.0.0.1");
+    }
+
+protected:
+    void addReplica(const char * ip, const char * rack, bool cached,
+                    StorageType type) {
+        lb.mutableLocations().push_back(MakeDatanode(ip, rack));
+        lb.mutableCached().push_back(cached);
+        lb.mutableStorageTypes().push_back(type);
+    }
+
+    int choose(ReplicaRanker & ranker) {
+        std::sort(failedNodes.begin(), failedNodes.end());
+        return ranker.choose(lb, failedNodes, localAddrs);
+    }
+
+protected:
+    LocatedBlock lb;
+    std::vector<DatanodeInfo> failedNodes;
+    unordered_set<std::string> localAddrs;
+};
+
+TEST_F(TestReplicaRanker, KeepNamenodeOrderOnTie) {
+    ReplicaRanker ranker;
+    addReplica("10.0.1.1", "/rack1", false, STORAGE_DISK);
+    addReplica("10.0.1.2", "/rack1", false, STORAGE_DISK);
+    EXPECT_EQ(0, choose(ranker));
+    failedNodes.push_back(lb.getLocations()[0]);
+    EXPECT_EQ(1, choose(ranker));
+    failedNodes.push_back(lb.getLocations()[1]);
+    EXPECT_EQ(-1, choose(ranker));
+}
+
+TEST_F(TestReplicaRanker, PreferCachedOverCloserDisk) {
+    ReplicaRanker ranker;
+    addReplica("10.0.1.1", "/rack1", false, STORAGE_DISK);
+    addReplica("10.0.3.1", "/rack3", true, STORAGE_DISK);
+    EXPECT_EQ(1, choose(ranker));
+}
+
+TEST_F(TestReplicaRanker, DefaultOrder) {
+    ReplicaRanker ranker;
+    addReplica("10.0.2.1", "/rack2", false, STORAGE_DISK);
+    addReplica("10.0.1.2", "/rack1", false, STORAGE_DISK);
+    addReplica("10.0.2.2", "/rack2", false, STORAGE_SSD);
+    addReplica("10.0.3.1", "/rack3", true, STORAGE_DISK);
+    addReplica("10.0.0.1", "/rack1", false, STORAGE_DISK);
+    EXPECT_EQ(4, choose(ranker));
+    EXPECT_EQ("/rack1", ranker.getLocalRack());
+    failedNodes.push_back(lb.getLocations()[4]);
+    EXPECT_EQ(3, choose(ranker));
+    failedNodes.push_back(lb.getLocations()[3]);
+    EXPECT_EQ(2, choose(ranker));
+    failedNodes.push_back(lb.getLocations()[2]);
+    EXPECT_EQ(1, choose(ranker));
+    failedNodes.push_back(lb.getLocations()[1]);
+    EXPECT_EQ(0, choose(ranker));
+}
+
+TEST_F(TestReplicaRanker, ConfiguredWeights) {
+    Config c;
+    c.set("input.replica.weight.cached", 0);
+    c.set("input.replica.weight.fast-storage", 16);
+    SessionConfig conf(c);
+    ReplicaRanker ranker(conf);
+    addReplica("10.0.3.1", "/rack3", true, STORAGE_DISK);
+    addReplica("10.0.0.1", "/rack1", false, STORAGE_DISK);
+    addReplica("10.0.2.1", "/rack2", false, STORAGE_RAM_DISK);
+    EXPECT_EQ(2, choose(ranker));
+}
+
+TEST_F(TestReplicaRanker, UnknownCacheAndStorage) {
+    ReplicaRanker ranker;
+    lb.mutableLocations().push_back(MakeDatanode("10.0.1.1", "/rack1"));
+    lb.mutableLocations().push_back(MakeDatanode("10.0.0.1", "/rack1"));
+    EXPECT_FALSE(lb.isCached(0));
+    EXPECT_EQ(STORAGE_DISK, lb.getStorageType(1));
+    EXPECT_EQ(1, choose(ranker));
+}
@@ -38,6 +38,7 @@
 #include "MockRpcClient.h"
 #include "MockRpcRemoteCall.h"
 #include "MockSocket.h"
+#include "rpc/AlignmentContext.h"
 #include "rpc/RpcChannel.h"
 #include "RpcHeader.pb.h"
 #include "TestUtil.h"
@@ -441,3 +442,59 @@ TEST(TestRpcChannel, TestTimeout) {
 }
 
 
+
+static void ParseRequestFrame(const WriteBuffer & buffer, RpcRequestHeaderProto & rpcHeader,
+                              RequestHeaderProto & requestHeader, ::google::protobuf::Message & request) {
+    CodedInputStream stream(reinterpret_cast<const uint8_t *>(buffer.getBuffer(0)),
+                            buffer.getDataSize(0));
+    uint32_t size, len;
+    ASSERT_TRUE(stream.ReadLittleEndian32(&size));
+    ASSERT_EQ(buffer.getDataSize(0) - sizeof(size), ntohl(size));
+    ASSERT_TRUE(stream.ReadVarint32(&len));
+    CodedInputStream::Limit limit = stream.PushLimit(len);
+    ASSERT_TRUE(rpcHeader.ParseFromCodedStream(&stream));
+    stream.PopLimit(limit);
+    ASSERT_TRUE(stream.ReadVarint32(&len));
+    limit = stream.PushLimit(len);
+    ASSERT_TRUE(requestHeader.ParseFromCodedStream(&stream));
+    stream.PopLimit(limit);
+    ASSERT_TRUE(stream.ReadVarint32(&len));
+    limit = stream.PushLimit(len);
+    ASSERT_TRUE(request.ParseFromCodedStream(&stream));
+    stream.PopLimit(limit);
+    EXPECT_EQ(0, stream.BytesUntilLimit());
+}
+
+TEST(TestRpcChannel, TestSerialize_ReuseHeaders) {
+    RpcProtocolInfo protocol(1, "org.apache.hadoop.hdfs.protocol.ClientProtocol", "kind");
+    RpcRequestHeaders headers;
+    AlignmentContext alignment;
+    alignment.updateResponseState(100);
+    GetFileInfoRequestProto request1, request2, parsed;
+    request1.set_src("/a/long/path/to/make/the/first/request/larger");
+    request2.set_src("/short");
+    RpcCall call1(true, "getFileInfo", &request1, NULL);
+    call1.setAlignmentContext(&alignment);
+    RpcCall call2(false, "mkdirs", &request2, NULL);
+    RpcRemoteCall remote1(call1, 1, "client"), remote2(call2, 2, "client");
+    RpcRequestHeaderProto rpcHeader;
+    RequestHeaderProto requestHeader;
+    WriteBuffer buffer;
+    remote1.serialize(protocol, buffer, headers);
+    ParseRequestFrame(buffer, rpcHeader, requestHeader, parsed);
+    EXPECT_EQ(1, rpcHeader.callid());
+    EXPECT_EQ(100, rpcHeader.stateid());
+    EXPECT_EQ("getFileInfo", requestHeader.methodname());
+    EXPECT_EQ(request1.src(), parsed.src());
+    /*
+     * the reused headers must not leak fields from the previous call.
+     */
+    buffer.setBufferDataSize(0);
+    remote2.serialize(protocol, buffer, headers);
+    ParseRequestFrame(buffer, rpcHeader, requestHeader, parsed);
+    EXPECT_EQ(2, rpcHeader.callid());
+    EXPECT_FALSE(rpcHeader.has_stateid());
+    EXPECT_EQ("mkdirs", requestHeader.methodname());
+    EXPECT_EQ(protocol.getProtocol(), requestHeader.declaringclassprotocolname());
+    EXPECT_EQ(request2.src(), parsed.src());
+}
@@ -108,3 +108,74 @@ TEST(TestRpcClient, TestCleanupIdleChannel) {
     channel->close(false);
     sleep_for(seconds(3));
 }
+
+static RpcChannel * CreateMockChannel(std::vector<NiceMock<MockRpcChannel> *> & channels) {
+    channels.push_back(new NiceMock<MockRpcChannel>);
+    return channels.back();
+}
+
+TEST(TestRpcClient, TestRoundRobinChannels) {
+    RpcAuth auth;
+    RpcProtocolInfo protocol(0, "test", "kind");
+    RpcServerInfo server("unknown token service", "unknown server", "unknown port");
+    Config conf;
+    conf.set("rpc.client.connections.per.server", 3);
+    SessionConfig session(conf);
+    RpcConfig rpcConf(session);
+    MockRpcChannelStub stub;
+    RpcClientImpl client;
+    client.stub = &stub;
+    std::vector<NiceMock<MockRpcChannel> *> channels;
+    EXPECT_CALL(stub, getChannel(_, _)).Times(3).WillRepeatedly(
+        InvokeWithoutArgs(bind(&CreateMockChannel, ref(channels))));
+
+    for (int i = 0; i < 6; ++i) {
+        RpcChannel & rc = client.getChannel(auth, protocol, server, rpcConf);
+        ASSERT_EQ(static_cast<size_t>(std::min(i + 1, 3)), channels.size());
+        EXPECT_EQ(channels[i % 3], &rc);
+    }
+}
+
+TEST(TestRpcClient, TestLeastOutstandingChannels) {
+    RpcAuth auth;
+    RpcProtocolInfo protocol(0, "test", "kind");
+    RpcServerInfo server("unknown token service", "unknown server", "unknown port");
+    Config conf;
+    conf.set("rpc.client.connections.per.server", 2);
+    conf.set("rpc.client.connection.policy", "least-outstanding");
+    SessionConfig session(conf);
+    RpcConfig rpcConf(session);
+    MockRpcChannelStub stub;
+    RpcClientImpl client;
+    client.stub = &stub;
+    std::vector<NiceMock<MockRpcChannel> *> channels;
+    EXPECT_CALL(stub, getChannel(_, _)).Times(2).WillRepeatedly(
+        InvokeWithoutArgs(bind(&CreateMockChannel, ref(channels))));
+    /*
+     * an idle channel is reused.
+     */
+    RpcChannel * first = &client.getChannel(auth, protocol, server, rpcConf);
+    ASSERT_EQ(1u, channels.size());
+    EXPECT_CALL(*channels[0], getRefCount()).WillRepeatedly(Return(0));
+    EXPECT_EQ(first, &client.getChannel(auth, protocol, server, rpcConf));
+    /*
+     * a busy channel makes a new connection.
+     */
+    EXPECT_CALL(*channels[0], getRefCount()).WillRepeatedly(Return(3));
+    RpcChannel * second = &client.getChannel(auth, protocol, server, rpcConf);
+    ASSERT_EQ(2u, channels.size());
+    EXPECT_EQ(channels[1], second);
+    /*
+     * the pool is full, choose the least busy one.
+     */
+    EXPECT_CALL(*channels[1], getRefCount()).WillRepeatedly(Return(5));
+    EXPECT_EQ(first, &client.getChannel(auth, protocol, server, rpcConf));
+    EXPECT_CALL(*channels[0], getRefCount()).WillRepeatedly(Return(7));
+    EXPECT_EQ(second, &client.getChannel(auth, protocol, server, rpcConf));
+}
+
+TEST(TestRpcClient, TestInvalidConnectionPolicy) {
+    Config conf;
+    conf.set("rpc.client.connection.policy", "random");
+    EXPECT_THROW(SessionConfig session(conf), HdfsConfigInvalid);
+}
@@ -26,6 +26,7 @@
  * limitations under the License.
  */
 #include "gtest/gtest.h"
+#include "Exception.h"
 #include "SessionConfig.h"
 #include "XmlConfig.h"
 
@@ -37,3 +38,15 @@ TEST(TestSessionConfig, TestSelect) {
     SessionConfig session(conf);
     ASSERT_STREQ("hdfs://localhost:9000", session.getDefaultUri().c_str());
 }
+
+TEST(TestSessionConfig, TestTraceSampleRateRange) {
+    Config conf;
+    conf.set("dfs.client.trace.sample-rate", 0.5);
+    EXPECT_DOUBLE_EQ(0.5, SessionConfig(conf).getTraceSampleRate());
+    conf.set("dfs.client.trace.sample-rate", 0);
+    EXPECT_DOUBLE_EQ(0, SessionConfig(conf).getTraceSampleRate());
+    conf.set("dfs.client.trace.sample-rate", 1.5);
+    EXPECT_THROW(SessionConfig session(conf), HdfsConfigInvalid);
+    conf.set("dfs.client.trace.sample-rate", -0.1);
+    EXPECT_THROW(SessionConfig session(conf), HdfsConfigInvalid);
+}
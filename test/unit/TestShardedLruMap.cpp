@@ -0,0 +1,186 @@
+/********************************************************************
+ * Copyright (c) 2013 - 2014, Pivotal Inc.
+ * All rights reserved.
+ *
+ * Author: Zhanwei Wang
+ ********************************************************************/
+/********************************************************************
+ * 2014 -
+ * open source under Apache License Version 2.0
+ ********************************************************************/
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "gtest/gtest.h"
+
+#include "Function.h"
+#include "LruMap.h"
+#include "ShardedLruMap.h"
+#include "Thread.h"
+
+using namespace Hdfs;
+using namespace Hdfs::Internal;
+
+TEST(TestShardedLruMap, TestInsertAndFind) {
+    ShardedLruMap<int, int> map(3, 1);
+    map.insert(1, 1);
+    map.insert(2, 2);
+    map.insert(3, 3);
+    map.insert(4, 4);
+    int value = 0;
+    EXPECT_EQ(3u, map.size());
+    EXPECT_FALSE(map.find(1, &value));
+    EXPECT_TRUE(map.find(2, &value));
+    EXPECT_EQ(2, value);
+    EXPECT_TRUE(map.find(4, &value));
+    EXPECT_EQ(4, value);
+    /*
+     * 3 is the only entry not used since the last eviction.
+     */
+    map.insert(5, 5);
+    EXPECT_FALSE(map.find(3, &value));
+    EXPECT_TRUE(map.find(2, &value));
+    EXPECT_TRUE(map.find(4, &value));
+    EXPECT_TRUE(map.find(5, &value));
+    map.insert(5, 50);
+    EXPECT_TRUE(map.find(5, &value));
+    EXPECT_EQ(50, value);
+    EXPECT_EQ(3u, map.size());
+}
+
+TEST(TestShardedLruMap, TestFindAndErase) {
+    ShardedLruMap<int, int> map(3, 1);
+    map.insert(1, 1);
+    map.insert(2, 2);
+    map.insert(3, 3);
+    map.insert(4, 4);
+    int value = 0;
+    EXPECT_EQ(3u, map.size());
+    EXPECT_TRUE(map.findAndErase(2, &value));
+    EXPECT_EQ(2, value);
+    EXPECT_EQ(2u, map.size());
+    EXPECT_FALSE(map.find(2, &value));
+    map.erase(3);
+    EXPECT_EQ(1u, map.size());
+    map.insert(5, 5);
+    map.insert(6, 6);
+    EXPECT_EQ(3u, map.size());
+    EXPECT_TRUE(map.find(4, &value));
+    EXPECT_TRUE(map.find(5, &value));
+    EXPECT_TRUE(map.find(6, &value));
+}
+
+TEST(TestShardedLruMap, TestSetMaxSize) {
+    ShardedLruMap<int, int> map(100, 4);
+
+    for (int i = 0; i < 1000; ++i) {
+        map.insert(i, i);
+        EXPECT_LE(map.size(), 100u);
+    }
+
+    EXPECT_EQ(100u, map.size());
+    map.setMaxSize(10);
+    EXPECT_EQ(10u, map.size());
+    int value, found = 0;
+
+    for (int i = 0; i < 1000; ++i) {
+        found += map.find(i, &value) ? 1 : 0;
+    }
+
+    EXPECT_EQ(10, found);
+    map.setMaxSize(0);
+    map.insert(1, 1);
+    EXPECT_EQ(0u, map.size());
+}
+
+TEST(TestShardedLruMap, TestReinsertKeepsReference) {
+    ShardedLruMap<int, int> map(3, 1);
+    map.insert(1, 1);
+    map.insert(2, 2);
+    map.insert(3, 3);
+    int value = 0;
+    EXPECT_TRUE(map.findAndErase(1, &value));
+    map.insert(1, 1);
+    /*
+     * 1 was used before it was taken, so 2 is evicted instead.
+     */
+    map.insert(4, 4);
+    EXPECT_TRUE(map.find(1, &value));
+    EXPECT_FALSE(map.find(2, &value));
+    EXPECT_TRUE(map.find(3, &value));
+    EXPECT_TRUE(map.find(4, &value));
+}
+
+TEST(TestShardedLruMap, TestCapacitySmallerThanShards) {
+    ShardedLruMap<int, int> map(2, 16);
+    int value = 0;
+
+    for (int i = 0; i < 100; ++i) {
+        map.insert(i, i);
+        EXPECT_TRUE(map.find(i, &value));
+    }
+
+    EXPECT_LE(map.size(), 16u);
+    map.setMaxSize(0);
+    map.insert(1, 1);
+    EXPECT_FALSE(map.find(1, &value));
+}
+
+template <typename Map>
+static void MapWorker(Map * map, int id, int ops, int keys) {
+    int value;
+    uint32_t seed = id * 2654435761u + 1;
+
+    for (int i = 0; i < ops; ++i) {
+        seed = seed * 1103515245u + 12345u;
+        int key = (seed >> 8) % keys;
+
+        if (!map->find(key, &value)) {
+            map->insert(key, key);
+        } else {
+            EXPECT_EQ(key, value);
+        }
+    }
+}
+
+template <typename Map>
+static void RunContention(Map & map, int threads, int ops, int keys) {
+    std::vector<shared_ptr<thread> > workers;
+
+    for (int i = 0; i < threads; ++i) {
+        workers.push_back(shared_ptr<thread>(new thread));
+        CREATE_THREAD(*workers.back(), bind(&MapWorker<Map>, &map, i, ops, keys));
+    }
+
+    for (int i = 0; i < threads; ++i) {
+        workers[i]->join();
+    }
+}
+
+/*
+ * Mostly hits from many threads, as on the short circuit read path.
+ */
+TEST(TestShardedLruMap, TestContention) {
+    const int threads = 32, ops = 20000, keys = 800, capacity = 1024;
+    LruMap<int, int> lru(capacity);
+    ShardedLruMap<int, int> sharded(capacity);
+    RunContention(lru, threads, ops, keys);
+    RunContention(sharded, threads, ops, keys);
+    EXPECT_LE(lru.size(), static_cast<size_t>(capacity));
+    EXPECT_LE(sharded.size(), static_cast<size_t>(capacity));
+    EXPECT_GT(sharded.size(), 0u);
+}
@@ -0,0 +1,467 @@
+/********************************************************************
+ * Copyright (c) 2013 - 2014, Pivotal Inc.
+ * All rights reserved.
+ *
+ * Author: Zhanwei Wang
+ ********************************************************************/
+/********************************************************************
+ * 2014 -
+ * open source under Apache License Version 2.0
+ ********************************************************************/
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "gtest/gtest.h"
+
+#include "client/ReadShortCircuitInfo.h"
+#include "client/ShortCircuitShm.h"
+#include "datatransfer.pb.h"
+#include "network/DomainSocket.h"
+#include "Thread.h"
+#include "XmlConfig.h"
+
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <vector>
+
+using namespace Hdfs;
+using namespace Hdfs::Internal;
+
+#define STUB_SHM_SIZE 8192
+
+/*
+ * A stand-in datanode serving the short-circuit ops over a UNIX socket.
+ */
+class ShortCircuitDatanodeStub {
+public:
+    ShortCircuitDatanodeStub(const std::string & path, bool supportShm) :
+        failShm(false), fdsRequests(0), releases(0), shmRequests(0),
+        lastSlotIdx(-1), supportShm(supportShm), stopped(false), shmBase(NULL), shmFd(-1),
+        path(path) {
+        ::unlink(path.c_str());
+        listenFd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        struct sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", path.c_str());
+        EXPECT_EQ(0, ::bind(listenFd, (struct sockaddr *) &addr, sizeof(addr)));
+        EXPECT_EQ(0, ::listen(listenFd, 16));
+        dataFd = CreateTempFile(4096);
+        metaFd = CreateTempFile(64);
+        worker = thread(bind(&ShortCircuitDatanodeStub::run, this));
+    }
+
+    ~ShortCircuitDatanodeStub() {
+        stopped = true;
+        worker.join();
+
+        for (size_t i = 0; i < clients.size(); ++i) {
+            ::close(clients[i]);
+        }
+
+        if (shmBase) {
+            munmap(shmBase, STUB_SHM_SIZE);
+            ::close(shmFd);
+        }
+
+        ::close(dataFd);
+        ::close(metaFd);
+        ::close(listenFd);
+        ::unlink(path.c_str());
+    }
+
+    /*
+     * Revoke the replica registered in the slot, as the datanode does when
+     * it uncaches a block.
+     */
+    void revoke(int32_t idx) {
+        uint64_t * flags = reinterpret_cast<uint64_t *>(
+            shmBase + idx * ShortCircuitShm::SlotSize);
+        __atomic_fetch_and(flags, ~ShortCircuitShm::ValidFlag, __ATOMIC_SEQ_CST);
+    }
+
+public:
+    atomic<bool> failShm;
+    atomic<int> fdsRequests;
+    atomic<int> releases;
+    atomic<int> shmRequests;
+    atomic<int> lastSlotIdx;
+
+private:
+    static int CreateTempFile(size_t size) {
+        char name[] = "/tmp/libhdfs3-shm-test-XXXXXX";
+        int fd = mkstemp(name);
+        EXPECT_NE(-1, fd);
+        ::unlink(name);
+        EXPECT_EQ(0, ftruncate(fd, size));
+        return fd;
+    }
+
+    static bool ReadFully(int fd, char * buffer, size_t size) {
+        while (size > 0) {
+            ssize_t rc = ::read(fd, buffer, size);
+
+            if (rc <= 0) {
+                return false;
+            }
+
+            buffer += rc;
+            size -= rc;
+        }
+
+        return true;
+    }
+
+    static void WriteResponse(int fd, const ::google::protobuf::Message & msg) {
+        std::string body = msg.SerializeAsString();
+        std::string buffer;
+        uint32_t size = body.size();
+
+        do {
+            char c = size & 0x7F;
+            size >>= 7;
+            buffer.push_back(size ? (c | 0x80) : c);
+        } while (size);
+
+        buffer += body;
+        ASSERT_EQ(static_cast<ssize_t>(buffer.size()),
+                  ::write(fd, buffer.data(), buffer.size()));
+    }
+
+    static void SendFds(int fd, const int * fds, size_t nfds) {
+        char payload = 0;
+        struct iovec iov;
+        iov.iov_base = &payload;
+        iov.iov_len = 1;
+        std::vector<char> aux(CMSG_SPACE(sizeof(int) * nfds), 0);
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = &aux[0];
+        msg.msg_controllen = aux.size();
+        struct cmsghdr * cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int) * nfds);
+        memcpy(CMSG_DATA(cmsg), fds, sizeof(int) * nfds);
+        ASSERT_EQ(1, ::sendmsg(fd, &msg, 0));
+    }
+
+    void run() {
+        while (!stopped) {
+            std::vector<struct pollfd> pfds(clients.size() + 1);
+            pfds[0].fd = listenFd;
+            pfds[0].events = POLLIN;
+
+            for (size_t i = 0; i < clients.size(); ++i) {
+                pfds[i + 1].fd = clients[i];
+                pfds[i + 1].events = POLLIN;
+            }
+
+            if (::poll(&pfds[0], pfds.size(), 20) <= 0) {
+                continue;
+            }
+
+            for (size_t i = clients.size(); i > 0; --i) {
+                if (pfds[i].revents && !handle(clients[i - 1])) {
+                    ::close(clients[i - 1]);
+                    clients.erase(clients.begin() + (i - 1));
+                }
+            }
+
+            if (pfds[0].revents & POLLIN) {
+                clients.push_back(::accept(listenFd, NULL, NULL));
+            }
+        }
+    }
+
+    bool handle(int fd) {
+        char header[3];
+
+        if (!ReadFully(fd, header, sizeof(header))) {
+            return false;
+        }
+
+        uint32_t size = 0;
+        char c;
+
+        for (int shift = 0;; shift += 7) {
+            if (!ReadFully(fd, &c, 1)) {
+                return false;
+            }
+
+            size |= static_cast<uint32_t>(c & 0x7F) << shift;
+
+            if (!(c & 0x80)) {
+                break;
+            }
+        }
+
+        std::vector<char> body(size + 1);
+
+        if (!ReadFully(fd, &body[0], size)) {
+            return false;
+        }
+
+        switch (header[2]) {
+        case 89: {
+            ShortCircuitShmRequestProto req;
+            EXPECT_TRUE(req.ParseFromArray(&body[0], size));
+            ++shmRequests;
+            ShortCircuitShmResponseProto resp;
+
+            if (!supportShm) {
+                resp.set_status(Status::DT_PROTO_ERROR_UNSUPPORTED);
+                WriteResponse(fd, resp);
+                return true;
+            }
+
+            if (failShm) {
+                resp.set_status(Status::DT_PROTO_ERROR);
+                resp.set_error("out of shared memory");
+                WriteResponse(fd, resp);
+                return true;
+            }
+
+            EXPECT_TRUE(shmBase == NULL);
+            shmFd = CreateTempFile(STUB_SHM_SIZE);
+            shmBase = static_cast<char *>(mmap(NULL, STUB_SHM_SIZE,
+                                               PROT_READ | PROT_WRITE, MAP_SHARED, shmFd, 0));
+            resp.set_status(Status::DT_PROTO_SUCCESS);
+            resp.mutable_id()->set_hi(1);
+            resp.mutable_id()->set_lo(2);
+            WriteResponse(fd, resp);
+            SendFds(fd, &shmFd, 1);
+            return true;
+        }
+
+        case 87: {
+            OpRequestShortCircuitAccessProto req;
+            EXPECT_TRUE(req.ParseFromArray(&body[0], size));
+            ++fdsRequests;
+            BlockOpResponseProto resp;
+            lastSlotIdx = -1;
+
+            if (req.has_slotid()) {
+                int32_t idx = req.slotid().slotidx();
+                uint64_t flags = __atomic_load_n(reinterpret_cast<uint64_t *>(
+                                                     shmBase + idx * ShortCircuitShm::SlotSize), __ATOMIC_SEQ_CST);
+                EXPECT_TRUE(flags & ShortCircuitShm::ValidFlag);
+                lastSlotIdx = idx;
+            }
+
+            resp.set_status(Status::DT_PROTO_SUCCESS);
+            WriteResponse(fd, resp);
+            int fds[] = {dataFd, metaFd};
+            SendFds(fd, fds, 2);
+            return true;
+        }
+
+        case 88: {
+            ReleaseShortCircuitAccessRequestProto req;
+            EXPECT_TRUE(req.ParseFromArray(&body[0], size));
+            ++releases;
+            ReleaseShortCircuitAccessResponseProto resp;
+            resp.set_status(Status::DT_PROTO_SUCCESS);
+            WriteResponse(fd, resp);
+            return true;
+        }
+
+        default:
+            ADD_FAILURE() << "unexpected op " << static_cast<int>(header[2]);
+            return false;
+        }
+    }
+
+private:
+    bool supportShm;
+    atomic<bool> stopped;
+    char * shmBase;
+    int dataFd;
+    int listenFd;
+    int metaFd;
+    int shmFd;
+    std::string path;
+    std::vector<int> clients;
+    thread worker;
+};
+
+static std::string StubPath(const char * name) {
+    char buffer[100];
+    snprintf(buffer, sizeof(buffer), "/tmp/libhdfs3-%s-%d.sock", name,
+             static_cast<int>(getpid()));
+    return buffer;
+}
+
+static ExtendedBlock MakeBlock(int64_t blockId) {
+    ExtendedBlock block;
+    block.setBlockId(blockId);
+    block.setPoolId("test-pool");
+    block.setNumBytes(4096);
+    return block;
+}
+
+TEST(TestShortCircuitShm, AllocAndFreeSlots) {
+    char name[] = "/tmp/libhdfs3-shm-test-XXXXXX";
+    int fd = mkstemp(name);
+    ASSERT_NE(-1, fd);
+    ::unlink(name);
+    ASSERT_EQ(0, ftruncate(fd, STUB_SHM_SIZE));
+    ShortCircuitShm shm(ShortCircuitShmId(1, 2), fd,
+                        shared_ptr<Socket>(new DomainSocketImpl));
+    ASSERT_EQ(STUB_SHM_SIZE / ShortCircuitShm::SlotSize, shm.getNumSlots());
+    EXPECT_TRUE(shm.isEmpty());
+
+    for (int32_t i = 0; i < shm.getNumSlots(); ++i) {
+        EXPECT_EQ(i, shm.allocSlot());
+        EXPECT_TRUE(shm.isSlotValid(i));
+        EXPECT_FALSE(shm.isSlotAnchorable(i));
+    }
+
+    EXPECT_TRUE(shm.isFull());
+    EXPECT_EQ(-1, shm.allocSlot());
+    shm.freeSlot(5);
+    EXPECT_FALSE(shm.isSlotValid(5));
+    EXPECT_EQ(5, shm.allocSlot());
+    shm.invalidateAll();
+    EXPECT_FALSE(shm.isSlotValid(0));
+    EXPECT_EQ("00000000000000010000000000000002", shm.getId().toString());
+}
+
+TEST(TestShortCircuitShm, ReuseFdsUntilRevoked) {
+    std::string path = StubPath("shm-revoke");
+    ShortCircuitDatanodeStub stub(path, true);
+    Config c;
+    SessionConfig conf(c);
+    conf.setDomainSocketPath(path);
+    DatanodeInfo dn;
+    ReadShortCircuitInfoBuilder builder(dn, RpcAuth(), conf, "test-client");
+    ExtendedBlock block = MakeBlock(330001);
+    shared_ptr<ReadShortCircuitInfo> info;
+
+    ASSERT_NO_THROW(info = builder.fetchOrCreate(block, Token()));
+    ASSERT_TRUE(info != NULL);
+    EXPECT_EQ(1, stub.shmRequests);
+    EXPECT_EQ(1, stub.fdsRequests);
+    ASSERT_NE(-1, stub.lastSlotIdx);
+    ASSERT_TRUE(info->getFdHolder()->slot != NULL);
+    EXPECT_TRUE(info->getFdHolder()->slot->isValid());
+    info.reset();
+
+    // the slot is still valid, the cached descriptors are reused.
+    ASSERT_NO_THROW(info = builder.fetchOrCreate(block, Token()));
+    EXPECT_EQ(1, stub.fdsRequests);
+    info.reset();
+
+    // once revoked, new descriptors are requested and the old slot released.
+    stub.revoke(stub.lastSlotIdx);
+    ASSERT_NO_THROW(info = builder.fetchOrCreate(block, Token()));
+    EXPECT_EQ(2, stub.fdsRequests);
+    EXPECT_EQ(1, stub.releases);
+    EXPECT_EQ(1, stub.shmRequests);
+    EXPECT_TRUE(info->getFdHolder()->slot->isValid());
+    EXPECT_EQ(1u, ShortCircuitShmManager::GetManager(path)->getNumSegments());
+    info.reset();
+}
+
+TEST(TestShortCircuitShm, FlushReleasesWithoutAlloc) {
+    std::string path = StubPath("shm-flush");
+    ShortCircuitDatanodeStub stub(path, true);
+    Config c;
+    SessionConfig conf(c);
+    conf.setDomainSocketPath(path);
+    shared_ptr<ShortCircuitSlot> slot;
+
+    ASSERT_NO_THROW(
+        slot = ShortCircuitShmManager::AllocSlot(path, "test-client", conf));
+    ASSERT_TRUE(slot != NULL);
+    slot->setRegistered(true);
+    slot.reset();
+    shared_ptr<ShortCircuitShmManager> manager =
+        ShortCircuitShmManager::GetManager(path);
+    EXPECT_EQ(1u, manager->getNumPendingReleases());
+    EXPECT_EQ(0, stub.releases);
+
+    // an idle client gives the slot back when it is closed.
+    ASSERT_NO_THROW(ShortCircuitShmManager::FlushAll(conf));
+    EXPECT_EQ(1, stub.releases);
+    EXPECT_EQ(0u, manager->getNumPendingReleases());
+    EXPECT_TRUE(manager->segments[0]->isEmpty());
+}
+
+TEST(TestShortCircuitShm, FallbackWithoutShm) {
+    std::string path = StubPath("shm-unsupported");
+    ShortCircuitDatanodeStub stub(path, false);
+    Config c;
+    SessionConfig conf(c);
+    conf.setDomainSocketPath(path);
+    DatanodeInfo dn;
+    ReadShortCircuitInfoBuilder builder(dn, RpcAuth(), conf, "test-client");
+    shared_ptr<ReadShortCircuitInfo> info;
+
+    ASSERT_NO_THROW(info = builder.fetchOrCreate(MakeBlock(330002), Token()));
+    ASSERT_TRUE(info != NULL);
+    EXPECT_TRUE(info->getFdHolder()->slot == NULL);
+    EXPECT_EQ(-1, stub.lastSlotIdx);
+    EXPECT_TRUE(ShortCircuitShmManager::GetManager(path)->isDisabled());
+    info.reset();
+
+    // the datanode is not asked for a segment again.
+    ASSERT_NO_THROW(info = builder.fetchOrCreate(MakeBlock(330003), Token()));
+    EXPECT_EQ(1, stub.shmRequests);
+    EXPECT_EQ(2, stub.fdsRequests);
+    info.reset();
+}
+
+TEST(TestShortCircuitShm, BackoffAfterSegmentFailure) {
+    std::string path = StubPath("shm-failure");
+    ShortCircuitDatanodeStub stub(path, true);
+    stub.failShm = true;
+    Config c;
+    SessionConfig conf(c);
+    conf.setDomainSocketPath(path);
+    DatanodeInfo dn;
+    ReadShortCircuitInfoBuilder builder(dn, RpcAuth(), conf, "test-client");
+    shared_ptr<ReadShortCircuitInfo> info;
+
+    ASSERT_NO_THROW(info = builder.fetchOrCreate(MakeBlock(330004), Token()));
+    ASSERT_TRUE(info != NULL);
+    EXPECT_TRUE(info->getFdHolder()->slot == NULL);
+    EXPECT_FALSE(ShortCircuitShmManager::GetManager(path)->isDisabled());
+    info.reset();
+
+    // the failure is remembered, the next block does not ask again.
+    ASSERT_NO_THROW(info = builder.fetchOrCreate(MakeBlock(330005), Token()));
+    EXPECT_TRUE(info->getFdHolder()->slot == NULL);
+    EXPECT_EQ(1, stub.shmRequests);
+    info.reset();
+
+    // once the interval is over, a segment is requested again.
+    stub.failShm = false;
+    ShortCircuitShmManager::GetManager(path)->retryTime = steady_clock::now();
+    ASSERT_NO_THROW(info = builder.fetchOrCreate(MakeBlock(330006), Token()));
+    EXPECT_EQ(2, stub.shmRequests);
+    ASSERT_TRUE(info->getFdHolder()->slot != NULL);
+    info.reset();
+}
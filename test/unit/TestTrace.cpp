@@ -0,0 +1,148 @@
+/********************************************************************
+ * Copyright (c) 2013 - 2014, Pivotal Inc.
+ * All rights reserved.
+ *
+ * Author: Zhanwei Wang
+ ********************************************************************/
+/********************************************************************
+ * 2014 -
+ * open source under Apache License Version 2.0
+ ********************************************************************/
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "gtest/gtest.h"
+
+#include "Trace.h"
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace Hdfs::Internal;
+
+class TestTrace: public ::testing::Test {
+public:
+    virtual void SetUp() {
+        buffer = shared_ptr<TraceRingBuffer>(new TraceRingBuffer(16));
+        Tracer::SetSink(buffer);
+        Tracer::SetSampleRate(1);
+    }
+
+    virtual void TearDown() {
+        Tracer::SetSink(shared_ptr<TraceSink>());
+        Tracer::SetSampleRate(0);
+    }
+
+protected:
+    shared_ptr<TraceRingBuffer> buffer;
+};
+
+TEST_F(TestTrace, Disabled) {
+    Tracer::SetSampleRate(0);
+    EXPECT_FALSE(Tracer::IsEnabled());
+    {
+        TraceSpan span("disabled");
+        EXPECT_FALSE(span.isSampled());
+    }
+    Tracer::SetSampleRate(1);
+    Tracer::SetSink(shared_ptr<TraceSink>());
+    EXPECT_FALSE(Tracer::IsEnabled());
+    {
+        TraceSpan span("disabled");
+        EXPECT_FALSE(span.isSampled());
+    }
+    EXPECT_TRUE(buffer->getRecords().empty());
+}
+
+TEST_F(TestTrace, ParentAndChild) {
+    {
+        TraceSpan root("root");
+        TRACE_DETAIL(root, "offset=%d", 42);
+        {
+            TraceSpan child("child");
+            TraceSpan grandchild("grandchild");
+        }
+        TraceSpan sibling("sibling");
+    }
+    {
+        TraceSpan other("other");
+    }
+    std::vector<TraceRecord> records = buffer->getRecords();
+    ASSERT_EQ(5u, records.size());
+    EXPECT_STREQ("grandchild", records[0].name);
+    EXPECT_STREQ("child", records[1].name);
+    EXPECT_STREQ("sibling", records[2].name);
+    EXPECT_STREQ("root", records[3].name);
+    EXPECT_STREQ("other", records[4].name);
+    const TraceRecord & root = records[3];
+    EXPECT_EQ(0u, root.parentId);
+    EXPECT_EQ(root.spanId, root.traceId);
+    EXPECT_STREQ("offset=42", root.detail);
+    EXPECT_EQ(records[1].spanId, records[0].parentId);
+    EXPECT_EQ(root.spanId, records[1].parentId);
+    EXPECT_EQ(root.spanId, records[2].parentId);
+
+    for (int i = 0; i < 3; ++i) {
+        EXPECT_EQ(root.traceId, records[i].traceId);
+        EXPECT_EQ(root.threadId, records[i].threadId);
+        EXPECT_GE(records[i].start, root.start);
+        EXPECT_LE(records[i].duration, root.duration);
+    }
+
+    EXPECT_NE(root.traceId, records[4].traceId);
+    EXPECT_EQ(0u, records[4].parentId);
+}
+
+TEST_F(TestTrace, UnsampledRootSuppressesChildren) {
+    Tracer::SetSampleRate(0.000001);
+    int sampled = 0;
+
+    for (int i = 0; i < 100; ++i) {
+        TraceSpan root("root");
+        TraceSpan child("child");
+        EXPECT_EQ(root.isSampled(), child.isSampled());
+        sampled += root.isSampled() ? 1 : 0;
+    }
+
+    EXPECT_EQ(static_cast<size_t>(sampled * 2), buffer->getRecords().size());
+    EXPECT_LT(sampled, 10);
+}
+
+TEST_F(TestTrace, RingBufferKeepsLatest) {
+    for (int i = 0; i < 20; ++i) {
+        TraceSpan span("span");
+        TRACE_DETAIL(span, "%d", i);
+    }
+
+    std::vector<TraceRecord> records = buffer->getRecords();
+    ASSERT_EQ(16u, records.size());
+    EXPECT_STREQ("4", records[0].detail);
+    EXPECT_STREQ("19", records[15].detail);
+}
+
+TEST_F(TestTrace, ChromeTrace) {
+    EXPECT_EQ("{\"traceEvents\":[],\"displayTimeUnit\":\"ms\"}",
+              buffer->toChromeTrace());
+    {
+        TraceSpan span("InputStream::read");
+        TRACE_DETAIL(span, "path=\"/a\"");
+    }
+    std::string json = buffer->toChromeTrace();
+    EXPECT_EQ(0u, json.find("{\"traceEvents\":[{\"name\":\"InputStream::read\",\"cat\":\"hdfs\",\"ph\":\"X\",\"ts\":"));
+    EXPECT_NE(std::string::npos, json.find("\"parent_id\":0,\"detail\":\"path=\\\"/a\\\"\"}}]"));
+}
@@ -0,0 +1,209 @@
+/********************************************************************
+ * Copyright (c) 2013 - 2014, Pivotal Inc.
+ * All rights reserved.
+ *
+ * Author: Zhanwei Wang
+ ********************************************************************/
+/********************************************************************
+ * 2014 -
+ * open source under Apache License Version 2.0
+ ********************************************************************/
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "gtest/gtest.h"
+
+#include "BigEndian.h"
+#include "client/LocalBlockReader.h"
+#include "client/VerifiedChunkCache.h"
+#include "common/Metrics.h"
+#include "datatransfer.pb.h"
+#include "SWCrc32c.h"
+#include "XmlConfig.h"
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <vector>
+
+using namespace Hdfs;
+using namespace Hdfs::Internal;
+
+#define CHUNK_SIZE 512
+
+TEST(TestVerifiedChunkCache, Ranges) {
+    VerifiedChunkCache cache;
+    ReadShortCircuitInfoKey key(50010, 1, "pool");
+    VerifiedReplica replica(1001, 1, 2);
+    cache.setMaxSize(16);
+    EXPECT_TRUE(cache.isEnabled());
+    EXPECT_FALSE(cache.isVerified(key, replica, 0, 512));
+    cache.addVerified(key, replica, 0, 1024);
+    cache.addVerified(key, replica, 2048, 4096);
+    EXPECT_TRUE(cache.isVerified(key, replica, 0, 1024));
+    EXPECT_TRUE(cache.isVerified(key, replica, 512, 1024));
+    EXPECT_FALSE(cache.isVerified(key, replica, 512, 2560));
+    EXPECT_TRUE(cache.isVerified(key, replica, 2048, 3072));
+    // filling the hole merges the ranges.
+    cache.addVerified(key, replica, 1024, 2048);
+    EXPECT_TRUE(cache.isVerified(key, replica, 0, 4096));
+    EXPECT_FALSE(cache.isVerified(key, replica, 0, 4097));
+    // another generation stamp or meta file is another replica.
+    EXPECT_FALSE(cache.isVerified(key, VerifiedReplica(1002, 1, 2), 0, 512));
+    EXPECT_FALSE(cache.isVerified(key, VerifiedReplica(1001, 1, 3), 0, 512));
+    cache.addVerified(key, VerifiedReplica(1002, 1, 2), 0, 512);
+    EXPECT_FALSE(cache.isVerified(key, replica, 0, 512));
+    EXPECT_TRUE(cache.isVerified(key, VerifiedReplica(1002, 1, 2), 0, 512));
+    cache.invalidate(key);
+    EXPECT_FALSE(cache.isVerified(key, VerifiedReplica(1002, 1, 2), 0, 512));
+    cache.setMaxSize(0);
+    EXPECT_FALSE(cache.isEnabled());
+    cache.addVerified(key, replica, 0, 512);
+    EXPECT_FALSE(cache.isVerified(key, replica, 0, 512));
+}
+
+TEST(TestVerifiedChunkCache, ConfigureKeepsLargestSize) {
+    VerifiedChunkCache cache;
+    EXPECT_FALSE(cache.isEnabled());
+    cache.configure(16);
+    EXPECT_TRUE(cache.isEnabled());
+    cache.configure(0);
+    EXPECT_TRUE(cache.isEnabled());
+    EXPECT_EQ(16, cache.maxSize);
+}
+
+TEST(TestVerifiedChunkCache, Stats) {
+    VerifiedChunkCache cache;
+    cache.recordVerified(1000, 2000);
+    cache.recordSkipped(3000);
+    VerifiedChunkCacheStats stats = cache.getStats();
+    EXPECT_EQ(1000, stats.verifiedBytes);
+    EXPECT_EQ(2000, stats.verifyNanos);
+    EXPECT_EQ(3000, stats.skippedBytes);
+    EXPECT_EQ(6000, stats.savedNanos);
+}
+
+class TestLocalBlockReaderVerifiedCache: public ::testing::Test {
+public:
+    void SetUp() {
+        data.resize(10 * CHUNK_SIZE + 100);
+
+        for (size_t i = 0; i < data.size(); ++i) {
+            data[i] = static_cast<char>(rand());
+        }
+
+        std::vector<char> meta(7);
+        WriteBigEndian16ToArray(1, &meta[0]);
+        meta[2] = ChecksumTypeProto::CHECKSUM_CRC32C;
+        WriteBigEndian32ToArray(CHUNK_SIZE, &meta[3]);
+
+        for (size_t i = 0; i < data.size(); i += CHUNK_SIZE) {
+            SWCrc32c crc;
+            crc.update(&data[i], std::min<size_t>(CHUNK_SIZE, data.size() - i));
+            meta.resize(meta.size() + 4);
+            WriteBigEndian32ToArray(crc.getValue(), &meta[meta.size() - 4]);
+        }
+
+        dataPath = WriteTempFile(data);
+        metaPath = WriteTempFile(meta);
+        block.setBlockId(350001);
+        block.setGenerationStamp(1001);
+        block.setPoolId("pool");
+        block.setNumBytes(data.size());
+    }
+
+    void TearDown() {
+        ::unlink(dataPath.c_str());
+        ::unlink(metaPath.c_str());
+    }
+
+    static std::string WriteTempFile(const std::vector<char> & content) {
+        char name[] = "/tmp/libhdfs3-verified-test-XXXXXX";
+        int fd = mkstemp(name);
+        EXPECT_NE(-1, fd);
+        EXPECT_EQ(static_cast<ssize_t>(content.size()),
+                  ::write(fd, &content[0], content.size()));
+        ::close(fd);
+        return name;
+    }
+
+    shared_ptr<ReadShortCircuitInfo> open() {
+        shared_ptr<ReadShortCircuitInfo> info(new ReadShortCircuitInfo(
+                ReadShortCircuitInfoKey(50010, block.getBlockId(), block.getPoolId()), true));
+        shared_ptr<FileWrapper> dataFile(new PreadFileWrapper(true, 0, false, false));
+        shared_ptr<FileWrapper> metaFile(new PreadFileWrapper(true, 0, false, false));
+        EXPECT_TRUE(dataFile->open(dataPath));
+        EXPECT_TRUE(metaFile->open(metaPath));
+        info->setDataFile(dataFile);
+        info->setMetaFile(metaFile);
+        info->setMetaIdentity(1, 2);
+        return info;
+    }
+
+    void readAll(SessionConfig & conf, int64_t offset) {
+        std::vector<char> buffer, result(data.size() - offset);
+        LocalBlockReader reader(open(), block, offset, true, conf, buffer);
+        size_t done = 0;
+
+        while (done < result.size()) {
+            int32_t rc = reader.read(&result[done], result.size() - done);
+            ASSERT_GT(rc, 0);
+            done += rc;
+        }
+
+        EXPECT_EQ(0, memcmp(&result[0], &data[offset], result.size()));
+    }
+
+protected:
+    ExtendedBlock block;
+    std::string dataPath;
+    std::string metaPath;
+    std::vector<char> data;
+};
+
+TEST_F(TestLocalBlockReaderVerifiedCache, SkipVerifiedChunks) {
+    Config c;
+    SessionConfig conf(c);
+    conf.setLocalReadBufferSize(2 * CHUNK_SIZE);
+    VerifiedChunkCache & cache = ReadShortCircuitInfoBuilder::GetVerifiedChunkCache();
+    cache.setMaxSize(16);
+    VerifiedChunkCacheStats before = cache.getStats();
+    Counter & skipped = MetricsRegistry::GetMetricsRegistry().counter(
+                            "hdfs_client_checksum_skipped_bytes_total", "");
+    int64_t skippedBefore = skipped.get();
+
+    readAll(conf, 0);
+    VerifiedChunkCacheStats stats = cache.getStats();
+    EXPECT_EQ(static_cast<int64_t>(data.size()), stats.verifiedBytes - before.verifiedBytes);
+    EXPECT_EQ(0, stats.skippedBytes - before.skippedBytes);
+
+    // a second reader, starting in the middle of a chunk, skips all of them.
+    readAll(conf, CHUNK_SIZE + 10);
+    before = stats;
+    stats = cache.getStats();
+    EXPECT_EQ(0, stats.verifiedBytes - before.verifiedBytes);
+    EXPECT_EQ(static_cast<int64_t>(data.size() - CHUNK_SIZE), stats.skippedBytes - before.skippedBytes);
+    EXPECT_EQ(stats.skippedBytes - before.skippedBytes, skipped.get() - skippedBefore);
+
+    // invalidating the replica forgets the verified chunks.
+    open()->setValid(false);
+    readAll(conf, 0);
+    before = stats;
+    stats = cache.getStats();
+    EXPECT_EQ(static_cast<int64_t>(data.size()), stats.verifiedBytes - before.verifiedBytes);
+    cache.setMaxSize(0);
+}
@@ -354,6 +354,7 @@ TEST_F(TestOutputStream, append_Success) {
     EXPECT_CALL(*pipelineStub, close(_)).Times(2).WillOnce(Return(lastBlock)).WillOnce(Return(lastBlock));
     EXPECT_CALL(*fs, fsync(_)).Times(2);
     EXPECT_NO_THROW(ous.append(buffer, sizeof(buffer)));
+    EXPECT_EQ(static_cast<int64_t>(sizeof(buffer)), ous.getStatistics().getBytesWritten());
     EXPECT_CALL(*pipelineStub, close(_)).Times(1).WillOnce(Return(lastBlock));
     EXPECT_CALL(*fs, fsync(_)).Times(1);
     EXPECT_CALL(*fs, complete(_, _)).Times(1).WillOnce(Return(true));